@@ -0,0 +1,71 @@
+#include "AllocationCounter.h"
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace
+{
+	std::atomic<uint64_t> allocationCount = 0;
+	std::atomic<uint64_t> allocationBytes = 0;
+
+	void* CountedAllocate(size_t a_size)
+	{
+		allocationCount.fetch_add(1, std::memory_order_relaxed);
+		allocationBytes.fetch_add(a_size, std::memory_order_relaxed);
+		return std::malloc(a_size == 0 ? 1 : a_size);
+	}
+}
+
+uint64_t AllocationCounter::GetCount()
+{
+	return allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::GetBytes()
+{
+	return allocationBytes.load(std::memory_order_relaxed);
+}
+
+void* operator new(size_t a_size)
+{
+	void* memory = CountedAllocate(a_size);
+	if (memory == nullptr) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t a_size)
+{
+	void* memory = CountedAllocate(a_size);
+	if (memory == nullptr) throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t a_size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(a_size);
+}
+
+void* operator new[](size_t a_size, const std::nothrow_t&) noexcept
+{
+	return CountedAllocate(a_size);
+}
+
+void operator delete(void* a_pMemory) noexcept
+{
+	std::free(a_pMemory);
+}
+
+void operator delete[](void* a_pMemory) noexcept
+{
+	std::free(a_pMemory);
+}
+
+void operator delete(void* a_pMemory, size_t) noexcept
+{
+	std::free(a_pMemory);
+}
+
+void operator delete[](void* a_pMemory, size_t) noexcept
+{
+	std::free(a_pMemory);
+}
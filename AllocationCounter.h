@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// Counts heap allocations made through global operator new, the
+/// replacement operators live in AllocationCounter.cpp.
+/// Take the difference of two reads to get allocations over a span, e.g. a frame.
+/// </summary>
+namespace AllocationCounter
+{
+	uint64_t GetCount();
+	uint64_t GetBytes();
+}
@@ -0,0 +1,113 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <array>
+
+/// <summary>
+/// Axis aligned box in center/extents form with an enclosing sphere radius.
+/// Meshes store their local bounds, entities transform them into the
+/// camera-relative space the renderer works in.
+/// </summary>
+struct Bounds
+{
+	DirectX::XMFLOAT3 m_center = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 m_extents = { 0.0f, 0.0f, 0.0f };
+	float m_radius = 0.0f;
+
+	static Bounds FromMinMax(const DirectX::XMFLOAT3& a_min, const DirectX::XMFLOAT3& a_max)
+	{
+		Bounds bounds;
+		bounds.m_center = DirectX::XMFLOAT3(
+			(a_min.x + a_max.x) * 0.5f,
+			(a_min.y + a_max.y) * 0.5f,
+			(a_min.z + a_max.z) * 0.5f);
+		bounds.m_extents = DirectX::XMFLOAT3(
+			(a_max.x - a_min.x) * 0.5f,
+			(a_max.y - a_min.y) * 0.5f,
+			(a_max.z - a_min.z) * 0.5f);
+		bounds.UpdateRadius();
+		return bounds;
+	}
+
+	void UpdateRadius()
+	{
+		m_radius = std::sqrt(m_extents.x * m_extents.x + m_extents.y * m_extents.y + m_extents.z * m_extents.z);
+	}
+
+	/// <summary>
+	/// Box enclosing these bounds after a_matrix is applied (row vector convention)
+	/// </summary>
+	Bounds Transformed(const DirectX::XMFLOAT4X4& a_matrix) const
+	{
+		Bounds bounds;
+		DirectX::XMStoreFloat3(&bounds.m_center,
+			DirectX::XMVector3TransformCoord(DirectX::XMLoadFloat3(&m_center), DirectX::XMLoadFloat4x4(&a_matrix)));
+
+		//each world axis picks up the absolute contribution of every local axis
+		const DirectX::XMFLOAT4X4& m = a_matrix;
+		bounds.m_extents.x = std::fabs(m._11) * m_extents.x + std::fabs(m._21) * m_extents.y + std::fabs(m._31) * m_extents.z;
+		bounds.m_extents.y = std::fabs(m._12) * m_extents.x + std::fabs(m._22) * m_extents.y + std::fabs(m._32) * m_extents.z;
+		bounds.m_extents.z = std::fabs(m._13) * m_extents.x + std::fabs(m._23) * m_extents.y + std::fabs(m._33) * m_extents.z;
+		bounds.UpdateRadius();
+		return bounds;
+	}
+};
+
+/// <summary>
+/// Structure of arrays copy of many Bounds, padded to a multiple of 4 so
+/// batches can be loaded straight into SIMD registers
+/// </summary>
+struct BoundsSoA
+{
+	std::vector<float> m_centerX;
+	std::vector<float> m_centerY;
+	std::vector<float> m_centerZ;
+	std::vector<float> m_extentX;
+	std::vector<float> m_extentY;
+	std::vector<float> m_extentZ;
+	std::vector<float> m_radius;
+
+	void Clear()
+	{
+		m_count = 0;
+		Resize(0);
+	}
+
+	void Reserve(size_t a_count)
+	{
+		size_t padded = (a_count + 3) & ~size_t(3);
+		for (std::vector<float>* lane : Lanes()) lane->reserve(padded);
+	}
+
+	void Add(const Bounds& a_bounds)
+	{
+		size_t index = m_count++;
+		Resize(m_count);
+		m_centerX[index] = a_bounds.m_center.x;
+		m_centerY[index] = a_bounds.m_center.y;
+		m_centerZ[index] = a_bounds.m_center.z;
+		m_extentX[index] = a_bounds.m_extents.x;
+		m_extentY[index] = a_bounds.m_extents.y;
+		m_extentZ[index] = a_bounds.m_extents.z;
+		m_radius[index] = a_bounds.m_radius;
+	}
+
+	size_t Size() const { return m_count; }
+
+private:
+	size_t m_count = 0;
+
+	std::array<std::vector<float>*, 7> Lanes()
+	{
+		return { &m_centerX, &m_centerY, &m_centerZ, &m_extentX, &m_extentY, &m_extentZ, &m_radius };
+	}
+
+	void Resize(size_t a_count)
+	{
+		//padding lanes are zero sized boxes, the culler ignores anything past m_count
+		size_t padded = (a_count + 3) & ~size_t(3);
+		for (std::vector<float>* lane : Lanes()) lane->resize(padded, 0.0f);
+	}
+};
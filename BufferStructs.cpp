@@ -3,23 +3,76 @@
 VertexShaderConstantBuffer::VertexShaderConstantBuffer()
 {
 	//Identity transform matrix
+	DirectX::XMStoreFloat4x4(&m_worldViewProjectionMatrix, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&m_worldMatrix, DirectX::XMMatrixIdentity());
-	DirectX::XMStoreFloat4x4(&m_projectionMatrix, DirectX::XMMatrixIdentity());
-	DirectX::XMStoreFloat4x4(&m_viewMatrix, DirectX::XMMatrixIdentity());
 	DirectX::XMStoreFloat4x4(&m_worldInverseTranspose, DirectX::XMMatrixIdentity());
+	m_irradianceIndex = 0;
+	m_padding = { 0.0f, 0.0f, 0.0f };
 	// white tint, original color shown
 }
 
+InstanceData::InstanceData()
+{
+	DirectX::XMStoreFloat4x4(&m_worldMatrix, DirectX::XMMatrixIdentity());
+	DirectX::XMStoreFloat4x4(&m_worldInverseTranspose, DirectX::XMMatrixIdentity());
+	m_irradianceIndex = 0;
+	m_padding = { 0.0f, 0.0f, 0.0f };
+}
+
+InstanceBatchConstantBuffer::InstanceBatchConstantBuffer()
+{
+	m_firstInstance = 0;
+	m_padding = { 0.0f, 0.0f, 0.0f };
+}
+
+PerFrameConstantBuffer::PerFrameConstantBuffer()
+{
+	DirectX::XMStoreFloat4x4(&m_viewMatrix, DirectX::XMMatrixIdentity());
+	DirectX::XMStoreFloat4x4(&m_projectionMatrix, DirectX::XMMatrixIdentity());
+	DirectX::XMStoreFloat4x4(&m_viewProjectionMatrix, DirectX::XMMatrixIdentity());
+	m_cameraPosition = { 0.0f, 0.0f, 0.0f };
+	m_lightCount = 0;
+	m_clusterCounts = { 1, 1, 1 };
+	m_directionalLightCount = 0;
+	m_clusterTileScale = { 0.0f, 0.0f };
+	m_clusterSliceScale = 0.0f;
+	m_clusterSliceBias = 0.0f;
+}
+
+ShadowConstantBuffer::ShadowConstantBuffer()
+{
+	for (DirectX::XMFLOAT4X4& viewProjection : m_cascadeViewProjection) {
+		DirectX::XMStoreFloat4x4(&viewProjection, DirectX::XMMatrixIdentity());
+	}
+	for (float& depth : m_cascadeFarDepths) {
+		depth = 0.0f;
+	}
+	m_texelSize = { 0.0f, 0.0f };
+	m_cascadeCount = 0;
+	m_enabled = 0;
+}
+
+DeferredConstantBuffer::DeferredConstantBuffer()
+{
+	DirectX::XMStoreFloat4x4(&m_inverseViewProjection, DirectX::XMMatrixIdentity());
+	m_projectionX = 1.0f;
+	m_projectionY = 1.0f;
+	m_depthScale = 1.0f;
+	m_depthBias = 0.0f;
+	m_tileCounts = { 0, 0 };
+	m_screenSize = { 0, 0 };
+	m_orthographic = 0;
+	m_padding = { 0.0f, 0.0f, 0.0f };
+}
+
 PSConstantBuffer::PSConstantBuffer()
 {
 	m_colorTint = { 1.0f, 1.0f, 1.0f, 1.0f }; //white;
 	m_scale = { 1, 1 };
 	m_offset = { 0, 0 };
 	m_timeElapsedMs = 0;
-	m_cameraPosition = { 0.0f, 0.0f, 0.0f };
-	for (int i = 0; i < 5; i++) {
-		m_lights[i] = Light{};
-	}
+	m_materialIndex = 0;
+	m_padding = { 0.0f, 0.0f };
 }
 
 SkyVSConstantBuffer::SkyVSConstantBuffer()
@@ -3,27 +3,103 @@
 #include "Light.h"
 #include <array>
 
+//per object, b0
 struct VertexShaderConstantBuffer
 {
+	DirectX::XMFLOAT4X4 m_worldViewProjectionMatrix;
 	DirectX::XMFLOAT4X4 m_worldMatrix;
-	DirectX::XMFLOAT4X4 m_projectionMatrix;
-	DirectX::XMFLOAT4X4 m_viewMatrix;
 	DirectX::XMFLOAT4X4 m_worldInverseTranspose;
+	unsigned int m_irradianceIndex; // element of the object irradiance buffer, see ProbeGrid
+	DirectX::XMFLOAT3 m_padding; // 16
 
 	VertexShaderConstantBuffer();
 };
 
+//one element of the instanced vertex shader's structured buffer, t0
+struct InstanceData
+{
+	DirectX::XMFLOAT4X4 m_worldMatrix;
+	DirectX::XMFLOAT4X4 m_worldInverseTranspose;
+	unsigned int m_irradianceIndex;
+	DirectX::XMFLOAT3 m_padding; // 16
+
+	InstanceData();
+};
+
+//per instanced draw, b0 of the instanced vertex shader
+struct InstanceBatchConstantBuffer
+{
+	unsigned int m_firstInstance;
+	DirectX::XMFLOAT3 m_padding; // 16
+
+	InstanceBatchConstantBuffer();
+};
+
+//per frame, b1, bound once for both VS and PS
+struct PerFrameConstantBuffer
+{
+	DirectX::XMFLOAT4X4 m_viewMatrix;
+	DirectX::XMFLOAT4X4 m_projectionMatrix;
+	DirectX::XMFLOAT4X4 m_viewProjectionMatrix;
+	DirectX::XMFLOAT3 m_cameraPosition;
+	unsigned int m_lightCount; // 16, lights are in the structured buffer at LIGHT_BUFFER_SLOT
+	DirectX::XMUINT3 m_clusterCounts;
+	unsigned int m_directionalLightCount; // 16, directional lights come first and skip the clusters
+	DirectX::XMFLOAT2 m_clusterTileScale;
+	float m_clusterSliceScale;
+	float m_clusterSliceBias; // 16, pixel to cluster, see LightClusters
+
+	PerFrameConstantBuffer();
+};
+
+//per frame, b2 of the pixel shader, cascade matrices of the first directional light
+struct ShadowConstantBuffer
+{
+	DirectX::XMFLOAT4X4 m_cascadeViewProjection[4];
+	float m_cascadeFarDepths[4]; // 16, view depth each cascade ends at, a float4 in the shader
+	DirectX::XMFLOAT2 m_texelSize;
+	unsigned int m_cascadeCount;
+	unsigned int m_enabled; // 16
+
+	ShadowConstantBuffer();
+};
+
+//per frame, b0 of DeferredLightingCS.hlsl, depth to view and world space plus the tile grid
+struct DeferredConstantBuffer
+{
+	DirectX::XMFLOAT4X4 m_inverseViewProjection;
+	float m_projectionX;
+	float m_projectionY; // _11 and _22 of the projection
+	float m_depthScale;
+	float m_depthBias; // 16, _33 and _43 of the projection
+	DirectX::XMUINT2 m_tileCounts;
+	DirectX::XMUINT2 m_screenSize; // 16
+	unsigned int m_orthographic;
+	DirectX::XMFLOAT3 m_padding; // 16
+
+	DeferredConstantBuffer();
+};
+
+//per object, b0, camera and lights are per frame
 struct PSConstantBuffer {
 	DirectX::XMFLOAT4 m_colorTint; // 16
 	DirectX::XMFLOAT2 m_scale;
 	DirectX::XMFLOAT2 m_offset; // 16
-	DirectX::XMFLOAT3 m_cameraPosition;
-	float m_timeElapsedMs; // 16
-	std::array<Light, 5> m_lights;
+	float m_timeElapsedMs;
+	unsigned int m_materialIndex;
+	DirectX::XMFLOAT2 m_padding; // 16
 
 	PSConstantBuffer();
 };
 
+//one element of the material table, t4 of the pixel shader
+struct MaterialConstants
+{
+	DirectX::XMFLOAT4 m_colorTint; // 16
+	DirectX::XMFLOAT2 m_scale;
+	DirectX::XMFLOAT2 m_offset; // 16
+};
+
 struct SkyVSConstantBuffer {
 	DirectX::XMFLOAT4X4 m_projectionMatrix;
 	DirectX::XMFLOAT4X4 m_viewMatrix;
@@ -0,0 +1,463 @@
+#include "Bvh.h"
+#include <algorithm>
+#include <future>
+#include <numeric>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	const uint32_t NO_PARENT = 0xFFFFFFFF;
+	const int BIN_COUNT = 16;
+
+	//subtrees bigger than this are handed to another thread
+	const uint32_t PARALLEL_BUILD_THRESHOLD = 16384;
+	const int MAX_PARALLEL_DEPTH = 4;
+
+	//trees with fewer objects refit on the calling thread
+	const size_t PARALLEL_REFIT_THRESHOLD = 4096;
+
+	float Component(const XMFLOAT3& a_vector, int a_axis)
+	{
+		return a_axis == 0 ? a_vector.x : (a_axis == 1 ? a_vector.y : a_vector.z);
+	}
+
+	void Grow(XMFLOAT3& a_min, XMFLOAT3& a_max, const XMFLOAT3& a_otherMin, const XMFLOAT3& a_otherMax)
+	{
+		a_min.x = (std::min)(a_min.x, a_otherMin.x);
+		a_min.y = (std::min)(a_min.y, a_otherMin.y);
+		a_min.z = (std::min)(a_min.z, a_otherMin.z);
+		a_max.x = (std::max)(a_max.x, a_otherMax.x);
+		a_max.y = (std::max)(a_max.y, a_otherMax.y);
+		a_max.z = (std::max)(a_max.z, a_otherMax.z);
+	}
+
+	float HalfSurfaceArea(const XMFLOAT3& a_min, const XMFLOAT3& a_max)
+	{
+		float x = a_max.x - a_min.x;
+		float y = a_max.y - a_min.y;
+		float z = a_max.z - a_min.z;
+		if (x < 0.0f || y < 0.0f || z < 0.0f) return 0.0f;
+		return x * y + y * z + z * x;
+	}
+
+	enum class PlaneTest { OUTSIDE, INSIDE, INTERSECTING };
+
+	PlaneTest TestBoxPlane(const XMFLOAT4& a_plane, const XMFLOAT3& a_min, const XMFLOAT3& a_max)
+	{
+		XMFLOAT3 center((a_min.x + a_max.x) * 0.5f, (a_min.y + a_max.y) * 0.5f, (a_min.z + a_max.z) * 0.5f);
+		XMFLOAT3 extents(a_max.x - center.x, a_max.y - center.y, a_max.z - center.z);
+		float distance = a_plane.x * center.x + a_plane.y * center.y + a_plane.z * center.z + a_plane.w;
+		float radius = std::fabs(a_plane.x) * extents.x + std::fabs(a_plane.y) * extents.y + std::fabs(a_plane.z) * extents.z;
+		if (distance + radius < 0.0f) return PlaneTest::OUTSIDE;
+		if (distance - radius >= 0.0f) return PlaneTest::INSIDE;
+		return PlaneTest::INTERSECTING;
+	}
+
+	bool BoxOverlapsSphere(const XMFLOAT3& a_min, const XMFLOAT3& a_max, const XMFLOAT3& a_center, float a_radius)
+	{
+		float x = std::clamp(a_center.x, a_min.x, a_max.x) - a_center.x;
+		float y = std::clamp(a_center.y, a_min.y, a_max.y) - a_center.y;
+		float z = std::clamp(a_center.z, a_min.z, a_max.z) - a_center.z;
+		return x * x + y * y + z * z <= a_radius * a_radius;
+	}
+
+	/// <summary>
+	/// Slab test, returns the entry distance or FLT_MAX on a miss
+	/// </summary>
+	float IntersectRayBox(const XMFLOAT3& a_origin, const XMFLOAT3& a_inverseDirection, float a_maxDistance,
+		const XMFLOAT3& a_min, const XMFLOAT3& a_max)
+	{
+		float x1 = (a_min.x - a_origin.x) * a_inverseDirection.x;
+		float x2 = (a_max.x - a_origin.x) * a_inverseDirection.x;
+		float y1 = (a_min.y - a_origin.y) * a_inverseDirection.y;
+		float y2 = (a_max.y - a_origin.y) * a_inverseDirection.y;
+		float z1 = (a_min.z - a_origin.z) * a_inverseDirection.z;
+		float z2 = (a_max.z - a_origin.z) * a_inverseDirection.z;
+
+		float entry = (std::max)((std::max)((std::min)(x1, x2), (std::min)(y1, y2)), (std::min)(z1, z2));
+		float exit = (std::min)((std::min)((std::max)(x1, x2), (std::max)(y1, y2)), (std::max)(z1, z2));
+
+		if (exit < 0.0f || entry > exit || entry > a_maxDistance) return FLT_MAX;
+		return (std::max)(entry, 0.0f);
+	}
+}
+
+void Bvh::SetObjectBounds(uint32_t a_objectIndex, const Bounds& a_bounds)
+{
+	const XMFLOAT3& c = a_bounds.m_center;
+	const XMFLOAT3& e = a_bounds.m_extents;
+	m_objectMin[a_objectIndex] = XMFLOAT3(c.x - e.x, c.y - e.y, c.z - e.z);
+	m_objectMax[a_objectIndex] = XMFLOAT3(c.x + e.x, c.y + e.y, c.z + e.z);
+	m_centroids[a_objectIndex] = c;
+}
+
+void Bvh::Build(const std::vector<Bounds>& a_bounds, uint32_t a_maxLeafSize)
+{
+	uint32_t count = static_cast<uint32_t>(a_bounds.size());
+	m_maxLeafSize = a_maxLeafSize > 0 ? a_maxLeafSize : 1;
+
+	m_objectMin.resize(count);
+	m_objectMax.resize(count);
+	m_centroids.resize(count);
+	m_leafOfObject.assign(count, 0);
+	m_objectSlots.resize(count);
+	std::iota(m_objectSlots.begin(), m_objectSlots.end(), 0u);
+	for (uint32_t i = 0; i < count; i++) {
+		SetObjectBounds(i, a_bounds[i]);
+	}
+
+	m_nodeCount = 0;
+	if (count == 0) {
+		m_nodes.clear();
+		m_parents.clear();
+		return;
+	}
+
+	//a binary tree with at least one object per leaf never needs more than 2n-1 nodes
+	m_nodes.assign(2 * static_cast<size_t>(count) - 1, Node{});
+	m_parents.assign(m_nodes.size(), NO_PARENT);
+	m_nextNode = 1;
+
+	BuildRange(0, 0, count, 0);
+	m_nodeCount = m_nextNode;
+}
+
+void Bvh::BuildRange(uint32_t a_nodeIndex, uint32_t a_first, uint32_t a_count, int a_depth)
+{
+	Node& node = m_nodes[a_nodeIndex];
+
+	//node box and the box around centroids, the latter drives the binning
+	node.m_min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	node.m_max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	XMFLOAT3 centroidMin = node.m_min;
+	XMFLOAT3 centroidMax = node.m_max;
+	for (uint32_t i = a_first; i < a_first + a_count; i++) {
+		uint32_t object = m_objectSlots[i];
+		Grow(node.m_min, node.m_max, m_objectMin[object], m_objectMax[object]);
+		Grow(centroidMin, centroidMax, m_centroids[object], m_centroids[object]);
+	}
+
+	auto makeLeaf = [&]() {
+		node.m_leftOrFirst = a_first;
+		node.m_count = a_count;
+		for (uint32_t i = a_first; i < a_first + a_count; i++) {
+			m_leafOfObject[m_objectSlots[i]] = a_nodeIndex;
+		}
+	};
+
+	if (a_count <= m_maxLeafSize) {
+		makeLeaf();
+		return;
+	}
+
+	//binned SAH, pick the cheapest of BIN_COUNT - 1 split planes on each axis
+	int bestAxis = -1;
+	int bestSplit = 0;
+	float bestCost = FLT_MAX;
+	for (int axis = 0; axis < 3; axis++) {
+		float axisMin = Component(centroidMin, axis);
+		float axisMax = Component(centroidMax, axis);
+		if (axisMax - axisMin <= 0.0f) continue;
+
+		uint32_t binCounts[BIN_COUNT] = {};
+		XMFLOAT3 binMin[BIN_COUNT];
+		XMFLOAT3 binMax[BIN_COUNT];
+		for (int b = 0; b < BIN_COUNT; b++) {
+			binMin[b] = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+			binMax[b] = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		}
+
+		float scale = BIN_COUNT / (axisMax - axisMin);
+		for (uint32_t i = a_first; i < a_first + a_count; i++) {
+			uint32_t object = m_objectSlots[i];
+			int bin = (std::min)(BIN_COUNT - 1, static_cast<int>((Component(m_centroids[object], axis) - axisMin) * scale));
+			binCounts[bin]++;
+			Grow(binMin[bin], binMax[bin], m_objectMin[object], m_objectMax[object]);
+		}
+
+		//sweep from both ends so every split is costed in O(bins)
+		float leftArea[BIN_COUNT - 1];
+		uint32_t leftCount[BIN_COUNT - 1];
+		XMFLOAT3 sweepMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 sweepMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		uint32_t sweepCount = 0;
+		for (int b = 0; b < BIN_COUNT - 1; b++) {
+			sweepCount += binCounts[b];
+			Grow(sweepMin, sweepMax, binMin[b], binMax[b]);
+			leftCount[b] = sweepCount;
+			leftArea[b] = HalfSurfaceArea(sweepMin, sweepMax);
+		}
+
+		sweepMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+		sweepMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		sweepCount = 0;
+		for (int b = BIN_COUNT - 1; b > 0; b--) {
+			sweepCount += binCounts[b];
+			Grow(sweepMin, sweepMax, binMin[b], binMax[b]);
+			float cost = leftCount[b - 1] * leftArea[b - 1] + sweepCount * HalfSurfaceArea(sweepMin, sweepMax);
+			if (cost < bestCost) {
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = b;
+			}
+		}
+	}
+
+	uint32_t leftCount = 0;
+	if (bestAxis >= 0) {
+		//splitting has to beat testing every object in this node
+		float leafCost = a_count * HalfSurfaceArea(node.m_min, node.m_max);
+		if (bestCost >= leafCost && a_count <= m_maxLeafSize * 4) {
+			makeLeaf();
+			return;
+		}
+
+		float axisMin = Component(centroidMin, bestAxis);
+		float scale = BIN_COUNT / (Component(centroidMax, bestAxis) - axisMin);
+		uint32_t* first = m_objectSlots.data() + a_first;
+		uint32_t* middle = std::partition(first, first + a_count, [&](uint32_t a_object) {
+			int bin = (std::min)(BIN_COUNT - 1, static_cast<int>((Component(m_centroids[a_object], bestAxis) - axisMin) * scale));
+			return bin < bestSplit;
+		});
+		leftCount = static_cast<uint32_t>(middle - first);
+	}
+
+	//every centroid in the same spot, SAH can't separate them so split by count
+	if (leftCount == 0 || leftCount == a_count) {
+		leftCount = a_count / 2;
+	}
+
+	uint32_t left = m_nextNode.fetch_add(2);
+	node.m_leftOrFirst = left;
+	node.m_count = 0;
+	m_parents[left] = a_nodeIndex;
+	m_parents[left + 1] = a_nodeIndex;
+
+	if (a_count >= PARALLEL_BUILD_THRESHOLD && a_depth < MAX_PARALLEL_DEPTH) {
+		std::future<void> leftBuild = std::async(std::launch::async,
+			[this, left, a_first, leftCount, a_depth]() { BuildRange(left, a_first, leftCount, a_depth + 1); });
+		BuildRange(left + 1, a_first + leftCount, a_count - leftCount, a_depth + 1);
+		leftBuild.get();
+	}
+	else {
+		BuildRange(left, a_first, leftCount, a_depth + 1);
+		BuildRange(left + 1, a_first + leftCount, a_count - leftCount, a_depth + 1);
+	}
+}
+
+void Bvh::FitNode(uint32_t a_nodeIndex)
+{
+	Node& node = m_nodes[a_nodeIndex];
+	node.m_min = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	node.m_max = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+
+	if (node.IsLeaf()) {
+		for (uint32_t i = node.m_leftOrFirst; i < node.m_leftOrFirst + node.m_count; i++) {
+			uint32_t object = m_objectSlots[i];
+			Grow(node.m_min, node.m_max, m_objectMin[object], m_objectMax[object]);
+		}
+	}
+	else {
+		const Node& left = m_nodes[node.m_leftOrFirst];
+		const Node& right = m_nodes[node.m_leftOrFirst + 1];
+		Grow(node.m_min, node.m_max, left.m_min, left.m_max);
+		Grow(node.m_min, node.m_max, right.m_min, right.m_max);
+	}
+}
+
+void Bvh::Refit(const std::vector<Bounds>& a_bounds)
+{
+	for (uint32_t i = 0; i < m_objectMin.size() && i < a_bounds.size(); i++) {
+		SetObjectBounds(i, a_bounds[i]);
+	}
+
+	if (m_nodeCount > 0 && m_objectMin.size() >= PARALLEL_REFIT_THRESHOLD) {
+		RefitSubtree(0, 0);
+		return;
+	}
+
+	//children are always allocated after their parent, so reverse order is bottom up
+	for (size_t i = m_nodeCount; i > 0; i--) {
+		FitNode(static_cast<uint32_t>(i - 1));
+	}
+}
+
+void Bvh::RefitSubtree(uint32_t a_nodeIndex, int a_depth)
+{
+	const Node& node = m_nodes[a_nodeIndex];
+	if (!node.IsLeaf()) {
+		uint32_t left = node.m_leftOrFirst;
+		if (a_depth < MAX_PARALLEL_DEPTH) {
+			std::future<void> leftRefit = std::async(std::launch::async,
+				[this, left, a_depth]() { RefitSubtree(left, a_depth + 1); });
+			RefitSubtree(left + 1, a_depth + 1);
+			leftRefit.get();
+		}
+		else {
+			RefitSubtree(left, a_depth + 1);
+			RefitSubtree(left + 1, a_depth + 1);
+		}
+	}
+	FitNode(a_nodeIndex);
+}
+
+void Bvh::UpdateObject(uint32_t a_objectIndex, const Bounds& a_bounds)
+{
+	if (a_objectIndex >= m_objectMin.size()) return;
+
+	SetObjectBounds(a_objectIndex, a_bounds);
+	for (uint32_t node = m_leafOfObject[a_objectIndex]; node != NO_PARENT; node = m_parents[node]) {
+		FitNode(node);
+	}
+}
+
+void Bvh::CollectSubtree(uint32_t a_nodeIndex, std::vector<uint32_t>& a_results) const
+{
+	//leaves of a subtree own one contiguous run of slots, find its ends
+	uint32_t first = a_nodeIndex;
+	while (!m_nodes[first].IsLeaf()) first = m_nodes[first].m_leftOrFirst;
+	uint32_t last = a_nodeIndex;
+	while (!m_nodes[last].IsLeaf()) last = m_nodes[last].m_leftOrFirst + 1;
+
+	const Node& firstLeaf = m_nodes[first];
+	const Node& lastLeaf = m_nodes[last];
+	a_results.insert(a_results.end(),
+		m_objectSlots.begin() + firstLeaf.m_leftOrFirst,
+		m_objectSlots.begin() + lastLeaf.m_leftOrFirst + lastLeaf.m_count);
+}
+
+void Bvh::QueryFrustum(const Frustum& a_frustum, std::vector<uint32_t>& a_results) const
+{
+	a_results.clear();
+	if (m_nodeCount == 0) return;
+
+	//each entry carries which planes still need testing, a box fully inside a plane
+	//stays inside for all of its children
+	const uint32_t allPlanes = (1u << Frustum::PLANE_COUNT) - 1;
+	std::vector<std::pair<uint32_t, uint32_t>> stack;
+	stack.reserve(64);
+	stack.push_back({ 0, allPlanes });
+
+	while (!stack.empty()) {
+		auto [nodeIndex, planeMask] = stack.back();
+		stack.pop_back();
+		const Node& node = m_nodes[nodeIndex];
+
+		bool outside = false;
+		for (int p = 0; p < Frustum::PLANE_COUNT && !outside; p++) {
+			if (!(planeMask & (1u << p))) continue;
+			PlaneTest test = TestBoxPlane(a_frustum.GetPlane(static_cast<Frustum::Plane>(p)), node.m_min, node.m_max);
+			if (test == PlaneTest::OUTSIDE) outside = true;
+			else if (test == PlaneTest::INSIDE) planeMask &= ~(1u << p);
+		}
+		if (outside) continue;
+
+		if (planeMask == 0) {
+			CollectSubtree(nodeIndex, a_results);
+		}
+		else if (node.IsLeaf()) {
+			for (uint32_t i = node.m_leftOrFirst; i < node.m_leftOrFirst + node.m_count; i++) {
+				uint32_t object = m_objectSlots[i];
+				XMFLOAT3 center(
+					(m_objectMin[object].x + m_objectMax[object].x) * 0.5f,
+					(m_objectMin[object].y + m_objectMax[object].y) * 0.5f,
+					(m_objectMin[object].z + m_objectMax[object].z) * 0.5f);
+				XMFLOAT3 extents(
+					m_objectMax[object].x - center.x,
+					m_objectMax[object].y - center.y,
+					m_objectMax[object].z - center.z);
+				if (a_frustum.IntersectsBox(center, extents)) a_results.push_back(object);
+			}
+		}
+		else {
+			stack.push_back({ node.m_leftOrFirst + 1, planeMask });
+			stack.push_back({ node.m_leftOrFirst, planeMask });
+		}
+	}
+}
+
+void Bvh::QuerySphere(const XMFLOAT3& a_center, float a_radius, std::vector<uint32_t>& a_results) const
+{
+	a_results.clear();
+	if (m_nodeCount == 0) return;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	stack.push_back(0);
+
+	while (!stack.empty()) {
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+		if (!BoxOverlapsSphere(node.m_min, node.m_max, a_center, a_radius)) continue;
+
+		if (node.IsLeaf()) {
+			for (uint32_t i = node.m_leftOrFirst; i < node.m_leftOrFirst + node.m_count; i++) {
+				uint32_t object = m_objectSlots[i];
+				if (BoxOverlapsSphere(m_objectMin[object], m_objectMax[object], a_center, a_radius)) {
+					a_results.push_back(object);
+				}
+			}
+		}
+		else {
+			stack.push_back(node.m_leftOrFirst + 1);
+			stack.push_back(node.m_leftOrFirst);
+		}
+	}
+}
+
+bool Bvh::Raycast(
+	const XMFLOAT3& a_origin,
+	const XMFLOAT3& a_direction,
+	float a_maxDistance,
+	uint32_t& a_hitObject,
+	float& a_hitDistance) const
+{
+	if (m_nodeCount == 0) return false;
+
+	XMFLOAT3 inverseDirection(1.0f / a_direction.x, 1.0f / a_direction.y, 1.0f / a_direction.z);
+	float closest = a_maxDistance;
+	bool hit = false;
+
+	std::vector<uint32_t> stack;
+	stack.reserve(64);
+	if (IntersectRayBox(a_origin, inverseDirection, closest, m_nodes[0].m_min, m_nodes[0].m_max) != FLT_MAX) {
+		stack.push_back(0);
+	}
+
+	while (!stack.empty()) {
+		const Node& node = m_nodes[stack.back()];
+		stack.pop_back();
+
+		if (node.IsLeaf()) {
+			for (uint32_t i = node.m_leftOrFirst; i < node.m_leftOrFirst + node.m_count; i++) {
+				uint32_t object = m_objectSlots[i];
+				float distance = IntersectRayBox(a_origin, inverseDirection, closest, m_objectMin[object], m_objectMax[object]);
+				if (distance == FLT_MAX) continue;
+				if (!hit || distance < closest) {
+					closest = distance;
+					a_hitObject = object;
+					hit = true;
+				}
+			}
+			continue;
+		}
+
+		//visit the nearer child first so the far one is more likely to be pruned
+		uint32_t nearChild = node.m_leftOrFirst;
+		uint32_t farChild = node.m_leftOrFirst + 1;
+		float nearDistance = IntersectRayBox(a_origin, inverseDirection, closest, m_nodes[nearChild].m_min, m_nodes[nearChild].m_max);
+		float farDistance = IntersectRayBox(a_origin, inverseDirection, closest, m_nodes[farChild].m_min, m_nodes[farChild].m_max);
+		if (farDistance < nearDistance) {
+			std::swap(nearChild, farChild);
+			std::swap(nearDistance, farDistance);
+		}
+		if (farDistance != FLT_MAX) stack.push_back(farChild);
+		if (nearDistance != FLT_MAX) stack.push_back(nearChild);
+	}
+
+	if (hit) a_hitDistance = closest;
+	return hit;
+}
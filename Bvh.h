@@ -0,0 +1,88 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include "Bounds.h"
+#include "Frustum.h"
+
+/// <summary>
+/// Bounding volume hierarchy over a flat list of object boxes.
+/// Built top down with a binned surface area heuristic, large subtrees are
+/// split across threads. Objects are referred to by their index in the list
+/// given to Build; moving an object only refits the path up to the root.
+/// </summary>
+class Bvh
+{
+public:
+	struct Node
+	{
+		DirectX::XMFLOAT3 m_min;
+		uint32_t m_leftOrFirst;	// left child index, or first object slot for leaves
+		DirectX::XMFLOAT3 m_max;
+		uint32_t m_count;		// 0 for interior nodes, right child is m_leftOrFirst + 1
+
+		bool IsLeaf() const { return m_count > 0; }
+	};
+
+	/// <summary>
+	/// Builds the tree from scratch, a_bounds[i] becomes object i
+	/// </summary>
+	void Build(const std::vector<Bounds>& a_bounds, uint32_t a_maxLeafSize = 4);
+
+	/// <summary>
+	/// Recomputes every node box from the object boxes, topology is kept.
+	/// Big trees refit their top subtrees on separate threads.
+	/// </summary>
+	void Refit(const std::vector<Bounds>& a_bounds);
+
+	/// <summary>
+	/// Moves a single object and grows/shrinks its ancestors to match
+	/// </summary>
+	void UpdateObject(uint32_t a_objectIndex, const Bounds& a_bounds);
+
+	void QueryFrustum(const Frustum& a_frustum, std::vector<uint32_t>& a_results) const;
+	void QuerySphere(const DirectX::XMFLOAT3& a_center, float a_radius, std::vector<uint32_t>& a_results) const;
+
+	/// <summary>
+	/// Closest object box hit by the ray, direction does not need to be normalized
+	/// (a_hitDistance is then in units of its length)
+	/// </summary>
+	bool Raycast(
+		const DirectX::XMFLOAT3& a_origin,
+		const DirectX::XMFLOAT3& a_direction,
+		float a_maxDistance,
+		uint32_t& a_hitObject,
+		float& a_hitDistance) const;
+
+	size_t GetObjectCount() const { return m_objectMin.size(); }
+	size_t GetNodeCount() const { return m_nodeCount; }
+	const std::vector<Node>& GetNodes() const { return m_nodes; }
+
+	/// <summary>
+	/// Object indices in leaf order, a leaf owns [m_leftOrFirst, m_leftOrFirst + m_count)
+	/// </summary>
+	const std::vector<uint32_t>& GetObjectSlots() const { return m_objectSlots; }
+
+private:
+	//per object boxes and centroids, indexed by object
+	std::vector<DirectX::XMFLOAT3> m_objectMin;
+	std::vector<DirectX::XMFLOAT3> m_objectMax;
+	std::vector<DirectX::XMFLOAT3> m_centroids;
+
+	//leaves point at ranges of this list
+	std::vector<uint32_t> m_objectSlots;
+	std::vector<uint32_t> m_leafOfObject;
+
+	std::vector<Node> m_nodes;
+	std::vector<uint32_t> m_parents;
+	std::atomic<uint32_t> m_nextNode = 0;
+	size_t m_nodeCount = 0;
+	uint32_t m_maxLeafSize = 4;
+
+	void SetObjectBounds(uint32_t a_objectIndex, const Bounds& a_bounds);
+	void BuildRange(uint32_t a_nodeIndex, uint32_t a_first, uint32_t a_count, int a_depth);
+	void FitNode(uint32_t a_nodeIndex);
+	void RefitSubtree(uint32_t a_nodeIndex, int a_depth);
+	void CollectSubtree(uint32_t a_nodeIndex, std::vector<uint32_t>& a_results) const;
+};
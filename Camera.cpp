@@ -16,6 +16,7 @@ Camera::Camera(
 	m_projection = a_projectionType;
 
 	m_transform = Transform(a_initialPosition, a_startingOrientation);
+	DirectX::XMStoreFloat4x4(&m_viewMatrix, DirectX::XMMatrixIdentity());
 	Camera::UpdateProjectionMatrix(a_aspectRatio);
 	Camera::UpdateViewMatrix();
 }
@@ -34,6 +35,35 @@ DirectX::XMFLOAT4X4 Camera::GetProjectionMatrix()
 	return m_projectionMatrix;
 }
 
+const DirectX::XMFLOAT4X4& Camera::GetViewProjectionMatrix()
+{
+	return m_viewProjectionMatrix;
+}
+
+float Camera::GetNearPlane()
+{
+	return m_nearPlane;
+}
+
+float Camera::GetFarPlane()
+{
+	return m_farPlane;
+}
+
+Projection Camera::GetProjection()
+{
+	return m_projection;
+}
+
+void Camera::UpdateViewProjectionMatrix()
+{
+	//row vector convention, view first then projection
+	DirectX::XMMATRIX viewProjection = DirectX::XMMatrixMultiply(
+		DirectX::XMLoadFloat4x4(&m_viewMatrix),
+		DirectX::XMLoadFloat4x4(&m_projectionMatrix));
+	DirectX::XMStoreFloat4x4(&m_viewProjectionMatrix, viewProjection);
+}
+
 void Camera::UpdateProjectionMatrix(float a_aspectRatio)
 {
 	DirectX::XMMATRIX projectionMatrix;
@@ -49,16 +79,29 @@ void Camera::UpdateProjectionMatrix(float a_aspectRatio)
 		break;
 	}
 	DirectX::XMStoreFloat4x4(&m_projectionMatrix, projectionMatrix);
+	UpdateViewProjectionMatrix();
 }
 
-void Camera::UpdateViewMatrix()
+void Camera::UpdateViewMatrix(float a_interpolationAlpha)
 {
-	DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&m_transform.GetPosition());
+	//movement runs at the fixed step, blend between the last two ticks
+	m_renderPosition = m_transform.GetInterpolatedPosition(a_interpolationAlpha);
+
+	//rebase once the camera drifts too far from the render origin
+	Double3 offset = m_renderPosition - m_renderOrigin;
+	if (offset.LengthSquared() > m_rebaseDistance * m_rebaseDistance) {
+		m_renderOrigin = m_renderPosition;
+	}
+
+	//view is built relative to the render origin, matching the entity world matrices
+	DirectX::XMFLOAT3 relativePosition = GetRelativePosition();
+	DirectX::XMVECTOR position = DirectX::XMLoadFloat3(&relativePosition);
 	DirectX::XMVECTOR forward = DirectX::XMLoadFloat3(&m_transform.GetForward());
 	DirectX::XMVECTOR worldUpVector = { 0.0f, 1.0f, 0.0f };
 
 	DirectX::XMMATRIX viewMatrix = DirectX::XMMatrixLookToLH(position, forward, worldUpVector);
 	DirectX::XMStoreFloat4x4(&m_viewMatrix, viewMatrix);
+	UpdateViewProjectionMatrix();
 }
 
 void Camera::Update(float a_deltaTime)
@@ -119,30 +162,51 @@ void Camera::Update(float a_deltaTime)
 		//DirectX::XMStoreFloat4(&rotationOffset, rotationOffsetVector);
 		//m_transform.Rotate(rotationOffset);
 	}
+}
+
+void Camera::FixedUpdate(float a_stepSeconds)
+{
+	m_transform.SavePreviousState();
+
 	//process user input
 	//movement
+	float distance = m_moveSpeed * a_stepSeconds;
 	if (Input::KeyDown('W')) {
-		m_transform.MoveRelative(0.0f, 0.0f, m_moveSpeed * a_deltaTime);
+		m_transform.MoveRelative(0.0f, 0.0f, distance);
 	}
 	if (Input::KeyDown('S')) {
-		m_transform.MoveRelative(0.0f, 0.0f, -m_moveSpeed * a_deltaTime);
+		m_transform.MoveRelative(0.0f, 0.0f, -distance);
 	}
 	if (Input::KeyDown('D')) {
-		m_transform.MoveRelative(m_moveSpeed * a_deltaTime, 0.0f, 0.0f);
+		m_transform.MoveRelative(distance, 0.0f, 0.0f);
 	}
 	if (Input::KeyDown('A')) {
-		m_transform.MoveRelative(-m_moveSpeed * a_deltaTime, 0.0f, 0.0f);
+		m_transform.MoveRelative(-distance, 0.0f, 0.0f);
 	}
 	if (Input::KeyDown(VK_SPACE)) {
-		m_transform.MoveRelative(0.0f, m_moveSpeed * a_deltaTime, 0.0f);
+		m_transform.MoveRelative(0.0f, distance, 0.0f);
 	}
 	if (Input::KeyDown('X')) {
-		m_transform.MoveRelative(0.0f, -m_moveSpeed * a_deltaTime, 0.0f);
+		m_transform.MoveRelative(0.0f, -distance, 0.0f);
 	}
-
-	Camera::UpdateViewMatrix();
 }
 
 Transform Camera::GetTransform() {
 	return m_transform;
 }
+
+const Double3& Camera::GetRenderOrigin()
+{
+	return m_renderOrigin;
+}
+
+DirectX::XMFLOAT3 Camera::GetRelativePosition()
+{
+	return m_renderPosition.RelativeTo(m_renderOrigin);
+}
+
+void Camera::SetRebaseDistance(double a_distance)
+{
+	m_rebaseDistance = a_distance;
+	UpdateViewMatrix();
+}
@@ -3,6 +3,7 @@
 #include <DirectXMath.h>
 #include "Projection.h"
 #include "Transform.h"
+#include "Double3.h"
 
 class Camera
 {
@@ -10,6 +11,7 @@ private:
 	Transform m_transform;
 	DirectX::XMFLOAT4X4 m_viewMatrix;
 	DirectX::XMFLOAT4X4 m_projectionMatrix;
+	DirectX::XMFLOAT4X4 m_viewProjectionMatrix;
 
 	/// <summary>
 	/// Field of view, in radians
@@ -22,6 +24,26 @@ private:
 
 	Projection m_projection = Projection::PERSPECTIVE;
 
+	/// <summary>
+	/// World position everything is rendered relative to
+	/// </summary>
+	Double3 m_renderOrigin;
+
+	/// <summary>
+	/// How far the camera may drift from the render origin before it is rebased,
+	/// 0 rebases every update (fully camera-relative rendering)
+	/// </summary>
+	double m_rebaseDistance = 0.0;
+
+	/// <summary>
+	/// Interpolated world position the current view matrix was built from
+	/// </summary>
+	Double3 m_renderPosition;
+
+	/// <summary>
+	/// Recombines view and projection, called whenever either changes
+	/// </summary>
+	void UpdateViewProjectionMatrix();
 
 public:
 	Camera(
@@ -32,15 +54,35 @@ public:
 	~Camera();
 	DirectX::XMFLOAT4X4 GetViewMatrix();
 	DirectX::XMFLOAT4X4 GetProjectionMatrix();
+	const DirectX::XMFLOAT4X4& GetViewProjectionMatrix();
+	float GetNearPlane();
+	float GetFarPlane();
+	Projection GetProjection();
 
 	void UpdateProjectionMatrix(float a_aspectRatio);
 
-	void UpdateViewMatrix();
+	/// <summary>
+	/// Rebuilds the view matrix, a_interpolationAlpha blends the position
+	/// between the last two fixed steps
+	/// </summary>
+	void UpdateViewMatrix(float a_interpolationAlpha = 1.0f);
 
+	/// <summary>
+	/// Per frame, mouse look
+	/// </summary>
 	void Update(float a_deltaTime);
 
+	/// <summary>
+	/// Per fixed step, keyboard movement
+	/// </summary>
+	void FixedUpdate(float a_stepSeconds);
+
 	Transform GetTransform();
 
+	const Double3& GetRenderOrigin();
+	DirectX::XMFLOAT3 GetRelativePosition();
+	void SetRebaseDistance(double a_distance);
+
 	float m_lookOffsetYaw = 0;
 	float m_lookOffsetPitch = 0;
 };
@@ -0,0 +1,49 @@
+#include "CommandRecording.h"
+#include <future>
+#include <algorithm>
+
+std::vector<CommandChunk> CommandRecording::PlanChunks(size_t a_itemCount, size_t a_maxChunks, size_t a_minItemsPerChunk)
+{
+	std::vector<CommandChunk> chunks;
+	if (a_itemCount == 0) return chunks;
+
+	size_t minItems = (std::max)(a_minItemsPerChunk, size_t(1));
+	size_t chunkCount = std::clamp(a_itemCount / minItems, size_t(1), (std::max)(a_maxChunks, size_t(1)));
+
+	//the first a_itemCount % chunkCount chunks take one extra item
+	size_t baseCount = a_itemCount / chunkCount;
+	size_t remainder = a_itemCount % chunkCount;
+	size_t first = 0;
+	for (size_t i = 0; i < chunkCount; i++) {
+		size_t count = baseCount + (i < remainder ? 1 : 0);
+		chunks.push_back({ first, count });
+		first += count;
+	}
+	return chunks;
+}
+
+void CommandRecording::RecordAndExecute(
+	const std::vector<CommandChunk>& a_chunks,
+	const std::vector<CommandSink*>& a_sinks,
+	const std::function<void(size_t a_chunkIndex, const CommandChunk& a_chunk)>& a_record)
+{
+	auto recordChunk = [&](size_t a_chunkIndex) {
+		CommandSink* sink = a_sinks[a_chunkIndex];
+		sink->BeginRecording();
+		a_record(a_chunkIndex, a_chunks[a_chunkIndex]);
+		sink->FinishRecording();
+	};
+
+	//the calling thread records the first chunk instead of waiting idle
+	std::vector<std::future<void>> tasks;
+	for (size_t i = 1; i < a_chunks.size(); i++) {
+		tasks.push_back(std::async(std::launch::async, recordChunk, i));
+	}
+	if (!a_chunks.empty()) recordChunk(0);
+	for (std::future<void>& task : tasks) task.get();
+
+	//replay strictly in chunk order, whichever thread finished first
+	for (size_t i = 0; i < a_chunks.size(); i++) {
+		a_sinks[i]->Execute();
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <cstddef>
+
+/// <summary>
+/// Somewhere a chunk of draws can be recorded on one thread and replayed
+/// later on the thread that owns the immediate context.
+/// </summary>
+class CommandSink
+{
+public:
+	virtual ~CommandSink() = default;
+
+	/// <summary>
+	/// Called on the recording thread before the chunk's commands
+	/// </summary>
+	virtual void BeginRecording() = 0;
+
+	/// <summary>
+	/// Called on the recording thread after the chunk's commands
+	/// </summary>
+	virtual void FinishRecording() = 0;
+
+	/// <summary>
+	/// Called on the submitting thread, once per chunk in chunk order
+	/// </summary>
+	virtual void Execute() = 0;
+};
+
+/// <summary>
+/// Contiguous range of items recorded together
+/// </summary>
+struct CommandChunk
+{
+	size_t m_first;
+	size_t m_count;
+};
+
+namespace CommandRecording
+{
+	/// <summary>
+	/// Splits a_itemCount items into at most a_maxChunks contiguous chunks of
+	/// at least a_minItemsPerChunk, sized as evenly as possible and in item order
+	/// </summary>
+	std::vector<CommandChunk> PlanChunks(size_t a_itemCount, size_t a_maxChunks, size_t a_minItemsPerChunk);
+
+	/// <summary>
+	/// Records chunk i on a_sinks[i], every chunk but the first on its own thread,
+	/// then executes the sinks in chunk order on the calling thread so the
+	/// replayed commands keep the original item order.
+	/// a_sinks needs at least as many entries as a_chunks.
+	/// </summary>
+	void RecordAndExecute(
+		const std::vector<CommandChunk>& a_chunks,
+		const std::vector<CommandSink*>& a_sinks,
+		const std::function<void(size_t a_chunkIndex, const CommandChunk& a_chunk)>& a_record);
+}
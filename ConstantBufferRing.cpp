@@ -0,0 +1,69 @@
+#include "ConstantBufferRing.h"
+#include <algorithm>
+
+void ConstantBufferRing::Reset(unsigned int a_capacityInBytes)
+{
+	m_capacity = a_capacityInBytes / ALIGNMENT * ALIGNMENT;
+	m_head = 0;
+	m_tail = 0;
+	m_bytesInFlight = 0;
+	m_frameBytes = 0;
+	m_frames.clear();
+}
+
+void ConstantBufferRing::BeginFrame(uint64_t a_frameIndex, uint64_t a_completedFrame)
+{
+	CloseFrame();
+	m_frameIndex = a_frameIndex;
+	Retire(a_completedFrame);
+}
+
+void ConstantBufferRing::Retire(uint64_t a_completedFrame)
+{
+	while (!m_frames.empty() && m_frames.front().m_frameIndex <= a_completedFrame) {
+		m_tail = m_frames.front().m_end;
+		m_bytesInFlight -= m_frames.front().m_bytes;
+		m_frames.pop_front();
+	}
+}
+
+bool ConstantBufferRing::Allocate(unsigned int a_sizeInBytes, unsigned int& a_offsetInBytes)
+{
+	unsigned int size = Align(a_sizeInBytes);
+	if (size == 0 || size > m_capacity) return false;
+
+	//nothing in flight, start again from the front so the whole buffer is usable
+	if (m_bytesInFlight == 0) {
+		m_head = 0;
+		m_tail = 0;
+	}
+
+	unsigned int wasted = 0;
+	if (m_head > m_tail || m_bytesInFlight == 0) {
+		//free space is [head, capacity) then [0, tail)
+		if (m_head + size > m_capacity) {
+			if (size > m_tail) return false;
+			//skip the end of the buffer, those bytes are charged to this frame
+			wasted = m_capacity - m_head;
+			m_head = 0;
+		}
+	}
+	else {
+		//head has wrapped behind tail, free space is [head, tail)
+		if (m_head + size > m_tail) return false;
+	}
+
+	a_offsetInBytes = m_head;
+	m_head += size;
+	m_frameBytes += size + wasted;
+	m_bytesInFlight += size + wasted;
+	m_highWaterBytes = (std::max)(m_highWaterBytes, m_bytesInFlight);
+	return true;
+}
+
+void ConstantBufferRing::CloseFrame()
+{
+	if (m_frameBytes == 0) return;
+	m_frames.push_back({ m_frameIndex, m_head, m_frameBytes });
+	m_frameBytes = 0;
+}
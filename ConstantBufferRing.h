@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+
+/// <summary>
+/// Offset bookkeeping for a frame partitioned constant buffer ring.
+/// Each frame allocates linearly after the previous one, a frame's bytes
+/// are only handed out again once the GPU has signalled that frame's fence.
+/// Knows nothing about D3D, the caller owns the buffer and the fences.
+/// </summary>
+class ConstantBufferRing
+{
+public:
+	//D3D11.1 constant buffer offsets must be multiples of 16 constants
+	static constexpr unsigned int ALIGNMENT = 256;
+
+	static unsigned int Align(unsigned int a_sizeInBytes) { return (a_sizeInBytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+	/// <summary>
+	/// Forgets every allocation, only safe when the GPU no longer reads the old range
+	/// (or it lives in a buffer that has been replaced)
+	/// </summary>
+	void Reset(unsigned int a_capacityInBytes);
+
+	/// <summary>
+	/// Starts a_frameIndex, releasing every frame up to and including a_completedFrame
+	/// </summary>
+	void BeginFrame(uint64_t a_frameIndex, uint64_t a_completedFrame);
+
+	/// <summary>
+	/// Releases frames the GPU has finished with since BeginFrame, used when an allocation fails
+	/// </summary>
+	void Retire(uint64_t a_completedFrame);
+
+	/// <summary>
+	/// Reserves a_sizeInBytes (rounded up to ALIGNMENT)
+	/// </summary>
+	/// <returns>False when the free part of the ring is too small and nothing was reserved</returns>
+	bool Allocate(unsigned int a_sizeInBytes, unsigned int& a_offsetInBytes);
+
+	unsigned int GetCapacity() const { return m_capacity; }
+
+	/// <summary>
+	/// Bytes reserved by frames the GPU may still be reading, including the current one
+	/// </summary>
+	unsigned int GetBytesInFlight() const { return m_bytesInFlight; }
+	unsigned int GetFrameBytes() const { return m_frameBytes; }
+	unsigned int GetHighWaterBytes() const { return m_highWaterBytes; }
+	void ResetHighWater() { m_highWaterBytes = m_bytesInFlight; }
+
+private:
+	struct FrameRegion
+	{
+		uint64_t m_frameIndex;
+		unsigned int m_end;
+		unsigned int m_bytes;
+	};
+
+	unsigned int m_capacity = 0;
+	unsigned int m_head = 0;
+	unsigned int m_tail = 0;
+	unsigned int m_bytesInFlight = 0;
+	unsigned int m_frameBytes = 0;
+	unsigned int m_highWaterBytes = 0;
+	uint64_t m_frameIndex = 0;
+
+	//closed frames, oldest first
+	std::deque<FrameRegion> m_frames;
+
+	void CloseFrame();
+};
@@ -0,0 +1,129 @@
+#include "D3D11RenderBackend.h"
+#include <cstring>
+#include <array>
+#include <algorithm>
+
+namespace
+{
+	D3D11_SHADER_TYPE ToShaderType(RenderCommand::Stage a_stage)
+	{
+		return a_stage == RenderCommand::Stage::VERTEX ? D3D11_VERTEX_SHADER : D3D11_PIXEL_SHADER;
+	}
+}
+
+D3D11RenderBackend::D3D11RenderBackend(GraphicsStateCache& a_state)
+	: m_pState(&a_state)
+{
+}
+
+void D3D11RenderBackend::Execute(const RenderCommandList& a_commands)
+{
+	using namespace RenderCommand;
+
+	for (const Header& header : a_commands) {
+		switch (header.m_type) {
+		case Type::BIND_PIPELINE: {
+			const BindPipeline& command = RenderCommandList::As<BindPipeline>(header);
+			m_pState->VSSetShader(static_cast<ID3D11VertexShader*>(command.m_vertexShader));
+			m_pState->PSSetShader(static_cast<ID3D11PixelShader*>(command.m_pixelShader));
+			break;
+		}
+		case Type::SET_RENDER_STATE: {
+			const SetRenderState& command = RenderCommandList::As<SetRenderState>(header);
+			m_pState->RSSetState(static_cast<ID3D11RasterizerState*>(command.m_rasterizerState));
+			m_pState->OMSetDepthStencilState(static_cast<ID3D11DepthStencilState*>(command.m_depthStencilState), command.m_stencilRef);
+			break;
+		}
+		case Type::BIND_SHADER_RESOURCE: {
+			const BindShaderResource& command = RenderCommandList::As<BindShaderResource>(header);
+			ID3D11ShaderResourceView* view = static_cast<ID3D11ShaderResourceView*>(command.m_view);
+			if (command.m_stage == Stage::VERTEX) m_pState->VSSetShaderResource(command.m_slot, view);
+			else m_pState->PSSetShaderResource(command.m_slot, view);
+			break;
+		}
+		case Type::BIND_SAMPLER: {
+			//only the pixel shader samples so far
+			const BindSampler& command = RenderCommandList::As<BindSampler>(header);
+			m_pState->PSSetSampler(command.m_slot, static_cast<ID3D11SamplerState*>(command.m_sampler));
+			break;
+		}
+		case Type::BIND_SHADER_RESOURCES: {
+			const BindShaderResources& command = RenderCommandList::As<BindShaderResources>(header);
+			std::array<ID3D11ShaderResourceView*, D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT> views;
+			unsigned int count = (std::min)(command.m_count, static_cast<uint32_t>(views.size()));
+			for (unsigned int i = 0; i < count; i++) {
+				views[i] = static_cast<ID3D11ShaderResourceView*>(command.GetViews()[i]);
+			}
+			if (command.m_stage == Stage::PIXEL) {
+				m_pState->PSSetShaderResources(command.m_firstSlot, count, views.data());
+			}
+			else {
+				for (unsigned int i = 0; i < count; i++) m_pState->VSSetShaderResource(command.m_firstSlot + i, views[i]);
+			}
+			break;
+		}
+		case Type::BIND_SAMPLERS: {
+			const BindSamplers& command = RenderCommandList::As<BindSamplers>(header);
+			std::array<ID3D11SamplerState*, D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT> samplers;
+			unsigned int count = (std::min)(command.m_count, static_cast<uint32_t>(samplers.size()));
+			for (unsigned int i = 0; i < count; i++) {
+				samplers[i] = static_cast<ID3D11SamplerState*>(command.GetSamplers()[i]);
+			}
+			m_pState->PSSetSamplers(command.m_firstSlot, count, samplers.data());
+			break;
+		}
+		case Type::BIND_CONSTANT_BUFFER: {
+			const BindConstantBuffer& command = RenderCommandList::As<BindConstantBuffer>(header);
+			Graphics::BindConstantBufferRange(
+				static_cast<ID3D11Buffer*>(command.m_buffer),
+				command.m_offsetInBytes,
+				command.m_sizeInBytes,
+				ToShaderType(command.m_stage),
+				command.m_slot,
+				*m_pState);
+			break;
+		}
+		case Type::UPDATE_CONSTANT_BUFFER: {
+			//maps on the immediate context, lists replayed on a recording thread must not contain these
+			const UpdateConstantBuffer& command = RenderCommandList::As<UpdateConstantBuffer>(header);
+			Graphics::ConstantBufferAllocation allocation = Graphics::MapNextConstantBuffer(command.m_sizeInBytes);
+			memcpy(allocation.m_pData, command.GetData(), command.m_sizeInBytes);
+			Graphics::UnmapConstantBuffer(allocation);
+			Graphics::BindConstantBufferRange(
+				allocation.m_pBuffer,
+				allocation.m_offsetInBytes,
+				command.m_sizeInBytes,
+				ToShaderType(command.m_stage),
+				command.m_slot,
+				*m_pState);
+			break;
+		}
+		case Type::BIND_GEOMETRY: {
+			const BindGeometry& command = RenderCommandList::As<BindGeometry>(header);
+			m_pState->IASetVertexBuffer(static_cast<ID3D11Buffer*>(command.m_vertexBuffer), command.m_stride, 0);
+			m_pState->IASetIndexBuffer(
+				static_cast<ID3D11Buffer*>(command.m_indexBuffer),
+				command.m_indexSizeInBytes == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+				0);
+			break;
+		}
+		case Type::DRAW_INDEXED: {
+			const DrawIndexed& command = RenderCommandList::As<DrawIndexed>(header);
+			m_pState->GetContext()->DrawIndexed(command.m_indexCount, command.m_startIndex, command.m_baseVertex);
+			break;
+		}
+		case Type::DRAW_INDEXED_INSTANCED: {
+			const DrawIndexedInstanced& command = RenderCommandList::As<DrawIndexedInstanced>(header);
+			m_pState->GetContext()->DrawIndexedInstanced(
+				command.m_indexCount,
+				command.m_instanceCount,
+				command.m_startIndex,
+				command.m_baseVertex,
+				command.m_startInstance);
+			break;
+		}
+		default:
+			break;
+		}
+	}
+}
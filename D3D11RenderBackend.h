@@ -0,0 +1,22 @@
+#pragma once
+#include "RenderBackend.h"
+#include "Graphics.h"
+
+/// <summary>
+/// Replays command lists through a state cache, so redundant binds in a
+/// list are still filtered before they reach the context.
+/// </summary>
+class D3D11RenderBackend : public RenderBackend
+{
+public:
+	/// <summary>
+	/// a_state picks the context, deferred contexts replay through their own cache.
+	/// Lists with UpdateConstantBuffer map the ring and have to run on the immediate context
+	/// </summary>
+	D3D11RenderBackend(GraphicsStateCache& a_state = Graphics::State);
+
+	void Execute(const RenderCommandList& a_commands) override;
+
+private:
+	GraphicsStateCache* m_pState;
+};
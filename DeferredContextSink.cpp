@@ -0,0 +1,127 @@
+#include "DeferredContextSink.h"
+
+void PipelineBaseline::Capture(ID3D11DeviceContext1* a_pContext)
+{
+	for (Microsoft::WRL::ComPtr<ID3D11RenderTargetView>& target : m_pRenderTargets) target.Reset();
+	m_pDepthStencil.Reset();
+	m_pInputLayout.Reset();
+	m_pDepthStencilState.Reset();
+	m_pPerFrameBuffer.Reset();
+	m_pInstanceSRV.Reset();
+	m_pPixelPerFrameBuffer.Reset();
+	for (Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>& view : m_pPixelFrameSRVs) view.Reset();
+	m_pShadowBuffer.Reset();
+	m_pShadowSampler.Reset();
+
+	ID3D11RenderTargetView* renderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT] = {};
+	a_pContext->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, renderTargets, m_pDepthStencil.GetAddressOf());
+	m_renderTargetCount = 0;
+	for (unsigned int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++) {
+		m_pRenderTargets[i].Attach(renderTargets[i]);
+		if (renderTargets[i]) m_renderTargetCount = i + 1;
+	}
+
+	m_viewportCount = 1;
+	a_pContext->RSGetViewports(&m_viewportCount, &m_viewport);
+
+	a_pContext->IAGetInputLayout(m_pInputLayout.GetAddressOf());
+	a_pContext->IAGetPrimitiveTopology(&m_topology);
+	a_pContext->OMGetDepthStencilState(m_pDepthStencilState.GetAddressOf(), &m_stencilRef);
+
+	a_pContext->VSGetConstantBuffers1(1, 1, m_pPerFrameBuffer.GetAddressOf(), &m_perFrameFirstConstant, &m_perFrameNumConstants);
+	a_pContext->VSGetShaderResources(0, 1, m_pInstanceSRV.GetAddressOf());
+	a_pContext->PSGetConstantBuffers1(1, 1, m_pPixelPerFrameBuffer.GetAddressOf(), &m_pixelPerFrameFirstConstant, &m_pixelPerFrameNumConstants);
+
+	//one read for the whole range, the views come back already AddRef'd
+	ID3D11ShaderResourceView* pixelFrameViews[PIXEL_FRAME_SLOT_COUNT] = {};
+	a_pContext->PSGetShaderResources(PIXEL_FRAME_FIRST_SLOT, PIXEL_FRAME_SLOT_COUNT, pixelFrameViews);
+	for (unsigned int i = 0; i < PIXEL_FRAME_SLOT_COUNT; i++) {
+		m_pPixelFrameSRVs[i].Attach(pixelFrameViews[i]);
+	}
+
+	a_pContext->PSGetConstantBuffers1(SHADOW_CONSTANT_BUFFER_SLOT, 1, m_pShadowBuffer.GetAddressOf(), &m_shadowFirstConstant, &m_shadowNumConstants);
+	a_pContext->PSGetSamplers(SHADOW_SAMPLER_SLOT, 1, m_pShadowSampler.GetAddressOf());
+}
+
+DeferredContextSink::DeferredContextSink()
+{
+	Graphics::Device->CreateDeferredContext1(0, m_pContext.GetAddressOf());
+	m_state.SetContext(m_pContext.Get());
+}
+
+void DeferredContextSink::SetBaseline(const PipelineBaseline* a_pBaseline)
+{
+	m_pBaseline = a_pBaseline;
+}
+
+void DeferredContextSink::BeginRecording()
+{
+	//a new command list starts from default state, the shadow has to match
+	m_state.Invalidate();
+	m_state.ResetCounters();
+
+	if (m_pBaseline == nullptr) return;
+
+	m_pContext->OMSetRenderTargets(m_pBaseline->m_renderTargetCount, m_pBaseline->m_pRenderTargets[0].GetAddressOf(), m_pBaseline->m_pDepthStencil.Get());
+	if (m_pBaseline->m_viewportCount > 0) {
+		m_pContext->RSSetViewports(1, &m_pBaseline->m_viewport);
+	}
+
+	m_state.IASetInputLayout(m_pBaseline->m_pInputLayout.Get());
+	m_state.IASetPrimitiveTopology(m_pBaseline->m_topology);
+	m_state.OMSetDepthStencilState(m_pBaseline->m_pDepthStencilState.Get(), m_pBaseline->m_stencilRef);
+	if (m_pBaseline->m_pPerFrameBuffer) {
+		m_state.VSSetConstantBuffer(
+			1,
+			m_pBaseline->m_pPerFrameBuffer.Get(),
+			m_pBaseline->m_perFrameFirstConstant,
+			m_pBaseline->m_perFrameNumConstants);
+	}
+	m_state.VSSetShaderResource(0, m_pBaseline->m_pInstanceSRV.Get());
+	if (m_pBaseline->m_pPixelPerFrameBuffer) {
+		m_state.PSSetConstantBuffer(
+			1,
+			m_pBaseline->m_pPixelPerFrameBuffer.Get(),
+			m_pBaseline->m_pixelPerFrameFirstConstant,
+			m_pBaseline->m_pixelPerFrameNumConstants);
+	}
+
+	ID3D11ShaderResourceView* pixelFrameViews[PipelineBaseline::PIXEL_FRAME_SLOT_COUNT];
+	for (unsigned int i = 0; i < PipelineBaseline::PIXEL_FRAME_SLOT_COUNT; i++) {
+		pixelFrameViews[i] = m_pBaseline->m_pPixelFrameSRVs[i].Get();
+	}
+	m_state.PSSetShaderResources(PipelineBaseline::PIXEL_FRAME_FIRST_SLOT, PipelineBaseline::PIXEL_FRAME_SLOT_COUNT, pixelFrameViews);
+
+	if (m_pBaseline->m_pShadowBuffer) {
+		m_state.PSSetConstantBuffer(
+			SHADOW_CONSTANT_BUFFER_SLOT,
+			m_pBaseline->m_pShadowBuffer.Get(),
+			m_pBaseline->m_shadowFirstConstant,
+			m_pBaseline->m_shadowNumConstants);
+	}
+	m_state.PSSetSampler(SHADOW_SAMPLER_SLOT, m_pBaseline->m_pShadowSampler.Get());
+}
+
+void DeferredContextSink::FinishRecording()
+{
+	m_pCommandList.Reset();
+
+	//FALSE, the next recording sets up its own baseline anyway
+	m_pContext->FinishCommandList(FALSE, m_pCommandList.GetAddressOf());
+}
+
+void DeferredContextSink::Execute()
+{
+	if (!m_pCommandList) return;
+
+	//TRUE puts the immediate context back afterwards, so Graphics::State stays accurate
+	Graphics::Context->ExecuteCommandList(m_pCommandList.Get(), TRUE);
+	m_pCommandList.Reset();
+
+	Graphics::State.AddCounters(m_state.GetCounters());
+}
+
+GraphicsStateCache& DeferredContextSink::GetState()
+{
+	return m_state;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include "CommandRecording.h"
+#include "Graphics.h"
+#include "MaterialTable.h"
+#include "Light.h"
+#include "LightClusters.h"
+#include "ShadowMap.h"
+#include "LocalShadows.h"
+#include "Sky.h"
+#include "ProbeGrid.h"
+
+/// <summary>
+/// Immediate context state a deferred context has to start from.
+/// Deferred contexts begin every command list with default state, so
+/// whatever the frame bound before the draws is copied in here.
+/// </summary>
+struct PipelineBaseline
+{
+	//every bound target, the deferred path draws into all of the G-buffer's at once
+	Microsoft::WRL::ComPtr<ID3D11RenderTargetView> m_pRenderTargets[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	unsigned int m_renderTargetCount = 0;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> m_pDepthStencil;
+	D3D11_VIEWPORT m_viewport = {};
+	unsigned int m_viewportCount = 0;
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> m_pInputLayout;
+	D3D11_PRIMITIVE_TOPOLOGY m_topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+
+	//the shading pass after a depth pre-pass tests against the laid down depth
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> m_pDepthStencilState;
+	unsigned int m_stencilRef = 0;
+
+	//per frame vertex constants, b1
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pPerFrameBuffer;
+	unsigned int m_perFrameFirstConstant = 0;
+	unsigned int m_perFrameNumConstants = 0;
+
+	//instance matrices, VS t0
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pInstanceSRV;
+
+	//per frame pixel constants, b1
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pPixelPerFrameBuffer;
+	unsigned int m_pixelPerFrameFirstConstant = 0;
+	unsigned int m_pixelPerFrameNumConstants = 0;
+
+	//per frame pixel resources, material table, lights, cluster lists, shadow maps, shadow atlas, sky and object irradiance, contiguous from t4
+	static constexpr unsigned int PIXEL_FRAME_FIRST_SLOT = MaterialTable::SHADER_SLOT;
+	static constexpr unsigned int PIXEL_FRAME_SLOT_COUNT = OBJECT_IRRADIANCE_SLOT - MaterialTable::SHADER_SLOT + 1;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pPixelFrameSRVs[PIXEL_FRAME_SLOT_COUNT];
+
+	//shadow cascade constants, PS b2, and their comparison sampler
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pShadowBuffer;
+	unsigned int m_shadowFirstConstant = 0;
+	unsigned int m_shadowNumConstants = 0;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> m_pShadowSampler;
+
+	/// <summary>
+	/// Reads the baseline back from the immediate context
+	/// </summary>
+	void Capture(ID3D11DeviceContext1* a_pContext);
+};
+
+/// <summary>
+/// Records a chunk of draws on its own deferred context and replays the
+/// resulting command list on the immediate context.
+/// </summary>
+class DeferredContextSink : public CommandSink
+{
+public:
+	DeferredContextSink();
+
+	/// <summary>
+	/// Baseline applied at the start of every recording, must outlive the recording
+	/// </summary>
+	void SetBaseline(const PipelineBaseline* a_pBaseline);
+
+	void BeginRecording() override;
+	void FinishRecording() override;
+	void Execute() override;
+
+	/// <summary>
+	/// Binds made through this only touch the deferred context
+	/// </summary>
+	GraphicsStateCache& GetState();
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11DeviceContext1> m_pContext;
+	Microsoft::WRL::ComPtr<ID3D11CommandList> m_pCommandList;
+	GraphicsStateCache m_state;
+	const PipelineBaseline* m_pBaseline = nullptr;
+};
@@ -0,0 +1,181 @@
+// --------------------------------------------------------
+// Tiled lighting of the deferred path, one thread group per
+// 16 x 16 pixel tile:
+// - the group finds the nearest and farthest pixel of its tile
+// - culls the point and spot lights against the tile's slice of
+//   the view frustum, the same test as TiledLightCulling.cpp
+// - every thread lights its pixel with the directional lights and
+//   the tile's lights, on top of the ambient the G-buffer pass wrote
+// The tile lists are written out as well so the CPU can check them.
+// --------------------------------------------------------
+#define PERMUTATION_SHADOWS 1
+
+#include "Lighting.hlsli"
+#include "GBuffer.hlsli"
+
+#define TILE_SIZE 16
+#define MAX_LIGHTS_PER_TILE 255
+#define TILE_STRIDE (MAX_LIGHTS_PER_TILE + 1)
+
+cbuffer DeferredConstants : register(b0)
+{
+    matrix inverseViewProjection;
+    float projectionX;
+    float projectionY;
+    float depthScale;
+    float depthBias;
+    uint2 tileCounts;
+    uint2 screenSize;
+    uint orthographic;
+    float3 padding;
+};
+
+Texture2D GBufferAlbedo : register(t0);
+Texture2D GBufferNormal : register(t1);
+Texture2D GBufferAmbient : register(t2);
+Texture2D<float> GBufferDepth : register(t3);
+
+RWStructuredBuffer<uint> tileLights : register(u0);
+RWTexture2D<float4> litColor : register(u1);
+
+groupshared uint tileMinZ;
+groupshared uint tileMaxZ;
+groupshared uint tileLightCount;
+groupshared uint tileLightIndices[MAX_LIGHTS_PER_TILE];
+
+// depth = z * _33 + _43, divided by z for perspective
+float LinearizeDepth(float depth)
+{
+    return orthographic ? (depth - depthBias) / depthScale : depthBias / (depth - depthScale);
+}
+
+// side planes of a tile in view space, pointing into it
+void GetTilePlanes(uint2 tile, out float4 planes[4])
+{
+    float2 topLeft = tile * TILE_SIZE / (float2) screenSize;
+    float2 bottomRight = min((tile + 1) * TILE_SIZE, screenSize) / (float2) screenSize;
+    float left = topLeft.x * 2.0f - 1.0f;
+    float right = bottomRight.x * 2.0f - 1.0f;
+    float top = 1.0f - topLeft.y * 2.0f;
+    float bottom = 1.0f - bottomRight.y * 2.0f;
+
+    // perspective planes pass through the eye, orthographic ones are offset
+    planes[0] = orthographic ? float4(projectionX, 0.0f, 0.0f, -left) : float4(projectionX, 0.0f, -left, 0.0f);
+    planes[1] = orthographic ? float4(-projectionX, 0.0f, 0.0f, right) : float4(-projectionX, 0.0f, right, 0.0f);
+    planes[2] = orthographic ? float4(0.0f, -projectionY, 0.0f, top) : float4(0.0f, -projectionY, top, 0.0f);
+    planes[3] = orthographic ? float4(0.0f, projectionY, 0.0f, -bottom) : float4(0.0f, projectionY, -bottom, 0.0f);
+
+    for (uint i = 0; i < 4; i++)
+    {
+        planes[i] /= length(planes[i].xyz);
+    }
+}
+
+bool SphereIntersectsTile(float4 planes[4], float minZ, float maxZ, float4 sphere)
+{
+    if (sphere.z + sphere.w < minZ || sphere.z - sphere.w > maxZ)
+        return false;
+    for (uint i = 0; i < 4; i++)
+    {
+        if (dot(planes[i].xyz, sphere.xyz) + planes[i].w < -sphere.w)
+            return false;
+    }
+    return true;
+}
+
+[numthreads(TILE_SIZE, TILE_SIZE, 1)]
+void main(uint3 groupId : SV_GroupID, uint3 pixel : SV_DispatchThreadID, uint threadIndex : SV_GroupIndex)
+{
+    if (threadIndex == 0)
+    {
+        // the largest finite float, empty tiles keep min above max so nothing passes
+        tileMinZ = 0x7F7FFFFF;
+        tileMaxZ = 0;
+        tileLightCount = 0;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    // pixels past the screen edge and the cleared far plane don't widen the range
+    float depth = all(pixel.xy < screenSize) ? GBufferDepth[pixel.xy] : 1.0f;
+    bool covered = depth < 1.0f;
+    if (covered)
+    {
+        // positive floats order the same as their bits
+        float viewZ = LinearizeDepth(depth);
+        InterlockedMin(tileMinZ, asuint(viewZ));
+        InterlockedMax(tileMaxZ, asuint(viewZ));
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    float4 planes[4];
+    GetTilePlanes(groupId.xy, planes);
+    float minZ = asfloat(tileMinZ);
+    float maxZ = asfloat(tileMaxZ);
+    uint localLightCount = lightCount - directionalLightCount;
+    for (uint j = threadIndex; j < localLightCount; j += TILE_SIZE * TILE_SIZE)
+    {
+        Light light = lights[directionalLightCount + j];
+        float4 sphere = float4(mul(view, float4(light.position, 1.0f)).xyz, light.range);
+        if (!SphereIntersectsTile(planes, minZ, maxZ, sphere))
+            continue;
+
+        uint slot;
+        InterlockedAdd(tileLightCount, 1, slot);
+        if (slot < MAX_LIGHTS_PER_TILE)
+            tileLightIndices[slot] = j;
+    }
+    GroupMemoryBarrierWithGroupSync();
+
+    uint count = min(tileLightCount, MAX_LIGHTS_PER_TILE);
+    uint tileOffset = (groupId.y * tileCounts.x + groupId.x) * TILE_STRIDE;
+    if (threadIndex == 0)
+        tileLights[tileOffset] = count;
+    for (uint k = threadIndex; k < count; k += TILE_SIZE * TILE_SIZE)
+    {
+        tileLights[tileOffset + 1 + k] = tileLightIndices[k];
+    }
+
+    if (!covered)
+        return;
+
+    float4 albedoMetalness = GBufferAlbedo[pixel.xy];
+    float4 normalRoughness = GBufferNormal[pixel.xy];
+    float3 albedoColor = albedoMetalness.rgb;
+    float metallic = albedoMetalness.a;
+    float roughness = normalRoughness.a;
+    float3 specularColor = lerp(0.04f, albedoColor, metallic);
+
+    // back to a world position through the pixel center
+    float2 clipPosition = (pixel.xy + 0.5f) / screenSize * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f);
+    float4 worldPosition = mul(inverseViewProjection, float4(clipPosition, depth, 1.0f));
+
+    // only what the light functions read
+    VertexToPixel input = (VertexToPixel) 0;
+    input.worldPosition = worldPosition.xyz / worldPosition.w;
+    input.normal = UnpackNormal(normalRoughness.rgb);
+
+    float3 finalColor = GBufferAmbient[pixel.xy].rgb;
+
+    // only the first directional light casts shadows
+    for (uint i = 0; i < directionalLightCount; i++)
+    {
+        float3 lightColor = DirectionalLight(input, lights[i], albedoColor, roughness, specularColor, metallic);
+        finalColor += i == 0 ? lightColor * SampleShadow(input.worldPosition, LinearizeDepth(depth)) : lightColor;
+    }
+
+    for (uint l = 0; l < count; l++)
+    {
+        Light light = lights[directionalLightCount + tileLightIndices[l]];
+        switch (light.type)
+        {
+            case LIGHT_TYPE_POINT:
+                finalColor += PointLight(input, light, albedoColor, roughness, specularColor, metallic) * SampleLocalShadow(light, input.worldPosition);
+                break;
+            case LIGHT_TYPE_SPOT:
+                finalColor += SpotLight(input, light, albedoColor, roughness, specularColor, metallic) * SampleLocalShadow(light, input.worldPosition);
+                break;
+        }
+    }
+
+    litColor[pixel.xy] = pow(float4(finalColor, 1), (1.0 / 2.2));
+}
@@ -0,0 +1,28 @@
+// --------------------------------------------------------
+// Copies the deferred path's lit image and depth into the back
+// buffer and main depth buffer, drawn with the shadow clear
+// triangle and the depth test set to always pass. Forward drawn
+// entities and the sky then test against the deferred depth,
+// pixels nothing was drawn into keep the cleared target.
+// --------------------------------------------------------
+Texture2D LitColor : register(t0);
+Texture2D<float> GBufferDepth : register(t1);
+
+struct ResolveOutput
+{
+    float4 color : SV_TARGET;
+    float depth : SV_DEPTH;
+};
+
+ResolveOutput main(float4 position : SV_POSITION)
+{
+    uint2 pixel = (uint2) position.xy;
+    float depth = GBufferDepth[pixel];
+    if (depth >= 1.0f)
+        discard;
+
+    ResolveOutput output;
+    output.color = LitColor[pixel];
+    output.depth = depth;
+    return output;
+}
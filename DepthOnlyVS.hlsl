@@ -0,0 +1,21 @@
+// Per object constant buffer, same layout as VertexShader.hlsl
+cbuffer BufferStruct : register(b0)
+{
+    matrix worldViewProjection;
+    matrix world;
+    matrix worldInverseTranspose;
+    uint irradianceIndex;
+    float3 objectPadding;
+};
+
+// --------------------------------------------------------
+// Depth pre-pass variant of VertexShader.hlsl
+// - reads the welded position stream only, see PositionStream.h
+// - the position is the exact expression VertexShader.hlsl uses, both
+//   precise, so the shading pass finds the same depth it tests against
+// --------------------------------------------------------
+float4 main(float3 localPosition : POSITION) : SV_POSITION
+{
+    precise float4 screenPosition = mul(worldViewProjection, float4(localPosition, 1.0f));
+    return screenPosition;
+}
@@ -0,0 +1,42 @@
+// Per draw constant buffer, same layout as VertexShaderInstanced.hlsl
+cbuffer InstanceBatch : register(b0)
+{
+    uint firstInstance;
+    float3 batchPadding;
+};
+
+// Per frame constant buffer, same layout as VertexShader.hlsl
+cbuffer PerFrame : register(b1)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float3 frameCameraPosition;
+    uint frameLightCount;
+};
+
+// Per instance matrices, same layout as VertexShaderInstanced.hlsl
+struct InstanceData
+{
+    matrix world;
+    matrix worldInverseTranspose;
+    uint irradianceIndex;
+    float3 padding;
+};
+
+StructuredBuffer<InstanceData> instances : register(t0);
+
+// --------------------------------------------------------
+// Depth pre-pass variant of VertexShaderInstanced.hlsl
+// - reads the welded position stream only, see PositionStream.h
+// - world then viewProjection, in the same order and as precise as
+//   VertexShaderInstanced.hlsl so the depth matches exactly
+// --------------------------------------------------------
+float4 main(float3 localPosition : POSITION, uint instanceId : SV_InstanceID) : SV_POSITION
+{
+    InstanceData instance = instances[firstInstance + instanceId];
+
+    precise float4 worldPosition = mul(instance.world, float4(localPosition, 1.0f));
+    precise float4 screenPosition = mul(viewProjection, worldPosition);
+    return screenPosition;
+}
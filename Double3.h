@@ -0,0 +1,48 @@
+#pragma once
+#include <DirectXMath.h>
+
+/// <summary>
+/// Double precision world-space position.
+/// Positions are kept in doubles on the CPU and only converted to float
+/// after the render origin has been subtracted, so the GPU never sees
+/// large coordinates.
+/// </summary>
+struct Double3
+{
+	double x;
+	double y;
+	double z;
+
+	Double3() : x(0.0), y(0.0), z(0.0) {}
+	Double3(double a_x, double a_y, double a_z) : x(a_x), y(a_y), z(a_z) {}
+	explicit Double3(const DirectX::XMFLOAT3& a_float3) : x(a_float3.x), y(a_float3.y), z(a_float3.z) {}
+
+	Double3 operator+(const Double3& a_other) const { return Double3(x + a_other.x, y + a_other.y, z + a_other.z); }
+	Double3 operator-(const Double3& a_other) const { return Double3(x - a_other.x, y - a_other.y, z - a_other.z); }
+	Double3 operator*(double a_scalar) const { return Double3(x * a_scalar, y * a_scalar, z * a_scalar); }
+	bool operator==(const Double3& a_other) const { return x == a_other.x && y == a_other.y && z == a_other.z; }
+	bool operator!=(const Double3& a_other) const { return !(*this == a_other); }
+
+	double LengthSquared() const { return x * x + y * y + z * z; }
+
+	static Double3 Lerp(const Double3& a_from, const Double3& a_to, double a_t)
+	{
+		return a_from + (a_to - a_from) * a_t;
+	}
+
+	/// <summary>
+	/// Lossy conversion, only safe for positions close to the origin
+	/// </summary>
+	DirectX::XMFLOAT3 ToFloat3() const
+	{
+		return DirectX::XMFLOAT3(static_cast<float>(x), static_cast<float>(y), static_cast<float>(z));
+	}
+
+	/// <summary>
+	/// Position relative to a_origin, subtracted in double before narrowing to float
+	/// </summary>
+	DirectX::XMFLOAT3 RelativeTo(const Double3& a_origin) const
+	{
+		return (*this - a_origin).ToFloat3();
+	}
+};
@@ -0,0 +1,40 @@
+#include "DynamicStructuredBuffer.h"
+#include "Graphics.h"
+#include <algorithm>
+#include <cstring>
+
+size_t DynamicStructuredBuffer::Upload(const void* a_pData, size_t a_count, unsigned int a_stride)
+{
+	//always keep at least one element so there is a view to bind, even when empty
+	if (a_count > m_capacity || a_stride != m_stride || !m_pBuffer) {
+		m_capacity = (std::max)({ a_count, m_capacity * 2, size_t(1) });
+		m_stride = a_stride;
+		m_pBuffer.Reset();
+		m_pSRV.Reset();
+
+		D3D11_BUFFER_DESC bufferDesc = {};
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.ByteWidth = static_cast<UINT>(m_capacity * a_stride);
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.StructureByteStride = a_stride;
+		Graphics::Device->CreateBuffer(&bufferDesc, 0, m_pBuffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = static_cast<UINT>(m_capacity);
+		Graphics::Device->CreateShaderResourceView(m_pBuffer.Get(), &srvDesc, m_pSRV.GetAddressOf());
+	}
+
+	if (a_count == 0) return 0;
+
+	size_t bytes = a_count * a_stride;
+	D3D11_MAPPED_SUBRESOURCE mappedBuffer = {};
+	Graphics::Context->Map(m_pBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
+	memcpy(mappedBuffer.pData, a_pData, bytes);
+	Graphics::Context->Unmap(m_pBuffer.Get(), 0);
+	return bytes;
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <cstddef>
+
+/// <summary>
+/// CPU written structured buffer that is refilled with WRITE_DISCARD,
+/// recreated at double the size whenever an upload doesn't fit.
+/// </summary>
+class DynamicStructuredBuffer
+{
+public:
+	/// <summary>
+	/// Copies a_count elements of a_stride bytes, returns the bytes written
+	/// </summary>
+	size_t Upload(const void* a_pData, size_t a_count, unsigned int a_stride);
+
+	ID3D11ShaderResourceView* GetSRV() const { return m_pSRV.Get(); }
+	size_t GetCapacity() const { return m_capacity; }
+
+private:
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pSRV;
+	size_t m_capacity = 0;
+	unsigned int m_stride = 0;
+};
@@ -0,0 +1,92 @@
+#include "FixedTimestep.h"
+#include <algorithm>
+#include <cmath>
+
+FixedTimestep::FixedTimestep(double a_stepSeconds, int a_maxSubsteps)
+{
+	m_stepSeconds = a_stepSeconds > 0.0 ? a_stepSeconds : 1.0 / 60.0;
+	m_maxSubsteps = a_maxSubsteps > 0 ? a_maxSubsteps : 1;
+}
+
+int FixedTimestep::Advance(double a_elapsedSeconds)
+{
+	//clocks can report negative or NaN deltas after a pause, treat them as no time passing
+	if (!(a_elapsedSeconds > 0.0)) {
+		m_lastSubstepCount = 0;
+		return 0;
+	}
+
+	m_accumulator += a_elapsedSeconds;
+
+	int steps = 0;
+	while (m_accumulator >= m_stepSeconds && steps < m_maxSubsteps) {
+		m_accumulator -= m_stepSeconds;
+		steps++;
+	}
+
+	//hit the catch-up limit, drop whole steps but keep the fraction so alpha stays smooth
+	if (m_accumulator >= m_stepSeconds) {
+		double dropped = std::floor(m_accumulator / m_stepSeconds) * m_stepSeconds;
+		m_accumulator -= dropped;
+		m_droppedSeconds += dropped;
+	}
+
+	m_tickCount += steps;
+	m_lastSubstepCount = steps;
+	return steps;
+}
+
+float FixedTimestep::GetAlpha() const
+{
+	//a rounding error short of a whole step would round up to 1 as a float
+	return (std::min)(static_cast<float>(m_accumulator / m_stepSeconds), std::nextafter(1.0f, 0.0f));
+}
+
+double FixedTimestep::GetStepSeconds() const
+{
+	return m_stepSeconds;
+}
+
+void FixedTimestep::SetStepSeconds(double a_stepSeconds)
+{
+	if (!(a_stepSeconds > 0.0)) return;
+
+	//keep the same alpha so changing rate doesn't pop the interpolation
+	double alpha = m_accumulator / m_stepSeconds;
+	m_stepSeconds = a_stepSeconds;
+	m_accumulator = alpha * m_stepSeconds;
+}
+
+int FixedTimestep::GetMaxSubsteps() const
+{
+	return m_maxSubsteps;
+}
+
+void FixedTimestep::SetMaxSubsteps(int a_maxSubsteps)
+{
+	if (a_maxSubsteps <= 0) return;
+	m_maxSubsteps = a_maxSubsteps;
+}
+
+uint64_t FixedTimestep::GetTickCount() const
+{
+	return m_tickCount;
+}
+
+int FixedTimestep::GetLastSubstepCount() const
+{
+	return m_lastSubstepCount;
+}
+
+double FixedTimestep::GetDroppedSeconds() const
+{
+	return m_droppedSeconds;
+}
+
+void FixedTimestep::Reset()
+{
+	m_accumulator = 0.0;
+	m_tickCount = 0;
+	m_lastSubstepCount = 0;
+	m_droppedSeconds = 0.0;
+}
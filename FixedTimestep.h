@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+
+/// <summary>
+/// Fixed step simulation scheduler.
+/// Frame time is fed into an accumulator and paid out in whole steps, the
+/// leftover fraction is exposed as an interpolation alpha for rendering.
+/// Has no clock of its own, so any time source (or a fake one) can drive it.
+/// </summary>
+class FixedTimestep
+{
+public:
+	FixedTimestep(double a_stepSeconds = 1.0 / 60.0, int a_maxSubsteps = 8);
+
+	/// <summary>
+	/// Adds elapsed time and returns how many fixed steps should be simulated now.
+	/// At most maxSubsteps are returned, time beyond that is dropped so a long
+	/// stall can't snowball into ever longer catch-up frames.
+	/// </summary>
+	int Advance(double a_elapsedSeconds);
+
+	/// <summary>
+	/// How far between the last two simulated steps rendering is, [0, 1)
+	/// </summary>
+	float GetAlpha() const;
+
+	double GetStepSeconds() const;
+	void SetStepSeconds(double a_stepSeconds);
+	int GetMaxSubsteps() const;
+	void SetMaxSubsteps(int a_maxSubsteps);
+
+	uint64_t GetTickCount() const;
+	int GetLastSubstepCount() const;
+	double GetDroppedSeconds() const;
+
+	/// <summary>
+	/// Clears the accumulator and counters
+	/// </summary>
+	void Reset();
+
+private:
+	double m_stepSeconds;
+	int m_maxSubsteps;
+
+	double m_accumulator = 0.0;
+	uint64_t m_tickCount = 0;
+	int m_lastSubstepCount = 0;
+	double m_droppedSeconds = 0.0;
+};
@@ -0,0 +1,337 @@
+#include "FrameProfiler.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define FRAME_PROFILER_TSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define FRAME_PROFILER_TSC
+#endif
+
+namespace
+{
+	//m_name is null for the end of a zone, ends pair with the latest open begin
+	struct Event
+	{
+		const char* m_name;
+		uint64_t m_time;
+	};
+
+	//single producer, the recording thread, and single consumer, whoever calls BeginFrame
+	struct ThreadBuffer
+	{
+		std::array<Event, FrameProfiler::EVENTS_PER_THREAD> m_events;
+		std::atomic<uint64_t> m_written = 0;
+		std::atomic<uint64_t> m_read = 0;
+		std::atomic<uint64_t> m_dropped = 0;
+		std::atomic<bool> m_inUse = false; // released when its thread exits and handed to the next new one
+		uint32_t m_thread = 0;
+
+		//consumer side, begins still waiting for their end, kept across frames
+		std::vector<Event> m_openZones;
+
+		//zones an exited thread finished before its ring was handed on, go into the next frame
+		std::vector<FrameProfiler::Zone> m_handedOnZones;
+	};
+
+	std::mutex registryMutex;
+	std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+
+	std::atomic<bool> enabled = true;
+	std::atomic<bool> paused = false;
+
+	//only touched by the thread calling BeginFrame
+	std::array<FrameProfiler::Frame, FrameProfiler::HISTORY> history;
+	FrameProfiler::Frame discarded;
+	size_t nextFrame = 0;
+	size_t frameCount = 0;
+	uint64_t frameIndex = 0;
+	uint64_t frameStart = 0;
+	bool frameOpen = false;
+	uint32_t mainThread = 0;
+
+	//ticks against steady_clock since the first frame, refined every frame
+	uint64_t anchorTicks = 0;
+	std::chrono::steady_clock::time_point anchorTime;
+	double ticksPerMillisecond = 1e6;
+
+	constexpr uint32_t NO_DROP = UINT32_MAX;
+
+	thread_local ThreadBuffer* t_pBuffer = nullptr;
+	thread_local uint32_t t_depth = 0; // zones open on this thread, dropped ones included
+	thread_local uint32_t t_dropDepth = NO_DROP; // depth of the first dropped begin, everything inside it goes too
+
+	struct BufferRelease
+	{
+		~BufferRelease()
+		{
+			if (t_pBuffer) t_pBuffer->m_inUse.store(false, std::memory_order_release);
+		}
+	};
+	thread_local BufferRelease t_bufferRelease;
+
+	//pairs the unread events of a_buffer into zones, called with registryMutex held
+	void Consume(ThreadBuffer& a_buffer, std::vector<FrameProfiler::Zone>& a_zones)
+	{
+		uint64_t written = a_buffer.m_written.load(std::memory_order_acquire);
+		for (uint64_t i = a_buffer.m_read.load(std::memory_order_relaxed); i < written; i++) {
+			const Event& event = a_buffer.m_events[i % FrameProfiler::EVENTS_PER_THREAD];
+			if (event.m_name) {
+				a_buffer.m_openZones.push_back(event);
+			}
+			else if (!a_buffer.m_openZones.empty()) {
+				Event begin = a_buffer.m_openZones.back();
+				a_buffer.m_openZones.pop_back();
+				a_zones.push_back({ begin.m_name, begin.m_time, event.m_time,
+					a_buffer.m_thread, static_cast<uint32_t>(a_buffer.m_openZones.size()) });
+			}
+		}
+		a_buffer.m_read.store(written, std::memory_order_release);
+	}
+
+	ThreadBuffer& GetBuffer()
+	{
+		if (t_pBuffer) return *t_pBuffer;
+
+		(void)&t_bufferRelease;
+		std::lock_guard<std::mutex> lock(registryMutex);
+		for (std::unique_ptr<ThreadBuffer>& buffer : buffers) {
+			bool inUse = false;
+			if (buffer->m_inUse.compare_exchange_strong(inUse, true, std::memory_order_acquire)) {
+				//the exited thread's zones are finished now, begins it never ended would
+				//otherwise pair with this thread's ends
+				Consume(*buffer, buffer->m_handedOnZones);
+				buffer->m_openZones.clear();
+				t_pBuffer = buffer.get();
+				return *t_pBuffer;
+			}
+		}
+		buffers.push_back(std::make_unique<ThreadBuffer>());
+		buffers.back()->m_thread = static_cast<uint32_t>(buffers.size() - 1);
+		buffers.back()->m_inUse.store(true, std::memory_order_relaxed);
+		t_pBuffer = buffers.back().get();
+		return *t_pBuffer;
+	}
+
+	void Push(ThreadBuffer& a_buffer, uint64_t a_written, const char* a_name)
+	{
+		a_buffer.m_events[a_written % FrameProfiler::EVENTS_PER_THREAD] = { a_name, FrameProfiler::Now() };
+		a_buffer.m_written.store(a_written + 1, std::memory_order_release);
+	}
+
+	void Drain(ThreadBuffer& a_buffer, FrameProfiler::Frame& a_frame)
+	{
+		a_frame.m_zones.insert(a_frame.m_zones.end(), a_buffer.m_handedOnZones.begin(), a_buffer.m_handedOnZones.end());
+		a_buffer.m_handedOnZones.clear();
+		Consume(a_buffer, a_frame.m_zones);
+		a_frame.m_dropped += a_buffer.m_dropped.exchange(0, std::memory_order_relaxed);
+	}
+
+	void AppendEscaped(std::string& a_out, const char* a_text)
+	{
+		for (const char* c = a_text; *c; c++) {
+			if (*c == '"' || *c == '\\') a_out += '\\';
+			if (static_cast<unsigned char>(*c) < 0x20) continue;
+			a_out += *c;
+		}
+	}
+
+	void AppendEvent(std::string& a_out, const char* a_name, uint32_t a_thread, double a_startUs, double a_durationUs)
+	{
+		char numbers[96];
+		a_out += ",\n{\"name\":\"";
+		AppendEscaped(a_out, a_name);
+		snprintf(numbers, sizeof(numbers), "\",\"ph\":\"X\",\"pid\":0,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", a_thread, a_startUs, a_durationUs);
+		a_out += numbers;
+	}
+}
+
+void FrameProfiler::BeginFrame()
+{
+	uint64_t now = Now();
+	std::chrono::steady_clock::time_point time = std::chrono::steady_clock::now();
+	mainThread = GetBuffer().m_thread;
+
+	if (!frameOpen) {
+		anchorTicks = now;
+		anchorTime = time;
+	}
+	else {
+		double milliseconds = std::chrono::duration<double, std::milli>(time - anchorTime).count();
+		if (milliseconds > 0.0) ticksPerMillisecond = (now - anchorTicks) / milliseconds;
+
+		bool keep = !paused.load(std::memory_order_relaxed);
+		Frame& frame = keep ? history[nextFrame] : discarded;
+		frame.m_index = frameIndex;
+		frame.m_start = frameStart;
+		frame.m_end = now;
+		frame.m_zones.clear();
+		frame.m_dropped = 0;
+		{
+			std::lock_guard<std::mutex> lock(registryMutex);
+			for (std::unique_ptr<ThreadBuffer>& buffer : buffers) Drain(*buffer, frame);
+		}
+		std::sort(frame.m_zones.begin(), frame.m_zones.end(), [](const Zone& a_a, const Zone& a_b) {
+			if (a_a.m_thread != a_b.m_thread) return a_a.m_thread < a_b.m_thread;
+			if (a_a.m_start != a_b.m_start) return a_a.m_start < a_b.m_start;
+			return a_a.m_depth < a_b.m_depth;
+		});
+
+		if (keep) {
+			nextFrame = (nextFrame + 1) % HISTORY;
+			frameCount = (std::min)(frameCount + 1, HISTORY);
+		}
+		frameIndex++;
+	}
+
+	frameStart = now;
+	frameOpen = true;
+}
+
+void FrameProfiler::SetEnabled(bool a_enabled)
+{
+	enabled.store(a_enabled, std::memory_order_relaxed);
+}
+
+bool FrameProfiler::IsEnabled()
+{
+	return enabled.load(std::memory_order_relaxed);
+}
+
+void FrameProfiler::SetPaused(bool a_paused)
+{
+	paused.store(a_paused, std::memory_order_relaxed);
+}
+
+bool FrameProfiler::IsPaused()
+{
+	return paused.load(std::memory_order_relaxed);
+}
+
+uint64_t FrameProfiler::Now()
+{
+#ifdef FRAME_PROFILER_TSC
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+double FrameProfiler::TicksToMilliseconds(uint64_t a_ticks)
+{
+	return a_ticks / ticksPerMillisecond;
+}
+
+void FrameProfiler::BeginZone(const char* a_name)
+{
+	ThreadBuffer& buffer = GetBuffer();
+	if (t_dropDepth == NO_DROP) {
+		//room for this begin and the end of every zone open around it, so ends never have to be dropped
+		uint64_t written = buffer.m_written.load(std::memory_order_relaxed);
+		uint64_t read = buffer.m_read.load(std::memory_order_acquire);
+		if (EVENTS_PER_THREAD - (written - read) >= t_depth + 2) {
+			Push(buffer, written, a_name);
+			t_depth++;
+			return;
+		}
+		t_dropDepth = t_depth;
+	}
+	buffer.m_dropped.fetch_add(1, std::memory_order_relaxed);
+	t_depth++;
+}
+
+void FrameProfiler::EndZone()
+{
+	if (t_depth == 0) return;
+	t_depth--;
+	if (t_dropDepth != NO_DROP) {
+		if (t_depth == t_dropDepth) t_dropDepth = NO_DROP;
+		return;
+	}
+	ThreadBuffer& buffer = GetBuffer();
+	Push(buffer, buffer.m_written.load(std::memory_order_relaxed), nullptr);
+}
+
+size_t FrameProfiler::GetFrameCount()
+{
+	return frameCount;
+}
+
+const FrameProfiler::Frame& FrameProfiler::GetFrame(size_t a_age)
+{
+	return history[(nextFrame + HISTORY - 1 - a_age) % HISTORY];
+}
+
+uint32_t FrameProfiler::GetThreadCount()
+{
+	std::lock_guard<std::mutex> lock(registryMutex);
+	return static_cast<uint32_t>(buffers.size());
+}
+
+uint32_t FrameProfiler::GetMainThread()
+{
+	return mainThread;
+}
+
+std::string FrameProfiler::GetThreadName(uint32_t a_thread)
+{
+	if (a_thread == mainThread) return "Main";
+	//rings are handed on when a thread exits, a worker lane can be several pooled threads over time
+	return "Worker " + std::to_string(a_thread);
+}
+
+std::string FrameProfiler::ExportChromeTrace()
+{
+	std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,\"args\":{\"name\":\"CPU\"}}";
+
+	//frames get a lane of their own past the threads so zones that cross a frame boundary still nest
+	uint32_t threadCount = GetThreadCount();
+	for (uint32_t thread = 0; thread <= threadCount; thread++) {
+		std::string name = thread < threadCount ? GetThreadName(thread) : "Frames";
+		out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" + std::to_string(thread) + ",\"args\":{\"name\":\"";
+		AppendEscaped(out, name.c_str());
+		out += "\"}}";
+		out += ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":0,\"tid\":" + std::to_string(thread) +
+			",\"args\":{\"sort_index\":" + std::to_string(thread == mainThread ? 0 : thread + 1) + "}}";
+	}
+
+	if (frameCount > 0) {
+		uint64_t origin = GetFrame(frameCount - 1).m_start;
+		auto toMicroseconds = [origin](uint64_t a_ticks) {
+			return a_ticks >= origin ? TicksToMilliseconds(a_ticks - origin) * 1000.0 : -TicksToMilliseconds(origin - a_ticks) * 1000.0;
+		};
+
+		for (size_t age = frameCount; age-- > 0;) {
+			const Frame& frame = GetFrame(age);
+			std::string frameName = "Frame " + std::to_string(frame.m_index);
+			AppendEvent(out, frameName.c_str(), threadCount, toMicroseconds(frame.m_start), TicksToMilliseconds(frame.m_end - frame.m_start) * 1000.0);
+			for (const Zone& zone : frame.m_zones) {
+				AppendEvent(out, zone.m_name, zone.m_thread, toMicroseconds(zone.m_start), TicksToMilliseconds(zone.m_end - zone.m_start) * 1000.0);
+			}
+		}
+	}
+
+	out += "\n]}\n";
+	return out;
+}
+
+bool FrameProfiler::WriteChromeTrace(const std::wstring& a_path)
+{
+	std::ofstream file(std::filesystem::path(a_path), std::ios::binary);
+	if (!file) return false;
+
+	std::string trace = ExportChromeTrace();
+	file.write(trace.data(), trace.size());
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// CPU frame profiler. Scopes record entering and leaving a named zone into a
+/// ring buffer owned by the recording thread, without locks, and BeginFrame
+/// drains every ring into the frame that just finished. The last HISTORY
+/// frames are kept for the UI and can be written out as Chrome trace JSON.
+/// Timestamps are TSC ticks where there is one, calibrated against steady_clock.
+/// Knows nothing about D3D or ImGui, Game draws the timeline.
+/// </summary>
+namespace FrameProfiler
+{
+	inline constexpr size_t HISTORY = 120;
+
+	//events per thread between two BeginFrame calls, zones past it are dropped whole
+	inline constexpr size_t EVENTS_PER_THREAD = 1 << 14;
+
+	struct Zone
+	{
+		const char* m_name; // only the pointer is kept, pass string literals
+		uint64_t m_start;
+		uint64_t m_end;
+		uint32_t m_thread; // ring the zone was recorded into, see GetThreadName
+		uint32_t m_depth;  // 0 for a zone with no enclosing zone on its thread
+	};
+
+	struct Frame
+	{
+		uint64_t m_index = 0;
+		uint64_t m_start = 0;
+		uint64_t m_end = 0;
+		std::vector<Zone> m_zones; // by thread, then start, zones belong to the frame they end in
+		uint64_t m_dropped = 0;
+	};
+
+	/// <summary>
+	/// Ends the running frame and starts the next one, once per frame on the
+	/// main thread before anything in the frame is profiled
+	/// </summary>
+	void BeginFrame();
+
+	void SetEnabled(bool a_enabled);
+	bool IsEnabled();
+
+	/// <summary>
+	/// While paused frames are still drained but the history isn't touched
+	/// </summary>
+	void SetPaused(bool a_paused);
+	bool IsPaused();
+
+	uint64_t Now();
+	double TicksToMilliseconds(uint64_t a_ticks);
+
+	void BeginZone(const char* a_name);
+	void EndZone();
+
+	/// <summary>
+	/// Finished frames, age 0 is the latest
+	/// </summary>
+	size_t GetFrameCount();
+	const Frame& GetFrame(size_t a_age);
+
+	uint32_t GetThreadCount();
+	uint32_t GetMainThread(); // the ring of the thread calling BeginFrame
+	std::string GetThreadName(uint32_t a_thread);
+
+	/// <summary>
+	/// Every frame in the history, oldest first, in the Chrome trace event format
+	/// that chrome://tracing and Perfetto open
+	/// </summary>
+	std::string ExportChromeTrace();
+	bool WriteChromeTrace(const std::wstring& a_path);
+
+	/// <summary>
+	/// Profiles the enclosing block, a zone is only ended if it was begun so
+	/// toggling the profiler inside one is safe
+	/// </summary>
+	class Scope
+	{
+	public:
+		explicit Scope(const char* a_name) : m_active(IsEnabled())
+		{
+			if (m_active) BeginZone(a_name);
+		}
+		~Scope()
+		{
+			if (m_active) EndZone();
+		}
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+
+	private:
+		bool m_active;
+	};
+}
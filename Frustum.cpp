@@ -0,0 +1,121 @@
+#include "Frustum.h"
+
+using namespace DirectX;
+
+Frustum::Frustum()
+{
+	//identity view-projection gives the unit clip volume
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	ExtractPlanes(identity);
+}
+
+void Frustum::ExtractPlanes(const XMFLOAT4X4& a_viewProjection)
+{
+	//clip = v * M, so each clip component is v dotted with a column of M
+	const XMFLOAT4X4& m = a_viewProjection;
+	XMVECTOR column1 = XMVectorSet(m._11, m._21, m._31, m._41);
+	XMVECTOR column2 = XMVectorSet(m._12, m._22, m._32, m._42);
+	XMVECTOR column3 = XMVectorSet(m._13, m._23, m._33, m._43);
+	XMVECTOR column4 = XMVectorSet(m._14, m._24, m._34, m._44);
+
+	XMVECTOR planes[PLANE_COUNT] = {
+		XMVectorAdd(column4, column1),		// -w <= x
+		XMVectorSubtract(column4, column1),	// x <= w
+		XMVectorAdd(column4, column2),		// -w <= y
+		XMVectorSubtract(column4, column2),	// y <= w
+		column3,							// 0 <= z
+		XMVectorSubtract(column4, column3)	// z <= w
+	};
+
+	for (int i = 0; i < PLANE_COUNT; i++) {
+		XMStoreFloat4(&m_planes[i], XMPlaneNormalize(planes[i]));
+	}
+}
+
+const XMFLOAT4& Frustum::GetPlane(Plane a_plane) const
+{
+	return m_planes[a_plane];
+}
+
+bool Frustum::IntersectsSphere(const XMFLOAT3& a_center, float a_radius) const
+{
+	for (const XMFLOAT4& plane : m_planes) {
+		float distance = plane.x * a_center.x + plane.y * a_center.y + plane.z * a_center.z + plane.w;
+		if (distance + a_radius < 0.0f) return false;
+	}
+	return true;
+}
+
+bool Frustum::IntersectsBox(const XMFLOAT3& a_center, const XMFLOAT3& a_extents) const
+{
+	for (const XMFLOAT4& plane : m_planes) {
+		float distance = plane.x * a_center.x + plane.y * a_center.y + plane.z * a_center.z + plane.w;
+		//projected half size of the box onto the plane normal
+		float radius =
+			std::fabs(plane.x) * a_extents.x +
+			std::fabs(plane.y) * a_extents.y +
+			std::fabs(plane.z) * a_extents.z;
+		if (distance + radius < 0.0f) return false;
+	}
+	return true;
+}
+
+void Frustum::Cull(const BoundsSoA& a_bounds, std::vector<uint32_t>& a_visible) const
+{
+	a_visible.clear();
+	size_t count = a_bounds.Size();
+	if (count == 0) return;
+
+	//splat each plane once, reused for every batch
+	XMVECTOR planeX[PLANE_COUNT], planeY[PLANE_COUNT], planeZ[PLANE_COUNT], planeW[PLANE_COUNT];
+	XMVECTOR absX[PLANE_COUNT], absY[PLANE_COUNT], absZ[PLANE_COUNT];
+	for (int p = 0; p < PLANE_COUNT; p++) {
+		planeX[p] = XMVectorReplicate(m_planes[p].x);
+		planeY[p] = XMVectorReplicate(m_planes[p].y);
+		planeZ[p] = XMVectorReplicate(m_planes[p].z);
+		planeW[p] = XMVectorReplicate(m_planes[p].w);
+		absX[p] = XMVectorAbs(planeX[p]);
+		absY[p] = XMVectorAbs(planeY[p]);
+		absZ[p] = XMVectorAbs(planeZ[p]);
+	}
+
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR allOutside = XMVectorTrueInt();
+
+	for (size_t i = 0; i < count; i += 4) {
+		XMVECTOR centerX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_bounds.m_centerX[i]));
+		XMVECTOR centerY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_bounds.m_centerY[i]));
+		XMVECTOR centerZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_bounds.m_centerZ[i]));
+		XMVECTOR radius = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_bounds.m_radius[i]));
+
+		//sphere pass, keep the plane distances for the box pass
+		XMVECTOR distance[PLANE_COUNT];
+		XMVECTOR outside = XMVectorFalseInt();
+		for (int p = 0; p < PLANE_COUNT; p++) {
+			distance[p] = XMVectorMultiplyAdd(centerX, planeX[p],
+				XMVectorMultiplyAdd(centerY, planeY[p],
+					XMVectorMultiplyAdd(centerZ, planeZ[p], planeW[p])));
+			outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance[p], radius), zero));
+		}
+		if (XMVector4EqualInt(outside, allOutside)) continue;
+
+		//box pass
+		XMVECTOR extentX = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_bounds.m_extentX[i]));
+		XMVECTOR extentY = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_bounds.m_extentY[i]));
+		XMVECTOR extentZ = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_bounds.m_extentZ[i]));
+		for (int p = 0; p < PLANE_COUNT; p++) {
+			XMVECTOR projectedRadius = XMVectorMultiplyAdd(extentX, absX[p],
+				XMVectorMultiplyAdd(extentY, absY[p],
+					XMVectorMultiply(extentZ, absZ[p])));
+			outside = XMVectorOrInt(outside, XMVectorLess(XMVectorAdd(distance[p], projectedRadius), zero));
+		}
+
+		uint32_t lanes[4];
+		XMStoreInt4(lanes, outside);
+		size_t batchSize = count - i < 4 ? count - i : 4;
+		for (size_t lane = 0; lane < batchSize; lane++) {
+			if (lanes[lane] == 0) a_visible.push_back(static_cast<uint32_t>(i + lane));
+		}
+	}
+}
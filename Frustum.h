@@ -0,0 +1,41 @@
+#pragma once
+#include <DirectXMath.h>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "Bounds.h"
+
+/// <summary>
+/// Six view frustum planes pulled straight out of a view-projection matrix.
+/// Works for any projection (perspective or orthographic) since it only
+/// looks at the combined matrix. Planes face inwards.
+/// </summary>
+class Frustum
+{
+public:
+	enum Plane { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+	Frustum();
+
+	/// <summary>
+	/// Rebuilds the planes, a_viewProjection uses the row vector convention
+	/// and D3D's 0..1 clip depth
+	/// </summary>
+	void ExtractPlanes(const DirectX::XMFLOAT4X4& a_viewProjection);
+
+	const DirectX::XMFLOAT4& GetPlane(Plane a_plane) const;
+
+	//single object tests, reference for the batched path
+	bool IntersectsSphere(const DirectX::XMFLOAT3& a_center, float a_radius) const;
+	bool IntersectsBox(const DirectX::XMFLOAT3& a_center, const DirectX::XMFLOAT3& a_extents) const;
+
+	/// <summary>
+	/// Tests 4 bounds per iteration, sphere first to reject whole batches
+	/// cheaply then the box for anything that survived.
+	/// Indices of visible bounds are written to a_visible in order.
+	/// </summary>
+	void Cull(const BoundsSoA& a_bounds, std::vector<uint32_t>& a_visible) const;
+
+private:
+	std::array<DirectX::XMFLOAT4, PLANE_COUNT> m_planes;
+};
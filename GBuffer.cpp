@@ -0,0 +1,91 @@
+#include "GBuffer.h"
+#include "Graphics.h"
+#include "TiledLightCulling.h"
+
+void GBuffer::Create(unsigned int a_width, unsigned int a_height)
+{
+	if (m_pDepthTexture && a_width == m_width && a_height == m_height) return;
+	m_width = a_width;
+	m_height = a_height;
+	m_tileCountX = TiledLightCulling::GetTileCount(a_width);
+	m_tileCountY = TiledLightCulling::GetTileCount(a_height);
+
+	//albedo through an sRGB view so dark colors keep their precision, alpha stays linear
+	const DXGI_FORMAT formats[TARGET_COUNT] = {
+		DXGI_FORMAT_R8G8B8A8_UNORM_SRGB,
+		DXGI_FORMAT_R8G8B8A8_UNORM,
+		DXGI_FORMAT_R11G11B10_FLOAT };
+
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = a_width;
+	textureDesc.Height = a_height;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = 1;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
+	for (unsigned int i = 0; i < TARGET_COUNT; i++) {
+		m_textures[i].Reset();
+		m_RTVs[i].Reset();
+		m_SRVs[i].Reset();
+		textureDesc.Format = formats[i];
+		Graphics::Device->CreateTexture2D(&textureDesc, 0, m_textures[i].GetAddressOf());
+		Graphics::Device->CreateRenderTargetView(m_textures[i].Get(), 0, m_RTVs[i].GetAddressOf());
+		Graphics::Device->CreateShaderResourceView(m_textures[i].Get(), 0, m_SRVs[i].GetAddressOf());
+	}
+
+	//typeless so the lighting pass can read the depth as a float texture
+	m_pDepthTexture.Reset();
+	m_pDSV.Reset();
+	m_pDepthSRV.Reset();
+	textureDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	Graphics::Device->CreateTexture2D(&textureDesc, 0, m_pDepthTexture.GetAddressOf());
+
+	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+	dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+	Graphics::Device->CreateDepthStencilView(m_pDepthTexture.Get(), &dsvDesc, m_pDSV.GetAddressOf());
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+	Graphics::Device->CreateShaderResourceView(m_pDepthTexture.Get(), &srvDesc, m_pDepthSRV.GetAddressOf());
+
+	//lit image, already gamma corrected like the back buffer
+	m_pLitTexture.Reset();
+	m_pLitUAV.Reset();
+	m_pLitSRV.Reset();
+	textureDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+	textureDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+	Graphics::Device->CreateTexture2D(&textureDesc, 0, m_pLitTexture.GetAddressOf());
+	Graphics::Device->CreateUnorderedAccessView(m_pLitTexture.Get(), 0, m_pLitUAV.GetAddressOf());
+	Graphics::Device->CreateShaderResourceView(m_pLitTexture.Get(), 0, m_pLitSRV.GetAddressOf());
+
+	//a count and TiledLightCulling::MAX_LIGHTS_PER_TILE indices per tile
+	m_pTileLightBuffer.Reset();
+	m_pTileLightUAV.Reset();
+	D3D11_BUFFER_DESC bufferDesc = {};
+	bufferDesc.ByteWidth = m_tileCountX * m_tileCountY * TiledLightCulling::TILE_STRIDE * sizeof(uint32_t);
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS;
+	bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	bufferDesc.StructureByteStride = sizeof(uint32_t);
+	Graphics::Device->CreateBuffer(&bufferDesc, 0, m_pTileLightBuffer.GetAddressOf());
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.NumElements = m_tileCountX * m_tileCountY * TiledLightCulling::TILE_STRIDE;
+	Graphics::Device->CreateUnorderedAccessView(m_pTileLightBuffer.Get(), &uavDesc, m_pTileLightUAV.GetAddressOf());
+}
+
+void GBuffer::Clear()
+{
+	const float black[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	for (unsigned int i = 0; i < TARGET_COUNT; i++) {
+		Graphics::Context->ClearRenderTargetView(m_RTVs[i].Get(), black);
+	}
+	Graphics::Context->ClearDepthStencilView(m_pDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <array>
+
+/// <summary>
+/// Window sized targets of the deferred path. The G-buffer pass writes the
+/// three targets of GBuffer.hlsli plus a depth buffer the lighting pass can
+/// read, DeferredLightingCS.hlsl writes the lit image and one light list per
+/// tile in the TiledLightCulling layout.
+/// </summary>
+class GBuffer
+{
+public:
+	static constexpr unsigned int TARGET_COUNT = 3;
+
+	/// <summary>
+	/// (Re)creates every texture and buffer, does nothing if the size already matches
+	/// </summary>
+	void Create(unsigned int a_width, unsigned int a_height);
+
+	/// <summary>
+	/// Clears the targets to zero and the depth to the far plane
+	/// </summary>
+	void Clear();
+
+	ID3D11RenderTargetView* GetRTV(unsigned int a_target) const { return m_RTVs[a_target].Get(); }
+	ID3D11ShaderResourceView* GetSRV(unsigned int a_target) const { return m_SRVs[a_target].Get(); }
+	ID3D11Texture2D* GetDepthTexture() const { return m_pDepthTexture.Get(); }
+	ID3D11DepthStencilView* GetDSV() const { return m_pDSV.Get(); }
+	ID3D11ShaderResourceView* GetDepthSRV() const { return m_pDepthSRV.Get(); }
+	ID3D11UnorderedAccessView* GetLitUAV() const { return m_pLitUAV.Get(); }
+	ID3D11ShaderResourceView* GetLitSRV() const { return m_pLitSRV.Get(); }
+	ID3D11Buffer* GetTileLightBuffer() const { return m_pTileLightBuffer.Get(); }
+	ID3D11UnorderedAccessView* GetTileLightUAV() const { return m_pTileLightUAV.Get(); }
+
+	unsigned int GetWidth() const { return m_width; }
+	unsigned int GetHeight() const { return m_height; }
+	unsigned int GetTileCountX() const { return m_tileCountX; }
+	unsigned int GetTileCountY() const { return m_tileCountY; }
+
+private:
+	unsigned int m_width = 0;
+	unsigned int m_height = 0;
+	unsigned int m_tileCountX = 0;
+	unsigned int m_tileCountY = 0;
+
+	std::array<Microsoft::WRL::ComPtr<ID3D11Texture2D>, TARGET_COUNT> m_textures;
+	std::array<Microsoft::WRL::ComPtr<ID3D11RenderTargetView>, TARGET_COUNT> m_RTVs;
+	std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, TARGET_COUNT> m_SRVs;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_pDepthTexture;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilView> m_pDSV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pDepthSRV;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_pLitTexture;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_pLitUAV;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pLitSRV;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pTileLightBuffer;
+	Microsoft::WRL::ComPtr<ID3D11UnorderedAccessView> m_pTileLightUAV;
+};
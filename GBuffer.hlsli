@@ -0,0 +1,63 @@
+#ifndef __GBUFFER_HLSLI__
+#define __GBUFFER_HLSLI__
+
+// G-buffer layout of the deferred path, see GBuffer.h
+// - albedo:  RGBA8 sRGB, linear albedo and metalness, the target does the sRGB curve
+// - normal:  RGBA8, octahedral normal in 2 x 12 bits over rgb, roughness in a
+// - ambient: R11G11B10, sky and probe light that needs the object, already times albedo
+// GBufferPacking.h mirrors the normal encoding on the CPU
+
+static const float GBUFFER_NORMAL_MAX = 4095.0f;
+
+struct GBufferOutput
+{
+    float4 albedo : SV_TARGET0;
+    float4 normal : SV_TARGET1;
+    float4 ambient : SV_TARGET2;
+};
+
+float2 EncodeOctahedral(float3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0f)
+    {
+        n.xy = (1.0f - abs(n.yx)) * (n.xy >= 0.0f ? 1.0f : -1.0f);
+    }
+    return n.xy;
+}
+
+float3 DecodeOctahedral(float2 e)
+{
+    float3 n = float3(e, 1.0f - abs(e.x) - abs(e.y));
+    if (n.z < 0.0f)
+    {
+        n.xy = (1.0f - abs(n.yx)) * (n.xy >= 0.0f ? 1.0f : -1.0f);
+    }
+    return normalize(n);
+}
+
+// 12 bits per axis, written as three bytes so the UNORM conversion of the target is exact
+float3 PackNormal(float3 n)
+{
+    uint2 q = (uint2) floor(saturate(EncodeOctahedral(n) * 0.5f + 0.5f) * GBUFFER_NORMAL_MAX + 0.5f);
+    uint3 bytes = uint3(q.x >> 4, ((q.x & 0xF) << 4) | (q.y >> 8), q.y & 0xFF);
+    return bytes / 255.0f;
+}
+
+float3 UnpackNormal(float3 packedNormal)
+{
+    uint3 bytes = (uint3) round(packedNormal * 255.0f);
+    uint2 q = uint2((bytes.x << 4) | (bytes.y >> 4), ((bytes.y & 0xF) << 8) | bytes.z);
+    return DecodeOctahedral(q / GBUFFER_NORMAL_MAX * 2.0f - 1.0f);
+}
+
+GBufferOutput PackGBuffer(float3 albedo, float3 normal, float roughness, float metalness, float3 ambient)
+{
+    GBufferOutput output;
+    output.albedo = float4(albedo, metalness);
+    output.normal = float4(PackNormal(normal), roughness);
+    output.ambient = float4(ambient, 1.0f);
+    return output;
+}
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+#include <DirectXMath.h>
+#include <array>
+#include <cmath>
+#include <cstdint>
+
+/// <summary>
+/// CPU reference of the G-buffer normal encoding in GBuffer.hlsli. Normals are
+/// folded onto an octahedron, giving two values in [-1, 1] that are quantized
+/// to 12 bits each and spread over the three bytes of an RGBA8 target, the
+/// fourth byte is left for roughness. Same rounding as the shader plus the
+/// UNORM conversion of the render target, so the bytes match bit for bit.
+/// </summary>
+namespace GBufferPacking
+{
+	constexpr uint32_t NORMAL_BITS = 12;
+	constexpr uint32_t NORMAL_MAX = (1u << NORMAL_BITS) - 1;
+
+	/// <summary>
+	/// Normalized direction to the unit square, the lower hemisphere is folded over the diagonals
+	/// </summary>
+	inline DirectX::XMFLOAT2 EncodeOctahedral(const DirectX::XMFLOAT3& a_normal)
+	{
+		float length = std::fabs(a_normal.x) + std::fabs(a_normal.y) + std::fabs(a_normal.z);
+		float x = a_normal.x / length;
+		float y = a_normal.y / length;
+		if (a_normal.z < 0.0f) {
+			float foldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float foldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = foldedX;
+			y = foldedY;
+		}
+		return DirectX::XMFLOAT2(x, y);
+	}
+
+	inline DirectX::XMFLOAT3 DecodeOctahedral(const DirectX::XMFLOAT2& a_encoded)
+	{
+		float x = a_encoded.x;
+		float y = a_encoded.y;
+		float z = 1.0f - std::fabs(x) - std::fabs(y);
+		if (z < 0.0f) {
+			float unfoldedX = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+			float unfoldedY = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+			x = unfoldedX;
+			y = unfoldedY;
+		}
+		float length = std::sqrt(x * x + y * y + z * z);
+		return DirectX::XMFLOAT3(x / length, y / length, z / length);
+	}
+
+	/// <summary>
+	/// The three bytes the shader's PackNormal ends up writing
+	/// </summary>
+	inline std::array<uint8_t, 3> PackNormal(const DirectX::XMFLOAT3& a_normal)
+	{
+		DirectX::XMFLOAT2 encoded = EncodeOctahedral(a_normal);
+		auto quantize = [](float a_value) {
+			float unit = a_value * 0.5f + 0.5f;
+			unit = unit < 0.0f ? 0.0f : (unit > 1.0f ? 1.0f : unit);
+			return static_cast<uint32_t>(std::floor(unit * NORMAL_MAX + 0.5f));
+		};
+		uint32_t x = quantize(encoded.x);
+		uint32_t y = quantize(encoded.y);
+		return {
+			static_cast<uint8_t>(x >> 4),
+			static_cast<uint8_t>(((x & 0xF) << 4) | (y >> 8)),
+			static_cast<uint8_t>(y & 0xFF) };
+	}
+
+	inline DirectX::XMFLOAT3 UnpackNormal(const std::array<uint8_t, 3>& a_bytes)
+	{
+		uint32_t x = (static_cast<uint32_t>(a_bytes[0]) << 4) | (a_bytes[1] >> 4);
+		uint32_t y = ((static_cast<uint32_t>(a_bytes[1]) & 0xF) << 8) | a_bytes[2];
+		return DecodeOctahedral(DirectX::XMFLOAT2(
+			static_cast<float>(x) / NORMAL_MAX * 2.0f - 1.0f,
+			static_cast<float>(y) / NORMAL_MAX * 2.0f - 1.0f));
+	}
+}
@@ -1,4 +1,5 @@
 #include "Game.h"
+#include "AllocationCounter.h"
 #include "Graphics.h"
 #include "Vertex.h"
 #include "Input.h"
@@ -10,6 +11,8 @@
 #include <DirectXMath.h>
 #include "WICTextureLoader.h"
 #include "Helper.h"
+#include "DeferredContextSink.h"
+#include "FrameProfiler.h"
 
 //ImGui includes
 #include "ImGui/imgui.h"
@@ -21,6 +24,11 @@
 #include <d3dcompiler.h>
 #include <vector>
 #include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -53,8 +61,94 @@ Game::Game()
 	Microsoft::WRL::ComPtr<ID3D11PixelShader> customPixelShader;
 
 	LoadVertexShader(m_pVSInputLayout, vertexShader, m_pVSConstantBuffer, L"VertexShader.cso");
+	m_pShadowVertexShader = vertexShader;
+
+	//clears single shadow atlas tiles, it only reads SV_VertexID so its layout and buffer are thrown away
+	{
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> unusedInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> unusedConstantBuffer;
+		LoadVertexShader(unusedInputLayout, m_pShadowClearVertexShader, unusedConstantBuffer, L"ShadowClearVS.cso");
+
+		D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+		depthDesc.DepthEnable = true;
+		depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+		depthDesc.DepthFunc = D3D11_COMPARISON_ALWAYS;
+		Graphics::Device->CreateDepthStencilState(&depthDesc, m_pShadowClearDepthState.GetAddressOf());
+	}
+
+	//tiled lighting of the deferred path and its copy into the back buffer, without either only forward is offered
+	{
+		Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+		if (SUCCEEDED(D3DReadFileToBlob(FixPath(L"DeferredLightingCS.cso").c_str(), shaderBlob.GetAddressOf()))) {
+			Graphics::Device->CreateComputeShader(
+				shaderBlob->GetBufferPointer(),
+				shaderBlob->GetBufferSize(),
+				0,
+				m_pDeferredLightingShader.GetAddressOf());
+		}
+		shaderBlob.Reset();
+		if (SUCCEEDED(D3DReadFileToBlob(FixPath(L"DeferredResolvePS.cso").c_str(), shaderBlob.GetAddressOf()))) {
+			Graphics::Device->CreatePixelShader(
+				shaderBlob->GetBufferPointer(),
+				shaderBlob->GetBufferSize(),
+				0,
+				m_pDeferredResolveShader.GetAddressOf());
+		}
+	}
+
+	//instanced variant shares the vertex layout and uses the ring buffer, so its layout and buffer are thrown away
+	{
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> instancedVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> unusedInputLayout;
+		Microsoft::WRL::ComPtr<ID3D11Buffer> unusedConstantBuffer;
+		LoadVertexShader(unusedInputLayout, instancedVertexShader, unusedConstantBuffer, L"VertexShaderInstanced.cso");
+		m_renderQueue.SetInstancedVertexShader(vertexShader, instancedVertexShader);
+	}
+
+	//depth pre-pass shaders read nothing but the position stream, so they get their own one element layout
+	{
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> depthOnlyVertexShader;
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> depthOnlyInstancedVertexShader;
+		Microsoft::WRL::ComPtr<ID3DBlob> shaderBlob;
+		if (SUCCEEDED(D3DReadFileToBlob(FixPath(L"DepthOnlyVS.cso").c_str(), shaderBlob.GetAddressOf()))) {
+			Graphics::Device->CreateVertexShader(
+				shaderBlob->GetBufferPointer(),
+				shaderBlob->GetBufferSize(),
+				0,
+				depthOnlyVertexShader.GetAddressOf());
+
+			D3D11_INPUT_ELEMENT_DESC positionElement = {};
+			positionElement.Format = DXGI_FORMAT_R32G32B32_FLOAT;
+			positionElement.SemanticName = "POSITION";
+			Graphics::Device->CreateInputLayout(
+				&positionElement,
+				1,
+				shaderBlob->GetBufferPointer(),
+				shaderBlob->GetBufferSize(),
+				m_pPositionInputLayout.GetAddressOf());
+		}
+		shaderBlob.Reset();
+		if (SUCCEEDED(D3DReadFileToBlob(FixPath(L"DepthOnlyVSInstanced.cso").c_str(), shaderBlob.GetAddressOf()))) {
+			Graphics::Device->CreateVertexShader(
+				shaderBlob->GetBufferPointer(),
+				shaderBlob->GetBufferSize(),
+				0,
+				depthOnlyInstancedVertexShader.GetAddressOf());
+		}
+		m_renderQueue.SetDepthOnlyVertexShaders(depthOnlyVertexShader, depthOnlyInstancedVertexShader);
+
+		//LESS_EQUAL rather than EQUAL, pre-passed pixels only pass where the depth matches
+		//while entities the pre-pass skipped still test and write as usual
+		D3D11_DEPTH_STENCIL_DESC depthDesc = {};
+		depthDesc.DepthEnable = true;
+		depthDesc.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL;
+		depthDesc.DepthFunc = D3D11_COMPARISON_LESS_EQUAL;
+		Graphics::Device->CreateDepthStencilState(&depthDesc, m_pDepthPrepassShadingState.GetAddressOf());
+	}
 	LoadPixelShader<PSConstantBuffer>(
 		PSConstantBuffer(), pixelShader, m_pPSConstantBuffer, L"PixelShader.cso");
+	m_pDefaultPixelShader = pixelShader;
+	LoadPixelShaderVariants();
 	LoadPixelShader<PSConstantBuffer>(
 		PSConstantBuffer(), uvPixelShader, m_pPSConstantBuffer, L"DebugUVsPS.cso");
 	LoadPixelShader<PSConstantBuffer>(
@@ -87,6 +181,11 @@ Game::Game()
 		m_pSamplerState		
 	);
 
+	//baked ahead of time with the Light probes panel, without a file the probe variants stay off
+	if (m_probeGrid.Load(FixPath(L"../../Assets/probes.bin"))) {
+		m_probeFileBytes = m_probeGrid.GetFileSize();
+	}
+
 
 	std::shared_ptr<Material> uvMaterial = std::make_shared<Material>(
 		DirectX::XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f),
@@ -100,31 +199,39 @@ Game::Game()
 		DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f),
 		vertexShader,
 		customPixelShader);
+	m_materialTable.Add(uvMaterial);
+	m_materialTable.Add(normalsMaterial);
+	m_materialTable.Add(customMaterial);
+
+	GameEntity* uvCube = m_entityPool.Create(m_pCube, uvMaterial);
+	GameEntity* uvCylinder = m_entityPool.Create(m_pCylinder, uvMaterial);
+	GameEntity* uvHelix = m_entityPool.Create(m_pHelix, uvMaterial);
+	uvCube->GetTransform().MoveAbsolute(3.0f, 0.0f, 10.0f);
+	uvCylinder->GetTransform().MoveAbsolute(6.0f, 0.0f, 0.0f);
+	uvHelix->GetTransform().MoveAbsolute(9.0f, 0.0f, -10.0f);
+
+	GameEntity* normalsCube = m_entityPool.Create(m_pCube, normalsMaterial);
+	GameEntity* normalsCylinder = m_entityPool.Create(m_pCylinder, normalsMaterial);
+	GameEntity* normalsHelix = m_entityPool.Create(m_pHelix, normalsMaterial);
+	normalsCube->GetTransform().MoveAbsolute(-3.0f, 0.0f, 10.0f);
+	normalsCylinder->GetTransform().MoveAbsolute(-6.0f, 0.0f, 0.0f);
+	normalsHelix->GetTransform().MoveAbsolute(-12.0f, 0.0f, -10.0f);
+
+	GameEntity* customCube = m_entityPool.Create(m_pCube, customMaterial);
+	GameEntity* customCylinder = m_entityPool.Create(m_pCylinder, customMaterial);
+	GameEntity* customHelix = m_entityPool.Create(m_pHelix, customMaterial);
+	customCube->GetTransform().MoveAbsolute(6.0f, 0.0f, 10.0f);
+	customCylinder->GetTransform().MoveAbsolute(9.0f, 0.0f, 0.0f);
+	customHelix->GetTransform().MoveAbsolute(12.0f, 0.0f, -10.0f);
+
+	//solid boxes make cheap, tight occluders
+	for (GameEntity* entity : { uvCube, normalsCube, customCube }) {
+		entity->m_isOccluder = true;
+	}
 
-	m_entitiesList.push_back(GameEntity(m_pCube, uvMaterial));
-	m_entitiesList.push_back(GameEntity(m_pCylinder, uvMaterial));
-	m_entitiesList.push_back(GameEntity(m_pHelix, uvMaterial));
-	m_entitiesList[3].GetTransform().MoveAbsolute(3.0f, 0.0f, 10.0f);
-	m_entitiesList[4].GetTransform().MoveAbsolute(6.0f, 0.0f, 0.0f);
-	m_entitiesList[5].GetTransform().MoveAbsolute(9.0f, 0.0f, -10.0f);
-
-	m_entitiesList.push_back(GameEntity(m_pCube, normalsMaterial));
-	m_entitiesList.push_back(GameEntity(m_pCylinder, normalsMaterial));
-	m_entitiesList.push_back(GameEntity(m_pHelix, normalsMaterial));
-	m_entitiesList[6].GetTransform().MoveAbsolute(-3.0f, 0.0f, 10.0f);
-	m_entitiesList[7].GetTransform().MoveAbsolute(-6.0f, 0.0f, 0.0f);
-	m_entitiesList[8].GetTransform().MoveAbsolute(-12.0f, 0.0f, -10.0f);
-
-	m_entitiesList.push_back(GameEntity(m_pCube, customMaterial));
-	m_entitiesList.push_back(GameEntity(m_pCylinder, customMaterial));
-	m_entitiesList.push_back(GameEntity(m_pHelix, customMaterial));
-	m_entitiesList[9].GetTransform().MoveAbsolute(6.0f, 0.0f, 10.0f);
-	m_entitiesList[10].GetTransform().MoveAbsolute(9.0f, 0.0f, 0.0f);
-	m_entitiesList[11].GetTransform().MoveAbsolute(12.0f, 0.0f, -10.0f);
-
-	//assign lights
-	for (GameEntity& entity : m_entitiesList) {
-		entity.m_PSConstantBuffer.m_lights = m_lights;
+	//the boxes and cylinders stay put, their local light shadows are drawn once and cached
+	for (GameEntity* entity : { uvCube, uvCylinder, normalsCube, normalsCylinder, customCube, customCylinder }) {
+		entity->m_isStatic = true;
 	}
 
 	// Set initial graphics API state
@@ -135,12 +242,12 @@ Game::Game()
 		// Tell the input assembler (IA) stage of the pipeline what kind of
 		// geometric primitives (points, lines or triangles) we want to draw.  
 		// Essentially: "What kind of shape should the GPU draw with our vertices?"
-		Graphics::Context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		Graphics::State.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
 
 		// Ensure the pipeline knows how to interpret all the numbers stored in
 		// the vertex buffer. For this course, all of your vertices will probably
 		// have the same layout, so we can just set this once at startup.
-		Graphics::Context->IASetInputLayout(m_pVSInputLayout.Get());
+		Graphics::State.IASetInputLayout(m_pVSInputLayout.Get());
 	}
 
 	m_number = 1;
@@ -251,6 +358,203 @@ void Game::LoadPixelShader(
 	Graphics::Device->CreateBuffer(&PS_ConstantBufferDesc, 0, a_pPixelShaderConstantBuffer.GetAddressOf());
 }
 
+// --------------------------------------------------------
+// Loads every PixelShader.hlsl variant the build produced,
+// keys missing from the output folder stay empty
+// --------------------------------------------------------
+void Game::LoadPixelShaderVariants()
+{
+	m_pixelShaderVariantsLoaded = 0;
+	for (uint32_t key = 0; key < ShaderPermutations::VARIANT_COUNT; key++) {
+		m_pixelShaderVariants[key].Reset();
+
+		Microsoft::WRL::ComPtr<ID3DBlob> pixelShaderBlob;
+		if (FAILED(D3DReadFileToBlob(FixPath(ShaderPermutations::GetFileName(key)).c_str(), pixelShaderBlob.GetAddressOf()))) continue;
+
+		Graphics::Device->CreatePixelShader(
+			pixelShaderBlob->GetBufferPointer(),
+			pixelShaderBlob->GetBufferSize(),
+			0,
+			m_pixelShaderVariants[key].GetAddressOf());
+		if (m_pixelShaderVariants[key]) m_pixelShaderVariantsLoaded++;
+	}
+}
+
+/// <summary>
+/// Fixes the material half of a_pMaterial's key from the texture slots it filled,
+/// call after its textures are added
+/// </summary>
+void Game::AddPermutedMaterial(std::shared_ptr<Material> a_pMaterial)
+{
+	const auto& textures = a_pMaterial->GetTextureSRVs();
+	m_permutedMaterials.push_back(a_pMaterial);
+	m_materialFeatures.push_back(ShaderPermutations::GetMaterialFeatures(
+		textures[1] != nullptr,
+		textures[2] != nullptr,
+		textures[3] != nullptr));
+	ResolveShaderPermutations(true);
+}
+
+ID3D11PixelShader* Game::GetPixelShaderVariant(uint32_t a_key) const
+{
+	ID3D11PixelShader* variant = m_pixelShaderVariants[a_key].Get();
+	return variant ? variant : m_pDefaultPixelShader.Get();
+}
+
+/// <summary>
+/// Gives every permuted material the variant for its features and this frame's,
+/// only does work when the frame half or the enabled flag changed
+/// </summary>
+void Game::ResolveShaderPermutations(bool a_force)
+{
+	uint32_t frameFeatures = ShaderPermutations::GetFrameFeatures(
+		m_lights.size() > m_directionalLightCount,
+		m_shadowsEnabled || m_localShadowsEnabled,
+		m_iblEnabled,
+		m_probesEnabled && !m_probeGrid.IsEmpty(),
+		m_deferredEnabled && m_shaderPermutationsEnabled && m_pDeferredLightingShader && m_pDeferredResolveShader);
+	if (!a_force && frameFeatures == m_appliedFrameFeatures && m_shaderPermutationsEnabled == m_appliedPermutationsEnabled) return;
+
+	for (size_t i = 0; i < m_permutedMaterials.size(); i++) {
+		ID3D11PixelShader* pixelShader = m_shaderPermutationsEnabled
+			? GetPixelShaderVariant(ShaderPermutations::Combine(m_materialFeatures[i], frameFeatures))
+			: m_pDefaultPixelShader.Get();
+		m_permutedMaterials[i]->SetPixelShader(pixelShader);
+	}
+	m_appliedFrameFeatures = frameFeatures;
+	m_appliedPermutationsEnabled = m_shaderPermutationsEnabled;
+	m_permutationResolves++;
+}
+
+/// <summary>
+/// Copies the sky cube back to the CPU as linear radiance, every face point
+/// sampled down to at most a_maxSize texels a side. Formats other than 8 bit
+/// RGBA and BGRA keep the baker's flat fallback sky.
+/// </summary>
+ProbeBaker::Sky Game::ReadSkyRadiance(uint32_t a_maxSize)
+{
+	ProbeBaker::Sky sky;
+	ID3D11ShaderResourceView* pSRV = m_sky.GetSRV();
+	if (!pSRV) return sky;
+
+	Microsoft::WRL::ComPtr<ID3D11Resource> pResource;
+	pSRV->GetResource(pResource.GetAddressOf());
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pCube;
+	if (FAILED(pResource->QueryInterface(IID_PPV_ARGS(pCube.GetAddressOf())))) return sky;
+
+	D3D11_TEXTURE2D_DESC desc = {};
+	pCube->GetDesc(&desc);
+	bool bgra = desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM || desc.Format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	bool rgba = desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM || desc.Format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	if ((!bgra && !rgba) || desc.ArraySize < 6 || desc.Width != desc.Height) return sky;
+
+	D3D11_TEXTURE2D_DESC stagingDesc = desc;
+	stagingDesc.Usage = D3D11_USAGE_STAGING;
+	stagingDesc.BindFlags = 0;
+	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	stagingDesc.MiscFlags = 0;
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> pStaging;
+	if (FAILED(Graphics::Device->CreateTexture2D(&stagingDesc, nullptr, pStaging.GetAddressOf()))) return sky;
+	Graphics::Context->CopyResource(pStaging.Get(), pCube.Get());
+
+	//same gamma and scale the shader's sky lookups use
+	std::array<float, 256> toLinear;
+	for (int i = 0; i < 256; i++) toLinear[i] = std::pow(i / 255.0f, 2.2f) * m_probeSkyIntensity;
+
+	uint32_t size = (std::min)(desc.Width, a_maxSize);
+	for (uint32_t face = 0; face < 6; face++) {
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		if (FAILED(Graphics::Context->Map(pStaging.Get(), D3D11CalcSubresource(0, face, desc.MipLevels), D3D11_MAP_READ, 0, &mapped))) return ProbeBaker::Sky();
+
+		std::vector<XMFLOAT3>& texels = sky.m_faces[face];
+		texels.resize(static_cast<size_t>(size) * size);
+		for (uint32_t y = 0; y < size; y++) {
+			const uint8_t* row = static_cast<const uint8_t*>(mapped.pData) + static_cast<size_t>(y * desc.Height / size) * mapped.RowPitch;
+			for (uint32_t x = 0; x < size; x++) {
+				const uint8_t* texel = row + static_cast<size_t>(x * desc.Width / size) * 4;
+				texels[static_cast<size_t>(y) * size + x] = bgra
+					? XMFLOAT3(toLinear[texel[2]], toLinear[texel[1]], toLinear[texel[0]])
+					: XMFLOAT3(toLinear[texel[0]], toLinear[texel[1]], toLinear[texel[2]]);
+			}
+		}
+		Graphics::Context->Unmap(pStaging.Get(), D3D11CalcSubresource(0, face, desc.MipLevels));
+	}
+	sky.m_size = size;
+	return sky;
+}
+
+/// <summary>
+/// Bakes a probe grid over the static entities with the current lights and
+/// sky, then saves it next to the other assets so the next run loads it
+/// </summary>
+void Game::BakeProbes()
+{
+	m_probeBaker.Clear();
+
+	//one triangle Bvh per mesh, shared by every entity drawing it
+	std::unordered_map<Mesh*, uint32_t> meshIds;
+	for (size_t i = 0; i < m_entityPool.Count(); i++) {
+		GameEntity* entity = m_entityPool[i];
+		if (!entity->m_isStatic) continue;
+
+		std::shared_ptr<Mesh> pMesh = entity->GetMesh();
+		auto found = meshIds.find(pMesh.get());
+		if (found == meshIds.end()) {
+			found = meshIds.emplace(pMesh.get(), m_probeBaker.AddMesh(pMesh->GetCpuPositions(), pMesh->GetCpuIndices())).first;
+		}
+
+		//textures are left out, the tint stands in for the surface color
+		XMFLOAT4 tint = entity->GetMaterial()->GetColorTint();
+		entity->GetTransform().CalculateWorldMatrix();
+		m_probeBaker.AddInstance(found->second, entity->GetTransform().GetWorldMatrix(), XMFLOAT3(tint.x, tint.y, tint.z));
+	}
+	//the baker works in float world space, probes sit near the world origin
+	std::vector<Light> worldLights;
+	for (const SceneLight& light : m_lights) worldLights.push_back(light.RelativeTo(Double3()));
+	m_probeBaker.SetLights(worldLights.data(), worldLights.size());
+	m_probeBaker.SetSky(ReadSkyRadiance(64));
+	m_probeBaker.BuildScene();
+
+	m_probeGrid = m_probeBaker.Bake(m_probeSettings);
+	m_probeFileBytes = m_probeGrid.Save(FixPath(L"../../Assets/probes.bin")) ? m_probeGrid.GetFileSize() : 0;
+
+	m_objectIrradianceStates.clear();
+	ResolveShaderPermutations(true);
+}
+
+/// <summary>
+/// Samples the probe grid at the center of every entity that moved since the
+/// last frame, the irradiance buffer is only refilled when one did
+/// </summary>
+void Game::UpdateObjectIrradiance()
+{
+	m_objectIrradianceSamples = 0;
+	if (!m_probesEnabled || m_probeGrid.IsEmpty()) return;
+
+	size_t count = m_entityPool.Count();
+	m_objectIrradianceStates.resize(count);
+	m_objectIrradiance.resize((std::max)(count, size_t(1)));
+	for (size_t i = 0; i < count; i++) {
+		GameEntity* entity = m_entityPool[i];
+		entity->m_irradianceIndex = static_cast<unsigned int>(i);
+
+		ObjectIrradianceState& state = m_objectIrradianceStates[i];
+		uint32_t version = entity->GetTransform().GetVersion();
+		if (state.m_pEntity == entity && state.m_version == version) continue;
+
+		state.m_pEntity = entity;
+		state.m_version = version;
+		m_objectIrradiance[i] = m_probeGrid.Sample(entity->GetWorldBounds().m_center);
+		m_objectIrradianceSamples++;
+	}
+
+	//a rebake clears the states, so an unchanged grid and no moved entity leave the buffer as it is
+	if (m_objectIrradianceSamples > 0 || !m_objectIrradianceBuffer.GetSRV()) {
+		m_objectIrradianceBuffer.Upload(m_objectIrradiance.data(), m_objectIrradiance.size(), sizeof(SphericalHarmonicsL2));
+	}
+	Graphics::State.PSSetShaderResource(OBJECT_IRRADIANCE_SLOT, m_objectIrradianceBuffer.GetSRV());
+}
+
 // --------------------------------------------------------
 // Creates the geometry we're going to draw
 // --------------------------------------------------------
@@ -362,47 +666,58 @@ void Game::CreateEntities(
 	green->AddTextureSRV(3, scratchedMetallic);
 	green->AddSampler(0, m_pSamplerState);
 
-	m_entitiesList.push_back(GameEntity(m_pCube, red));
-	m_entitiesList.push_back(GameEntity(m_pCylinder, white));
-	m_entitiesList.push_back(GameEntity(m_pHelix, green));
+	m_materialTable.Add(red);
+	m_materialTable.Add(white);
+	m_materialTable.Add(green);
+
+	//resolved to their PixelShader.hlsl variant now that their textures are known
+	AddPermutedMaterial(red);
+	AddPermutedMaterial(white);
+	AddPermutedMaterial(green);
+
+	GameEntity* bronzeCube = m_entityPool.Create(m_pCube, red);
+	GameEntity* floorCylinder = m_entityPool.Create(m_pCylinder, white);
+	GameEntity* scratchedHelix = m_entityPool.Create(m_pHelix, green);
 
-	m_entitiesList[0].GetTransform().MoveAbsolute(0.0f, 0.0f, 10.0f);
-	m_entitiesList[1].GetTransform().MoveAbsolute(3.0f, 0.0f, 0.0f);
-	m_entitiesList[2].GetTransform().MoveAbsolute(6.0f, 0.0f, -10.0f);
+	bronzeCube->GetTransform().MoveAbsolute(0.0f, 0.0f, 10.0f);
+	floorCylinder->GetTransform().MoveAbsolute(3.0f, 0.0f, 0.0f);
+	scratchedHelix->GetTransform().MoveAbsolute(6.0f, 0.0f, -10.0f);
 }
 
 void Game::CreateLights()
 {
+	m_lights.resize(5);
+
 	//directional
-	m_lights[0].m_Type = LIGHT_TYPE_DIRECTIONAL;
-	m_lights[0].m_Direction = DirectX::XMFLOAT3{-1.0f, 0.0f, 0.0f};
-	m_lights[0].m_Color = DirectX::XMFLOAT3{1.0f, 1.0f, 1.0f};
-	m_lights[0].m_Intensity = 1.0f;
-
-	m_lights[1].m_Type = LIGHT_TYPE_POINT;
-	m_lights[1].m_Position = DirectX::XMFLOAT3{0.0f, 0.0f, 0.0f};
-	m_lights[1].m_Color = DirectX::XMFLOAT3{1.0f, 1.0f, 1.0f};
-	m_lights[1].m_Intensity = 1.0f;
-	m_lights[1].m_Range = 10.0f;
-
-	m_lights[2].m_Type = LIGHT_TYPE_DIRECTIONAL;
-	m_lights[2].m_Direction = DirectX::XMFLOAT3{0.0f, 1.0f, 0.0f};
-	m_lights[2].m_Color = DirectX::XMFLOAT3{0.0f, 1.0f, 0.0f};
-	m_lights[2].m_Intensity = 1.0f;
-
-	m_lights[3].m_Type = LIGHT_TYPE_DIRECTIONAL;
-	m_lights[3].m_Direction = DirectX::XMFLOAT3{0.0f, -1.0f, 0.0f};
-	m_lights[3].m_Color = DirectX::XMFLOAT3{1.0f, 0.0f, 1.0f};
-	m_lights[3].m_Intensity = 1.0f;
-
-	m_lights[4].m_Type = LIGHT_TYPE_SPOT;
-	m_lights[4].m_Direction = DirectX::XMFLOAT3{0.0f, 0.0f, 1.0f};
-	m_lights[4].m_Color = DirectX::XMFLOAT3{1.0f, 1.0f, 1.0f};
-	m_lights[4].m_Position = DirectX::XMFLOAT3{4.0f, 0.0f, -2.0f};
-	m_lights[4].m_SpotOuterAngle = 80 * 3.14f / 180;
-	m_lights[4].m_SpotInnerAngle = 60 * 3.14f / 180;
-	m_lights[4].m_Intensity = 1.0f;
-	m_lights[4].m_Range = 100.0f;
+	m_lights[0].m_light.m_Type = LIGHT_TYPE_DIRECTIONAL;
+	m_lights[0].m_light.m_Direction = DirectX::XMFLOAT3{-1.0f, 0.0f, 0.0f};
+	m_lights[0].m_light.m_Color = DirectX::XMFLOAT3{1.0f, 1.0f, 1.0f};
+	m_lights[0].m_light.m_Intensity = 1.0f;
+
+	m_lights[1].m_light.m_Type = LIGHT_TYPE_POINT;
+	m_lights[1].m_position = Double3(0.0, 0.0, 0.0);
+	m_lights[1].m_light.m_Color = DirectX::XMFLOAT3{1.0f, 1.0f, 1.0f};
+	m_lights[1].m_light.m_Intensity = 1.0f;
+	m_lights[1].m_light.m_Range = 10.0f;
+
+	m_lights[2].m_light.m_Type = LIGHT_TYPE_DIRECTIONAL;
+	m_lights[2].m_light.m_Direction = DirectX::XMFLOAT3{0.0f, 1.0f, 0.0f};
+	m_lights[2].m_light.m_Color = DirectX::XMFLOAT3{0.0f, 1.0f, 0.0f};
+	m_lights[2].m_light.m_Intensity = 1.0f;
+
+	m_lights[3].m_light.m_Type = LIGHT_TYPE_DIRECTIONAL;
+	m_lights[3].m_light.m_Direction = DirectX::XMFLOAT3{0.0f, -1.0f, 0.0f};
+	m_lights[3].m_light.m_Color = DirectX::XMFLOAT3{1.0f, 0.0f, 1.0f};
+	m_lights[3].m_light.m_Intensity = 1.0f;
+
+	m_lights[4].m_light.m_Type = LIGHT_TYPE_SPOT;
+	m_lights[4].m_light.m_Direction = DirectX::XMFLOAT3{0.0f, 0.0f, 1.0f};
+	m_lights[4].m_light.m_Color = DirectX::XMFLOAT3{1.0f, 1.0f, 1.0f};
+	m_lights[4].m_position = Double3(4.0, 0.0, -2.0);
+	m_lights[4].m_light.m_SpotOuterAngle = 80 * 3.14f / 180;
+	m_lights[4].m_light.m_SpotInnerAngle = 60 * 3.14f / 180;
+	m_lights[4].m_light.m_Intensity = 1.0f;
+	m_lights[4].m_light.m_Range = 100.0f;
 }
 
 
@@ -426,23 +741,44 @@ void Game::OnResize()
 // --------------------------------------------------------
 void Game::Update(float deltaTime, float totalTime)
 {
+	FrameProfiler::Scope zone("Update");
 	RefreshGUI(deltaTime);
 	BuildUI();
 	// Example input checking: Quit if the escape key is pressed
 	if (Input::KeyDown(VK_ESCAPE))
 		Window::Quit();
 
-	for (GameEntity& ent : m_entitiesList) {
-		ent.m_lifetimeMs += deltaTime;
+	//entities aren't simulated at the fixed step, whatever moved them this frame
+	//(the inspector) is where they render, not blended from the last tick
+	for (GameEntity* ent : m_entityPool) {
+		ent->m_lifetimeMs += deltaTime;
+		ent->GetTransform().SavePreviousState();
 	}
-	//for (GameEntity& object : m_entitiesList) {
-	//	object.GetTransform().MoveAbsolute(sin(totalTime * 2) * deltaTime, sin(totalTime * 2) * deltaTime, 0.0f);
+	//for (GameEntity* object : m_entityPool) {
+	//	object->GetTransform().MoveAbsolute(sin(totalTime * 2) * deltaTime, sin(totalTime * 2) * deltaTime, 0.0f);
 	//}
 	m_pActiveCamera->Update(deltaTime);
 }
 
+// --------------------------------------------------------
+// Simulation step, runs at a fixed rate independent of framerate
+// --------------------------------------------------------
+void Game::FixedUpdate(float stepSeconds)
+{
+	FrameProfiler::Scope zone("FixedUpdate");
+	//fixed step state is the camera position only, it snapshots its own previous tick
+	//and is interpolated when drawn, mouse look and entities stay per frame in Update
+	m_pActiveCamera->FixedUpdate(stepSeconds);
+}
+
+FixedTimestep& Game::GetTimestep()
+{
+	return m_timestep;
+}
+
 //Builds custom GUI
 void Game::BuildUI() {
+	FrameProfiler::Scope zone("BuildUI");
 	//building window
 	ImGui::SetNextWindowSize({m_menuWidth, m_menuHeight});
 
@@ -458,6 +794,276 @@ void Game::BuildUI() {
 	{
 		ImGui::Text("Framerate: %f", ImGui::GetIO().Framerate);
 		ImGui::Text("Window dimensions: %dx%d", Window::Width(), Window::Height());
+		ImGui::Text("Constant buffer uploads: %u", m_cbUploadsLastFrame);
+		ImGui::Text("Constant bytes copied: %u", m_cbBytesUploadedLastFrame);
+		ImGui::Text("Constant bytes reserved: %u", m_cbBytesReservedLastFrame);
+		ImGui::Text("Constant ring: %u KB, high water %u KB, grown %u times",
+			Graphics::cbRing.GetCapacity() / 1024, Graphics::cbRing.GetHighWaterBytes() / 1024, Graphics::cbGrowCount);
+		ImGui::Text("Constant bytes in flight: %u", Graphics::cbRing.GetBytesInFlight());
+
+		//same per entity cost scaled up, per frame data is only paid once
+		unsigned int perEntityBytes = sizeof(VertexShaderConstantBuffer) + sizeof(PSConstantBuffer);
+		ImGui::Text("Estimated bytes for 10k entities: %u", perEntityBytes * 10000 + (unsigned int)sizeof(PerFrameConstantBuffer));
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Profiler"))
+	{
+		bool recording = FrameProfiler::IsEnabled();
+		if (ImGui::Checkbox("Record zones", &recording)) {
+			FrameProfiler::SetEnabled(recording);
+		}
+		ImGui::SameLine();
+		bool paused = FrameProfiler::IsPaused();
+		if (ImGui::Checkbox("Pause", &paused)) {
+			FrameProfiler::SetPaused(paused);
+		}
+
+		int frameCount = static_cast<int>(FrameProfiler::GetFrameCount());
+		if (frameCount > 0) {
+			//oldest on the left, click a bar to look at that frame
+			float frameMs[FrameProfiler::HISTORY];
+			float slowestMs = 0.0f;
+			for (int age = 0; age < frameCount; age++) {
+				const FrameProfiler::Frame& frame = FrameProfiler::GetFrame(age);
+				frameMs[frameCount - 1 - age] = static_cast<float>(FrameProfiler::TicksToMilliseconds(frame.m_end - frame.m_start));
+				slowestMs = (std::max)(slowestMs, frameMs[frameCount - 1 - age]);
+			}
+			ImGui::PlotHistogram("##FrameTimes", frameMs, frameCount, 0, nullptr, 0.0f, slowestMs, ImVec2(ImGui::GetContentRegionAvail().x, 50.0f));
+			if (ImGui::IsItemClicked()) {
+				float position = (ImGui::GetIO().MousePos.x - ImGui::GetItemRectMin().x) / (std::max)(ImGui::GetItemRectSize().x, 1.0f);
+				m_profilerFrameAge = frameCount - 1 - static_cast<int>(position * frameCount);
+			}
+			m_profilerFrameAge = std::clamp(m_profilerFrameAge, 0, frameCount - 1);
+			ImGui::SliderInt("Frames ago", &m_profilerFrameAge, 0, frameCount - 1);
+
+			const FrameProfiler::Frame& frame = FrameProfiler::GetFrame(m_profilerFrameAge);
+			ImGui::Text("Frame %llu: %.3fms, %zu zones, %llu dropped",
+				static_cast<unsigned long long>(frame.m_index),
+				FrameProfiler::TicksToMilliseconds(frame.m_end - frame.m_start),
+				frame.m_zones.size(),
+				static_cast<unsigned long long>(frame.m_dropped));
+			DrawProfilerTimeline(frame);
+
+			//total time and calls per zone name over every thread
+			std::vector<std::pair<const char*, std::pair<uint64_t, int>>> totals;
+			for (const FrameProfiler::Zone& zone : frame.m_zones) {
+				auto total = std::find_if(totals.begin(), totals.end(), [&](const auto& a_total) { return strcmp(a_total.first, zone.m_name) == 0; });
+				if (total == totals.end()) {
+					totals.push_back({ zone.m_name, { 0, 0 } });
+					total = totals.end() - 1;
+				}
+				total->second.first += zone.m_end - zone.m_start;
+				total->second.second++;
+			}
+			std::sort(totals.begin(), totals.end(), [](const auto& a_a, const auto& a_b) { return a_a.second.first > a_b.second.first; });
+			if (ImGui::BeginTable("ProfilerZones", 3)) {
+				ImGui::TableSetupColumn("Zone");
+				ImGui::TableSetupColumn("Calls");
+				ImGui::TableSetupColumn("Total ms");
+				ImGui::TableHeadersRow();
+				for (const auto& total : totals) {
+					ImGui::TableNextRow();
+					ImGui::TableNextColumn();
+					ImGui::Text("%s", total.first);
+					ImGui::TableNextColumn();
+					ImGui::Text("%d", total.second.second);
+					ImGui::TableNextColumn();
+					ImGui::Text("%.3f", FrameProfiler::TicksToMilliseconds(total.second.first));
+				}
+				ImGui::EndTable();
+			}
+		}
+
+		if (ImGui::Button("Export Chrome trace")) {
+			std::wstring path = FixPath(L"profile.json");
+			m_profilerTraceStatus = (FrameProfiler::WriteChromeTrace(path) ? "Wrote " : "Couldn't write ") + WideToNarrow(path);
+		}
+		if (!m_profilerTraceStatus.empty()) {
+			ImGui::TextWrapped("%s", m_profilerTraceStatus.c_str());
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("State filtering"))
+	{
+		ImGui::Text("Issued: %u, skipped: %u", m_stateCountersLastFrame.TotalIssued(), m_stateCountersLastFrame.TotalSkipped());
+		ImGui::Text("Heap allocations last frame: %llu", static_cast<unsigned long long>(m_allocationsLastFrame));
+
+		const char* categoryNames[] = { "Shaders", "Shader resources", "Samplers", "Constant buffers", "Input assembler", "Pipeline states" };
+		if (ImGui::BeginTable("StateCalls", 3)) {
+			ImGui::TableSetupColumn("Calls");
+			ImGui::TableSetupColumn("Issued");
+			ImGui::TableSetupColumn("Skipped");
+			ImGui::TableHeadersRow();
+			for (int i = 0; i < GraphicsStateCache::CATEGORY_COUNT; i++) {
+				ImGui::TableNextRow();
+				ImGui::TableNextColumn();
+				ImGui::Text("%s", categoryNames[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", m_stateCountersLastFrame.m_issued[i]);
+				ImGui::TableNextColumn();
+				ImGui::Text("%u", m_stateCountersLastFrame.m_skipped[i]);
+			}
+			ImGui::EndTable();
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Simulation"))
+	{
+		if (ImGui::SliderFloat("Tick rate (Hz)", &m_simulationRateHz, 10.0f, 240.0f)) {
+			m_timestep.SetStepSeconds(1.0 / m_simulationRateHz);
+		}
+		int maxSubsteps = m_timestep.GetMaxSubsteps();
+		if (ImGui::SliderInt("Max substeps", &maxSubsteps, 1, 16)) {
+			m_timestep.SetMaxSubsteps(maxSubsteps);
+		}
+		ImGui::Text("Ticks: %llu", (unsigned long long)m_timestep.GetTickCount());
+		ImGui::Text("Substeps last frame: %d", m_timestep.GetLastSubstepCount());
+		ImGui::Text("Interpolation alpha: %.2f", m_timestep.GetAlpha());
+		ImGui::Text("Dropped time: %.3fs", m_timestep.GetDroppedSeconds());
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Frustum culling"))
+	{
+		ImGui::Checkbox("Enabled", &m_frustumCullingEnabled);
+		ImGui::Text("Visible: %zu / %zu", m_visibleIndices.size(), m_entityPool.Count());
+		ImGui::Text("Cull time: %.3fms", m_cullTimeMs);
+
+		ImGui::Checkbox("Occlusion culling", &m_occlusionCullingEnabled);
+		ImGui::Text("Occluded: %zu (%zu occluder triangles, %.3fms)",
+			m_occludedLastFrame, m_occlusionCuller.GetTriangleCount(), m_occlusionTimeMs);
+
+		ImGui::Checkbox("Use scene BVH", &m_useSceneBvh);
+		ImGui::Text("BVH nodes: %zu, refits last frame: %zu", m_sceneBvh.GetNodeCount(), m_bvhRefitsLastFrame);
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Render queue"))
+	{
+		const RenderQueue::Stats& stats = m_renderQueue.GetStats();
+		ImGui::Checkbox("Instancing", &m_renderQueue.m_instancingEnabled);
+		ImGui::Checkbox("Range material binds", &m_renderQueue.m_materialRangeBinds);
+		ImGui::Text("Material table: %zu materials, %u uploads", m_materialTable.Count(), m_materialTable.GetUploadCount());
+		ImGui::Text("Draw calls: %zu for %zu entities", stats.m_draws, stats.m_instances);
+		ImGui::Text("Instanced draws: %zu", stats.m_instancedDraws);
+		if (stats.m_instances > 0) {
+			ImGui::Text("Draw call reduction: %.1f%%", 100.0 * (1.0 - static_cast<double>(stats.m_draws) / stats.m_instances));
+		}
+		ImGui::Text("Shader binds: %zu", stats.m_shaderBinds);
+		ImGui::Text("Material binds: %zu", stats.m_materialBinds);
+		ImGui::Text("Mesh binds: %zu", stats.m_meshBinds);
+		ImGui::Text("Sort: %.3fms", stats.m_sortMs);
+		ImGui::Checkbox("Deferred contexts", &m_renderQueue.m_deferredContextsEnabled);
+		ImGui::SliderInt("Recording threads", &m_renderQueue.m_maxRecordingThreads, 1, 8);
+		ImGui::Text("Chunks: %zu, record and execute: %.3fms", stats.m_chunks, stats.m_recordMs);
+		ImGui::Text("Command lists: %zu bytes", stats.m_commandBytes);
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Shader permutations"))
+	{
+		ImGui::Checkbox("Specialized pixel shaders", &m_shaderPermutationsEnabled);
+		ImGui::Checkbox("Sky ambient and reflections", &m_iblEnabled);
+		ImGui::Text("Variants loaded: %zu of %u", m_pixelShaderVariantsLoaded, ShaderPermutations::VARIANT_COUNT);
+		ImGui::Text("Frame features: %s", ShaderPermutations::Describe(m_appliedFrameFeatures).c_str());
+		for (size_t i = 0; i < m_permutedMaterials.size(); i++) {
+			uint32_t key = ShaderPermutations::Combine(m_materialFeatures[i], m_appliedFrameFeatures);
+			ImGui::Text("Material %u: key %u%s, %s",
+				m_permutedMaterials[i]->GetTableIndex(), key,
+				m_pixelShaderVariants[key] ? "" : " (default shader)",
+				ShaderPermutations::Describe(m_materialFeatures[i]).c_str());
+		}
+		ImGui::Text("Resolves: %zu", m_permutationResolves);
+
+		if (ImGui::Button("Write build manifest")) {
+			ShaderPermutations::WriteManifest(FixPath(L"../../PixelShaderPermutations.txt"));
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Reload variants")) {
+			LoadPixelShaderVariants();
+			ResolveShaderPermutations(true);
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Light probes"))
+	{
+		ImGui::Checkbox("Probe irradiance", &m_probesEnabled);
+		if (m_probeGrid.IsEmpty()) {
+			ImGui::Text("No probes, bake to create Assets/probes.bin");
+		}
+		else {
+			ImGui::Text("Grid: %u x %u x %u, spacing %.2f %.2f %.2f, file %zu bytes",
+				m_probeGrid.GetCountX(), m_probeGrid.GetCountY(), m_probeGrid.GetCountZ(),
+				m_probeGrid.GetSpacing().x, m_probeGrid.GetSpacing().y, m_probeGrid.GetSpacing().z, m_probeFileBytes);
+			ImGui::Text("Objects resampled this frame: %zu", m_objectIrradianceSamples);
+		}
+
+		int probeCounts[3] = { static_cast<int>(m_probeSettings.m_countX), static_cast<int>(m_probeSettings.m_countY), static_cast<int>(m_probeSettings.m_countZ) };
+		if (ImGui::SliderInt3("Probes", probeCounts, 1, 32)) {
+			m_probeSettings.m_countX = probeCounts[0];
+			m_probeSettings.m_countY = probeCounts[1];
+			m_probeSettings.m_countZ = probeCounts[2];
+		}
+		int samples = static_cast<int>(m_probeSettings.m_samplesPerProbe);
+		if (ImGui::SliderInt("Samples per probe", &samples, 16, 8192)) m_probeSettings.m_samplesPerProbe = samples;
+		int threads = static_cast<int>(m_probeSettings.m_maxThreads);
+		if (ImGui::SliderInt("Bake threads", &threads, 1, 32)) m_probeSettings.m_maxThreads = threads;
+		ImGui::SliderFloat("Sky intensity", &m_probeSkyIntensity, 0.0f, 2.0f);
+		if (ImGui::Button("Bake probes")) {
+			BakeProbes();
+		}
+
+		const ProbeBaker::Report& report = m_probeBaker.GetReport();
+		if (report.m_probeCount > 0) {
+			ImGui::Text("Scene: %zu meshes, %zu triangles, %zu instances, built in %.2fms",
+				report.m_meshCount, report.m_triangleCount, report.m_instanceCount, report.m_buildMs);
+			ImGui::Text("Bake: %zu probes in %.1fms on %u threads, %.2f Mrays/s",
+				report.m_probeCount, report.m_bakeMs, report.m_threads,
+				report.m_bakeMs > 0.0 ? report.m_rays / (report.m_bakeMs * 1000.0) : 0.0);
+			for (size_t i = 0; i < report.m_roundSamples.size(); i++) {
+				ImGui::Text("%u samples: irradiance changed %.2f%%", report.m_roundSamples[i], report.m_roundChange[i] * 100.0f);
+			}
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Deferred shading"))
+	{
+		if (!m_pDeferredLightingShader || !m_pDeferredResolveShader) {
+			ImGui::Text("Deferred shaders didn't load, forward only");
+		}
+		ImGui::Checkbox("Deferred path", &m_deferredEnabled);
+		if (m_deferredEnabled && !m_shaderPermutationsEnabled) {
+			ImGui::Text("Needs specialized pixel shaders for the G-buffer variants");
+		}
+		ImGui::Text("G-buffer draws: %zu, forward draws: %zu", m_deferredDraws, m_renderQueue.GetStats().m_draws);
+		ImGui::Text("Tiles: %u x %u of %u pixels", m_gBuffer.GetTileCountX(), m_gBuffer.GetTileCountY(), TiledLightCulling::TILE_SIZE);
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Depth pre-pass"))
+	{
+		if (!m_pPositionInputLayout || !m_renderQueue.HasDepthOnlyShaders()) {
+			ImGui::Text("Depth only shaders didn't load, shading tests depth by itself");
+		}
+		ImGui::Checkbox("Depth pre-pass", &m_depthPrepassEnabled);
+		if (m_depthPrepassEnabled) {
+			const RenderQueue::Stats& depthStats = m_renderQueue.GetDepthOnlyStats();
+			ImGui::Text("Depth draws: %zu for %zu entities, %zu instanced", depthStats.m_draws, depthStats.m_instances, depthStats.m_instancedDraws);
+			ImGui::Text("Front to back sort: %.3fms, record and execute: %.3fms", depthStats.m_sortMs, depthStats.m_recordMs);
+		}
+		ImGui::TreePop();
+	}
+
+	if (ImGui::TreeNode("Entity pool"))
+	{
+		ImGui::Text("Live entities: %zu", m_entityPool.Count());
+		ImGui::Text("Capacity: %zu (%zu chunks)", m_entityPool.Capacity(), m_entityPool.ChunkCount());
+		ImGui::Text("Fragmentation: %.1f%%", m_entityPool.GetFragmentation() * 100.0f);
 		ImGui::TreePop();
 	}
 
@@ -485,10 +1091,10 @@ void Game::BuildUI() {
 	ImGui::SliderFloat("How high would you like the window?", &m_menuHeight, 400.0f, 720.0f, "%f");
 
 	if (ImGui::TreeNode("Scene Objects")) {
-		for (int i = 1; i < 13; i++) {
-			ImGui::PushID(i);
-			if (ImGui::TreeNode("", "Object %d", i)) {
-				GameEntity* currentObject = &m_entitiesList[i - 1];
+		for (size_t i = 0; i < m_entityPool.Count(); i++) {
+			GameEntity* currentObject = m_entityPool[i];
+			ImGui::PushID(currentObject);
+			if (ImGui::TreeNode("", "Object %zu", i + 1)) {
 				DirectX::XMFLOAT3 position = currentObject->GetTransform().GetPosition();
 				DirectX::XMFLOAT4 rotation = currentObject->GetTransform().GetRotation();
 				DirectX::XMFLOAT3 scale = currentObject->GetTransform().GetScale();
@@ -510,6 +1116,8 @@ void Game::BuildUI() {
 				ImGui::Text("Triangles: %d", triangleCount);
 				ImGui::Text("Vertices: %d", vertexCount);
 				ImGui::Text("Indicies: %d", indexCount);
+				ImGui::Checkbox("Occluder", &currentObject->m_isOccluder);
+				ImGui::Checkbox("Static shadow caster", &currentObject->m_isStatic);
 				
 				if (ImGui::TreeNode("Material")) {
 					std::shared_ptr<Material> currentMaterial = currentObject->GetMaterial();
@@ -525,8 +1133,9 @@ void Game::BuildUI() {
 					if (ImGui::DragFloat2("UV Offset", &UVoffset.x, 0.1f, 0.0f, 10.0f)) {
 						currentMaterial->SetUVOffset(UVoffset.x, UVoffset.y);
 					}
-					for (const auto& [key, value] : currentMaterial->GetSRVMap()) {
-						ImGui::Image((void*)value.Get(), ImVec2(100, 100));
+					const auto& textures = currentMaterial->GetTextureSRVs();
+					for (unsigned int t = 0; t < currentMaterial->GetTextureCount(); t++) {
+						if (textures[t]) ImGui::Image((void*)textures[t].Get(), ImVec2(100, 100));
 					}
 					ImGui::TreePop();
 				}
@@ -582,8 +1191,94 @@ void Game::BuildUI() {
 
 
 	if (ImGui::TreeNode("Lights")) {
-		for (Light& light : m_lights) {
-			ImGui::PushID(&light);
+		//upload cost follows the light count, not lights times entities
+		ImGui::Text("%zu lights, %zu bytes uploaded per frame", m_lights.size(), m_lightBytesLastFrame);
+		ImGui::Text("Per draw pixel constants: %zu bytes", sizeof(PSConstantBuffer));
+		if (ImGui::Button("Add point light")) {
+			SceneLight light;
+			light.m_light.m_Type = LIGHT_TYPE_POINT;
+			light.m_light.m_Color = DirectX::XMFLOAT3{ 1.0f, 1.0f, 1.0f };
+			light.m_light.m_Intensity = 1.0f;
+			light.m_light.m_Range = 10.0f;
+			light.m_position = Double3(static_cast<double>(m_lights.size() % 8) * 3.0 - 12.0, 2.0, 0.0);
+			m_lights.push_back(light);
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Remove light") && !m_lights.empty()) {
+			m_lights.pop_back();
+		}
+
+		if (ImGui::TreeNode("Clusters")) {
+			size_t clusterCount = m_lightClusters.GetClusterCount();
+			ImGui::Text("%ux%ux%u clusters, binned in %.3fms",
+				m_lightClusters.GetCountX(), m_lightClusters.GetCountY(), m_lightClusters.GetCountZ(), m_clusterTimeMs);
+			ImGui::Text("Lights per cluster: %.2f average, %u max, %zu dropped",
+				static_cast<float>(m_lightClusters.GetIndices().size()) / clusterCount,
+				m_lightClusters.GetMaxLightsInCluster(), m_lightClusters.GetOverflowCount());
+			if (ImGui::Button("Scatter 1000 point lights")) {
+				std::mt19937 random(static_cast<unsigned int>(m_lights.size()));
+				std::uniform_real_distribution<float> position(-40.0f, 40.0f);
+				std::uniform_real_distribution<float> color(0.2f, 1.0f);
+				for (int i = 0; i < 1000; i++) {
+					SceneLight light;
+					light.m_light.m_Type = LIGHT_TYPE_POINT;
+					light.m_position = Double3(position(random), position(random) * 0.25f, position(random));
+					light.m_light.m_Color = DirectX::XMFLOAT3{ color(random), color(random), color(random) };
+					light.m_light.m_Intensity = 1.0f;
+					light.m_light.m_Range = 4.0f;
+					m_lights.push_back(light);
+				}
+			}
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Shadows")) {
+			ImGui::Checkbox("Cascaded shadows", &m_shadowsEnabled);
+			int cascadeCount = static_cast<int>(m_shadowCascades.m_cascadeCount);
+			if (ImGui::SliderInt("Cascades", &cascadeCount, 1, static_cast<int>(ShadowCascades::MAX_CASCADES))) {
+				m_shadowCascades.m_cascadeCount = static_cast<uint32_t>(cascadeCount);
+			}
+			ImGui::SliderFloat("Split lambda", &m_shadowCascades.m_splitLambda, 0.0f, 1.0f);
+			ImGui::SliderFloat("Shadow distance", &m_shadowCascades.m_maxDistance, 10.0f, 500.0f);
+			ImGui::SliderInt("Depth bias", &m_shadowMap.m_depthBias, 0, 10000);
+			ImGui::SliderFloat("Slope scaled bias", &m_shadowMap.m_slopeScaledDepthBias, 0.0f, 8.0f);
+			ImGui::Text("Shadow pass: %.3fms", m_shadowTimeMs);
+			for (uint32_t i = 0; i < m_shadowCascades.GetCascadeCount(); i++) {
+				const ShadowCascade& cascade = m_shadowCascades.GetCascade(i);
+				ImGui::Text("Cascade %u: %.2f to %.2f, radius %.2f, %zu casters",
+					i, cascade.m_nearDepth, cascade.m_farDepth, cascade.m_radius, m_shadowCasterCounts[i]);
+			}
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Local shadows")) {
+			ImGui::Checkbox("Point and spot light shadows", &m_localShadowsEnabled);
+			ImGui::SliderInt("Shadowed lights", &m_localShadowMaxLights, 1, 32);
+			ImGui::SliderFloat("Texels per screen pixel", &m_localShadows.m_resolutionScale, 0.25f, 4.0f);
+			if (ImGui::Button("Invalidate cached shadows")) {
+				m_localShadows.InvalidateAll();
+			}
+
+			const ShadowAtlas& atlas = m_localShadows.GetAtlas();
+			ImGui::Text("%zu lights, %zu tiles, atlas %.1f%% used",
+				m_localShadows.GetShadowedLightCount(), atlas.GetTileCount(),
+				100.0 * atlas.GetUsedArea() / (static_cast<double>(atlas.GetSize()) * atlas.GetSize()));
+			ImGui::Text("Faces redrawn: %zu static, %zu dynamic, %zu lights resized",
+				m_localShadowStaticRenders, m_localShadowDynamicRenders, m_localShadows.GetReallocationCount());
+			ImGui::Text("Local shadow pass: %.3fms", m_localShadowTimeMs);
+			ImGui::TreePop();
+		}
+
+		if (ImGui::TreeNode("Light BVH")) {
+			ImGui::Checkbox("Most important lights per cluster", &m_lightBvhEnabled);
+			ImGui::SliderInt("Lights per cluster", &m_lightBvhBudget, 1, static_cast<int>(LightClusters::MAX_LIGHTS_PER_CLUSTER));
+			ImGui::Text("%zu lights, %zu nodes", m_lightBvh.GetLightCount(), m_lightBvh.GetNodeCount());
+			ImGui::TreePop();
+		}
+
+		for (SceneLight& sceneLight : m_lights) {
+			Light& light = sceneLight.m_light;
+			ImGui::PushID(&sceneLight);
 			const char* lightType;
 			switch (light.m_Type) {
 			case 0:
@@ -601,25 +1296,15 @@ void Game::BuildUI() {
 			}
 
 			if (ImGui::TreeNode("", "%s Light", lightType)) {
-				if (ImGui::DragFloat3("Position", &light.m_Position.x, 0.1f, 0.0f, 10.0f))
-				{
-					UpdateLights();
-				}
+				ImGui::DragScalarN("Position", ImGuiDataType_Double, &sceneLight.m_position.x, 3, 0.1f);
 				if (ImGui::DragFloat3("Direction", &light.m_Direction.x, 0.1f, -10.0f, 10.0f)) {
 					//normalize direction
 					DirectX::XMVECTOR normalized = DirectX::XMLoadFloat3(&light.m_Direction);
 					normalized = DirectX::XMVector3Normalize(normalized);
 					DirectX::XMStoreFloat3(&light.m_Direction, normalized);
-					UpdateLights();
-				}
-				if (ImGui::DragFloat3("Color", &light.m_Color.x, 0.1f, 0.0f, 1.0f))
-				{
-					UpdateLights();
-				}
-				if (ImGui::DragFloat("Intensity", &light.m_Intensity, 0.1f, 0.0f, 10.0f))
-				{
-					UpdateLights();
 				}
+				ImGui::DragFloat3("Color", &light.m_Color.x, 0.1f, 0.0f, 1.0f);
+				ImGui::DragFloat("Intensity", &light.m_Intensity, 0.1f, 0.0f, 10.0f);
 				ImGui::TreePop();
 			}
 			ImGui::PopID();
@@ -657,11 +1342,35 @@ void Game::RefreshGUI(float deltaTime) {
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	FrameProfiler::Scope zone("Draw");
 	// Frame START
 	// - These things should happen ONCE PER FRAME
 	// - At the beginning of Game::Draw() before drawing *anything*
 
 	{
+		//includes waiting on the GPU for a free constant buffer frame
+		FrameProfiler::Scope zone("Begin frame");
+
+		//keep last frame's upload stats for the UI before counting this one
+		m_cbBytesUploadedLastFrame = Graphics::cbBytesUploaded;
+		m_cbBytesReservedLastFrame = Graphics::cbBytesReserved;
+		m_cbUploadsLastFrame = Graphics::cbUploadCount;
+		Graphics::cbBytesUploaded = 0;
+		Graphics::cbBytesReserved = 0;
+		Graphics::cbUploadCount = 0;
+
+		//ImGui and Present bind state behind the cache's back, start each frame from nothing
+		m_stateCountersLastFrame = Graphics::State.GetCounters();
+		Graphics::State.ResetCounters();
+		Graphics::State.Invalidate();
+
+		uint64_t allocations = AllocationCounter::GetCount();
+		m_allocationsLastFrame = allocations - m_allocationsAtFrameStart;
+		m_allocationsAtFrameStart = allocations;
+
+		//waits if the GPU is more than Graphics::cbFramesInFlight frames behind
+		Graphics::BeginConstantBufferFrame();
+
 		// Clear the back buffer (erase what's on screen) and depth buffer
 		Graphics::Context->ClearRenderTargetView(Graphics::BackBufferRTV.Get(),	m_color);
 		Graphics::Context->ClearDepthStencilView(Graphics::DepthBufferDSV.Get(), D3D11_CLEAR_DEPTH, 1.0f, 0);
@@ -693,12 +1402,80 @@ void Game::Draw(float deltaTime, float totalTime)
 	//		0);    // Offset to add to each index when looking up vertices
 	//}
 
+	//render between the last two simulation ticks
+	float interpolationAlpha = m_timestep.GetAlpha();
+	m_pActiveCamera->UpdateViewMatrix(interpolationAlpha);
+
+	UploadLights();
+	RenderShadows(interpolationAlpha);
+
+	//lit materials switch variants only when the lights, shadows, IBL or probe toggles change
+	ResolveShaderPermutations();
+	Graphics::State.PSSetShaderResource(Sky::SHADER_SLOT, m_sky.GetSRV());
+	UpdateObjectIrradiance();
+
+	//per frame data, uploaded once instead of once per entity and shared by the VS and PS
+	{
+		PerFrameConstantBuffer perFrame;
+		perFrame.m_viewMatrix = m_pActiveCamera->GetViewMatrix();
+		perFrame.m_projectionMatrix = m_pActiveCamera->GetProjectionMatrix();
+		perFrame.m_viewProjectionMatrix = m_pActiveCamera->GetViewProjectionMatrix();
+		perFrame.m_cameraPosition = m_pActiveCamera->GetRelativePosition();
+		perFrame.m_lightCount = static_cast<unsigned int>(m_relativeLights.size());
+		perFrame.m_directionalLightCount = m_directionalLightCount;
+		perFrame.m_clusterCounts = { m_lightClusters.GetCountX(), m_lightClusters.GetCountY(), m_lightClusters.GetCountZ() };
+		perFrame.m_clusterTileScale = {
+			static_cast<float>(m_lightClusters.GetCountX()) / Window::Width(),
+			static_cast<float>(m_lightClusters.GetCountY()) / Window::Height() };
+		perFrame.m_clusterSliceScale = m_lightClusters.GetSliceScale();
+		perFrame.m_clusterSliceBias = m_lightClusters.GetSliceBias();
+
+		Graphics::ConstantBufferAllocation allocation = Graphics::MapNextConstantBuffer(sizeof(perFrame));
+		memcpy(allocation.m_pData, &perFrame, sizeof(perFrame));
+		Graphics::UnmapConstantBuffer(allocation);
+		Graphics::BindConstantBufferRange(allocation.m_pBuffer, allocation.m_offsetInBytes, sizeof(perFrame), D3D11_VERTEX_SHADER, 1);
+		Graphics::BindConstantBufferRange(allocation.m_pBuffer, allocation.m_offsetInBytes, sizeof(perFrame), D3D11_PIXEL_SHADER, 1);
+	}
+
+	//material constants for every draw, indexed with PSConstantBuffer::m_materialIndex
+	m_materialTable.Update();
+
+	CullEntities();
+
 	{
-		for (GameEntity& entity : m_entitiesList) {
-			entity.GetMaterial()->BindTexturesAndSamplers();
-			entity.Draw(m_pVSConstantBuffer, m_pPSConstantBuffer, m_pActiveCamera);
+		//the deferred path draws what it can and leaves the rest to the forward queue below
+		const std::vector<uint32_t>* pForwardIndices = &m_visibleIndices;
+		if (m_appliedPermutationsEnabled && (m_appliedFrameFeatures & ShaderPermutations::DEFERRED)) {
+			RenderDeferred(interpolationAlpha);
+			pForwardIndices = &m_forwardIndices;
+		}
+		else {
+			m_deferredDraws = 0;
+		}
+
+		QueueVisibleEntities(*pForwardIndices);
+		m_renderQueue.Sort();
+
+		//depth first from the position streams, front to back, then the state sorted shading only runs on visible pixels
+		bool depthPrepass = m_depthPrepassEnabled && m_pPositionInputLayout && m_renderQueue.HasDepthOnlyShaders();
+		if (depthPrepass) {
+			Graphics::State.IASetInputLayout(m_pPositionInputLayout.Get());
+			m_renderQueue.SubmitDepthOnly(m_pActiveCamera, interpolationAlpha);
+			Graphics::State.IASetInputLayout(m_pVSInputLayout.Get());
+			Graphics::State.OMSetDepthStencilState(m_pDepthPrepassShadingState.Get(), 0);
+		}
+
+		m_renderQueue.Submit(m_pActiveCamera, interpolationAlpha);
+		if (depthPrepass) {
+			Graphics::State.OMSetDepthStencilState(nullptr, 0);
+		}
+
+		{
+			FrameProfiler::Scope zone("Sky");
+			m_frameCommands.Clear();
+			m_sky.Draw(m_pActiveCamera, m_frameCommands);
+			D3D11RenderBackend().Execute(m_frameCommands);
 		}
-		m_sky.Draw(m_pActiveCamera);
 	}
 
 	// Frame END
@@ -706,12 +1483,19 @@ void Game::Draw(float deltaTime, float totalTime)
 	// - At the very end of the frame (after drawing *everything*)
 	{
 		// Present at the end of the frame
-		ImGui::Render(); //renderable triangles
-		ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); //draws to screen
+		{
+			FrameProfiler::Scope zone("ImGui render");
+			ImGui::Render(); //renderable triangles
+			ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData()); //draws to screen
+		}
+		Graphics::EndConstantBufferFrame();
 		bool vsync = Graphics::VsyncState();
-		Graphics::SwapChain->Present(
-			vsync ? 1 : 0,
-			vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		{
+			FrameProfiler::Scope zone("Present");
+			Graphics::SwapChain->Present(
+				vsync ? 1 : 0,
+				vsync ? 0 : DXGI_PRESENT_ALLOW_TEARING);
+		}
 
 		// Re-bind back buffer and depth buffer after presenting
 		Graphics::Context->OMSetRenderTargets(
@@ -722,11 +1506,654 @@ void Game::Draw(float deltaTime, float totalTime)
 
 }
 
-void Game::UpdateLights() {
-	for (GameEntity& entity : m_entitiesList) {
-		entity.m_PSConstantBuffer.m_lights = m_lights;
+void Game::UploadLights() {
+	FrameProfiler::Scope zone("Lights");
+	//picks the shadowed lights first, their shadow index goes up with them
+	UpdateLocalShadows();
+
+	//light positions are uploaded relative to the render origin, same as entities
+	const Double3& origin = m_pActiveCamera->GetRenderOrigin();
+	//directional lights go first, every pixel reads them, the clusters index the rest
+	m_relativeLights.clear();
+	for (int pass = 0; pass < 2; pass++) {
+		for (size_t i = 0; i < m_lights.size(); i++) {
+			const SceneLight& light = m_lights[i];
+			if ((light.m_light.m_Type == LIGHT_TYPE_DIRECTIONAL) != (pass == 0)) continue;
+			m_relativeLights.push_back(light.RelativeTo(origin));
+			m_relativeLights.back().m_ShadowIndex = m_localShadows.GetShadowIndex(i);
+		}
+		if (pass == 0) m_directionalLightCount = static_cast<unsigned int>(m_relativeLights.size());
+	}
+
+	//one copy of every light per frame, however many entities read them
+	m_lightBytesLastFrame = m_lightBuffer.Upload(m_relativeLights.data(), m_relativeLights.size(), sizeof(Light));
+	Graphics::State.PSSetShaderResource(LIGHT_BUFFER_SLOT, m_lightBuffer.GetSRV());
+
+	BinLights();
+}
+
+/// <summary>
+/// Bins the point and spot lights into the active camera's clusters
+/// and uploads the per-cluster index lists
+/// </summary>
+void Game::BinLights()
+{
+	auto start = std::chrono::steady_clock::now();
+
+	m_lightClusters.SetProjection(
+		m_pActiveCamera->GetProjectionMatrix(),
+		m_pActiveCamera->GetNearPlane(),
+		m_pActiveCamera->GetFarPlane(),
+		m_pActiveCamera->GetProjection() == Projection::ORTHOGRAPHIC);
+
+	//the view matrix is relative to the render origin like the lights
+	DirectX::XMFLOAT4X4 viewMatrix = m_pActiveCamera->GetViewMatrix();
+	DirectX::XMMATRIX view = DirectX::XMLoadFloat4x4(&viewMatrix);
+
+	if (m_lightBvhEnabled) {
+		m_lightBvh.Update(m_relativeLights.data() + m_directionalLightCount, m_relativeLights.size() - m_directionalLightCount);
+
+		DirectX::XMFLOAT4X4 viewToRelative;
+		DirectX::XMStoreFloat4x4(&viewToRelative, DirectX::XMMatrixInverse(nullptr, view));
+		m_lightClusters.SelectFromBvh(m_lightBvh, viewToRelative, static_cast<uint32_t>(m_lightBvhBudget));
+	}
+	else {
+		m_lightSpheres.clear();
+		for (size_t i = m_directionalLightCount; i < m_relativeLights.size(); i++) {
+			const Light& light = m_relativeLights[i];
+			DirectX::XMFLOAT3 center;
+			DirectX::XMStoreFloat3(&center, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&light.m_Position), view));
+			m_lightSpheres.push_back(DirectX::XMFLOAT4(center.x, center.y, center.z, light.m_Range));
+		}
+		m_lightClusters.Bin(m_lightSpheres);
+	}
+
+	m_clusterTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+	const std::vector<uint32_t>& indices = m_lightClusters.GetIndices();
+	const std::vector<ClusterRange>& ranges = m_lightClusters.GetRanges();
+	m_lightBytesLastFrame += m_clusterIndexBuffer.Upload(indices.data(), indices.size(), sizeof(uint32_t));
+	m_lightBytesLastFrame += m_clusterRangeBuffer.Upload(ranges.data(), ranges.size(), sizeof(ClusterRange));
+	Graphics::State.PSSetShaderResource(CLUSTER_LIGHT_INDEX_SLOT, m_clusterIndexBuffer.GetSRV());
+	Graphics::State.PSSetShaderResource(CLUSTER_RANGE_SLOT, m_clusterRangeBuffer.GetSRV());
+}
+
+/// <summary>
+/// Fills m_visibleIndices with the pool indices of entities inside the active camera's frustum
+/// </summary>
+void Game::CullEntities()
+{
+	FrameProfiler::Scope zone("Culling");
+	auto start = std::chrono::steady_clock::now();
+
+	//bounds and planes are both relative to the render origin
+	m_frustum.ExtractPlanes(m_pActiveCamera->GetViewProjectionMatrix());
+	const Double3& origin = m_pActiveCamera->GetRenderOrigin();
+
+	if (!m_frustumCullingEnabled) {
+		m_visibleIndices.resize(m_entityPool.Count());
+		for (size_t i = 0; i < m_visibleIndices.size(); i++) {
+			m_visibleIndices[i] = static_cast<uint32_t>(i);
+		}
+	}
+	else if (m_useSceneBvh) {
+		SyncSceneBvh(origin);
+		m_sceneBvh.QueryFrustum(m_frustum, m_visibleIndices);
+	}
+	else {
+		m_cullBounds.Clear();
+		m_cullBounds.Reserve(m_entityPool.Count());
+		for (GameEntity* entity : m_entityPool) {
+			m_cullBounds.Add(entity->GetRelativeBounds(origin));
+		}
+		m_frustum.Cull(m_cullBounds, m_visibleIndices);
+	}
+
+	auto end = std::chrono::steady_clock::now();
+	m_cullTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+	m_occludedLastFrame = 0;
+	if (m_occlusionCullingEnabled) {
+		CullOccludedEntities();
 	}
 }
 
+/// <summary>
+/// Adds the entities of a_indices to the render queue with their view depth
+/// </summary>
+void Game::QueueVisibleEntities(const std::vector<uint32_t>& a_indices)
+{
+	FrameProfiler::Scope zone("Queue");
+	m_renderQueue.Clear();
+
+	const Double3& origin = m_pActiveCamera->GetRenderOrigin();
+	const DirectX::XMFLOAT4X4 view = m_pActiveCamera->GetViewMatrix();
+	float inverseFarPlane = 1.0f / m_pActiveCamera->GetFarPlane();
+
+	for (uint32_t index : a_indices) {
+		GameEntity* entity = m_entityPool[index];
+
+		//view space z of the entity origin, front to back within a state group
+		DirectX::XMFLOAT3 position = entity->GetTransform().GetWorldPosition().RelativeTo(origin);
+		float viewDepth = position.x * view._13 + position.y * view._23 + position.z * view._33 + view._43;
+		m_renderQueue.Add(entity, RenderPass::OPAQUE_GEOMETRY, viewDepth * inverseFarPlane);
+	}
+}
+
+/// <summary>
+/// Draws the entities whose material has a deferred variant into the G-buffer,
+/// lights it per tile with DeferredLightingCS.hlsl and copies the lit image and
+/// its depth into the window's targets. The rest is left in m_forwardIndices.
+/// </summary>
+void Game::RenderDeferred(float a_interpolationAlpha)
+{
+	FrameProfiler::Scope zone("Deferred");
+	//only the permuted materials were given a G-buffer variant
+	m_deferredIndices.clear();
+	m_forwardIndices.clear();
+	for (uint32_t index : m_visibleIndices) {
+		std::shared_ptr<Material> pMaterial = m_entityPool[index]->GetMaterial();
+		bool permuted = std::find(m_permutedMaterials.begin(), m_permutedMaterials.end(), pMaterial) != m_permutedMaterials.end();
+		(permuted ? m_deferredIndices : m_forwardIndices).push_back(index);
+	}
+
+	m_gBuffer.Create(Window::Width(), Window::Height());
+	m_gBuffer.Clear();
+	ID3D11RenderTargetView* targets[GBuffer::TARGET_COUNT];
+	for (unsigned int i = 0; i < GBuffer::TARGET_COUNT; i++) {
+		targets[i] = m_gBuffer.GetRTV(i);
+	}
+	Graphics::Context->OMSetRenderTargets(GBuffer::TARGET_COUNT, targets, m_gBuffer.GetDSV());
+
+	QueueVisibleEntities(m_deferredIndices);
+	m_renderQueue.Sort();
+	m_renderQueue.Submit(m_pActiveCamera, a_interpolationAlpha);
+	m_deferredDraws = m_renderQueue.GetStats().m_draws;
+
+	//the light functions read the same lights, shadows and per frame constants the pixel shader was given
+	PipelineBaseline frame;
+	frame.Capture(Graphics::Context.Get());
+	Graphics::Context->OMSetRenderTargets(0, nullptr, nullptr);
+
+	DirectX::XMFLOAT4X4 projection = m_pActiveCamera->GetProjectionMatrix();
+	DirectX::XMFLOAT4X4 viewProjection = m_pActiveCamera->GetViewProjectionMatrix();
+	DeferredConstantBuffer constants;
+	DirectX::XMStoreFloat4x4(&constants.m_inverseViewProjection, DirectX::XMMatrixInverse(nullptr, DirectX::XMLoadFloat4x4(&viewProjection)));
+	constants.m_projectionX = projection._11;
+	constants.m_projectionY = projection._22;
+	constants.m_depthScale = projection._33;
+	constants.m_depthBias = projection._43;
+	constants.m_tileCounts = { m_gBuffer.GetTileCountX(), m_gBuffer.GetTileCountY() };
+	constants.m_screenSize = { m_gBuffer.GetWidth(), m_gBuffer.GetHeight() };
+	constants.m_orthographic = m_pActiveCamera->GetProjection() == Projection::ORTHOGRAPHIC ? 1 : 0;
+
+	Graphics::ConstantBufferAllocation allocation = Graphics::MapNextConstantBuffer(sizeof(constants));
+	memcpy(allocation.m_pData, &constants, sizeof(constants));
+	Graphics::UnmapConstantBuffer(allocation);
+
+	//the state cache only shadows the graphics stages, compute binds go straight to the context
+	unsigned int firstConstant = allocation.m_offsetInBytes / 16;
+	unsigned int numConstants = ConstantBufferRing::Align(sizeof(constants)) / 16;
+	Graphics::Context->CSSetConstantBuffers1(0, 1, &allocation.m_pBuffer, &firstConstant, &numConstants);
+	Graphics::Context->CSSetConstantBuffers1(1, 1, frame.m_pPixelPerFrameBuffer.GetAddressOf(), &frame.m_pixelPerFrameFirstConstant, &frame.m_pixelPerFrameNumConstants);
+	Graphics::Context->CSSetConstantBuffers1(SHADOW_CONSTANT_BUFFER_SLOT, 1, frame.m_pShadowBuffer.GetAddressOf(), &frame.m_shadowFirstConstant, &frame.m_shadowNumConstants);
+	Graphics::Context->CSSetSamplers(SHADOW_SAMPLER_SLOT, 1, frame.m_pShadowSampler.GetAddressOf());
+
+	ID3D11ShaderResourceView* frameViews[PipelineBaseline::PIXEL_FRAME_SLOT_COUNT];
+	for (unsigned int i = 0; i < PipelineBaseline::PIXEL_FRAME_SLOT_COUNT; i++) {
+		frameViews[i] = frame.m_pPixelFrameSRVs[i].Get();
+	}
+	Graphics::Context->CSSetShaderResources(PipelineBaseline::PIXEL_FRAME_FIRST_SLOT, PipelineBaseline::PIXEL_FRAME_SLOT_COUNT, frameViews);
+
+	ID3D11ShaderResourceView* gBufferViews[GBuffer::TARGET_COUNT + 1] = { m_gBuffer.GetSRV(0), m_gBuffer.GetSRV(1), m_gBuffer.GetSRV(2), m_gBuffer.GetDepthSRV() };
+	ID3D11UnorderedAccessView* outputs[2] = { m_gBuffer.GetTileLightUAV(), m_gBuffer.GetLitUAV() };
+	Graphics::Context->CSSetShaderResources(0, GBuffer::TARGET_COUNT + 1, gBufferViews);
+	Graphics::Context->CSSetUnorderedAccessViews(0, 2, outputs, nullptr);
+	Graphics::Context->CSSetShader(m_pDeferredLightingShader.Get(), nullptr, 0);
+	Graphics::Context->Dispatch(m_gBuffer.GetTileCountX(), m_gBuffer.GetTileCountY(), 1);
+
+	//unbound so the resolve and the next frame's G-buffer pass can use them, the
+	//frame views as well since the shadow maps and atlas are drawn into next frame
+	ID3D11ShaderResourceView* noViews[GBuffer::TARGET_COUNT + 1] = {};
+	ID3D11ShaderResourceView* noFrameViews[PipelineBaseline::PIXEL_FRAME_SLOT_COUNT] = {};
+	ID3D11UnorderedAccessView* noOutputs[2] = {};
+	Graphics::Context->CSSetShaderResources(0, GBuffer::TARGET_COUNT + 1, noViews);
+	Graphics::Context->CSSetShaderResources(PipelineBaseline::PIXEL_FRAME_FIRST_SLOT, PipelineBaseline::PIXEL_FRAME_SLOT_COUNT, noFrameViews);
+	Graphics::Context->CSSetUnorderedAccessViews(0, 2, noOutputs, nullptr);
+	Graphics::Context->CSSetShader(nullptr, nullptr, 0);
+
+	//lit pixels and their depth into the window, the shadow clear triangle covers the viewport as well
+	Graphics::Context->OMSetRenderTargets(1, Graphics::BackBufferRTV.GetAddressOf(), Graphics::DepthBufferDSV.Get());
+	Graphics::State.IASetInputLayout(nullptr);
+	Graphics::State.VSSetShader(m_pShadowClearVertexShader.Get());
+	Graphics::State.PSSetShader(m_pDeferredResolveShader.Get());
+	Graphics::State.PSSetShaderResource(0, m_gBuffer.GetLitSRV());
+	Graphics::State.PSSetShaderResource(1, m_gBuffer.GetDepthSRV());
+	Graphics::State.RSSetState(nullptr);
+	Graphics::State.OMSetDepthStencilState(m_pShadowClearDepthState.Get(), 0);
+	Graphics::Context->Draw(3, 0);
+	Graphics::State.OMSetDepthStencilState(nullptr, 0);
+	Graphics::State.PSSetShaderResource(0, nullptr);
+	Graphics::State.PSSetShaderResource(1, nullptr);
+	Graphics::State.IASetInputLayout(m_pVSInputLayout.Get());
+}
+
+/// <summary>
+/// Draws a_frame as one lane per thread that recorded anything, the main thread
+/// first, with a row per nesting depth. Hovering a zone shows its length.
+/// </summary>
+void Game::DrawProfilerTimeline(const FrameProfiler::Frame& a_frame)
+{
+	uint32_t threadCount = FrameProfiler::GetThreadCount();
+	uint32_t mainThread = FrameProfiler::GetMainThread();
+	std::vector<uint32_t> laneRows(threadCount, 0);
+	for (const FrameProfiler::Zone& zone : a_frame.m_zones) {
+		laneRows[zone.m_thread] = (std::max)(laneRows[zone.m_thread], zone.m_depth + 1);
+	}
+
+	//each lane is a row with the thread's name and then its zone rows
+	float rowHeight = ImGui::GetTextLineHeightWithSpacing();
+	std::vector<float> laneTops(threadCount, 0.0f);
+	float height = 0.0f;
+	auto addLane = [&](uint32_t a_thread) {
+		laneTops[a_thread] = height + rowHeight;
+		height += rowHeight * (laneRows[a_thread] + 1);
+	};
+	if (mainThread < threadCount) addLane(mainThread);
+	for (uint32_t thread = 0; thread < threadCount; thread++) {
+		if (thread != mainThread && laneRows[thread] > 0) addLane(thread);
+	}
+
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	float width = (std::max)(ImGui::GetContentRegionAvail().x, 1.0f);
+	ImGui::InvisibleButton("ProfilerTimeline", ImVec2(width, (std::max)(height, rowHeight)));
+	bool hovered = ImGui::IsItemHovered();
+	ImVec2 mouse = ImGui::GetIO().MousePos;
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+
+	for (uint32_t thread = 0; thread < threadCount; thread++) {
+		if (thread != mainThread && laneRows[thread] == 0) continue;
+		drawList->AddText(ImVec2(origin.x, origin.y + laneTops[thread] - rowHeight), ImGui::GetColorU32(ImGuiCol_Text), FrameProfiler::GetThreadName(thread).c_str());
+	}
+
+	//zones can start in the frame before, they are clipped to this one
+	double frameTicks = static_cast<double>((std::max)(a_frame.m_end - a_frame.m_start, uint64_t(1)));
+	for (const FrameProfiler::Zone& zone : a_frame.m_zones) {
+		double start = std::clamp(static_cast<int64_t>(zone.m_start - a_frame.m_start) / frameTicks, 0.0, 1.0);
+		double end = std::clamp(static_cast<int64_t>(zone.m_end - a_frame.m_start) / frameTicks, 0.0, 1.0);
+		ImVec2 zoneMin(origin.x + static_cast<float>(start * width), origin.y + laneTops[zone.m_thread] + zone.m_depth * rowHeight);
+		ImVec2 zoneMax((std::max)(origin.x + static_cast<float>(end * width), zoneMin.x + 1.0f), zoneMin.y + rowHeight - 1.0f);
+
+		//colored by name so a zone keeps its color from frame to frame
+		uint32_t hash = 2166136261u;
+		for (const char* c = zone.m_name; *c; c++) hash = (hash ^ static_cast<uint8_t>(*c)) * 16777619u;
+		drawList->AddRectFilled(zoneMin, zoneMax, ImColor::HSV((hash % 360) / 360.0f, 0.5f, 0.8f));
+		if (zoneMax.x - zoneMin.x > ImGui::CalcTextSize(zone.m_name).x + 4.0f) {
+			drawList->AddText(ImVec2(zoneMin.x + 2.0f, zoneMin.y), IM_COL32_BLACK, zone.m_name);
+		}
+
+		if (hovered && mouse.x >= zoneMin.x && mouse.x < zoneMax.x && mouse.y >= zoneMin.y && mouse.y < zoneMax.y) {
+			ImGui::SetTooltip("%s\n%s, depth %u\n%.3fms", zone.m_name, FrameProfiler::GetThreadName(zone.m_thread).c_str(),
+				zone.m_depth, FrameProfiler::TicksToMilliseconds(zone.m_end - zone.m_start));
+		}
+	}
+}
+
+/// <summary>
+/// Rasterizes occluder entities into the software depth buffer and
+/// drops anything in m_visibleIndices that ends up fully behind them
+/// </summary>
+void Game::CullOccludedEntities()
+{
+	auto start = std::chrono::steady_clock::now();
+	const Double3& origin = m_pActiveCamera->GetRenderOrigin();
+
+	m_occlusionCuller.BeginFrame(m_pActiveCamera->GetViewProjectionMatrix());
+	for (GameEntity* entity : m_entityPool) {
+		if (!entity->m_isOccluder) continue;
+
+		std::shared_ptr<Mesh> mesh = entity->GetMesh();
+		m_occlusionCuller.AddOccluder(
+			mesh->GetCpuPositions().data(),
+			mesh->GetCpuIndices().data(),
+			static_cast<uint32_t>(mesh->GetCpuIndices().size()),
+			entity->GetTransform().GetRelativeWorldMatrix(origin));
+	}
+	m_occlusionCuller.Rasterize();
+
+	m_occlusionCandidates.resize(m_visibleIndices.size());
+	for (size_t i = 0; i < m_visibleIndices.size(); i++) {
+		m_occlusionCandidates[i] = m_entityPool[m_visibleIndices[i]]->GetRelativeBounds(origin);
+	}
+
+	size_t candidateCount = m_visibleIndices.size();
+	m_occlusionCuller.FilterVisible(m_occlusionCandidates, m_visibleIndices);
+	m_occludedLastFrame = candidateCount - m_visibleIndices.size();
+
+	auto end = std::chrono::steady_clock::now();
+	m_occlusionTimeMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+/// <summary>
+/// Keeps the scene BVH in step with the entity pool, in the same render origin
+/// relative space as the frustum so float boxes stay precise far from the world
+/// origin. Pool changes rebuild it, a rebased origin refits every box and moved
+/// transforms only refit their leaf path.
+/// </summary>
+void Game::SyncSceneBvh(const Double3& a_origin)
+{
+	m_bvhRefitsLastFrame = 0;
+	size_t poolChanges = m_entityPool.TotalCreated() + m_entityPool.TotalDestroyed();
+	bool rebuild = poolChanges != m_bvhPoolChanges || m_bvhBounds.size() != m_entityPool.Count();
+
+	if (rebuild || a_origin != m_bvhOrigin) {
+		m_bvhPoolChanges = poolChanges;
+		m_bvhOrigin = a_origin;
+		m_bvhBounds.resize(m_entityPool.Count());
+		m_bvhTransformVersions.resize(m_entityPool.Count());
+		for (size_t i = 0; i < m_entityPool.Count(); i++) {
+			m_bvhBounds[i] = m_entityPool[i]->GetRelativeBounds(m_bvhOrigin);
+			m_bvhTransformVersions[i] = m_entityPool[i]->GetTransform().GetVersion();
+		}
+
+		//moving the origin shifts every box by the same amount, the topology still fits
+		if (rebuild) {
+			m_sceneBvh.Build(m_bvhBounds);
+		}
+		else {
+			m_sceneBvh.Refit(m_bvhBounds);
+			m_bvhRefitsLastFrame = m_bvhBounds.size();
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < m_entityPool.Count(); i++) {
+		uint32_t version = m_entityPool[i]->GetTransform().GetVersion();
+		if (version == m_bvhTransformVersions[i]) continue;
+
+		m_bvhTransformVersions[i] = version;
+		m_bvhBounds[i] = m_entityPool[i]->GetRelativeBounds(m_bvhOrigin);
+		m_sceneBvh.UpdateObject(static_cast<uint32_t>(i), m_bvhBounds[i]);
+		m_bvhRefitsLastFrame++;
+	}
+}
+
+/// <summary>
+/// Fits the cascades to the active camera and draws every caster each one can see
+/// into its slice of the shadow map, then binds the map and matrices for the main pass
+/// </summary>
+void Game::RenderShadows(float a_interpolationAlpha)
+{
+	FrameProfiler::Scope zone("Shadows");
+	auto start = std::chrono::steady_clock::now();
+
+	//the maps are about to be depth targets, they can't stay bound as textures
+	Graphics::State.PSSetShaderResource(SHADOW_MAP_SLOT, nullptr);
+	Graphics::State.PSSetShaderResource(LOCAL_SHADOW_ATLAS_SLOT, nullptr);
+
+	ShadowConstantBuffer constants;
+	if (m_shadowsEnabled && m_directionalLightCount > 0) {
+		m_shadowMap.Create(m_shadowCascades.m_resolution, ShadowCascades::MAX_CASCADES);
+
+		const Double3& origin = m_pActiveCamera->GetRenderOrigin();
+		m_shadowCascades.Fit(
+			m_pActiveCamera->GetViewMatrix(),
+			m_pActiveCamera->GetProjectionMatrix(),
+			m_pActiveCamera->GetNearPlane(),
+			m_pActiveCamera->GetFarPlane(),
+			m_pActiveCamera->GetProjection() == Projection::ORTHOGRAPHIC,
+			m_relativeLights[0].m_Direction,
+			origin);
+
+		m_shadowCasterBounds.Clear();
+		m_shadowCasterBounds.Reserve(m_entityPool.Count());
+		for (GameEntity* entity : m_entityPool) {
+			m_shadowCasterBounds.Add(entity->GetRelativeBounds(origin));
+		}
+
+		D3D11_VIEWPORT viewport = {};
+		viewport.Width = static_cast<float>(m_shadowMap.GetResolution());
+		viewport.Height = static_cast<float>(m_shadowMap.GetResolution());
+		viewport.MaxDepth = 1.0f;
+		Graphics::Context->RSSetViewports(1, &viewport);
+
+		for (uint32_t i = 0; i < m_shadowCascades.GetCascadeCount(); i++) {
+			const ShadowCascade& cascade = m_shadowCascades.GetCascade(i);
+			m_shadowCascades.CullCasters(i, m_shadowCasterBounds, m_shadowCasters);
+			m_shadowCasterCounts[i] = m_shadowCasters.size();
+
+			ID3D11DepthStencilView* dsv = m_shadowMap.GetDSV(i);
+			Graphics::Context->ClearDepthStencilView(dsv, D3D11_CLEAR_DEPTH, 1.0f, 0);
+			Graphics::Context->OMSetRenderTargets(0, nullptr, dsv);
+
+			//depth only, no pixel shader
+			m_shadowCommands.Clear();
+			m_shadowCommands.BindPipeline(m_pShadowVertexShader.Get(), nullptr);
+			m_shadowCommands.SetRenderState(m_shadowMap.GetRasterizerState(), nullptr);
+			for (uint32_t index : m_shadowCasters) {
+				m_entityPool[index]->DrawDepth(m_shadowCommands, origin, a_interpolationAlpha, cascade.m_viewProjection);
+			}
+			D3D11RenderBackend().Execute(m_shadowCommands);
+
+			constants.m_cascadeViewProjection[i] = cascade.m_viewProjection;
+			constants.m_cascadeFarDepths[i] = cascade.m_farDepth;
+		}
+		for (uint32_t i = m_shadowCascades.GetCascadeCount(); i < ShadowCascades::MAX_CASCADES; i++) {
+			m_shadowCasterCounts[i] = 0;
+		}
+
+		m_shadowCommands.Clear();
+		m_shadowCommands.SetRenderState(nullptr, nullptr);
+		D3D11RenderBackend().Execute(m_shadowCommands);
+
+		constants.m_texelSize = {
+			1.0f / m_shadowMap.GetResolution(),
+			1.0f / m_shadowMap.GetResolution() };
+		constants.m_cascadeCount = m_shadowCascades.GetCascadeCount();
+		constants.m_enabled = 1;
+
+		Graphics::State.PSSetShaderResource(SHADOW_MAP_SLOT, m_shadowMap.GetSRV());
+		Graphics::State.PSSetSampler(SHADOW_SAMPLER_SLOT, m_shadowMap.GetComparisonSampler());
+	}
+	else {
+		m_shadowCasterCounts = {};
+	}
+
+	//uploaded even when off so the shader reads enabled = 0
+	Graphics::ConstantBufferAllocation allocation = Graphics::MapNextConstantBuffer(sizeof(constants));
+	memcpy(allocation.m_pData, &constants, sizeof(constants));
+	Graphics::UnmapConstantBuffer(allocation);
+	Graphics::BindConstantBufferRange(allocation.m_pBuffer, allocation.m_offsetInBytes, sizeof(constants), D3D11_PIXEL_SHADER, SHADOW_CONSTANT_BUFFER_SLOT);
+
+	RenderLocalShadows(a_interpolationAlpha);
+
+	//back to the window for the main pass
+	Graphics::Context->OMSetRenderTargets(
+		1,
+		Graphics::BackBufferRTV.GetAddressOf(),
+		Graphics::DepthBufferDSV.Get());
+	D3D11_VIEWPORT viewport = {};
+	viewport.Width = static_cast<float>(Window::Width());
+	viewport.Height = static_cast<float>(Window::Height());
+	viewport.MaxDepth = 1.0f;
+	Graphics::Context->RSSetViewports(1, &viewport);
+
+	m_shadowTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/// <summary>
+/// Compares every entity with last frame, static casters that moved, appeared,
+/// disappeared or changed their flag invalidate the lights around both places
+/// </summary>
+void Game::SyncStaticShadowCasters()
+{
+	const Double3& origin = m_pActiveCamera->GetRenderOrigin();
+	size_t count = m_entityPool.Count();
+	for (size_t i = count; i < m_staticCasterStates.size(); i++) {
+		const StaticCasterState& state = m_staticCasterStates[i];
+		if (state.m_isStatic) m_localShadows.InvalidateBounds(state.m_bounds, state.m_boundsOrigin);
+	}
+	m_staticCasterStates.resize(count);
+
+	for (size_t i = 0; i < count; i++) {
+		GameEntity* entity = m_entityPool[i];
+		StaticCasterState& state = m_staticCasterStates[i];
+		if (state.m_pEntity == entity &&
+			state.m_version == entity->GetTransform().GetVersion() &&
+			state.m_isStatic == entity->m_isStatic) continue;
+
+		if (state.m_isStatic) m_localShadows.InvalidateBounds(state.m_bounds, state.m_boundsOrigin);
+		state.m_pEntity = entity;
+		state.m_isStatic = entity->m_isStatic;
+		state.m_boundsOrigin = origin;
+		state.m_bounds = entity->GetRelativeBounds(origin);
+		state.m_version = entity->GetTransform().GetVersion();
+		if (state.m_isStatic) m_localShadows.InvalidateBounds(state.m_bounds, state.m_boundsOrigin);
+	}
+}
+
+/// <summary>
+/// Ranks the point and spot lights for the active camera and packs the
+/// shadowed ones into the atlas, before the lights are uploaded
+/// </summary>
+void Game::UpdateLocalShadows()
+{
+	m_localShadows.m_maxShadowedLights = static_cast<uint32_t>(m_localShadowMaxLights);
+
+	//no lights gives every tile back, all index -1
+	if (!m_localShadowsEnabled) {
+		m_localShadows.Update(m_lights.data(), 0, m_pActiveCamera->GetRenderOrigin(), {}, 1.0f, 1.0f, false);
+		return;
+	}
+
+	SyncStaticShadowCasters();
+	m_localShadows.Update(
+		m_lights.data(),
+		m_lights.size(),
+		m_pActiveCamera->GetRenderOrigin(),
+		m_pActiveCamera->GetRelativePosition(),
+		m_pActiveCamera->GetProjectionMatrix()._22,
+		static_cast<float>(Window::Height()),
+		m_pActiveCamera->GetProjection() == Projection::ORTHOGRAPHIC);
+}
+
+/// <summary>
+/// Redraws the static depth of invalidated faces into the cached atlas, then
+/// copies it and draws dynamic casters on top only when some face has one
+/// </summary>
+void Game::RenderLocalShadows(float a_interpolationAlpha)
+{
+	FrameProfiler::Scope zone("Local shadows");
+	auto start = std::chrono::steady_clock::now();
+	m_localShadowStaticRenders = 0;
+	m_localShadowDynamicRenders = 0;
+
+	const std::vector<LocalShadows::Face>& faces = m_localShadows.GetFaces();
+	if (faces.empty()) {
+		m_localShadowTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return;
+	}
+
+	m_localShadowStaticAtlas.Create(m_localShadows.GetAtlasSize(), 1);
+	m_localShadowAtlas.Create(m_localShadows.GetAtlasSize(), 1);
+
+	const Double3& origin = m_pActiveCamera->GetRenderOrigin();
+	m_staticShadowBounds.Clear();
+	m_dynamicShadowBounds.Clear();
+	m_staticShadowEntities.clear();
+	m_dynamicShadowEntities.clear();
+	for (size_t i = 0; i < m_entityPool.Count(); i++) {
+		GameEntity* entity = m_entityPool[i];
+		(entity->m_isStatic ? m_staticShadowBounds : m_dynamicShadowBounds).Add(entity->GetRelativeBounds(origin));
+		(entity->m_isStatic ? m_staticShadowEntities : m_dynamicShadowEntities).push_back(static_cast<uint32_t>(i));
+	}
+
+	auto drawFace = [&](const LocalShadows::Face& a_face, const std::vector<uint32_t>& a_entities) {
+		D3D11_VIEWPORT viewport = {};
+		viewport.TopLeftX = static_cast<float>(a_face.m_tile.m_x);
+		viewport.TopLeftY = static_cast<float>(a_face.m_tile.m_y);
+		viewport.Width = static_cast<float>(a_face.m_tile.m_size);
+		viewport.Height = static_cast<float>(a_face.m_tile.m_size);
+		viewport.MaxDepth = 1.0f;
+		Graphics::Context->RSSetViewports(1, &viewport);
+
+		m_shadowCommands.Clear();
+		m_shadowCommands.BindPipeline(m_pShadowVertexShader.Get(), nullptr);
+		m_shadowCommands.SetRenderState(m_localShadowAtlas.GetRasterizerState(), nullptr);
+		for (uint32_t index : m_shadowCasters) {
+			m_entityPool[a_entities[index]]->DrawDepth(m_shadowCommands, origin, a_interpolationAlpha, a_face.m_viewProjection);
+		}
+		D3D11RenderBackend().Execute(m_shadowCommands);
+	};
+
+	Frustum frustum;
+	bool staticTargetBound = false;
+	for (const LocalShadows::Face& face : faces) {
+		if (!face.m_staticDirty) continue;
+		if (!staticTargetBound) {
+			Graphics::Context->OMSetRenderTargets(0, nullptr, m_localShadowStaticAtlas.GetDSV(0));
+			staticTargetBound = true;
+		}
+
+		//depth clears ignore the viewport, a far plane triangle clears just this tile
+		D3D11_VIEWPORT viewport = {};
+		viewport.TopLeftX = static_cast<float>(face.m_tile.m_x);
+		viewport.TopLeftY = static_cast<float>(face.m_tile.m_y);
+		viewport.Width = static_cast<float>(face.m_tile.m_size);
+		viewport.Height = static_cast<float>(face.m_tile.m_size);
+		viewport.MaxDepth = 1.0f;
+		Graphics::Context->RSSetViewports(1, &viewport);
+		Graphics::State.IASetInputLayout(nullptr);
+		Graphics::State.VSSetShader(m_pShadowClearVertexShader.Get());
+		Graphics::State.PSSetShader(nullptr);
+		Graphics::State.RSSetState(nullptr);
+		Graphics::State.OMSetDepthStencilState(m_pShadowClearDepthState.Get(), 0);
+		Graphics::Context->Draw(3, 0);
+		Graphics::State.OMSetDepthStencilState(nullptr, 0);
+		Graphics::State.IASetInputLayout(m_pVSInputLayout.Get());
+
+		frustum.ExtractPlanes(face.m_viewProjection);
+		frustum.Cull(m_staticShadowBounds, m_shadowCasters);
+		drawFace(face, m_staticShadowEntities);
+		m_localShadowStaticRenders++;
+	}
+	m_localShadows.MarkStaticRendered();
+
+	//the cached atlas is used as is unless a dynamic caster is in some face's view
+	bool hasDynamicCasters = false;
+	for (size_t i = 0; i < faces.size() && !hasDynamicCasters && m_dynamicShadowBounds.Size() > 0; i++) {
+		frustum.ExtractPlanes(faces[i].m_viewProjection);
+		frustum.Cull(m_dynamicShadowBounds, m_shadowCasters);
+		hasDynamicCasters = !m_shadowCasters.empty();
+	}
+
+	ID3D11ShaderResourceView* atlasView = m_localShadowStaticAtlas.GetSRV();
+	if (hasDynamicCasters) {
+		Graphics::Context->OMSetRenderTargets(0, nullptr, nullptr);
+		Graphics::Context->CopyResource(m_localShadowAtlas.GetTexture(), m_localShadowStaticAtlas.GetTexture());
+		Graphics::Context->OMSetRenderTargets(0, nullptr, m_localShadowAtlas.GetDSV(0));
+		for (const LocalShadows::Face& face : faces) {
+			frustum.ExtractPlanes(face.m_viewProjection);
+			frustum.Cull(m_dynamicShadowBounds, m_shadowCasters);
+			if (m_shadowCasters.empty()) continue;
+			drawFace(face, m_dynamicShadowEntities);
+			m_localShadowDynamicRenders++;
+		}
+		atlasView = m_localShadowAtlas.GetSRV();
+	}
+
+	m_shadowCommands.Clear();
+	m_shadowCommands.SetRenderState(nullptr, nullptr);
+	D3D11RenderBackend().Execute(m_shadowCommands);
+
+	const std::vector<LocalShadowView>& views = m_localShadows.GetViews();
+	m_lightBytesLastFrame += m_localShadowViewBuffer.Upload(views.data(), views.size(), sizeof(LocalShadowView));
+	Graphics::State.PSSetShaderResource(LOCAL_SHADOW_VIEW_SLOT, m_localShadowViewBuffer.GetSRV());
+	Graphics::State.PSSetShaderResource(LOCAL_SHADOW_ATLAS_SLOT, atlasView);
+	Graphics::State.PSSetSampler(SHADOW_SAMPLER_SLOT, m_localShadowAtlas.GetComparisonSampler());
+
+	m_localShadowTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
 
 
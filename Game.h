@@ -13,6 +13,25 @@
 #include "Material.h"
 #include "Light.h"
 #include "Sky.h"
+#include "ObjectPool.h"
+#include "FixedTimestep.h"
+#include "Frustum.h"
+#include "Bvh.h"
+#include "OcclusionCuller.h"
+#include "RenderQueue.h"
+#include "RenderCommandList.h"
+#include "MaterialTable.h"
+#include "DynamicStructuredBuffer.h"
+#include "LightClusters.h"
+#include "ShadowCascades.h"
+#include "ShadowMap.h"
+#include "LocalShadows.h"
+#include "ShaderPermutations.h"
+#include "ProbeBaker.h"
+#include "ProbeGrid.h"
+#include "GBuffer.h"
+#include "TiledLightCulling.h"
+#include "FrameProfiler.h"
 
 class Game
 {
@@ -25,11 +44,17 @@ public:
 
 	// Primary functions
 	void Update(float deltaTime, float totalTime);
+	void FixedUpdate(float stepSeconds);
 	void BuildUI();
 	void RefreshGUI(float deltaTime);
 	void Draw(float deltaTime, float totalTime);
 	void OnResize();
 
+	/// <summary>
+	/// Scheduler deciding how many FixedUpdate steps run each frame
+	/// </summary>
+	FixedTimestep& GetTimestep();
+
 
 	// Initialization helper methods - feel free to customize, combine, remove, etc.
 	static void LoadVertexShader(
@@ -79,7 +104,70 @@ private:
 	bool m_hideHeader = false;
 
 	//Light
-	std::array<Light, 5> m_lights;
+	std::vector<SceneLight> m_lights;
+
+	//m_lights moved to the render origin, uploaded once per frame for every draw
+	std::vector<Light> m_relativeLights;
+	DynamicStructuredBuffer m_lightBuffer;
+	size_t m_lightBytesLastFrame = 0;
+	unsigned int m_directionalLightCount = 0;
+
+	//Clustered lighting, point and spot lights binned into froxels of the active camera
+	LightClusters m_lightClusters;
+	std::vector<DirectX::XMFLOAT4> m_lightSpheres;
+	DynamicStructuredBuffer m_clusterIndexBuffer;
+	DynamicStructuredBuffer m_clusterRangeBuffer;
+	double m_clusterTimeMs = 0.0;
+	void BinLights();
+
+	//Light BVH, fills clusters with their most important lights instead of every light in range
+	LightBvh m_lightBvh;
+	bool m_lightBvhEnabled = false;
+	int m_lightBvhBudget = 32;
+
+	//Cascaded shadows of the first directional light
+	ShadowCascades m_shadowCascades;
+	ShadowMap m_shadowMap;
+	BoundsSoA m_shadowCasterBounds;
+	std::vector<uint32_t> m_shadowCasters;
+	RenderCommandList m_shadowCommands;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pShadowVertexShader;
+	bool m_shadowsEnabled = true;
+	std::array<size_t, ShadowCascades::MAX_CASCADES> m_shadowCasterCounts = {};
+	double m_shadowTimeMs = 0.0;
+	void RenderShadows(float a_interpolationAlpha);
+
+	//Point and spot light shadows packed into an atlas, static casters cached between frames
+	LocalShadows m_localShadows;
+	ShadowMap m_localShadowStaticAtlas;
+	ShadowMap m_localShadowAtlas;
+	DynamicStructuredBuffer m_localShadowViewBuffer;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pShadowClearVertexShader;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> m_pShadowClearDepthState;
+	bool m_localShadowsEnabled = true;
+	int m_localShadowMaxLights = 8;
+	BoundsSoA m_staticShadowBounds;
+	BoundsSoA m_dynamicShadowBounds;
+	std::vector<uint32_t> m_staticShadowEntities;
+	std::vector<uint32_t> m_dynamicShadowEntities;
+	size_t m_localShadowStaticRenders = 0;
+	size_t m_localShadowDynamicRenders = 0;
+	double m_localShadowTimeMs = 0.0;
+	void UpdateLocalShadows();
+	void RenderLocalShadows(float a_interpolationAlpha);
+
+	//last known state of every entity, static ones invalidate the lights around them when they change
+	struct StaticCasterState
+	{
+		GameEntity* m_pEntity = nullptr;
+		uint32_t m_version = 0;
+		bool m_isStatic = false;
+		//relative to the render origin of the frame they were taken in
+		Bounds m_bounds;
+		Double3 m_boundsOrigin;
+	};
+	std::vector<StaticCasterState> m_staticCasterStates;
+	void SyncStaticShadowCasters();
 
 	//Meshes
 	std::shared_ptr<Mesh> m_pCube;
@@ -87,21 +175,129 @@ private:
 	std::shared_ptr<Mesh> m_pHelix;
 
 	//GameEntities
-	std::vector<GameEntity> m_entitiesList;
+	ObjectPool<GameEntity> m_entityPool;
+
+	//Constant buffer upload stats from the previous frame
+	unsigned int m_cbBytesUploadedLastFrame = 0;
+	unsigned int m_cbBytesReservedLastFrame = 0;
+	unsigned int m_cbUploadsLastFrame = 0;
+
+	//Bind calls issued and dropped by Graphics::State in the previous frame
+	GraphicsStateCache::Counters m_stateCountersLastFrame;
+	uint64_t m_allocationsAtFrameStart = 0;
+	uint64_t m_allocationsLastFrame = 0;
+
+	//Frustum culling
+	Frustum m_frustum;
+	BoundsSoA m_cullBounds;
+	std::vector<uint32_t> m_visibleIndices;
+	bool m_frustumCullingEnabled = true;
+	double m_cullTimeMs = 0.0;
+	void CullEntities();
+
+	//Scene BVH, bounds of every entity relative to m_bvhOrigin
+	Bvh m_sceneBvh;
+	std::vector<Bounds> m_bvhBounds;
+	std::vector<uint32_t> m_bvhTransformVersions;
+	Double3 m_bvhOrigin;
+	size_t m_bvhPoolChanges = 0;
+	bool m_useSceneBvh = true;
+	size_t m_bvhRefitsLastFrame = 0;
+	void SyncSceneBvh(const Double3& a_origin);
+
+	//Software occlusion culling
+	OcclusionCuller m_occlusionCuller;
+	std::vector<Bounds> m_occlusionCandidates;
+	bool m_occlusionCullingEnabled = true;
+	size_t m_occludedLastFrame = 0;
+	double m_occlusionTimeMs = 0.0;
+	void CullOccludedEntities();
+
+	//Sorted submission
+	RenderQueue m_renderQueue;
+	MaterialTable m_materialTable;
+
+	//commands drawn outside the render queue, the sky for now
+	RenderCommandList m_frameCommands;
+	void QueueVisibleEntities(const std::vector<uint32_t>& a_indices);
 
 	//Materials
 	std::vector<Material> m_materialsList;
 
+	//PixelShader.hlsl compiled per ShaderPermutations key, variants that didn't load use the default shader
+	std::array<Microsoft::WRL::ComPtr<ID3D11PixelShader>, ShaderPermutations::VARIANT_COUNT> m_pixelShaderVariants;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> m_pDefaultPixelShader;
+	size_t m_pixelShaderVariantsLoaded = 0;
+	void LoadPixelShaderVariants();
+
+	//materials drawn with PixelShader.hlsl, their key's material half is fixed when they're added
+	std::vector<std::shared_ptr<Material>> m_permutedMaterials;
+	std::vector<uint32_t> m_materialFeatures;
+	bool m_shaderPermutationsEnabled = true;
+	bool m_iblEnabled = false;
+	uint32_t m_appliedFrameFeatures = UINT32_MAX;
+	bool m_appliedPermutationsEnabled = false;
+	size_t m_permutationResolves = 0;
+	void AddPermutedMaterial(std::shared_ptr<Material> a_pMaterial);
+	ID3D11PixelShader* GetPixelShaderVariant(uint32_t a_key) const;
+	void ResolveShaderPermutations(bool a_force = false);
+
+	//irradiance probes baked from the sky and lights around the static entities, every entity reads the grid at its center
+	ProbeBaker m_probeBaker;
+	ProbeBaker::Settings m_probeSettings;
+	ProbeGrid m_probeGrid;
+	bool m_probesEnabled = true;
+	float m_probeSkyIntensity = 0.25f; // IBL_INTENSITY of PixelShader.hlsl, so probes and the sky cube agree
+	size_t m_probeFileBytes = 0;
+	ProbeBaker::Sky ReadSkyRadiance(uint32_t a_maxSize);
+	void BakeProbes();
+
+	//per pooled entity, resampled when the entity or its transform changes
+	struct ObjectIrradianceState
+	{
+		GameEntity* m_pEntity = nullptr;
+		uint32_t m_version = 0;
+	};
+	std::vector<ObjectIrradianceState> m_objectIrradianceStates;
+	std::vector<SphericalHarmonicsL2> m_objectIrradiance;
+	DynamicStructuredBuffer m_objectIrradianceBuffer;
+	size_t m_objectIrradianceSamples = 0;
+	void UpdateObjectIrradiance();
+
+	//deferred path, permuted materials write the G-buffer and DeferredLightingCS.hlsl lights it per screen tile
+	GBuffer m_gBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ComputeShader> m_pDeferredLightingShader;
+	Microsoft::WRL::ComPtr<ID3D11PixelShader> m_pDeferredResolveShader;
+	bool m_deferredEnabled = false;
+	std::vector<uint32_t> m_deferredIndices;
+	std::vector<uint32_t> m_forwardIndices; // visible entities whose material has no deferred variant
+	size_t m_deferredDraws = 0;
+	void RenderDeferred(float a_interpolationAlpha);
+
+	//depth pre-pass, forward entities lay down depth front to back and are then shaded where it matches
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> m_pPositionInputLayout;
+	Microsoft::WRL::ComPtr<ID3D11DepthStencilState> m_pDepthPrepassShadingState;
+	bool m_depthPrepassEnabled = false;
+
+	//CPU zone timeline, frames are counted back from the latest finished one
+	int m_profilerFrameAge = 0;
+	std::string m_profilerTraceStatus;
+	void DrawProfilerTimeline(const FrameProfiler::Frame& a_frame);
+
 	//Constant buffer for vertex shader
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pVSConstantBuffer;
 	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pPSConstantBuffer;
 
+	//Simulation
+	FixedTimestep m_timestep;
+	float m_simulationRateHz = 60.0f;
+
 	//Cameras
 	std::vector<std::shared_ptr<Camera>> m_camerasList;
 	std::shared_ptr<Camera> m_pActiveCamera;
 
 	//Updates lights in entity buffers
-	void UpdateLights();
+	void UploadLights();
 
 	Microsoft::WRL::ComPtr<ID3D11SamplerState> m_pSamplerState;
 	Sky m_sky;
@@ -29,30 +29,62 @@ Transform& GameEntity::GetTransform()
 	return m_transform;
 }
 
+Bounds GameEntity::GetRelativeBounds(const Double3& a_origin)
+{
+	return m_pMesh->GetLocalBounds().Transformed(m_transform.GetRelativeWorldMatrix(a_origin));
+}
+
+Bounds GameEntity::GetWorldBounds()
+{
+	m_transform.CalculateWorldMatrix();
+	return m_pMesh->GetLocalBounds().Transformed(m_transform.GetWorldMatrix());
+}
+
 void GameEntity::Draw(
-	Microsoft::WRL::ComPtr<ID3D11Buffer> a_VSConstantBuffer,
-	Microsoft::WRL::ComPtr<ID3D11Buffer> a_PSConstantBuffer,
-	std::shared_ptr<Camera> a_camera)
+	RenderCommandList& a_commands,
+	std::shared_ptr<Camera> a_camera,
+	float a_interpolationAlpha)
 {
 
-	Graphics::Context->VSSetShader(m_pMaterial->GetVertexShader().Get(), 0, 0);
-	Graphics::Context->PSSetShader(m_pMaterial->GetPixelShader().Get(), 0, 0);
+	a_commands.BindPipeline(m_pMaterial->GetVertexShader().Get(), m_pMaterial->GetPixelShader().Get());
 
-	//update struct matrix;
+	UploadConstantBuffers(a_commands, a_camera, a_interpolationAlpha);
 
-	//vertex shader
+	m_pMesh->Draw(a_commands);
+}
+
+void GameEntity::DrawDepth(
+	RenderCommandList& a_commands,
+	const Double3& a_origin,
+	float a_interpolationAlpha,
+	const DirectX::XMFLOAT4X4& a_viewProjection)
+{
+	//local copy, m_VSConstantBuffer still holds the camera's matrices for the main pass
+	VertexShaderConstantBuffer constants;
 	m_transform.CalculateWorldMatrix();
-	m_VSConstantBuffer.m_worldMatrix = m_transform.GetWorldMatrix();
-	m_VSConstantBuffer.m_projectionMatrix = a_camera->GetProjectionMatrix();
-	m_VSConstantBuffer.m_viewMatrix = a_camera->GetViewMatrix();
-	m_VSConstantBuffer.m_worldInverseTranspose = m_transform.GetWorldInverseTransposeMatrix();
+	m_transform.GetInterpolatedRelativeWorldMatrices(
+		a_origin,
+		a_interpolationAlpha,
+		constants.m_worldMatrix,
+		constants.m_worldInverseTranspose);
+
+	DirectX::XMMATRIX worldViewProjection = DirectX::XMMatrixMultiply(
+		DirectX::XMLoadFloat4x4(&constants.m_worldMatrix),
+		DirectX::XMLoadFloat4x4(&a_viewProjection));
+	DirectX::XMStoreFloat4x4(&constants.m_worldViewProjectionMatrix, worldViewProjection);
+
+	a_commands.UpdateConstantBuffer(
+		RenderCommand::Stage::VERTEX,
+		0,
+		&constants,
+		sizeof(constants));
+
+	m_pMesh->Draw(a_commands);
+}
 
-	//pixel shader buffer
-	m_PSConstantBuffer.m_colorTint = m_pMaterial->GetColorTint();
-	m_PSConstantBuffer.m_timeElapsedMs = m_lifetimeMs;
-	m_PSConstantBuffer.m_scale = m_pMaterial->GetUVscale();
-	m_PSConstantBuffer.m_offset = m_pMaterial->GetUVoffset();
-	m_PSConstantBuffer.m_cameraPosition = a_camera->GetTransform().GetPosition();
+void GameEntity::UploadConstantBuffers(RenderCommandList& a_commands, std::shared_ptr<Camera> a_camera, float a_interpolationAlpha)
+{
+	UpdateConstantBufferData(a_camera, a_interpolationAlpha);
 
 	//memcpy shader
 	//vertex shader buffer
@@ -66,19 +98,62 @@ void GameEntity::Draw(
 	//memcpy(mappedBuffer.pData, &m_PSConstantBuffer, sizeof(m_PSConstantBuffer));
 	//Graphics::Context->Unmap(a_PSConstantBuffer.Get(), 0);
 
-	Graphics::FillAndBindNextConstantBuffer(
+	a_commands.UpdateConstantBuffer(
+		RenderCommand::Stage::VERTEX,
+		0,
 		&m_VSConstantBuffer,
-		sizeof(m_VSConstantBuffer),
-		D3D11_VERTEX_SHADER,
-		0);
+		sizeof(m_VSConstantBuffer));
 
-	Graphics::FillAndBindNextConstantBuffer(
+	a_commands.UpdateConstantBuffer(
+		RenderCommand::Stage::PIXEL,
+		0,
 		&m_PSConstantBuffer,
-		sizeof(m_PSConstantBuffer),
-		D3D11_PIXEL_SHADER,
-		0);
+		sizeof(m_PSConstantBuffer));
+}
+
+void GameEntity::UpdateConstantBufferData(std::shared_ptr<Camera> a_camera, float a_interpolationAlpha)
+{
+	//update struct matrix;
+
+	//vertex shader
+	//world matrix is relative to the camera's render origin so the GPU only sees small values
+	//blended between the last two simulation ticks
+	m_transform.CalculateWorldMatrix();
+	m_transform.GetInterpolatedRelativeWorldMatrices(
+		a_camera->GetRenderOrigin(),
+		a_interpolationAlpha,
+		m_VSConstantBuffer.m_worldMatrix,
+		m_VSConstantBuffer.m_worldInverseTranspose);
+
+	//view and projection live in the per frame buffer, only the combined matrix is sent per object
+	DirectX::XMMATRIX worldViewProjection = DirectX::XMMatrixMultiply(
+		DirectX::XMLoadFloat4x4(&m_VSConstantBuffer.m_worldMatrix),
+		DirectX::XMLoadFloat4x4(&a_camera->GetViewProjectionMatrix()));
+	DirectX::XMStoreFloat4x4(&m_VSConstantBuffer.m_worldViewProjectionMatrix, worldViewProjection);
+	m_VSConstantBuffer.m_irradianceIndex = m_irradianceIndex;
+
+	UpdatePixelConstantBufferData(a_camera);
+}
+
+void GameEntity::UpdatePixelConstantBufferData(std::shared_ptr<Camera> a_camera)
+{
+	//pixel shader buffer
+	m_PSConstantBuffer.m_colorTint = m_pMaterial->GetColorTint();
+	m_PSConstantBuffer.m_timeElapsedMs = m_lifetimeMs;
+	m_PSConstantBuffer.m_scale = m_pMaterial->GetUVscale();
+	m_PSConstantBuffer.m_offset = m_pMaterial->GetUVoffset();
+	m_PSConstantBuffer.m_materialIndex = m_pMaterial->GetTableIndex();
+}
 
-	m_pMesh->Draw();
+void GameEntity::FillInstanceData(const Double3& a_origin, float a_interpolationAlpha, InstanceData& a_instance)
+{
+	m_transform.CalculateWorldMatrix();
+	m_transform.GetInterpolatedRelativeWorldMatrices(
+		a_origin,
+		a_interpolationAlpha,
+		a_instance.m_worldMatrix,
+		a_instance.m_worldInverseTranspose);
+	a_instance.m_irradianceIndex = m_irradianceIndex;
 }
 
 std::shared_ptr<Material> GameEntity::GetMaterial()
@@ -21,12 +21,69 @@ public:
 	~GameEntity();
 
 	float m_lifetimeMs;
+
+	/// <summary>
+	/// Rasterized into the software depth buffer to hide things behind it
+	/// </summary>
+	bool m_isOccluder = false;
+
+	/// <summary>
+	/// Drawn once into the cached local shadow maps, moving it redraws the lights around it
+	/// </summary>
+	bool m_isStatic = false;
+
+	/// <summary>
+	/// Element of the object irradiance buffer the pixel shader reads, written per frame while probes are on
+	/// </summary>
+	unsigned int m_irradianceIndex = 0;
 	std::shared_ptr<Mesh> GetMesh();
 	Transform& GetTransform();
+
+	/// <summary>
+	/// Mesh bounds moved into the space relative to a_origin
+	/// </summary>
+	Bounds GetRelativeBounds(const Double3& a_origin);
+
+	/// <summary>
+	/// Mesh bounds in absolute world space, float precision
+	/// </summary>
+	Bounds GetWorldBounds();
 	void Draw(
-		Microsoft::WRL::ComPtr<ID3D11Buffer> a_VSConstantBuffer,
-		Microsoft::WRL::ComPtr<ID3D11Buffer> a_PSConstantBuffer,
-		std::shared_ptr<Camera> a_camera);
+		RenderCommandList& a_commands,
+		std::shared_ptr<Camera> a_camera,
+		float a_interpolationAlpha = 1.0f);
+
+	/// <summary>
+	/// Depth only draw into a shadow map, a_viewProjection is the light's and
+	/// relative to a_origin like everything else this frame
+	/// </summary>
+	void DrawDepth(
+		RenderCommandList& a_commands,
+		const Double3& a_origin,
+		float a_interpolationAlpha,
+		const DirectX::XMFLOAT4X4& a_viewProjection);
+
+	/// <summary>
+	/// Emits this entity's VS/PS constants into a_commands, the part of
+	/// Draw that can't be shared between consecutive draws
+	/// </summary>
+	void UploadConstantBuffers(RenderCommandList& a_commands, std::shared_ptr<Camera> a_camera, float a_interpolationAlpha);
+
+	/// <summary>
+	/// Refreshes m_VSConstantBuffer and m_PSConstantBuffer without uploading them,
+	/// for callers that write many entities into one mapped range
+	/// </summary>
+	void UpdateConstantBufferData(std::shared_ptr<Camera> a_camera, float a_interpolationAlpha);
+
+	/// <summary>
+	/// Refreshes only m_PSConstantBuffer, instanced draws share one per batch
+	/// </summary>
+	void UpdatePixelConstantBufferData(std::shared_ptr<Camera> a_camera);
+
+	/// <summary>
+	/// Writes this entity's interpolated, camera relative matrices for the instanced vertex shader
+	/// </summary>
+	void FillInstanceData(const Double3& a_origin, float a_interpolationAlpha, InstanceData& a_instance);
 
 	std::shared_ptr<Material> GetMaterial();
 	void SetMaterial(std::shared_ptr<Material> a_pMaterial);
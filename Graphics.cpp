@@ -1,6 +1,9 @@
 #include "Graphics.h"
 #include <dxgi1_6.h>
 #include <dxgidebug.h>
+#include <algorithm>
+#include <cassert>
+#include <thread>
 
 // Tell the drivers to use high-performance GPU in multi-GPU systems (like laptops)
 extern "C"
@@ -22,6 +25,8 @@ namespace Graphics
 
 		D3D_FEATURE_LEVEL featureLevel{};
 
+		// The thread that initialized, the only one the constant ring may be used from
+		std::thread::id cbOwnerThread;
 	}
 }
 
@@ -53,6 +58,8 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 	if (apiInitialized)
 		return E_FAIL;
 
+	cbOwnerThread = std::this_thread::get_id();
+
 	// Save desired vsync state, though it may be stuck "on" if
 	// the device doesn't support screen tearing
 	vsyncDesired = vsyncIfPossible;
@@ -165,17 +172,19 @@ HRESULT Graphics::Initialize(unsigned int windowWidth, unsigned int windowHeight
 
 	//set up ring buffer
 	Context->QueryInterface<ID3D11DeviceContext1>(context1.GetAddressOf());
+	State.SetContext(Context.Get());
 
-	cbHeapOffsetInBytes = 0;
-	cbHeapSizeInBytes = 1000 * 256;
-	cbHeapSizeInBytes = (cbHeapSizeInBytes + 255) / 256 * 256;
+	//starting size only, the ring grows when a frame needs more
+	CreateConstantBufferHeap(1000 * 256);
 
-	D3D11_BUFFER_DESC RingBufferDesc = {};
-	RingBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	RingBufferDesc.ByteWidth = cbHeapSizeInBytes;
-	RingBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	RingBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	Graphics::Device->CreateBuffer(&RingBufferDesc, 0, ConstantBufferHeap.GetAddressOf());
+	D3D11_QUERY_DESC fenceDesc = {};
+	fenceDesc.Query = D3D11_QUERY_EVENT;
+	for (Microsoft::WRL::ComPtr<ID3D11Query>& fence : cbFrameFences) {
+		Device->CreateQuery(&fenceDesc, fence.GetAddressOf());
+	}
+	cbFrameIndex = 0;
+	cbCompletedFrame = 0;
+	cbGrowCount = 0;
 
 	return S_OK;
 }
@@ -341,10 +350,102 @@ void Graphics::PrintDebugMessages()
 
 void Graphics::FillAndBindNextConstantBuffer(void* a_data, unsigned int a_dataSizeInBytes, D3D11_SHADER_TYPE a_shadertype, unsigned int a_registerSlot)
 {
-	unsigned int reservationSize = (a_dataSizeInBytes + 255) / 256 * 256;
+	ConstantBufferAllocation allocation = MapNextConstantBuffer(a_dataSizeInBytes);
+	memcpy(allocation.m_pData, a_data, a_dataSizeInBytes);
+	UnmapConstantBuffer(allocation);
+
+	BindConstantBufferRange(allocation.m_pBuffer, allocation.m_offsetInBytes, a_dataSizeInBytes, a_shadertype, a_registerSlot);
+}
+
+namespace
+{
+	// --------------------------------------------------------
+	// Polls fences newer than the last completed frame without
+	// flushing, stopping at the first one still pending
+	// --------------------------------------------------------
+	void PollConstantBufferFences()
+	{
+		while (Graphics::cbCompletedFrame + 1 < Graphics::cbFrameIndex) {
+			uint64_t frame = Graphics::cbCompletedFrame + 1;
+			BOOL done = FALSE;
+			HRESULT result = Graphics::Context->GetData(
+				Graphics::cbFrameFences[frame % Graphics::cbFramesInFlight].Get(),
+				&done,
+				sizeof(done),
+				D3D11_ASYNC_GETDATA_DONOTFLUSH);
+			if (result != S_OK || !done) break;
+			Graphics::cbCompletedFrame = frame;
+		}
+	}
+}
+
+void Graphics::CreateConstantBufferHeap(unsigned int a_sizeInBytes)
+{
+	//the old heap may still be read by frames in flight
+	if (ConstantBufferHeap) {
+		cbRetiredHeaps.push_back({ ConstantBufferHeap, cbFrameIndex });
+		ConstantBufferHeap.Reset();
+	}
+
+	cbHeapSizeInBytes = ConstantBufferRing::Align(a_sizeInBytes);
+
+	D3D11_BUFFER_DESC RingBufferDesc = {};
+	RingBufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	RingBufferDesc.ByteWidth = cbHeapSizeInBytes;
+	RingBufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	RingBufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	Graphics::Device->CreateBuffer(&RingBufferDesc, 0, ConstantBufferHeap.GetAddressOf());
+
+	cbRing.Reset(cbHeapSizeInBytes);
+}
+
+void Graphics::BeginConstantBufferFrame()
+{
+	assert(std::this_thread::get_id() == cbOwnerThread && "the constant ring is main thread only");
+	cbFrameIndex++;
+
+	//this frame's fence slot was last signalled cbFramesInFlight frames ago, that frame has to finish first
+	if (cbFrameIndex > cbFramesInFlight) {
+		uint64_t reusedFrame = cbFrameIndex - cbFramesInFlight;
+		BOOL done = FALSE;
+		while (cbCompletedFrame < reusedFrame &&
+			Context->GetData(cbFrameFences[cbFrameIndex % cbFramesInFlight].Get(), &done, sizeof(done), 0) != S_OK) {
+		}
+		cbCompletedFrame = (std::max)(cbCompletedFrame, reusedFrame);
+	}
+	PollConstantBufferFences();
+
+	cbRing.BeginFrame(cbFrameIndex, cbCompletedFrame);
+
+	std::erase_if(cbRetiredHeaps, [](const RetiredConstantBufferHeap& a_heap) { return a_heap.m_lastFrame <= cbCompletedFrame; });
+}
+
+void Graphics::EndConstantBufferFrame()
+{
+	assert(std::this_thread::get_id() == cbOwnerThread && "the constant ring is main thread only");
+	Context->End(cbFrameFences[cbFrameIndex % cbFramesInFlight].Get());
+}
 
-	if (cbHeapOffsetInBytes + reservationSize >= cbHeapSizeInBytes) cbHeapOffsetInBytes = 0;
+Graphics::ConstantBufferAllocation Graphics::MapNextConstantBuffer(unsigned int a_sizeInBytes)
+{
+	//recording threads would race the ring's offsets and the immediate context map, catch it in debug builds
+	assert(std::this_thread::get_id() == cbOwnerThread && "the constant ring is main thread only");
+	unsigned int offset = 0;
+	if (!cbRing.Allocate(a_sizeInBytes, offset)) {
+		//the GPU may have caught up since the frame started
+		PollConstantBufferFences();
+		cbRing.Retire(cbCompletedFrame);
+
+		if (!cbRing.Allocate(a_sizeInBytes, offset)) {
+			//still full, move to a heap big enough for everything currently in flight plus this request
+			unsigned int required = cbRing.GetBytesInFlight() + ConstantBufferRing::Align(a_sizeInBytes);
+			CreateConstantBufferHeap((std::max)(cbHeapSizeInBytes * 2, required * 2));
+			cbGrowCount++;
+			cbRing.Allocate(a_sizeInBytes, offset);
+		}
+	}
 
+	//NO_OVERWRITE is safe, the ring never hands out bytes a pending frame can still read
 	D3D11_MAPPED_SUBRESOURCE map{};
 	Context->Map(
 		ConstantBufferHeap.Get(),
@@ -353,32 +454,47 @@ void Graphics::FillAndBindNextConstantBuffer(void* a_data, unsigned int a_dataSi
 		0,
 		&map);
 
-	void* uploadAddress = reinterpret_cast<void*>((UINT64)map.pData + cbHeapOffsetInBytes);
-	memcpy(uploadAddress, a_data, a_dataSizeInBytes);
+	cbBytesUploaded += a_sizeInBytes;
+	cbBytesReserved += ConstantBufferRing::Align(a_sizeInBytes);
+	cbUploadCount++;
 
-	Context->Unmap(ConstantBufferHeap.Get(), 0);
+	ConstantBufferAllocation allocation = {};
+	allocation.m_pBuffer = ConstantBufferHeap.Get();
+	allocation.m_offsetInBytes = offset;
+	allocation.m_pData = reinterpret_cast<void*>((UINT64)map.pData + offset);
+	return allocation;
+}
+
+void Graphics::UnmapConstantBuffer(const ConstantBufferAllocation& a_allocation)
+{
+	Context->Unmap(a_allocation.m_pBuffer, 0);
+}
 
-	unsigned int firstConstant = cbHeapOffsetInBytes / 16;
-	unsigned int numConstants = reservationSize / 16;
+void Graphics::BindConstantBufferRange(
+	ID3D11Buffer* a_pBuffer,
+	unsigned int a_offsetInBytes,
+	unsigned int a_sizeInBytes,
+	D3D11_SHADER_TYPE a_shadertype,
+	unsigned int a_registerSlot,
+	GraphicsStateCache& a_state)
+{
+	unsigned int firstConstant = a_offsetInBytes / 16;
+	unsigned int numConstants = ConstantBufferRing::Align(a_sizeInBytes) / 16;
 
 	switch (a_shadertype) {
 	case D3D11_VERTEX_SHADER:
-		context1->VSSetConstantBuffers1(
+		a_state.VSSetConstantBuffer(
 			a_registerSlot,
-			1,
-			ConstantBufferHeap.GetAddressOf(),
-			&firstConstant,
-			&numConstants);
+			a_pBuffer,
+			firstConstant,
+			numConstants);
 		break;
 	case D3D11_PIXEL_SHADER:
-		context1->PSSetConstantBuffers1(
+		a_state.PSSetConstantBuffer(
 			a_registerSlot,
-			1,
-			ConstantBufferHeap.GetAddressOf(),
-			&firstConstant,
-			&numConstants);
+			a_pBuffer,
+			firstConstant,
+			numConstants);
 		break;
 	}
-
-	cbHeapOffsetInBytes += reservationSize;
 }
@@ -5,10 +5,16 @@
 #include <string>
 #include <wrl/client.h>
 #include <d3d11shadertracing.h>
+#include "StateCache.h"
+#include "ConstantBufferRing.h"
+#include <array>
+#include <vector>
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "dxgi.lib")
 
+using GraphicsStateCache = StateCache<ID3D11DeviceContext1>;
+
 namespace Graphics
 {
 	// --- GLOBAL VARS ---
@@ -29,9 +35,42 @@ namespace Graphics
 
 	inline Microsoft::WRL::ComPtr<ID3D11Buffer> ConstantBufferHeap;
 
+	// Bind shaders, resources and pipeline state through this to drop redundant calls
+	inline GraphicsStateCache State;
+
 	inline unsigned int cbHeapSizeInBytes;
-	
-	inline unsigned int cbHeapOffsetInBytes;
+
+	// Offsets into ConstantBufferHeap, a frame's range is reused once its fence has passed.
+	// Main thread only, like everything else that maps on the immediate context, debug builds assert it
+	inline ConstantBufferRing cbRing;
+
+	// One event query per frame the CPU may run ahead of the GPU
+	inline constexpr unsigned int cbFramesInFlight = 3;
+	inline std::array<Microsoft::WRL::ComPtr<ID3D11Query>, cbFramesInFlight> cbFrameFences;
+	inline uint64_t cbFrameIndex;
+	inline uint64_t cbCompletedFrame;
+
+	// Heaps replaced by a larger one, kept until the frames that used them have finished
+	struct RetiredConstantBufferHeap
+	{
+		Microsoft::WRL::ComPtr<ID3D11Buffer> m_pBuffer;
+		uint64_t m_lastFrame;
+	};
+	inline std::vector<RetiredConstantBufferHeap> cbRetiredHeaps;
+	inline unsigned int cbGrowCount;
+
+	// Space reserved in the ring and mapped for writing
+	struct ConstantBufferAllocation
+	{
+		ID3D11Buffer* m_pBuffer;
+		unsigned int m_offsetInBytes;
+		void* m_pData;
+	};
+
+	// Constant buffer upload stats, reset by the caller once per frame
+	inline unsigned int cbBytesUploaded;
+	inline unsigned int cbBytesReserved;
+	inline unsigned int cbUploadCount;
 
 	// --- FUNCTIONS ---
 
@@ -53,4 +92,24 @@ namespace Graphics
 		D3D11_SHADER_TYPE a_shadertype,
 		unsigned int a_registerSlot
 	);
+
+	// (Re)creates ConstantBufferHeap at a_sizeInBytes, the previous heap is kept alive until its frames finish
+	void CreateConstantBufferHeap(unsigned int a_sizeInBytes);
+
+	// Constant buffer ring frame boundaries, Begin before the first upload and End after the last draw
+	void BeginConstantBufferFrame();
+	void EndConstantBufferFrame();
+
+	// Reserves and maps a_sizeInBytes of the ring so many constant blocks can be written with one map.
+	// Blocks inside must start on ConstantBufferRing::ALIGNMENT, call UnmapConstantBuffer before drawing.
+	// Main thread only: recording threads bind ranges uploaded before they start, they never suballocate
+	ConstantBufferAllocation MapNextConstantBuffer(unsigned int a_sizeInBytes);
+	void UnmapConstantBuffer(const ConstantBufferAllocation& a_allocation);
+	void BindConstantBufferRange(
+		ID3D11Buffer* a_pBuffer,
+		unsigned int a_offsetInBytes,
+		unsigned int a_sizeInBytes,
+		D3D11_SHADER_TYPE a_shadertype,
+		unsigned int a_registerSlot,
+		GraphicsStateCache& a_state = State);
 }
\ No newline at end of file
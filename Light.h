@@ -4,6 +4,10 @@
 #define LIGHT_TYPE_SPOT 2
 
 #include <DirectXMath.h>
+#include "Double3.h"
+
+//pixel shader register of the per frame light buffer
+inline constexpr unsigned int LIGHT_BUFFER_SLOT = 5;
 
 struct Light
 {
@@ -15,6 +19,27 @@ struct Light
 	DirectX::XMFLOAT3 m_Color;
 	float m_SpotInnerAngle;
 	float m_SpotOuterAngle;
-	DirectX::XMFLOAT2 m_Padding;
+	int m_ShadowIndex; // first LocalShadowView of the light, -1 without shadows, written per frame
+	float m_Padding;
+};
+
+/// <summary>
+/// A light as the scene keeps it. The world position is in double like entity
+/// transforms, m_light.m_Position is ignored until RelativeTo fills it in.
+/// </summary>
+struct SceneLight
+{
+	Light m_light = {};
+	Double3 m_position;
+
+	/// <summary>
+	/// The light the GPU gets, positioned relative to a_origin
+	/// </summary>
+	Light RelativeTo(const Double3& a_origin) const
+	{
+		Light light = m_light;
+		light.m_Position = m_position.RelativeTo(a_origin);
+		return light;
+	}
 };
 
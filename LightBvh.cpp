@@ -0,0 +1,282 @@
+#include "LightBvh.h"
+#include <algorithm>
+#include <functional>
+#include <future>
+#include <thread>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//lights per bounds task, and the tree size worth aggregating on several threads
+	const size_t MINIMUM_LIGHTS_PER_TASK = 1024;
+	const size_t PARALLEL_AGGREGATE_THRESHOLD = 4096;
+	const int MAX_PARALLEL_DEPTH = 3;
+
+	//same falloff as Attenuate in the pixel shader
+	float Falloff(float a_distanceSquared, float a_range)
+	{
+		if (a_range <= 0.0f) return 0.0f;
+		float attenuation = std::clamp(1.0f - a_distanceSquared / (a_range * a_range), 0.0f, 1.0f);
+		return attenuation * attenuation;
+	}
+
+	float Gap(float a_min, float a_max, float a_otherMin, float a_otherMax)
+	{
+		return (std::max)((std::max)(a_otherMin - a_max, a_min - a_otherMax), 0.0f);
+	}
+
+	float BoxDistanceSquared(const XMFLOAT3& a_min, const XMFLOAT3& a_max, const XMFLOAT3& a_otherMin, const XMFLOAT3& a_otherMax)
+	{
+		float x = Gap(a_min.x, a_max.x, a_otherMin.x, a_otherMax.x);
+		float y = Gap(a_min.y, a_max.y, a_otherMin.y, a_otherMax.y);
+		float z = Gap(a_min.z, a_max.z, a_otherMin.z, a_otherMax.z);
+		return x * x + y * y + z * z;
+	}
+
+	bool BoxesOverlap(const XMFLOAT3& a_min, const XMFLOAT3& a_max, const XMFLOAT3& a_otherMin, const XMFLOAT3& a_otherMax)
+	{
+		return a_min.x <= a_otherMax.x && a_max.x >= a_otherMin.x &&
+			a_min.y <= a_otherMax.y && a_max.y >= a_otherMin.y &&
+			a_min.z <= a_otherMax.z && a_max.z >= a_otherMin.z;
+	}
+}
+
+Bounds LightBvh::GetLightBounds(const Light& a_light)
+{
+	const XMFLOAT3& p = a_light.m_Position;
+	float range = a_light.m_Range;
+	XMFLOAT3 minimum(p.x - range, p.y - range, p.z - range);
+	XMFLOAT3 maximum(p.x + range, p.y + range, p.z + range);
+
+	XMFLOAT3 d = a_light.m_Direction;
+	float length = std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+	if (a_light.m_Type != LIGHT_TYPE_SPOT || a_light.m_SpotOuterAngle >= XM_PIDIV2 || length <= 0.0f) {
+		return Bounds::FromMinMax(minimum, maximum);
+	}
+	d = XMFLOAT3(d.x / length, d.y / length, d.z / length);
+
+	//apex, tip of the cap and the rim circle where the cap meets the outer cone
+	float cosOuter = std::cos(a_light.m_SpotOuterAngle);
+	float rimRadius = range * std::sin(a_light.m_SpotOuterAngle);
+	float axis[3] = { d.x, d.y, d.z };
+	float apex[3] = { p.x, p.y, p.z };
+	float low[3], high[3];
+	for (int i = 0; i < 3; i++) {
+		float rimCenter = apex[i] + axis[i] * range * cosOuter;
+		float rimExtent = rimRadius * std::sqrt((std::max)(0.0f, 1.0f - axis[i] * axis[i]));
+		float tip = apex[i] + axis[i] * range;
+		low[i] = (std::min)({ apex[i], rimCenter - rimExtent, tip });
+		high[i] = (std::max)({ apex[i], rimCenter + rimExtent, tip });
+
+		//the cap bulges out to the full range along any world axis inside the cone
+		if (axis[i] >= cosOuter) high[i] = apex[i] + range;
+		if (-axis[i] >= cosOuter) low[i] = apex[i] - range;
+	}
+	return Bounds::FromMinMax(XMFLOAT3(low[0], low[1], low[2]), XMFLOAT3(high[0], high[1], high[2]));
+}
+
+void LightBvh::Update(const Light* a_lights, size_t a_count)
+{
+	m_lights.resize(a_count);
+	m_bounds.resize(a_count);
+
+	auto boundRange = [&](size_t a_first, size_t a_end) {
+		for (size_t i = a_first; i < a_end; i++) {
+			const Light& light = a_lights[i];
+			Bounds bounds = GetLightBounds(light);
+			LightData& data = m_lights[i];
+			data.m_position = light.m_Position;
+			data.m_range = light.m_Range;
+			data.m_power = light.m_Intensity * (std::max)({ light.m_Color.x, light.m_Color.y, light.m_Color.z });
+			data.m_influenceMin = XMFLOAT3(
+				bounds.m_center.x - bounds.m_extents.x,
+				bounds.m_center.y - bounds.m_extents.y,
+				bounds.m_center.z - bounds.m_extents.z);
+			data.m_influenceMax = XMFLOAT3(
+				bounds.m_center.x + bounds.m_extents.x,
+				bounds.m_center.y + bounds.m_extents.y,
+				bounds.m_center.z + bounds.m_extents.z);
+			m_bounds[i] = bounds;
+		}
+	};
+
+	size_t taskCount = std::min<size_t>((std::max)(std::thread::hardware_concurrency(), 1u), a_count / MINIMUM_LIGHTS_PER_TASK + 1);
+	size_t perTask = (a_count + taskCount - 1) / taskCount;
+	std::vector<std::future<void>> tasks;
+	for (size_t task = 1; task < taskCount; task++) {
+		size_t first = task * perTask;
+		size_t end = (std::min)(first + perTask, a_count);
+		if (first >= end) break;
+		tasks.push_back(std::async(std::launch::async, boundRange, first, end));
+	}
+	boundRange(0, (std::min)(perTask, a_count));
+	for (std::future<void>& task : tasks) task.get();
+
+	//refits slowly loosen the tree as lights move, start over now and then
+	m_rebuilt = a_count != m_bvh.GetObjectCount() || m_refitsSinceBuild >= m_maxRefits;
+	if (m_rebuilt) {
+		m_bvh.Build(m_bounds);
+		m_refitsSinceBuild = 0;
+	}
+	else {
+		m_bvh.Refit(m_bounds);
+		m_refitsSinceBuild++;
+	}
+
+	m_nodeData.resize(m_bvh.GetNodeCount());
+	if (!m_nodeData.empty()) AggregateNode(0, 0);
+}
+
+void LightBvh::AggregateNode(uint32_t a_nodeIndex, int a_depth)
+{
+	const Bvh::Node& node = m_bvh.GetNodes()[a_nodeIndex];
+	NodeData& data = m_nodeData[a_nodeIndex];
+	data.m_positionMin = XMFLOAT3(FLT_MAX, FLT_MAX, FLT_MAX);
+	data.m_positionMax = XMFLOAT3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	data.m_power = 0.0f;
+	data.m_maxRange = 0.0f;
+
+	auto grow = [&](const XMFLOAT3& a_min, const XMFLOAT3& a_max, float a_power, float a_range) {
+		data.m_positionMin = XMFLOAT3(
+			(std::min)(data.m_positionMin.x, a_min.x),
+			(std::min)(data.m_positionMin.y, a_min.y),
+			(std::min)(data.m_positionMin.z, a_min.z));
+		data.m_positionMax = XMFLOAT3(
+			(std::max)(data.m_positionMax.x, a_max.x),
+			(std::max)(data.m_positionMax.y, a_max.y),
+			(std::max)(data.m_positionMax.z, a_max.z));
+		data.m_power += a_power;
+		data.m_maxRange = (std::max)(data.m_maxRange, a_range);
+	};
+
+	if (node.IsLeaf()) {
+		const std::vector<uint32_t>& slots = m_bvh.GetObjectSlots();
+		for (uint32_t i = node.m_leftOrFirst; i < node.m_leftOrFirst + node.m_count; i++) {
+			const LightData& light = m_lights[slots[i]];
+			grow(light.m_position, light.m_position, light.m_power, light.m_range);
+		}
+		return;
+	}
+
+	uint32_t left = node.m_leftOrFirst;
+	if (a_depth < MAX_PARALLEL_DEPTH && m_lights.size() >= PARALLEL_AGGREGATE_THRESHOLD) {
+		std::future<void> leftAggregate = std::async(std::launch::async,
+			[this, left, a_depth]() { AggregateNode(left, a_depth + 1); });
+		AggregateNode(left + 1, a_depth + 1);
+		leftAggregate.get();
+	}
+	else {
+		AggregateNode(left, a_depth + 1);
+		AggregateNode(left + 1, a_depth + 1);
+	}
+
+	for (uint32_t child = left; child <= left + 1; child++) {
+		const NodeData& childData = m_nodeData[child];
+		grow(childData.m_positionMin, childData.m_positionMax, childData.m_power, childData.m_maxRange);
+	}
+}
+
+float LightBvh::GetImportance(uint32_t a_light, const XMFLOAT3& a_min, const XMFLOAT3& a_max) const
+{
+	const LightData& light = m_lights[a_light];
+	if (!BoxesOverlap(light.m_influenceMin, light.m_influenceMax, a_min, a_max)) return 0.0f;
+	float distanceSquared = BoxDistanceSquared(light.m_position, light.m_position, a_min, a_max);
+	return light.m_power * Falloff(distanceSquared, light.m_range);
+}
+
+float LightBvh::GetNodeBound(uint32_t a_nodeIndex, const XMFLOAT3& a_min, const XMFLOAT3& a_max) const
+{
+	//every light below is at least this far away and reaches at most this far
+	const Bvh::Node& node = m_bvh.GetNodes()[a_nodeIndex];
+	if (!BoxesOverlap(node.m_min, node.m_max, a_min, a_max)) return 0.0f;
+	const NodeData& data = m_nodeData[a_nodeIndex];
+	float distanceSquared = BoxDistanceSquared(data.m_positionMin, data.m_positionMax, a_min, a_max);
+	return data.m_power * Falloff(distanceSquared, data.m_maxRange);
+}
+
+void LightBvh::QueryTopLights(
+	const XMFLOAT3& a_min,
+	const XMFLOAT3& a_max,
+	uint32_t a_maxLights,
+	std::vector<uint32_t>& a_results,
+	QueryScratch& a_scratch) const
+{
+	a_results.clear();
+	if (m_nodeData.empty() || a_maxLights == 0) return;
+
+	//best first, nodes by upper bound in a max heap, kept lights in a min heap
+	std::vector<std::pair<float, uint32_t>>& nodes = a_scratch.m_nodes;
+	std::vector<std::pair<float, uint32_t>>& kept = a_scratch.m_lights;
+	nodes.clear();
+	kept.clear();
+	auto keptOrder = std::greater<std::pair<float, uint32_t>>();
+
+	float rootBound = GetNodeBound(0, a_min, a_max);
+	if (rootBound > 0.0f) nodes.push_back({ rootBound, 0 });
+
+	while (!nodes.empty()) {
+		std::pop_heap(nodes.begin(), nodes.end());
+		auto [bound, nodeIndex] = nodes.back();
+		nodes.pop_back();
+
+		//nothing left can beat the weakest light kept
+		if (kept.size() == a_maxLights && bound <= kept.front().first) break;
+
+		const Bvh::Node& node = m_bvh.GetNodes()[nodeIndex];
+		if (node.IsLeaf()) {
+			const std::vector<uint32_t>& slots = m_bvh.GetObjectSlots();
+			for (uint32_t i = node.m_leftOrFirst; i < node.m_leftOrFirst + node.m_count; i++) {
+				std::pair<float, uint32_t> candidate(GetImportance(slots[i], a_min, a_max), slots[i]);
+				if (candidate.first <= 0.0f) continue;
+
+				if (kept.size() < a_maxLights) {
+					kept.push_back(candidate);
+					std::push_heap(kept.begin(), kept.end(), keptOrder);
+				}
+				else if (candidate > kept.front()) {
+					std::pop_heap(kept.begin(), kept.end(), keptOrder);
+					kept.back() = candidate;
+					std::push_heap(kept.begin(), kept.end(), keptOrder);
+				}
+			}
+			continue;
+		}
+
+		for (uint32_t child = node.m_leftOrFirst; child <= node.m_leftOrFirst + 1; child++) {
+			float childBound = GetNodeBound(child, a_min, a_max);
+			if (childBound <= 0.0f) continue;
+			if (kept.size() == a_maxLights && childBound <= kept.front().first) continue;
+			nodes.push_back({ childBound, child });
+			std::push_heap(nodes.begin(), nodes.end());
+		}
+	}
+
+	std::sort(kept.begin(), kept.end(), keptOrder);
+	for (const std::pair<float, uint32_t>& light : kept) {
+		a_results.push_back(light.second);
+	}
+}
+
+void LightBvh::FindTopLightsBruteForce(
+	const XMFLOAT3& a_min,
+	const XMFLOAT3& a_max,
+	uint32_t a_maxLights,
+	std::vector<uint32_t>& a_results) const
+{
+	std::vector<std::pair<float, uint32_t>> scored;
+	for (uint32_t i = 0; i < m_lights.size(); i++) {
+		float importance = GetImportance(i, a_min, a_max);
+		if (importance > 0.0f) scored.push_back({ importance, i });
+	}
+
+	size_t count = (std::min)(scored.size(), static_cast<size_t>(a_maxLights));
+	std::partial_sort(scored.begin(), scored.begin() + count, scored.end(), std::greater<std::pair<float, uint32_t>>());
+
+	a_results.clear();
+	for (size_t i = 0; i < count; i++) {
+		a_results.push_back(scored[i].second);
+	}
+}
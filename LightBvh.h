@@ -0,0 +1,100 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include "Bvh.h"
+#include "Light.h"
+
+/// <summary>
+/// Bvh over the influence bounds of point and spot lights, with per node
+/// power and range so queries can rank lights without visiting them all.
+/// A light's importance for a box is its power (intensity times brightest color
+/// channel) scaled by the same range falloff the pixel shader uses, measured
+/// at the closest point of the box. Interior nodes keep an upper bound of that.
+/// Knows nothing about D3D, lights are referred to by their index in Update.
+/// </summary>
+class LightBvh
+{
+public:
+	/// <summary>
+	/// Working memory for one query, keep one per thread so queries don't allocate
+	/// </summary>
+	struct QueryScratch
+	{
+		std::vector<std::pair<float, uint32_t>> m_nodes;
+		std::vector<std::pair<float, uint32_t>> m_lights;
+	};
+
+	/// <summary>
+	/// Point and spot lights only, directional lights reach everything.
+	/// Rebuilds when the light count changed or after m_maxRefits refits,
+	/// otherwise refits the existing tree. Bounds are computed on worker threads.
+	/// </summary>
+	void Update(const Light* a_lights, size_t a_count);
+
+	/// <summary>
+	/// Up to a_maxLights lights with non zero importance for the box,
+	/// most important first
+	/// </summary>
+	void QueryTopLights(
+		const DirectX::XMFLOAT3& a_min,
+		const DirectX::XMFLOAT3& a_max,
+		uint32_t a_maxLights,
+		std::vector<uint32_t>& a_results,
+		QueryScratch& a_scratch) const;
+
+	/// <summary>
+	/// Scores every light, reference for checking QueryTopLights
+	/// </summary>
+	void FindTopLightsBruteForce(
+		const DirectX::XMFLOAT3& a_min,
+		const DirectX::XMFLOAT3& a_max,
+		uint32_t a_maxLights,
+		std::vector<uint32_t>& a_results) const;
+
+	/// <summary>
+	/// Importance of one light for a box, 0 when the box is out of its reach
+	/// </summary>
+	float GetImportance(uint32_t a_light, const DirectX::XMFLOAT3& a_min, const DirectX::XMFLOAT3& a_max) const;
+
+	/// <summary>
+	/// Axis aligned box around everything a light can reach, spot lights are
+	/// bounded by their apex, cap and the rim of their outer cone
+	/// </summary>
+	static Bounds GetLightBounds(const Light& a_light);
+
+	size_t GetLightCount() const { return m_lights.size(); }
+	size_t GetNodeCount() const { return m_bvh.GetNodeCount(); }
+	bool WasRebuilt() const { return m_rebuilt; }
+
+	uint32_t m_maxRefits = 60;
+
+private:
+	struct LightData
+	{
+		DirectX::XMFLOAT3 m_position;
+		float m_range;
+		DirectX::XMFLOAT3 m_influenceMin;
+		float m_power;
+		DirectX::XMFLOAT3 m_influenceMax;
+	};
+
+	//bounds on the lights below a node, indexed like Bvh::GetNodes
+	struct NodeData
+	{
+		DirectX::XMFLOAT3 m_positionMin;
+		float m_power;
+		DirectX::XMFLOAT3 m_positionMax;
+		float m_maxRange;
+	};
+
+	Bvh m_bvh;
+	std::vector<LightData> m_lights;
+	std::vector<Bounds> m_bounds;
+	std::vector<NodeData> m_nodeData;
+	uint32_t m_refitsSinceBuild = 0;
+	bool m_rebuilt = false;
+
+	void AggregateNode(uint32_t a_nodeIndex, int a_depth);
+	float GetNodeBound(uint32_t a_nodeIndex, const DirectX::XMFLOAT3& a_min, const DirectX::XMFLOAT3& a_max) const;
+};
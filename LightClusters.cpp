@@ -0,0 +1,293 @@
+#include "LightClusters.h"
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <cmath>
+#include <cstring>
+#include "FrameProfiler.h"
+#include <cfloat>
+
+using namespace DirectX;
+
+LightClusters::LightClusters(uint32_t a_countX, uint32_t a_countY, uint32_t a_countZ)
+	: m_countX((std::max)(a_countX, 1u)),
+	m_countY((std::max)(a_countY, 1u)),
+	m_countZ((std::max)(a_countZ, 1u))
+{
+}
+
+void LightClusters::SetProjection(const XMFLOAT4X4& a_projection, float a_nearPlane, float a_farPlane, bool a_orthographic)
+{
+	if (a_projection._11 == m_scaleX && a_projection._22 == m_scaleY &&
+		a_nearPlane == m_nearPlane && a_farPlane == m_farPlane &&
+		a_orthographic == m_orthographic && !m_clusterMin.empty()) {
+		return;
+	}
+
+	m_scaleX = a_projection._11;
+	m_scaleY = a_projection._22;
+	m_nearPlane = a_nearPlane;
+	m_farPlane = a_farPlane;
+	m_orthographic = a_orthographic;
+	BuildClusterBounds();
+}
+
+void LightClusters::BuildClusterBounds()
+{
+	//exponential slices keep clusters roughly cube shaped, near ones don't get huge
+	float logRatio = std::log(m_farPlane / m_nearPlane);
+	m_sliceScale = m_countZ / logRatio;
+	m_sliceBias = -static_cast<float>(m_countZ) * std::log(m_nearPlane) / logRatio;
+
+	m_sliceNear.resize(m_countZ + 1);
+	for (uint32_t k = 0; k <= m_countZ; k++) {
+		m_sliceNear[k] = m_nearPlane * std::pow(m_farPlane / m_nearPlane, static_cast<float>(k) / m_countZ);
+	}
+
+	m_clusterMin.resize(GetClusterCount());
+	m_clusterMax.resize(GetClusterCount());
+	for (uint32_t k = 0; k < m_countZ; k++) {
+		float nearZ = m_sliceNear[k];
+		float farZ = m_sliceNear[k + 1];
+
+		for (uint32_t j = 0; j < m_countY; j++) {
+			//tile rows go down the screen, ndc y goes up
+			float bottom = 1.0f - 2.0f * (j + 1) / m_countY;
+			float top = 1.0f - 2.0f * j / m_countY;
+
+			for (uint32_t i = 0; i < m_countX; i++) {
+				float left = -1.0f + 2.0f * i / m_countX;
+				float right = -1.0f + 2.0f * (i + 1) / m_countX;
+
+				XMFLOAT3 minimum, maximum;
+				if (m_orthographic) {
+					minimum = XMFLOAT3(left / m_scaleX, bottom / m_scaleY, nearZ);
+					maximum = XMFLOAT3(right / m_scaleX, top / m_scaleY, farZ);
+				}
+				else {
+					//the tile's edges fan out with depth, take the extremes at both ends
+					minimum = XMFLOAT3(
+						(std::min)(left * nearZ, left * farZ) / m_scaleX,
+						(std::min)(bottom * nearZ, bottom * farZ) / m_scaleY,
+						nearZ);
+					maximum = XMFLOAT3(
+						(std::max)(right * nearZ, right * farZ) / m_scaleX,
+						(std::max)(top * nearZ, top * farZ) / m_scaleY,
+						farZ);
+				}
+
+				uint32_t cluster = (k * m_countY + j) * m_countX + i;
+				m_clusterMin[cluster] = minimum;
+				m_clusterMax[cluster] = maximum;
+			}
+		}
+	}
+}
+
+void LightClusters::Bin(const std::vector<XMFLOAT4>& a_spheres)
+{
+	ForEachSlice([&](uint32_t a_slice) { BinSlice(a_slice, a_spheres); });
+}
+
+void LightClusters::SelectFromBvh(const LightBvh& a_bvh, const XMFLOAT4X4& a_viewToBvh, uint32_t a_maxLights)
+{
+	ForEachSlice([&](uint32_t a_slice) { SelectSlice(a_slice, a_bvh, a_viewToBvh, a_maxLights); });
+}
+
+void LightClusters::ForEachSlice(const std::function<void(uint32_t a_slice)>& a_binSlice)
+{
+	m_ranges.assign(GetClusterCount(), ClusterRange{ 0, 0 });
+	m_indices.clear();
+	m_maxLightsInCluster = 0;
+	m_overflowCount = 0;
+	if (m_clusterMin.empty()) return;
+
+	m_slices.resize(m_countZ);
+
+	//each task takes a run of depth slices, they never write to the same clusters
+	uint32_t taskCount = std::clamp((std::min)(std::thread::hardware_concurrency(), m_maxThreads), 1u, m_countZ);
+	uint32_t slicesPerTask = (m_countZ + taskCount - 1) / taskCount;
+
+	auto binSlices = [&](uint32_t a_first, uint32_t a_end) {
+		FrameProfiler::Scope zone("Bin slices");
+		for (uint32_t slice = a_first; slice < a_end; slice++) {
+			a_binSlice(slice);
+		}
+	};
+
+	std::vector<std::future<void>> tasks;
+	for (uint32_t task = 1; task < taskCount; task++) {
+		uint32_t first = task * slicesPerTask;
+		uint32_t end = (std::min)(first + slicesPerTask, m_countZ);
+		if (first >= end) break;
+		tasks.push_back(std::async(std::launch::async, binSlices, first, end));
+	}
+	binSlices(0, (std::min)(slicesPerTask, m_countZ));
+	for (std::future<void>& task : tasks) task.get();
+
+	//slice lists go back to back, offsets were relative to their slice
+	size_t total = 0;
+	for (const SliceScratch& slice : m_slices) total += slice.m_indices.size();
+	m_indices.resize(total);
+
+	uint32_t clustersPerSlice = m_countX * m_countY;
+	uint32_t sliceOffset = 0;
+	for (uint32_t k = 0; k < m_countZ; k++) {
+		const SliceScratch& slice = m_slices[k];
+		if (!slice.m_indices.empty()) {
+			memcpy(m_indices.data() + sliceOffset, slice.m_indices.data(), slice.m_indices.size() * sizeof(uint32_t));
+		}
+
+		for (uint32_t c = 0; c < clustersPerSlice; c++) {
+			ClusterRange& range = m_ranges[k * clustersPerSlice + c];
+			range.m_offset += sliceOffset;
+			m_maxLightsInCluster = (std::max)(m_maxLightsInCluster, range.m_count);
+		}
+
+		sliceOffset += static_cast<uint32_t>(slice.m_indices.size());
+		m_overflowCount += slice.m_overflowCount;
+	}
+}
+
+void LightClusters::BinSlice(uint32_t a_slice, const std::vector<XMFLOAT4>& a_spheres)
+{
+	SliceScratch& scratch = m_slices[a_slice];
+	scratch.m_x.clear();
+	scratch.m_y.clear();
+	scratch.m_z.clear();
+	scratch.m_radiusSquared.clear();
+	scratch.m_lightIndex.clear();
+	scratch.m_indices.clear();
+	scratch.m_overflowCount = 0;
+
+	//only lights reaching into this slice's depth range are tested against its clusters
+	float nearZ = m_sliceNear[a_slice];
+	float farZ = m_sliceNear[a_slice + 1];
+	for (size_t i = 0; i < a_spheres.size(); i++) {
+		const XMFLOAT4& sphere = a_spheres[i];
+		if (sphere.z + sphere.w < nearZ || sphere.z - sphere.w > farZ) continue;
+
+		scratch.m_x.push_back(sphere.x);
+		scratch.m_y.push_back(sphere.y);
+		scratch.m_z.push_back(sphere.z);
+		scratch.m_radiusSquared.push_back(sphere.w * sphere.w);
+		scratch.m_lightIndex.push_back(static_cast<uint32_t>(i));
+	}
+
+	//negative radius never passes, so the padding lanes drop out of the mask
+	while (scratch.m_x.size() % 4 != 0) {
+		scratch.m_x.push_back(0.0f);
+		scratch.m_y.push_back(0.0f);
+		scratch.m_z.push_back(0.0f);
+		scratch.m_radiusSquared.push_back(-1.0f);
+		scratch.m_lightIndex.push_back(0);
+	}
+
+	size_t candidateCount = scratch.m_x.size();
+	uint32_t clustersPerSlice = m_countX * m_countY;
+	uint32_t firstCluster = a_slice * clustersPerSlice;
+	XMVECTOR zero = XMVectorZero();
+
+	for (uint32_t c = 0; c < clustersPerSlice; c++) {
+		uint32_t cluster = firstCluster + c;
+		XMVECTOR minX = XMVectorReplicate(m_clusterMin[cluster].x);
+		XMVECTOR minY = XMVectorReplicate(m_clusterMin[cluster].y);
+		XMVECTOR minZ = XMVectorReplicate(m_clusterMin[cluster].z);
+		XMVECTOR maxX = XMVectorReplicate(m_clusterMax[cluster].x);
+		XMVECTOR maxY = XMVectorReplicate(m_clusterMax[cluster].y);
+		XMVECTOR maxZ = XMVectorReplicate(m_clusterMax[cluster].z);
+
+		uint32_t offset = static_cast<uint32_t>(scratch.m_indices.size());
+		uint32_t count = 0;
+
+		for (size_t l = 0; l < candidateCount; l += 4) {
+			XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scratch.m_x[l]));
+			XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scratch.m_y[l]));
+			XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scratch.m_z[l]));
+			XMVECTOR radiusSquared = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&scratch.m_radiusSquared[l]));
+
+			//distance from each center to the box, per axis, zero when inside
+			XMVECTOR dx = XMVectorMax(XMVectorMax(XMVectorSubtract(minX, x), XMVectorSubtract(x, maxX)), zero);
+			XMVECTOR dy = XMVectorMax(XMVectorMax(XMVectorSubtract(minY, y), XMVectorSubtract(y, maxY)), zero);
+			XMVECTOR dz = XMVectorMax(XMVectorMax(XMVectorSubtract(minZ, z), XMVectorSubtract(z, maxZ)), zero);
+			XMVECTOR distanceSquared = XMVectorAdd(XMVectorAdd(XMVectorMultiply(dx, dx), XMVectorMultiply(dy, dy)), XMVectorMultiply(dz, dz));
+
+			XMVECTOR hit = XMVectorLessOrEqual(distanceSquared, radiusSquared);
+			if (XMVector4EqualInt(hit, zero)) continue;
+
+			uint32_t lanes[4];
+			XMStoreInt4(lanes, hit);
+			for (size_t v = 0; v < 4; v++) {
+				if (!lanes[v]) continue;
+				if (count < MAX_LIGHTS_PER_CLUSTER) {
+					scratch.m_indices.push_back(scratch.m_lightIndex[l + v]);
+					count++;
+				}
+				else {
+					scratch.m_overflowCount++;
+				}
+			}
+		}
+
+		m_ranges[cluster] = ClusterRange{ offset, count };
+	}
+}
+
+void LightClusters::SelectSlice(uint32_t a_slice, const LightBvh& a_bvh, const XMFLOAT4X4& a_viewToBvh, uint32_t a_maxLights)
+{
+	SliceScratch& scratch = m_slices[a_slice];
+	scratch.m_indices.clear();
+	scratch.m_overflowCount = 0;
+
+	XMMATRIX viewToBvh = XMLoadFloat4x4(&a_viewToBvh);
+	uint32_t maxLights = (std::min)(a_maxLights, MAX_LIGHTS_PER_CLUSTER);
+	uint32_t clustersPerSlice = m_countX * m_countY;
+	uint32_t firstCluster = a_slice * clustersPerSlice;
+
+	for (uint32_t c = 0; c < clustersPerSlice; c++) {
+		uint32_t cluster = firstCluster + c;
+		const XMFLOAT3& clusterMin = m_clusterMin[cluster];
+		const XMFLOAT3& clusterMax = m_clusterMax[cluster];
+
+		//box around the cluster's corners in the bvh's space
+		XMVECTOR minimum = XMVectorReplicate(FLT_MAX);
+		XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+		for (int corner = 0; corner < 8; corner++) {
+			XMVECTOR position = XMVector3Transform(XMVectorSet(
+				(corner & 1) ? clusterMax.x : clusterMin.x,
+				(corner & 2) ? clusterMax.y : clusterMin.y,
+				(corner & 4) ? clusterMax.z : clusterMin.z,
+				1.0f), viewToBvh);
+			minimum = XMVectorMin(minimum, position);
+			maximum = XMVectorMax(maximum, position);
+		}
+		XMFLOAT3 boxMin, boxMax;
+		XMStoreFloat3(&boxMin, minimum);
+		XMStoreFloat3(&boxMax, maximum);
+
+		a_bvh.QueryTopLights(boxMin, boxMax, maxLights, scratch.m_selected, scratch.m_query);
+		m_ranges[cluster] = ClusterRange{
+			static_cast<uint32_t>(scratch.m_indices.size()),
+			static_cast<uint32_t>(scratch.m_selected.size()) };
+		scratch.m_indices.insert(scratch.m_indices.end(), scratch.m_selected.begin(), scratch.m_selected.end());
+	}
+}
+
+bool LightClusters::SphereOverlapsBox(const XMFLOAT4& a_sphere, const XMFLOAT3& a_min, const XMFLOAT3& a_max)
+{
+	float dx = (std::max)((std::max)(a_min.x - a_sphere.x, a_sphere.x - a_max.x), 0.0f);
+	float dy = (std::max)((std::max)(a_min.y - a_sphere.y, a_sphere.y - a_max.y), 0.0f);
+	float dz = (std::max)((std::max)(a_min.z - a_sphere.z, a_sphere.z - a_max.z), 0.0f);
+	return dx * dx + dy * dy + dz * dz <= a_sphere.w * a_sphere.w;
+}
+
+std::vector<uint32_t> LightClusters::FindClustersBruteForce(const XMFLOAT4& a_sphere) const
+{
+	std::vector<uint32_t> clusters;
+	for (uint32_t cluster = 0; cluster < m_clusterMin.size(); cluster++) {
+		if (SphereOverlapsBox(a_sphere, m_clusterMin[cluster], m_clusterMax[cluster])) {
+			clusters.push_back(cluster);
+		}
+	}
+	return clusters;
+}
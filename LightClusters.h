@@ -0,0 +1,134 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include "LightBvh.h"
+
+//pixel shader registers of the cluster light lists
+inline constexpr unsigned int CLUSTER_LIGHT_INDEX_SLOT = 6;
+inline constexpr unsigned int CLUSTER_RANGE_SLOT = 7;
+
+/// <summary>
+/// Where a cluster's lights start in the index list and how many there are
+/// </summary>
+struct ClusterRange
+{
+	uint32_t m_offset;
+	uint32_t m_count;
+};
+
+/// <summary>
+/// Splits the view frustum into a grid of froxels, screen tiles in x and y and
+/// exponential slices in depth, and bins light spheres into per-cluster index lists.
+/// Depth slices are binned on worker threads, clusters test 4 lights at a time.
+/// Knows nothing about D3D, everything is plain view space spheres and matrices.
+/// </summary>
+class LightClusters
+{
+public:
+	//lights past this in one cluster are dropped, the shader loop stays bounded
+	static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 256;
+
+	LightClusters(uint32_t a_countX = 16, uint32_t a_countY = 9, uint32_t a_countZ = 24);
+
+	/// <summary>
+	/// Rebuilds the cluster bounds when the projection changed, a_projection is the
+	/// same row vector matrix used for drawing, only its x and y scale are read
+	/// </summary>
+	void SetProjection(const DirectX::XMFLOAT4X4& a_projection, float a_nearPlane, float a_farPlane, bool a_orthographic);
+
+	/// <summary>
+	/// Bins view space spheres (xyz center, w range), the indices written
+	/// are positions in a_spheres
+	/// </summary>
+	void Bin(const std::vector<DirectX::XMFLOAT4>& a_spheres);
+
+	/// <summary>
+	/// Fills every cluster with the a_maxLights most important lights of a_bvh instead,
+	/// dense areas keep the lights that matter rather than the first ones binned.
+	/// Clusters are moved to the bvh's space with a_viewToBvh, the indices written
+	/// are the bvh's light indices.
+	/// </summary>
+	void SelectFromBvh(const LightBvh& a_bvh, const DirectX::XMFLOAT4X4& a_viewToBvh, uint32_t a_maxLights);
+
+	const std::vector<ClusterRange>& GetRanges() const { return m_ranges; }
+	const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+
+	uint32_t GetCountX() const { return m_countX; }
+	uint32_t GetCountY() const { return m_countY; }
+	uint32_t GetCountZ() const { return m_countZ; }
+	uint32_t GetClusterCount() const { return m_countX * m_countY * m_countZ; }
+
+	/// <summary>
+	/// slice = log(viewZ) * scale + bias
+	/// </summary>
+	float GetSliceScale() const { return m_sliceScale; }
+	float GetSliceBias() const { return m_sliceBias; }
+
+	//results of the last Bin
+	uint32_t GetMaxLightsInCluster() const { return m_maxLightsInCluster; }
+	size_t GetOverflowCount() const { return m_overflowCount; }
+
+	/// <summary>
+	/// Clusters a view space sphere overlaps, one at a time with no SIMD or
+	/// threads, reference for checking Bin
+	/// </summary>
+	std::vector<uint32_t> FindClustersBruteForce(const DirectX::XMFLOAT4& a_sphere) const;
+
+	unsigned int m_maxThreads = 4;
+
+private:
+	uint32_t m_countX;
+	uint32_t m_countY;
+	uint32_t m_countZ;
+
+	float m_scaleX = 0.0f;
+	float m_scaleY = 0.0f;
+	float m_nearPlane = 0.0f;
+	float m_farPlane = 0.0f;
+	bool m_orthographic = false;
+	float m_sliceScale = 0.0f;
+	float m_sliceBias = 0.0f;
+
+	//view space bounds, x fastest then y then slice
+	std::vector<DirectX::XMFLOAT3> m_clusterMin;
+	std::vector<DirectX::XMFLOAT3> m_clusterMax;
+	std::vector<float> m_sliceNear;
+
+	std::vector<ClusterRange> m_ranges;
+	std::vector<uint32_t> m_indices;
+	uint32_t m_maxLightsInCluster = 0;
+	size_t m_overflowCount = 0;
+
+	/// <summary>
+	/// Per slice working set, kept between frames so binning doesn't allocate
+	/// </summary>
+	struct SliceScratch
+	{
+		//candidates overlapping the slice in depth, padded to a multiple of 4
+		std::vector<float> m_x;
+		std::vector<float> m_y;
+		std::vector<float> m_z;
+		std::vector<float> m_radiusSquared;
+		std::vector<uint32_t> m_lightIndex;
+
+		std::vector<uint32_t> m_indices;
+		size_t m_overflowCount = 0;
+
+		LightBvh::QueryScratch m_query;
+		std::vector<uint32_t> m_selected;
+	};
+	std::vector<SliceScratch> m_slices;
+
+	void BuildClusterBounds();
+	void BinSlice(uint32_t a_slice, const std::vector<DirectX::XMFLOAT4>& a_spheres);
+	void SelectSlice(uint32_t a_slice, const LightBvh& a_bvh, const DirectX::XMFLOAT4X4& a_viewToBvh, uint32_t a_maxLights);
+
+	/// <summary>
+	/// Runs a_binSlice for every depth slice across the worker threads, then
+	/// joins the per slice lists into m_ranges and m_indices
+	/// </summary>
+	void ForEachSlice(const std::function<void(uint32_t a_slice)>& a_binSlice);
+	static bool SphereOverlapsBox(const DirectX::XMFLOAT4& a_sphere, const DirectX::XMFLOAT3& a_min, const DirectX::XMFLOAT3& a_max);
+};
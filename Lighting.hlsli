@@ -0,0 +1,262 @@
+#ifndef __LIGHTING_HLSLI__
+#define __LIGHTING_HLSLI__
+
+#include "ShaderIncludes.hlsli"
+#define LIGHT_TYPE_DIRECTIONAL 0
+#define LIGHT_TYPE_POINT 1
+#define LIGHT_TYPE_SPOT 2
+
+// Light evaluation shared by the forward pixel shader and the deferred lighting pass.
+// PERMUTATION_SHADOWS has to be defined before this is included.
+
+struct Light
+{
+    int type;
+    float3 direction;
+    float range;
+    float3 position;
+    float intensity;
+    float3 color;
+    float spotInnerAngle;
+    float spotOuterAngle;
+    int shadowIndex;
+    float padding;
+};
+
+// Per frame constant buffer, shared with the vertex shader
+cbuffer PerFrame : register(b1)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float3 cameraPosition;
+    uint lightCount;
+    uint3 clusterCounts;
+    uint directionalLightCount;
+    float2 clusterTileScale;
+    float clusterSliceScale;
+    float clusterSliceBias;
+}
+
+// directional lights first, then the point and spot lights the clusters index
+StructuredBuffer<Light> lights : register(t5);
+
+// Cascaded shadow map of the first directional light, see ShadowCascades
+cbuffer ShadowConstants : register(b2)
+{
+    matrix cascadeViewProjection[4];
+    float4 cascadeFarDepths;
+    float2 shadowTexelSize;
+    uint cascadeCount;
+    uint shadowsEnabled;
+}
+
+Texture2DArray ShadowMaps : register(t8);
+SamplerComparisonState ShadowSampler : register(s2);
+
+// Point and spot light shadows, Light.shadowIndex is the first view of the light
+struct LocalShadowView
+{
+    matrix viewProjection;
+    float4 atlasRect;
+};
+
+StructuredBuffer<LocalShadowView> localShadowViews : register(t9);
+Texture2DArray LocalShadowAtlas : register(t10);
+
+// 3x3 comparison taps around uv, 0 fully shadowed to 1 fully lit
+float FilterShadow(Texture2DArray shadowMap, float2 uv, float slice, float depth, float2 texelSize)
+{
+    float lit = 0.0f;
+    [unroll]
+    for (int y = -1; y <= 1; y++)
+    {
+        [unroll]
+        for (int x = -1; x <= 1; x++)
+        {
+            lit += shadowMap.SampleCmpLevelZero(ShadowSampler, float3(uv + float2(x, y) * texelSize, slice), depth);
+        }
+    }
+    return lit / 9.0f;
+}
+
+// the first cascade that covers viewZ
+float SampleShadow(float3 worldPosition, float viewZ)
+{
+#if PERMUTATION_SHADOWS
+    if (shadowsEnabled == 0)
+        return 1.0f;
+
+    uint cascade = 0;
+    while (cascade < cascadeCount && viewZ > cascadeFarDepths[cascade])
+        cascade++;
+    if (cascade >= cascadeCount)
+        return 1.0f;
+
+    float4 lightPosition = mul(cascadeViewProjection[cascade], float4(worldPosition, 1.0f));
+    float2 uv = lightPosition.xy * float2(0.5f, -0.5f) + 0.5f;
+    return FilterShadow(ShadowMaps, uv, cascade, lightPosition.z, shadowTexelSize);
+#else
+    return 1.0f;
+#endif
+}
+
+// point lights pick the cube face the pixel is in, +x -x +y -y +z -z like LocalShadows
+float SampleLocalShadow(Light light, float3 worldPosition)
+{
+#if PERMUTATION_SHADOWS
+    if (light.shadowIndex < 0)
+        return 1.0f;
+
+    uint viewIndex = light.shadowIndex;
+    if (light.type == LIGHT_TYPE_POINT)
+    {
+        float3 toPixel = worldPosition - light.position;
+        float3 axis = abs(toPixel);
+        if (axis.x >= axis.y && axis.x >= axis.z)
+            viewIndex += toPixel.x < 0.0f ? 1 : 0;
+        else if (axis.y >= axis.z)
+            viewIndex += toPixel.y < 0.0f ? 3 : 2;
+        else
+            viewIndex += toPixel.z < 0.0f ? 5 : 4;
+    }
+    LocalShadowView shadowView = localShadowViews[viewIndex];
+
+    float4 lightPosition = mul(shadowView.viewProjection, float4(worldPosition, 1.0f));
+    lightPosition.xyz /= lightPosition.w;
+
+    // kept off the tile's edge so the filter never reads a neighbouring tile
+    float3 atlasSize;
+    LocalShadowAtlas.GetDimensions(atlasSize.x, atlasSize.y, atlasSize.z);
+    float2 texelSize = 1.0f / atlasSize.xy;
+    float2 uv = (lightPosition.xy * float2(0.5f, -0.5f) + 0.5f) * shadowView.atlasRect.xy + shadowView.atlasRect.zw;
+    uv = clamp(uv, shadowView.atlasRect.zw + texelSize * 1.5f, shadowView.atlasRect.zw + shadowView.atlasRect.xy - texelSize * 1.5f);
+    return FilterShadow(LocalShadowAtlas, uv, 0.0f, lightPosition.z, texelSize);
+#else
+    return 1.0f;
+#endif
+}
+
+float3 Attenuate(Light light, float3 worldPos)
+{
+    float dist = distance(light.position, worldPos);
+    float att = saturate(1.0f - (dist * dist / (light.range * light.range)));
+    return att * att;
+}
+
+float D_GGX(float3 normal, float3 halfAngle, float roughness)
+{
+    float MIN_ROUGHNESS = 0.0000001;
+    float NdotH = saturate(dot(normal, halfAngle));
+    float NdotH2 = NdotH * NdotH;
+    float a = roughness * roughness;
+    float a2 = max(a * a, MIN_ROUGHNESS);
+    
+    float denomToSquare = NdotH2 * (a2 - 1) + 1;
+
+    return a2 / (3.14 * denomToSquare * denomToSquare);
+}
+
+float G_SchlickGGX(float3 normal, float3 view, float roughness)
+{
+    float k = pow(roughness + 1, 2) / 8.0f;
+    float NdotV = saturate(dot(normal, view));
+
+    return 1 / (NdotV * (1 - k) + k);
+
+}
+
+float3 F_Schlick(float3 view, float3 halfAngle, float3 specularColor)
+{
+    float VdotH = saturate(dot(view, halfAngle));
+
+    return specularColor + (1 - specularColor) * pow(1 - VdotH, 5);
+}
+
+float3 DiffuseEnergyConserve(float3 diffuse, float3 fresnel, float metalness)
+{ 
+    return diffuse * (1 - fresnel) * (1 - metalness);
+}
+
+float3 MicrofacetBRDF(float3 n, float3 l, float3 v, float roughness, float3 f0)
+{
+    float3 halfAngle = normalize(n + l);
+    float D = D_GGX(n, halfAngle, roughness);
+    float G = G_SchlickGGX(n, v, roughness);
+    float3 F = F_Schlick(v, halfAngle, f0);
+
+    float3 specularResult = (D * F * G) / 4;
+    return specularResult * saturate(dot(n, 1));
+}
+
+float3 CalculatePhong(VertexToPixel input, Light light, float3 albedoColor)
+{
+ float3 refl = reflect(-light.direction, input.normal);
+
+    float RdotV = saturate(dot(refl, normalize(input.worldPosition - cameraPosition)));
+    return pow(RdotV, 256) *
+       light.color *
+       light.intensity *
+       albedoColor.xyz;
+}
+
+float3 PointLight(VertexToPixel input, Light light, float3 albedoColor, float roughness, float3 specularColor, float metalness)
+{
+    //diffuse
+    //float3 directionToLight = -lights[lightIndex].direction;
+    float3 directionToLight = light.position - input.worldPosition;
+    float3 diffuseTerm = saturate(dot(input.normal, directionToLight)) * 
+        light.color * 
+        light.intensity * 
+        albedoColor;  
+
+    //specularlity
+    float3 directionToCamera = cameraPosition - input.worldPosition;
+    float3 specularTerm = MicrofacetBRDF(
+        input.normal, directionToLight, directionToCamera, roughness, specularColor);
+
+    float3 fresnel = F_Schlick(input.normal, input.normal + directionToLight, specularColor);
+    float3 balancedDiff = DiffuseEnergyConserve(diffuseTerm, fresnel, metalness);
+
+    float3 total = (balancedDiff * diffuseTerm + specularTerm) * light.intensity * light.color;
+
+    return total * Attenuate(light, input.worldPosition);
+}
+
+float3 DirectionalLight(VertexToPixel input, Light light, float3 albedoColor, float roughness, float3 specularColor, float metalness)
+{
+    //diffuse
+    float3 directionToLight = -light.direction;
+    float3 diffuseTerm = saturate(dot(input.normal, directionToLight)) * 
+        light.color * 
+        light.intensity * 
+        albedoColor;  
+
+    //specularity
+    float3 directionToCamera = cameraPosition - input.worldPosition;
+    float3 specularTerm = MicrofacetBRDF(
+        input.normal, directionToLight, directionToCamera, roughness, specularColor);
+
+    float3 fresnel = F_Schlick(input.normal, input.normal + directionToLight, specularColor);
+    float3 balancedDiff = DiffuseEnergyConserve(diffuseTerm, fresnel, metalness);
+
+    float3 total = (balancedDiff * diffuseTerm + specularTerm) * light.intensity * light.color;
+
+    return total;
+}
+
+float3 SpotLight(VertexToPixel input, Light light, float3 albedoColor, float roughness, float3 specularColor, float metalness)
+{
+    float3 lightToPixel = light.position - input.worldPosition;
+    float pixelAngle = saturate(dot(lightToPixel, light.direction));
+
+    float cosOuter = cos(light.spotOuterAngle);
+    float cosInner = cos(light.spotInnerAngle);
+    float fallOffRange = cosOuter - cosInner;
+
+    float spotTerm = saturate((cosOuter - pixelAngle) / fallOffRange);
+
+    return PointLight(input, light, albedoColor, roughness, specularColor, metalness) * spotTerm;
+}
+
+#endif
@@ -0,0 +1,283 @@
+#include "LocalShadows.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//cube face order the pixel shader picks faces in
+	const XMFLOAT3 CUBE_FORWARD[6] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f },
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, -1.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f } };
+	const XMFLOAT3 CUBE_UP[6] = {
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+		{ 0.0f, 0.0f, -1.0f }, { 0.0f, 0.0f, 1.0f },
+		{ 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } };
+
+	//wider cones than this can't be covered by one perspective view
+	constexpr float MAX_SPOT_FOV = 170.0f * XM_PI / 180.0f;
+}
+
+LocalShadows::LocalShadows()
+	: m_atlas(4096, 128)
+{
+}
+
+float LocalShadows::GetScreenSize(
+	const XMFLOAT3& a_lightPosition,
+	float a_range,
+	const XMFLOAT3& a_cameraPosition,
+	float a_projectionScaleY,
+	float a_screenHeight,
+	bool a_orthographic)
+{
+	float halfHeight = a_screenHeight * 0.5f;
+	if (a_orthographic) {
+		return (std::min)(a_range * a_projectionScaleY * halfHeight, a_screenHeight);
+	}
+
+	float dx = a_lightPosition.x - a_cameraPosition.x;
+	float dy = a_lightPosition.y - a_cameraPosition.y;
+	float dz = a_lightPosition.z - a_cameraPosition.z;
+	float distanceSquared = dx * dx + dy * dy + dz * dz;
+	float rangeSquared = a_range * a_range;
+
+	//inside the light's range it can touch the whole screen
+	if (distanceSquared <= rangeSquared) return a_screenHeight;
+
+	//tangent of the angle the sphere covers, exact for a sphere seen from outside
+	float tangent = a_range / std::sqrt(distanceSquared - rangeSquared);
+	return (std::min)(tangent * a_projectionScaleY * halfHeight, a_screenHeight);
+}
+
+uint32_t LocalShadows::GetFaceCount(const Light& a_light)
+{
+	if (a_light.m_Type == LIGHT_TYPE_POINT) return 6;
+	if (a_light.m_Type != LIGHT_TYPE_SPOT) return 0;
+
+	const XMFLOAT3& d = a_light.m_Direction;
+	return d.x * d.x + d.y * d.y + d.z * d.z > 0.0f ? 1 : 0;
+}
+
+bool LocalShadows::SameShadowSettings(const SceneLight& a_first, const SceneLight& a_second)
+{
+	//color and intensity don't change depth, everything else does
+	const Light& first = a_first.m_light;
+	const Light& second = a_second.m_light;
+	return a_first.m_position == a_second.m_position &&
+		first.m_Type == second.m_Type &&
+		first.m_Direction.x == second.m_Direction.x &&
+		first.m_Direction.y == second.m_Direction.y &&
+		first.m_Direction.z == second.m_Direction.z &&
+		first.m_Range == second.m_Range &&
+		first.m_SpotOuterAngle == second.m_SpotOuterAngle;
+}
+
+void LocalShadows::FreeTiles(Entry& a_entry)
+{
+	for (uint32_t i = 0; i < a_entry.m_faceCount; i++) {
+		m_atlas.Free(a_entry.m_tiles[i]);
+		a_entry.m_tiles[i] = {};
+	}
+	a_entry.m_faceCount = 0;
+}
+
+bool LocalShadows::AllocateTiles(Entry& a_entry, uint32_t a_size)
+{
+	//all faces or none, a point light with missing faces would cast holes
+	uint32_t faceCount = GetFaceCount(a_entry.m_light.m_light);
+	for (uint32_t i = 0; i < faceCount; i++) {
+		a_entry.m_tiles[i] = m_atlas.Allocate(a_size);
+		if (!a_entry.m_tiles[i].IsValid()) {
+			a_entry.m_faceCount = i;
+			FreeTiles(a_entry);
+			return false;
+		}
+	}
+	a_entry.m_faceCount = faceCount;
+	return true;
+}
+
+void LocalShadows::Update(
+	const SceneLight* a_lights,
+	size_t a_count,
+	const Double3& a_renderOrigin,
+	const XMFLOAT3& a_cameraPosition,
+	float a_projectionScaleY,
+	float a_screenHeight,
+	bool a_orthographic)
+{
+	m_reallocationCount = 0;
+
+	//lights removed from the end give their tiles back
+	for (size_t i = a_count; i < m_entries.size(); i++) {
+		FreeTiles(m_entries[i]);
+	}
+	m_entries.resize(a_count);
+
+	m_ranking.clear();
+	for (uint32_t i = 0; i < a_count; i++) {
+		const Light& light = a_lights[i].m_light;
+		Entry& entry = m_entries[i];
+		if (!SameShadowSettings(entry.m_light, a_lights[i])) {
+			//a point light turned spot needs different tiles
+			if (GetFaceCount(entry.m_light.m_light) != GetFaceCount(light)) FreeTiles(entry);
+			entry.m_staticDirty = true;
+		}
+		entry.m_light = a_lights[i];
+		entry.m_selected = false;
+		entry.m_screenSize = 0.0f;
+		if (GetFaceCount(light) == 0 || light.m_Range <= 0.0f || light.m_Intensity <= 0.0f) continue;
+
+		XMFLOAT3 position = a_lights[i].m_position.RelativeTo(a_renderOrigin);
+		entry.m_screenSize = GetScreenSize(position, light.m_Range, a_cameraPosition, a_projectionScaleY, a_screenHeight, a_orthographic);
+		m_ranking.push_back(i);
+	}
+
+	//most important first, ties keep light order so the pick doesn't flicker
+	std::sort(m_ranking.begin(), m_ranking.end(), [this](uint32_t a_first, uint32_t a_second) {
+		float first = m_entries[a_first].m_screenSize;
+		float second = m_entries[a_second].m_screenSize;
+		return first != second ? first > second : a_first < a_second;
+	});
+	if (m_ranking.size() > m_maxShadowedLights) m_ranking.resize(m_maxShadowedLights);
+	for (uint32_t i : m_ranking) m_entries[i].m_selected = true;
+
+	auto wantedSize = [this](const Entry& a_entry) {
+		uint32_t size = m_atlas.GetMinTileSize();
+		uint32_t maxSize = (std::min)(m_maxTileSize, m_atlas.GetSize());
+		while (size < maxSize && static_cast<float>(size) < a_entry.m_screenSize * m_resolutionScale) size <<= 1;
+		return size;
+	};
+
+	//everything that gives space back goes first so the important lights find room
+	for (Entry& entry : m_entries) {
+		if (!entry.m_selected) FreeTiles(entry);
+	}
+	m_pendingAllocations.clear();
+	for (uint32_t i : m_ranking) {
+		Entry& entry = m_entries[i];
+		uint32_t wanted = wantedSize(entry);
+		uint32_t current = entry.m_faceCount > 0 ? entry.m_tiles[0].m_size : 0;
+
+		//grows right away but only shrinks past half, a light at a size boundary doesn't keep redrawing
+		if (current != 0 && current >= wanted && current <= wanted * 2) continue;
+		FreeTiles(entry);
+		m_pendingAllocations.push_back(i);
+	}
+	for (uint32_t i : m_pendingAllocations) {
+		Entry& entry = m_entries[i];
+		//a smaller shadow beats none
+		for (uint32_t size = wantedSize(entry); size >= m_atlas.GetMinTileSize(); size /= 2) {
+			if (AllocateTiles(entry, size)) break;
+		}
+		entry.m_staticDirty = true;
+		m_reallocationCount++;
+	}
+
+	m_faces.clear();
+	m_views.clear();
+	m_shadowedLightCount = 0;
+	float texelToUv = 1.0f / m_atlas.GetSize();
+	for (uint32_t i : m_ranking) {
+		Entry& entry = m_entries[i];
+		if (entry.m_faceCount == 0) continue;
+		m_shadowedLightCount++;
+		entry.m_firstView = static_cast<uint32_t>(m_views.size());
+
+		const Light& light = a_lights[i].m_light;
+		XMFLOAT3 position = a_lights[i].m_position.RelativeTo(a_renderOrigin);
+		XMVECTOR eye = XMLoadFloat3(&position);
+
+		XMMATRIX projection;
+		XMVECTOR spotDirection = XMVectorZero();
+		XMVECTOR spotUp = XMVectorZero();
+		if (light.m_Type == LIGHT_TYPE_POINT) {
+			projection = XMMatrixPerspectiveFovLH(XM_PIDIV2, 1.0f, m_nearPlane, light.m_Range);
+		}
+		else {
+			spotDirection = XMVector3Normalize(XMLoadFloat3(&light.m_Direction));
+			spotUp = std::fabs(XMVectorGetY(spotDirection)) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+			float fov = std::clamp(light.m_SpotOuterAngle * 2.0f, 0.01f, MAX_SPOT_FOV);
+			projection = XMMatrixPerspectiveFovLH(fov, 1.0f, m_nearPlane, light.m_Range);
+		}
+
+		for (uint32_t face = 0; face < entry.m_faceCount; face++) {
+			XMMATRIX view = light.m_Type == LIGHT_TYPE_POINT
+				? XMMatrixLookToLH(eye, XMLoadFloat3(&CUBE_FORWARD[face]), XMLoadFloat3(&CUBE_UP[face]))
+				: XMMatrixLookToLH(eye, spotDirection, spotUp);
+
+			const ShadowAtlasTile& tile = entry.m_tiles[face];
+			Face shadowFace;
+			shadowFace.m_light = i;
+			shadowFace.m_view = static_cast<uint32_t>(m_views.size());
+			shadowFace.m_tile = tile;
+			XMStoreFloat4x4(&shadowFace.m_viewProjection, XMMatrixMultiply(view, projection));
+			shadowFace.m_staticDirty = entry.m_staticDirty;
+			m_faces.push_back(shadowFace);
+
+			LocalShadowView shadowView;
+			shadowView.m_viewProjection = shadowFace.m_viewProjection;
+			shadowView.m_atlasRect = XMFLOAT4(
+				tile.m_size * texelToUv,
+				tile.m_size * texelToUv,
+				tile.m_x * texelToUv,
+				tile.m_y * texelToUv);
+			m_views.push_back(shadowView);
+		}
+	}
+}
+
+void LocalShadows::InvalidateBounds(const Bounds& a_bounds, const Double3& a_origin)
+{
+	for (Entry& entry : m_entries) {
+		if (entry.m_faceCount == 0 || entry.m_staticDirty) continue;
+
+		//sphere against box, distance from the light to the closest point of the box
+		const Double3& position = entry.m_light.m_position;
+		double center[3] = {
+			a_origin.x + a_bounds.m_center.x,
+			a_origin.y + a_bounds.m_center.y,
+			a_origin.z + a_bounds.m_center.z };
+		double extents[3] = { a_bounds.m_extents.x, a_bounds.m_extents.y, a_bounds.m_extents.z };
+		double point[3] = { position.x, position.y, position.z };
+		double distanceSquared = 0.0;
+		for (int axis = 0; axis < 3; axis++) {
+			double outside = std::fabs(point[axis] - center[axis]) - extents[axis];
+			if (outside > 0.0) distanceSquared += outside * outside;
+		}
+		double range = entry.m_light.m_light.m_Range;
+		if (distanceSquared <= range * range) entry.m_staticDirty = true;
+	}
+}
+
+void LocalShadows::InvalidateAll()
+{
+	for (Entry& entry : m_entries) entry.m_staticDirty = true;
+}
+
+void LocalShadows::MarkStaticRendered()
+{
+	for (Entry& entry : m_entries) {
+		if (entry.m_faceCount > 0) entry.m_staticDirty = false;
+	}
+	for (Face& face : m_faces) face.m_staticDirty = false;
+}
+
+int LocalShadows::GetShadowIndex(size_t a_light) const
+{
+	if (a_light >= m_entries.size()) return -1;
+	const Entry& entry = m_entries[a_light];
+	return entry.m_selected && entry.m_faceCount > 0 ? static_cast<int>(entry.m_firstView) : -1;
+}
+
+size_t LocalShadows::GetDirtyFaceCount() const
+{
+	size_t count = 0;
+	for (const Face& face : m_faces) {
+		if (face.m_staticDirty) count++;
+	}
+	return count;
+}
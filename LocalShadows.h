@@ -0,0 +1,137 @@
+#pragma once
+#include <DirectXMath.h>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "Bounds.h"
+#include "Double3.h"
+#include "Light.h"
+#include "ShadowAtlas.h"
+
+//pixel shader registers of the shadow views and the atlas they point into
+inline constexpr unsigned int LOCAL_SHADOW_VIEW_SLOT = 9;
+inline constexpr unsigned int LOCAL_SHADOW_ATLAS_SLOT = 10;
+
+/// <summary>
+/// One rendered face of a shadowed light, indexed by Light::m_ShadowIndex.
+/// Point lights have six in +x -x +y -y +z -z order, spot lights one.
+/// </summary>
+struct LocalShadowView
+{
+	DirectX::XMFLOAT4X4 m_viewProjection;
+	DirectX::XMFLOAT4 m_atlasRect; // 16, xy scale and zw offset from the face's uv to the atlas
+};
+
+/// <summary>
+/// Picks which point and spot lights get shadows and how big, packs them into
+/// a ShadowAtlas and remembers which faces still hold valid static geometry.
+/// Lights are scored by the screen size of their range, the most important get
+/// tiles sized to match. A light's static depth is only redrawn when the light
+/// changes, its tile moves, or a static caster moved inside its range.
+/// Knows nothing about D3D, everything is plain matrices and tiles.
+/// </summary>
+class LocalShadows
+{
+public:
+	/// <summary>
+	/// Face to draw this frame, views are relative to the render origin
+	/// </summary>
+	struct Face
+	{
+		uint32_t m_light;
+		uint32_t m_view;
+		ShadowAtlasTile m_tile;
+		DirectX::XMFLOAT4X4 m_viewProjection;
+		bool m_staticDirty;
+	};
+
+	LocalShadows();
+
+	/// <summary>
+	/// Re-scores a_lights and refreshes the faces and views. a_cameraPosition
+	/// is relative to a_renderOrigin, a_projectionScaleY is the camera
+	/// projection's _22.
+	/// </summary>
+	void Update(
+		const SceneLight* a_lights,
+		size_t a_count,
+		const Double3& a_renderOrigin,
+		const DirectX::XMFLOAT3& a_cameraPosition,
+		float a_projectionScaleY,
+		float a_screenHeight,
+		bool a_orthographic);
+
+	/// <summary>
+	/// A static caster changed inside a_bounds, which are relative to a_origin,
+	/// every light whose range touches them redraws its static depth. The box is
+	/// placed in doubles so far from the world origin it stays exact.
+	/// Call before the frame's Update.
+	/// </summary>
+	void InvalidateBounds(const Bounds& a_bounds, const Double3& a_origin);
+	void InvalidateAll();
+
+	/// <summary>
+	/// Call once the dirty faces were drawn, they stay cached from then on
+	/// </summary>
+	void MarkStaticRendered();
+
+	const std::vector<Face>& GetFaces() const { return m_faces; }
+	const std::vector<LocalShadowView>& GetViews() const { return m_views; }
+
+	/// <summary>
+	/// First view of light a_light for Light::m_ShadowIndex, -1 when unshadowed
+	/// </summary>
+	int GetShadowIndex(size_t a_light) const;
+
+	/// <summary>
+	/// Radius of a light's range on screen in pixels, what lights are ranked by
+	/// </summary>
+	static float GetScreenSize(
+		const DirectX::XMFLOAT3& a_lightPosition,
+		float a_range,
+		const DirectX::XMFLOAT3& a_cameraPosition,
+		float a_projectionScaleY,
+		float a_screenHeight,
+		bool a_orthographic);
+
+	const ShadowAtlas& GetAtlas() const { return m_atlas; }
+	uint32_t GetAtlasSize() const { return m_atlas.GetSize(); }
+
+	//stats of the last Update
+	size_t GetShadowedLightCount() const { return m_shadowedLightCount; }
+	size_t GetDirtyFaceCount() const;
+	size_t GetReallocationCount() const { return m_reallocationCount; }
+
+	//settings, read by the next Update
+	uint32_t m_maxShadowedLights = 8;
+	uint32_t m_maxTileSize = 1024;
+	float m_resolutionScale = 2.0f;
+	float m_nearPlane = 0.05f;
+
+private:
+	struct Entry
+	{
+		//what the static depth was drawn with, any change redraws it
+		SceneLight m_light;
+		std::array<ShadowAtlasTile, 6> m_tiles = {};
+		uint32_t m_faceCount = 0;
+		uint32_t m_firstView = 0;
+		float m_screenSize = 0.0f;
+		bool m_selected = false;
+		bool m_staticDirty = true;
+	};
+
+	ShadowAtlas m_atlas;
+	std::vector<Entry> m_entries;
+	std::vector<uint32_t> m_ranking;
+	std::vector<uint32_t> m_pendingAllocations;
+	std::vector<Face> m_faces;
+	std::vector<LocalShadowView> m_views;
+	size_t m_shadowedLightCount = 0;
+	size_t m_reallocationCount = 0;
+
+	void FreeTiles(Entry& a_entry);
+	bool AllocateTiles(Entry& a_entry, uint32_t a_size);
+	static bool SameShadowSettings(const SceneLight& a_first, const SceneLight& a_second);
+	static uint32_t GetFaceCount(const Light& a_light);
+};
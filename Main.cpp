@@ -6,6 +6,7 @@
 #include "Graphics.h"
 #include "Game.h"
 #include "Input.h"
+#include "FrameProfiler.h"
 
 // Annonymous namespace to hold variables
 // only accessible in this file
@@ -117,14 +118,24 @@ int WINAPI WinMain(
 			float totalTime = (float)((currentTime - startTime) * perfSeconds);
 			previousTime = currentTime;
 
+			// Close the last frame's profile before anything in this one is timed
+			FrameProfiler::BeginFrame();
+
 			// Calculate basic fps
 			Window::UpdateStats(totalTime);
 
 			// Input updating
 			Input::Update();
 
-			// Update and draw
+			// Update, run however many fixed simulation steps are due, then draw
 			game->Update(deltaTime, totalTime);
+
+			FixedTimestep& timestep = game->GetTimestep();
+			int steps = timestep.Advance(deltaTime);
+			for (int i = 0; i < steps; i++) {
+				game->FixedUpdate((float)timestep.GetStepSeconds());
+			}
+
 			game->Draw(deltaTime, totalTime);
 
 			// Notify Input system about end of frame
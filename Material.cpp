@@ -6,6 +6,8 @@
 #include <wrl/client.h>
 #include <DirectXMath.h>
 #include <memory>
+#include <stdexcept>
+#include <algorithm>
 
 Material::Material(DirectX::XMFLOAT4 a_colorTint, Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pVertexShader, Microsoft::WRL::ComPtr<ID3D11PixelShader> a_pPixelShader) : 
 	Material(
@@ -83,28 +85,61 @@ void Material::SetUVOffset(float a_xOffset, float a_yOffset) {
 	m_UVoffset.y = a_yOffset;
 }
 
-void Material::BindTexturesAndSamplers()
+void Material::BindTexturesAndSamplers(RenderCommandList& a_commands, bool a_perSlot)
 {
-	for (const auto& [key, value] : m_textureSRV) {
-		Graphics::Context->PSSetShaderResources(key, 1, value.GetAddressOf());
+	if (a_perSlot) {
+		for (unsigned int i = 0; i < m_textureCount; i++) {
+			if (m_textureSRVs[i]) a_commands.BindShaderResource(RenderCommand::Stage::PIXEL, i, m_textureSRVs[i].Get());
+		}
+		for (unsigned int i = 0; i < m_samplerCount; i++) {
+			if (m_samplers[i]) a_commands.BindSampler(RenderCommand::Stage::PIXEL, i, m_samplers[i].Get());
+		}
+		return;
 	}
 
-	for (const auto& [key, value] : m_samplers) {
-		Graphics::Context->PSSetSamplers(key, 1, value.GetAddressOf());
-	}
+	std::array<RenderHandle, MAX_TEXTURE_SLOTS> views;
+	for (unsigned int i = 0; i < m_textureCount; i++) views[i] = m_textureSRVs[i].Get();
+	std::array<RenderHandle, MAX_SAMPLER_SLOTS> samplers;
+	for (unsigned int i = 0; i < m_samplerCount; i++) samplers[i] = m_samplers[i].Get();
+
+	if (m_textureCount > 0) a_commands.BindShaderResources(RenderCommand::Stage::PIXEL, 0, m_textureCount, views.data());
+	if (m_samplerCount > 0) a_commands.BindSamplers(RenderCommand::Stage::PIXEL, 0, m_samplerCount, samplers.data());
 }
 
-std::unordered_map<unsigned int, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> Material::GetSRVMap()
+const std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, Material::MAX_TEXTURE_SLOTS>& Material::GetTextureSRVs() const
 {
-	return m_textureSRV;
+	return m_textureSRVs;
+}
+
+unsigned int Material::GetTextureCount() const
+{
+	return m_textureCount;
+}
+
+unsigned int Material::GetTableIndex() const
+{
+	return m_tableIndex;
+}
+
+void Material::SetTableIndex(unsigned int a_index)
+{
+	m_tableIndex = a_index;
 }
 
 void Material::AddTextureSRV(unsigned int a_index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> a_textureSRV)
 {
-	m_textureSRV[a_index] = a_textureSRV;
+	if (a_index >= MAX_TEXTURE_SLOTS) {
+		throw std::out_of_range("Material texture slot past MAX_TEXTURE_SLOTS");
+	}
+	m_textureSRVs[a_index] = a_textureSRV;
+	m_textureCount = (std::max)(m_textureCount, a_index + 1);
 }
 
 void Material::AddSampler(unsigned int a_index, Microsoft::WRL::ComPtr<ID3D11SamplerState> a_sampler)
 {
+	if (a_index >= MAX_SAMPLER_SLOTS) {
+		throw std::out_of_range("Material sampler slot past MAX_SAMPLER_SLOTS");
+	}
 	m_samplers[a_index] = a_sampler;
+	m_samplerCount = (std::max)(m_samplerCount, a_index + 1);
 }
@@ -2,10 +2,16 @@
 #include "BufferStructs.h"
 #include <wrl/client.h>
 #include <d3d11.h>
-#include <unordered_map>
+#include <array>
+#include "RenderCommandList.h"
 
 class Material
 {
+public:
+	//t0-t3 are albedo, normal, roughness and metalness, the material table follows them
+	static constexpr unsigned int MAX_TEXTURE_SLOTS = 4;
+	static constexpr unsigned int MAX_SAMPLER_SLOTS = 2;
+
 private:
 	DirectX::XMFLOAT4 m_colorTint;
 	Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pVertexShader;
@@ -13,10 +19,14 @@ private:
 	DirectX::XMFLOAT2 m_UVscale;
 	DirectX::XMFLOAT2 m_UVoffset;
 
-	//srvs
-	std::unordered_map<unsigned int, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> m_textureSRV;
-	std::unordered_map<unsigned int, Microsoft::WRL::ComPtr<ID3D11SamplerState>> m_samplers;
+	//fixed slot arrays, slots [0, count) are bound with one call each
+	std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, MAX_TEXTURE_SLOTS> m_textureSRVs;
+	std::array<Microsoft::WRL::ComPtr<ID3D11SamplerState>, MAX_SAMPLER_SLOTS> m_samplers;
+	unsigned int m_textureCount = 0;
+	unsigned int m_samplerCount = 0;
 
+	//element of the material table holding this material's constants
+	unsigned int m_tableIndex = 0;
 
 public:
 	Material(
@@ -49,7 +59,17 @@ public:
 
 	void AddTextureSRV(unsigned int a_index, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> a_textureSRV);
 	void AddSampler(unsigned int a_index, Microsoft::WRL::ComPtr<ID3D11SamplerState> a_sampler);
-	void BindTexturesAndSamplers();
-	std::unordered_map<unsigned int, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> GetSRVMap();
+
+	/// <summary>
+	/// One range bind for the textures and one for the samplers,
+	/// a_perSlot emits a bind per slot instead for comparison
+	/// </summary>
+	void BindTexturesAndSamplers(RenderCommandList& a_commands, bool a_perSlot = false);
+
+	const std::array<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>, MAX_TEXTURE_SLOTS>& GetTextureSRVs() const;
+	unsigned int GetTextureCount() const;
+
+	unsigned int GetTableIndex() const;
+	void SetTableIndex(unsigned int a_index);
 };
 
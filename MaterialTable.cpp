@@ -0,0 +1,32 @@
+#include "MaterialTable.h"
+#include "Graphics.h"
+#include <cstring>
+
+void MaterialTable::Add(std::shared_ptr<Material> a_pMaterial)
+{
+	a_pMaterial->SetTableIndex(static_cast<unsigned int>(m_materials.size()));
+	m_materials.push_back(a_pMaterial);
+}
+
+void MaterialTable::Update()
+{
+	if (m_materials.empty()) return;
+
+	m_constants.resize(m_materials.size());
+	for (size_t i = 0; i < m_materials.size(); i++) {
+		m_constants[i].m_colorTint = m_materials[i]->GetColorTint();
+		m_constants[i].m_scale = m_materials[i]->GetUVscale();
+		m_constants[i].m_offset = m_materials[i]->GetUVoffset();
+	}
+
+	//materials rarely change, most frames skip the map entirely, a grown table always differs
+	bool changed = m_uploaded.size() != m_constants.size() ||
+		memcmp(m_uploaded.data(), m_constants.data(), m_constants.size() * sizeof(MaterialConstants)) != 0;
+	if (changed) {
+		m_buffer.Upload(m_constants.data(), m_constants.size(), sizeof(MaterialConstants));
+		m_uploaded = m_constants;
+		m_uploadCount++;
+	}
+
+	Graphics::State.PSSetShaderResource(SHADER_SLOT, m_buffer.GetSRV());
+}
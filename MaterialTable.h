@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "Material.h"
+#include "BufferStructs.h"
+#include "DynamicStructuredBuffer.h"
+
+/// <summary>
+/// Every material's constants in one structured buffer, draws only pass
+/// their material's index instead of the constants themselves.
+/// </summary>
+class MaterialTable
+{
+public:
+	//pixel shader register of the table, right after the material textures
+	static constexpr unsigned int SHADER_SLOT = Material::MAX_TEXTURE_SLOTS;
+
+	/// <summary>
+	/// Gives a_pMaterial the next index in the table
+	/// </summary>
+	void Add(std::shared_ptr<Material> a_pMaterial);
+
+	/// <summary>
+	/// Re-reads every material and uploads the table when something changed, then binds it
+	/// </summary>
+	void Update();
+
+	size_t Count() const { return m_materials.size(); }
+	unsigned int GetUploadCount() const { return m_uploadCount; }
+
+private:
+	std::vector<std::shared_ptr<Material>> m_materials;
+	std::vector<MaterialConstants> m_constants;
+	std::vector<MaterialConstants> m_uploaded;
+	unsigned int m_uploadCount = 0;
+	DynamicStructuredBuffer m_buffer;
+};
@@ -3,6 +3,7 @@
 #include <DirectXMath.h>
 #include "Vertex.h"
 #include "Graphics.h"
+#include "PositionStream.h"
 #include <fstream>
 #include <stdexcept>
 #include <unordered_map>
@@ -13,6 +14,23 @@ using namespace DirectX;
 void Mesh::CreateVertexBuffer(UINT a_vertexCount, const Vertex* a_pFirstVertex)
 {
 	m_vertexBufferCount = a_vertexCount;
+
+	//local bounds from the same vertices that go to the GPU
+	if (a_vertexCount > 0) {
+		XMFLOAT3 minPosition = a_pFirstVertex[0].m_position;
+		XMFLOAT3 maxPosition = a_pFirstVertex[0].m_position;
+		for (UINT i = 1; i < a_vertexCount; i++) {
+			XMStoreFloat3(&minPosition, XMVectorMin(XMLoadFloat3(&minPosition), XMLoadFloat3(&a_pFirstVertex[i].m_position)));
+			XMStoreFloat3(&maxPosition, XMVectorMax(XMLoadFloat3(&maxPosition), XMLoadFloat3(&a_pFirstVertex[i].m_position)));
+		}
+		m_localBounds = Bounds::FromMinMax(minPosition, maxPosition);
+	}
+
+	m_cpuPositions.resize(a_vertexCount);
+	for (UINT i = 0; i < a_vertexCount; i++) {
+		m_cpuPositions[i] = a_pFirstVertex[i].m_position;
+	}
+
 	// Create a VERTEX BUFFER
 	// - This holds the vertex data of triangles for a single object
 	// - This buffer is created on the GPU, which is where the data needs to
@@ -44,6 +62,7 @@ void Mesh::CreateVertexBuffer(UINT a_vertexCount, const Vertex* a_pFirstVertex)
 void Mesh::CreateIndexBuffer(UINT a_indexCount, const UINT* a_pFirstIndex)
 {
 	m_indexBufferCount = a_indexCount;
+	m_cpuIndices.assign(a_pFirstIndex, a_pFirstIndex + a_indexCount);
 	// Create an INDEX BUFFER
 	// - This holds indices to elements in the vertex buffer
 	// - This is most useful when vertices are shared among neighboring triangles
@@ -71,6 +90,42 @@ void Mesh::CreateIndexBuffer(UINT a_indexCount, const UINT* a_pFirstIndex)
 	}
 }
 
+void Mesh::CreatePositionBuffers()
+{
+	//built from the CPU copies, so both constructors get it the same way
+	PositionStream stream;
+	stream.Build(m_cpuPositions, m_cpuIndices);
+	m_positionVertexCount = static_cast<UINT>(stream.GetPositions().size());
+	if (m_positionVertexCount == 0) return;
+
+	D3D11_BUFFER_DESC vbd = {};
+	vbd.Usage = D3D11_USAGE_IMMUTABLE;
+	vbd.ByteWidth = sizeof(XMFLOAT3) * m_positionVertexCount;
+	vbd.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	D3D11_SUBRESOURCE_DATA initialVertexData = {};
+	initialVertexData.pSysMem = stream.GetPositions().data();
+	Graphics::Device->CreateBuffer(&vbd, &initialVertexData, m_positionVertexBuffer.GetAddressOf());
+
+	//welding usually brings the count under 16 bits, halving the index reads as well
+	std::vector<uint16_t> shortIndices;
+	D3D11_SUBRESOURCE_DATA initialIndexData = {};
+	if (stream.HasShortIndices()) {
+		shortIndices = stream.GetShortIndices();
+		m_positionIndexSize = sizeof(uint16_t);
+		initialIndexData.pSysMem = shortIndices.data();
+	}
+	else {
+		m_positionIndexSize = sizeof(UINT);
+		initialIndexData.pSysMem = stream.GetIndices().data();
+	}
+
+	D3D11_BUFFER_DESC ibd = {};
+	ibd.Usage = D3D11_USAGE_IMMUTABLE;
+	ibd.ByteWidth = m_positionIndexSize * static_cast<UINT>(stream.GetIndices().size());
+	ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	Graphics::Device->CreateBuffer(&ibd, &initialIndexData, m_positionIndexBuffer.GetAddressOf());
+}
+
 Mesh::Mesh(Vertex a_vertices[], UINT a_indices[], int a_verticesLength, int a_indicesLength)
 {
 	m_vertexBufferCount = a_verticesLength;
@@ -86,6 +141,7 @@ Mesh::Mesh(Vertex a_vertices[], UINT a_indices[], int a_verticesLength, int a_in
 	CalculateTangents(a_vertices, a_verticesLength, a_indices, a_indicesLength);
 	CreateVertexBuffer(a_verticesLength, &a_vertices[0]);
 	CreateIndexBuffer(a_indicesLength, &a_indices[0]);
+	CreatePositionBuffers();
 }
 
 Mesh::Mesh(const char* a_fileName)
@@ -348,6 +404,7 @@ Mesh::Mesh(const char* a_fileName)
 	// NEXT: Create the actual buffers!
 	CreateVertexBuffer(static_cast<UINT>(finalVertices.size()), &finalVertices[0]);
 	CreateIndexBuffer(static_cast<UINT>(finalIndices.size()), &finalIndices[0]);
+	CreatePositionBuffers();
 
 	// *************************************
 	//      IMPLEMENTATION NOTES (2/2)
@@ -398,35 +455,72 @@ int Mesh::GetVertexCount()
 	return m_vertexBufferCount;
 }
 
-void Mesh::Draw()
+const Bounds& Mesh::GetLocalBounds()
+{
+	return m_localBounds;
+}
+
+const std::vector<DirectX::XMFLOAT3>& Mesh::GetCpuPositions()
+{
+	return m_cpuPositions;
+}
+
+const std::vector<uint32_t>& Mesh::GetCpuIndices()
+{
+	return m_cpuIndices;
+}
+
+int Mesh::GetPositionVertexCount()
+{
+	return m_positionVertexCount;
+}
+
+void Mesh::Draw(RenderCommandList& a_commands)
 {
 	// DRAW geometry
 	// - These steps are generally repeated for EACH object you draw
 	// - Other Direct3D calls will also be necessary to do more complex things
-	{
-		// Set buffers in the input assembler (IA) stage
-		//  - Do this ONCE PER OBJECT, since each object may have different geometry
-		//  - For this demo, this step *could* simply be done once during Init()
-		//  - However, this needs to be done between EACH DrawIndexed() call
-		//     when drawing different geometry, so it's here as an example
-		UINT stride = sizeof(Vertex);
-		UINT offset = 0;
-		Graphics::Context->IASetVertexBuffers(0, 1, m_vertexBuffer.GetAddressOf(), &stride, &offset);
-		Graphics::Context->IASetIndexBuffer(m_indexBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-		// Tell Direct3D to draw
-		//  - Begins the rendering pipeline on the GPU
-		//  - Do this ONCE PER OBJECT you intend to draw
-		//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
-		//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
-		//     vertices in the currently set VERTEX BUFFER
-		Graphics::Context->DrawIndexed(
-			GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
-			0,     // Offset to the first index we want to use
-			0);    // Offset to add to each index when looking up vertices
-	}
-	
-}	
+	Bind(a_commands);
+	DrawIndexed(a_commands);
+}
+
+void Mesh::Bind(RenderCommandList& a_commands)
+{
+	// Set buffers in the input assembler (IA) stage
+	//  - Only needed when the previous draw used different geometry
+	a_commands.BindGeometry(m_vertexBuffer.Get(), m_indexBuffer.Get(), sizeof(Vertex), sizeof(UINT));
+}
+
+void Mesh::BindPositions(RenderCommandList& a_commands)
+{
+	a_commands.BindGeometry(m_positionVertexBuffer.Get(), m_positionIndexBuffer.Get(), sizeof(XMFLOAT3), m_positionIndexSize);
+}
+
+void Mesh::DrawIndexed(RenderCommandList& a_commands)
+{
+	// Tell Direct3D to draw
+	//  - Begins the rendering pipeline on the GPU
+	//  - Do this ONCE PER OBJECT you intend to draw
+	//  - This will use all currently set Direct3D resources (shaders, buffers, etc)
+	//  - DrawIndexed() uses the currently set INDEX BUFFER to look up corresponding
+	//     vertices in the currently set VERTEX BUFFER
+	a_commands.DrawIndexed(
+		GetIndexCount(),     // The number of indices to use (we could draw a subset if we wanted)
+		0,     // Offset to the first index we want to use
+		0);    // Offset to add to each index when looking up vertices
+}
+
+void Mesh::DrawIndexedInstanced(UINT a_instanceCount, RenderCommandList& a_commands)
+{
+	//one call for every copy, per instance data comes from the bound instance buffer
+	a_commands.DrawIndexedInstanced(
+		GetIndexCount(),	// Indices per instance
+		a_instanceCount,	// How many copies to draw
+		0,					// Offset to the first index
+		0,					// Offset added to each index
+		0);					// SV_InstanceID still starts at 0, so the offset goes in a constant buffer
+}
+
 // --------------------------------------------------------
 // Author: Chris Cascioli
 // Purpose: Calculates the tangents of the vertices in a mesh
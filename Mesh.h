@@ -6,6 +6,8 @@
 #include <DirectXMath.h>
 #include "Graphics.h"
 #include <vector>
+#include "Bounds.h"
+#include "RenderCommandList.h"
 
 class Mesh
 {
@@ -16,8 +18,22 @@ private:
 	UINT m_indexBufferCount;
 	UINT m_vertexBufferCount;
 
+	//local space box around every vertex, used for culling
+	Bounds m_localBounds;
+
+	//CPU side copies for software rasterization
+	std::vector<DirectX::XMFLOAT3> m_cpuPositions;
+	std::vector<uint32_t> m_cpuIndices;
+
+	//welded positions for depth only passes, see PositionStream
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_positionVertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_positionIndexBuffer;
+	UINT m_positionIndexSize = sizeof(UINT);
+	UINT m_positionVertexCount = 0;
+
 	void CreateVertexBuffer(UINT ta_vertexCount, const Vertex* a_pFirstVertex);
 	void CreateIndexBuffer(UINT a_indexCount, const UINT* a_pFirstIndex);
+	void CreatePositionBuffers();
 
 	void CalculateTangents(Vertex* a_verts, int a_numVerts, unsigned int* a_indicies, int a_numIndicies);
 
@@ -29,6 +45,18 @@ public:
 	Microsoft::WRL::ComPtr<ID3D11Buffer> GetIndexBuffer();
 	int GetIndexCount();
 	int GetVertexCount();
-	void Draw();
+	const Bounds& GetLocalBounds();
+	const std::vector<DirectX::XMFLOAT3>& GetCpuPositions();
+	const std::vector<uint32_t>& GetCpuIndices();
+	int GetPositionVertexCount();
+	void Draw(RenderCommandList& a_commands);
+
+	//Draw split in two so consecutive draws of the same mesh can skip the IA binds
+	void Bind(RenderCommandList& a_commands);
+
+	//position only stream with its own index buffer, same index count so the draws don't change
+	void BindPositions(RenderCommandList& a_commands);
+	void DrawIndexed(RenderCommandList& a_commands);
+	void DrawIndexedInstanced(UINT a_instanceCount, RenderCommandList& a_commands);
 };
 
@@ -0,0 +1,147 @@
+#pragma once
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+/// <summary>
+/// Chunked object pool with free-list reuse.
+/// Objects are constructed in place inside fixed-size chunks that are never
+/// reallocated, so a pointer returned by Create() stays valid until Destroy().
+/// Create/Destroy are O(1); live objects are also tracked in a dense list so
+/// iteration does not have to walk dead slots.
+/// </summary>
+template <typename T, size_t ChunkSize = 256>
+class ObjectPool
+{
+private:
+	struct Slot
+	{
+		alignas(T) unsigned char m_storage[sizeof(T)];
+		Slot* m_pNextFree;
+		size_t m_liveIndex;
+		bool m_alive;
+	};
+
+	static_assert(ChunkSize > 0, "ObjectPool chunks must hold at least one object");
+
+	std::vector<std::unique_ptr<Slot[]>> m_chunks;
+	Slot* m_pFreeHead = nullptr;
+
+	//dense list of live objects, order changes on Destroy
+	std::vector<T*> m_live;
+
+	size_t m_totalCreated = 0;
+	size_t m_totalDestroyed = 0;
+
+	static Slot* SlotFromObject(T* a_pObject)
+	{
+		//storage is the first member, so the object and slot share an address
+		return reinterpret_cast<Slot*>(a_pObject);
+	}
+
+	void AllocateChunk()
+	{
+		//live objects never outnumber slots, with room for all of them the push in Create can't throw
+		size_t capacity = Capacity() + ChunkSize;
+		if (m_live.capacity() < capacity) m_live.reserve((std::max)(capacity, m_live.capacity() * 2));
+
+		std::unique_ptr<Slot[]> chunk = std::make_unique<Slot[]>(ChunkSize);
+
+		//link back to front so slots are handed out in address order
+		for (size_t i = ChunkSize; i > 0; i--) {
+			Slot& slot = chunk[i - 1];
+			slot.m_alive = false;
+			slot.m_liveIndex = 0;
+			slot.m_pNextFree = m_pFreeHead;
+			m_pFreeHead = &slot;
+		}
+
+		m_chunks.push_back(std::move(chunk));
+	}
+
+public:
+	ObjectPool() = default;
+	~ObjectPool() { Clear(); }
+	ObjectPool(const ObjectPool&) = delete;
+	ObjectPool& operator=(const ObjectPool&) = delete;
+
+	/// <summary>
+	/// Constructs a new object in the first free slot, growing by one chunk if needed
+	/// </summary>
+	/// <returns>Stable pointer to the new object</returns>
+	template <typename... Args>
+	T* Create(Args&&... a_args)
+	{
+		if (m_pFreeHead == nullptr) AllocateChunk();
+
+		//if the constructor throws the slot is still at the head of the free list,
+		//nothing after it can throw since AllocateChunk reserved the live list
+		Slot* slot = m_pFreeHead;
+		T* object = new (slot->m_storage) T(std::forward<Args>(a_args)...);
+		m_pFreeHead = slot->m_pNextFree;
+
+		slot->m_alive = true;
+		slot->m_liveIndex = m_live.size();
+		m_live.push_back(object);
+		m_totalCreated++;
+		return object;
+	}
+
+	/// <summary>
+	/// Destroys an object created by this pool and returns its slot to the free list
+	/// </summary>
+	void Destroy(T* a_pObject)
+	{
+		if (a_pObject == nullptr) return;
+
+		Slot* slot = SlotFromObject(a_pObject);
+		if (!slot->m_alive) return;
+
+		//swap-remove from the dense list
+		T* last = m_live.back();
+		m_live[slot->m_liveIndex] = last;
+		SlotFromObject(last)->m_liveIndex = slot->m_liveIndex;
+		m_live.pop_back();
+
+		a_pObject->~T();
+		slot->m_alive = false;
+		slot->m_pNextFree = m_pFreeHead;
+		m_pFreeHead = slot;
+		m_totalDestroyed++;
+	}
+
+	/// <summary>
+	/// Destroys every live object, chunks are kept for reuse
+	/// </summary>
+	void Clear()
+	{
+		while (!m_live.empty()) {
+			Destroy(m_live.back());
+		}
+	}
+
+	size_t Count() const { return m_live.size(); }
+	size_t Capacity() const { return m_chunks.size() * ChunkSize; }
+	size_t ChunkCount() const { return m_chunks.size(); }
+	size_t TotalCreated() const { return m_totalCreated; }
+	size_t TotalDestroyed() const { return m_totalDestroyed; }
+
+	/// <summary>
+	/// Fraction of allocated slots that are currently unused (0 = fully packed)
+	/// </summary>
+	float GetFragmentation() const
+	{
+		if (Capacity() == 0) return 0.0f;
+		return 1.0f - static_cast<float>(Count()) / static_cast<float>(Capacity());
+	}
+
+	//dense iteration over live objects
+	T* operator[](size_t a_index) { return m_live[a_index]; }
+	typename std::vector<T*>::iterator begin() { return m_live.begin(); }
+	typename std::vector<T*>::iterator end() { return m_live.end(); }
+	typename std::vector<T*>::const_iterator begin() const { return m_live.begin(); }
+	typename std::vector<T*>::const_iterator end() const { return m_live.end(); }
+};
@@ -0,0 +1,341 @@
+#include "OcclusionCuller.h"
+#include <algorithm>
+#include <future>
+#include <thread>
+#include <cmath>
+#include "FrameProfiler.h"
+
+using namespace DirectX;
+
+OcclusionCuller::OcclusionCuller(uint32_t a_width, uint32_t a_height, uint32_t a_bandCount)
+{
+	m_bandCount = a_bandCount > 0 ? a_bandCount : 1;
+	XMStoreFloat4x4(&m_viewProjection, XMMatrixIdentity());
+	Resize(a_width, a_height);
+}
+
+void OcclusionCuller::Resize(uint32_t a_width, uint32_t a_height)
+{
+	//rows are processed 4 pixels at a time
+	m_width = (std::max)((a_width + 3) & ~3u, 4u);
+	m_height = (std::max)(a_height, 1u);
+	m_depth.assign(static_cast<size_t>(m_width) * m_height, 1.0f);
+	m_pyramid.clear();
+	m_pyramidWidths.clear();
+	m_pyramidHeights.clear();
+}
+
+void OcclusionCuller::BeginFrame(const XMFLOAT4X4& a_viewProjection)
+{
+	m_viewProjection = a_viewProjection;
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	m_triangles.clear();
+	m_pyramid.clear();
+	m_pyramidWidths.clear();
+	m_pyramidHeights.clear();
+}
+
+void OcclusionCuller::AddOccluder(
+	const XMFLOAT3* a_positions,
+	const uint32_t* a_indices,
+	uint32_t a_indexCount,
+	const XMFLOAT4X4& a_world)
+{
+	XMMATRIX worldViewProjection = XMMatrixMultiply(XMLoadFloat4x4(&a_world), XMLoadFloat4x4(&m_viewProjection));
+	float width = static_cast<float>(m_width);
+	float height = static_cast<float>(m_height);
+
+	for (uint32_t i = 0; i + 2 < a_indexCount; i += 3) {
+		XMFLOAT3 screen[3];
+		ScreenTriangle triangle;
+		bool clipped = false;
+		for (int v = 0; v < 3 && !clipped; v++) {
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&a_positions[a_indices[i + v]]), worldViewProjection));
+
+			//dropping near plane crossers can only let more things through, never fewer
+			if (clip.w <= 1e-5f || clip.z < 0.0f) {
+				clipped = true;
+				break;
+			}
+			float inverseW = 1.0f / clip.w;
+			screen[v].x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+			screen[v].y = (0.5f - clip.y * inverseW * 0.5f) * height;
+			screen[v].z = clip.z * inverseW;
+		}
+		if (clipped) continue;
+
+		//both windings are rasterized, flip so the edge functions are positive inside
+		float area =
+			(screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) -
+			(screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+		if (std::fabs(area) < 1e-6f) continue;
+
+		//clockwise on screen faces the camera, same as the default rasterizer state
+		triangle.m_backFacing = area < 0.0f;
+		if (area < 0.0f) {
+			std::swap(screen[1], screen[2]);
+			area = -area;
+		}
+
+		triangle.m_minX = (std::max)(static_cast<int>(std::floor((std::min)({ screen[0].x, screen[1].x, screen[2].x }))), 0);
+		triangle.m_maxX = (std::min)(static_cast<int>(std::ceil((std::max)({ screen[0].x, screen[1].x, screen[2].x }))), static_cast<int>(m_width) - 1);
+		triangle.m_minY = (std::max)(static_cast<int>(std::floor((std::min)({ screen[0].y, screen[1].y, screen[2].y }))), 0);
+		triangle.m_maxY = (std::min)(static_cast<int>(std::ceil((std::max)({ screen[0].y, screen[1].y, screen[2].y }))), static_cast<int>(m_height) - 1);
+		if (triangle.m_minX > triangle.m_maxX || triangle.m_minY > triangle.m_maxY) continue;
+
+		//edge e is opposite vertex e, so it doubles as that vertex's barycentric weight
+		for (int e = 0; e < 3; e++) {
+			const XMFLOAT3& from = screen[(e + 1) % 3];
+			const XMFLOAT3& to = screen[(e + 2) % 3];
+			triangle.m_edgeA[e] = from.y - to.y;
+			triangle.m_edgeB[e] = to.x - from.x;
+			triangle.m_edgeC[e] = -(triangle.m_edgeA[e] * from.x + triangle.m_edgeB[e] * from.y);
+		}
+
+		float inverseArea = 1.0f / area;
+		triangle.m_depthA = (triangle.m_edgeA[0] * screen[0].z + triangle.m_edgeA[1] * screen[1].z + triangle.m_edgeA[2] * screen[2].z) * inverseArea;
+		triangle.m_depthB = (triangle.m_edgeB[0] * screen[0].z + triangle.m_edgeB[1] * screen[1].z + triangle.m_edgeB[2] * screen[2].z) * inverseArea;
+		triangle.m_depthC = (triangle.m_edgeC[0] * screen[0].z + triangle.m_edgeC[1] * screen[1].z + triangle.m_edgeC[2] * screen[2].z) * inverseArea;
+
+		m_triangles.push_back(triangle);
+	}
+}
+
+void OcclusionCuller::RasterizeBand(uint32_t a_firstRow, uint32_t a_endRow)
+{
+	FrameProfiler::Scope zone("Rasterize band");
+	XMVECTOR pixelOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	XMVECTOR zero = XMVectorZero();
+
+	for (const ScreenTriangle& triangle : m_triangles) {
+		int firstRow = (std::max)(triangle.m_minY, static_cast<int>(a_firstRow));
+		int endRow = (std::min)(triangle.m_maxY + 1, static_cast<int>(a_endRow));
+		if (firstRow >= endRow) continue;
+
+		int firstColumn = triangle.m_minX & ~3;
+		XMVECTOR startX = XMVectorAdd(XMVectorReplicate(static_cast<float>(firstColumn)), pixelOffsets);
+
+		XMVECTOR edgeA[3], edgeStep[3];
+		for (int e = 0; e < 3; e++) {
+			edgeA[e] = XMVectorReplicate(triangle.m_edgeA[e]);
+			edgeStep[e] = XMVectorReplicate(triangle.m_edgeA[e] * 4.0f);
+		}
+		XMVECTOR depthA = XMVectorReplicate(triangle.m_depthA);
+		XMVECTOR depthStep = XMVectorReplicate(triangle.m_depthA * 4.0f);
+
+		for (int y = firstRow; y < endRow; y++) {
+			float pixelY = y + 0.5f;
+
+			//values at the first 4 pixel block, then stepped across the row
+			XMVECTOR edge[3];
+			for (int e = 0; e < 3; e++) {
+				edge[e] = XMVectorMultiplyAdd(edgeA[e], startX,
+					XMVectorReplicate(triangle.m_edgeB[e] * pixelY + triangle.m_edgeC[e]));
+			}
+			XMVECTOR depth = XMVectorMultiplyAdd(depthA, startX,
+				XMVectorReplicate(triangle.m_depthB * pixelY + triangle.m_depthC));
+
+			float* row = &m_depth[static_cast<size_t>(y) * m_width];
+			for (int x = firstColumn; x <= triangle.m_maxX; x += 4) {
+				XMVECTOR coverage = XMVectorAndInt(
+					XMVectorAndInt(XMVectorGreaterOrEqual(edge[0], zero), XMVectorGreaterOrEqual(edge[1], zero)),
+					XMVectorGreaterOrEqual(edge[2], zero));
+
+				if (!XMVector4EqualInt(coverage, zero)) {
+					XMFLOAT4* block = reinterpret_cast<XMFLOAT4*>(row + x);
+					XMVECTOR current = XMLoadFloat4(block);
+					XMVECTOR nearest = XMVectorMin(current, XMVectorMax(depth, zero));
+					XMStoreFloat4(block, XMVectorSelect(current, nearest, coverage));
+				}
+
+				for (int e = 0; e < 3; e++) edge[e] = XMVectorAdd(edge[e], edgeStep[e]);
+				depth = XMVectorAdd(depth, depthStep);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::Rasterize()
+{
+	//every band walks the whole triangle list but only touches its own rows
+	uint32_t bandCount = (std::min)(m_bandCount, m_height);
+	uint32_t rowsPerBand = (m_height + bandCount - 1) / bandCount;
+
+	std::vector<std::future<void>> bands;
+	for (uint32_t band = 1; band < bandCount; band++) {
+		uint32_t firstRow = band * rowsPerBand;
+		uint32_t endRow = (std::min)(firstRow + rowsPerBand, m_height);
+		if (firstRow >= endRow) break;
+		bands.push_back(std::async(std::launch::async, [this, firstRow, endRow]() { RasterizeBand(firstRow, endRow); }));
+	}
+	RasterizeBand(0, (std::min)(rowsPerBand, m_height));
+	for (std::future<void>& band : bands) band.get();
+
+	BuildPyramid();
+}
+
+OcclusionCuller::OverdrawEstimate OcclusionCuller::EstimateOverdraw()
+{
+	std::fill(m_depth.begin(), m_depth.end(), 1.0f);
+	m_pyramid.clear();
+	m_pyramidWidths.clear();
+	m_pyramidHeights.clear();
+
+	OverdrawEstimate estimate;
+	for (const ScreenTriangle& triangle : m_triangles) {
+		if (triangle.m_backFacing) continue;
+
+		for (int y = triangle.m_minY; y <= triangle.m_maxY; y++) {
+			float pixelY = y + 0.5f;
+			float* row = &m_depth[static_cast<size_t>(y) * m_width];
+			for (int x = triangle.m_minX; x <= triangle.m_maxX; x++) {
+				float pixelX = x + 0.5f;
+				bool covered = true;
+				for (int e = 0; e < 3 && covered; e++) {
+					covered = triangle.m_edgeA[e] * pixelX + triangle.m_edgeB[e] * pixelY + triangle.m_edgeC[e] >= 0.0f;
+				}
+				if (!covered) continue;
+
+				float depth = (std::max)(triangle.m_depthA * pixelX + triangle.m_depthB * pixelY + triangle.m_depthC, 0.0f);
+				if (depth >= row[x]) continue;
+				row[x] = depth;
+				estimate.m_shadedFragments++;
+			}
+		}
+	}
+
+	for (float depth : m_depth) {
+		if (depth < 1.0f) estimate.m_coveredPixels++;
+	}
+	return estimate;
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+	m_pyramid.clear();
+	m_pyramidWidths.clear();
+	m_pyramidHeights.clear();
+
+	const float* source = m_depth.data();
+	uint32_t sourceWidth = m_width;
+	uint32_t sourceHeight = m_height;
+
+	//keep the farthest depth of each 2x2 block, an object has to be behind all of it
+	while (sourceWidth > 1 || sourceHeight > 1) {
+		uint32_t width = (sourceWidth + 1) / 2;
+		uint32_t height = (sourceHeight + 1) / 2;
+		std::vector<float> level(static_cast<size_t>(width) * height);
+
+		for (uint32_t y = 0; y < height; y++) {
+			uint32_t y0 = y * 2;
+			uint32_t y1 = (std::min)(y0 + 1, sourceHeight - 1);
+			for (uint32_t x = 0; x < width; x++) {
+				uint32_t x0 = x * 2;
+				uint32_t x1 = (std::min)(x0 + 1, sourceWidth - 1);
+				level[y * width + x] = (std::max)(
+					(std::max)(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+					(std::max)(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+			}
+		}
+
+		m_pyramid.push_back(std::move(level));
+		m_pyramidWidths.push_back(width);
+		m_pyramidHeights.push_back(height);
+		source = m_pyramid.back().data();
+		sourceWidth = width;
+		sourceHeight = height;
+	}
+}
+
+bool OcclusionCuller::IsVisible(const Bounds& a_bounds) const
+{
+	if (m_pyramid.empty()) return true;
+
+	XMMATRIX viewProjection = XMLoadFloat4x4(&m_viewProjection);
+	float width = static_cast<float>(m_width);
+	float height = static_cast<float>(m_height);
+
+	float minX = width, maxX = 0.0f, minY = height, maxY = 0.0f, minZ = 1.0f;
+	for (int corner = 0; corner < 8; corner++) {
+		XMFLOAT3 position(
+			a_bounds.m_center.x + ((corner & 1) ? a_bounds.m_extents.x : -a_bounds.m_extents.x),
+			a_bounds.m_center.y + ((corner & 2) ? a_bounds.m_extents.y : -a_bounds.m_extents.y),
+			a_bounds.m_center.z + ((corner & 4) ? a_bounds.m_extents.z : -a_bounds.m_extents.z));
+
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&position), viewProjection));
+
+		//touching the near plane, nothing can be in front of it
+		if (clip.w <= 1e-5f || clip.z < 0.0f) return true;
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW * 0.5f + 0.5f) * width;
+		float y = (0.5f - clip.y * inverseW * 0.5f) * height;
+		minX = (std::min)(minX, x);
+		maxX = (std::max)(maxX, x);
+		minY = (std::min)(minY, y);
+		maxY = (std::max)(maxY, y);
+		minZ = (std::min)(minZ, clip.z * inverseW);
+	}
+
+	if (maxX < 0.0f || maxY < 0.0f || minX >= width || minY >= height) return true;
+
+	//pixel rectangle, then walk up the pyramid until it spans a handful of texels
+	uint32_t x0 = static_cast<uint32_t>((std::max)(minX, 0.0f));
+	uint32_t x1 = static_cast<uint32_t>((std::min)(maxX, width - 1.0f));
+	uint32_t y0 = static_cast<uint32_t>((std::max)(minY, 0.0f));
+	uint32_t y1 = static_cast<uint32_t>((std::min)(maxY, height - 1.0f));
+
+	size_t level = 0;
+	x0 >>= 1; x1 >>= 1; y0 >>= 1; y1 >>= 1;
+	while ((x1 - x0 > 3 || y1 - y0 > 3) && level + 1 < m_pyramid.size()) {
+		level++;
+		x0 >>= 1; x1 >>= 1; y0 >>= 1; y1 >>= 1;
+	}
+
+	const std::vector<float>& depth = m_pyramid[level];
+	uint32_t levelWidth = m_pyramidWidths[level];
+	float farthest = 0.0f;
+	for (uint32_t y = y0; y <= y1; y++) {
+		for (uint32_t x = x0; x <= x1; x++) {
+			farthest = (std::max)(farthest, depth[y * levelWidth + x]);
+		}
+	}
+
+	return minZ <= farthest;
+}
+
+void OcclusionCuller::FilterVisible(const std::vector<Bounds>& a_bounds, std::vector<uint32_t>& a_indices) const
+{
+	size_t count = (std::min)(a_bounds.size(), a_indices.size());
+	std::vector<uint8_t> visible(count, 1);
+
+	//small lists aren't worth the thread start up
+	const size_t minimumPerTask = 256;
+	size_t taskCount = std::min<size_t>((std::max)(std::thread::hardware_concurrency(), 1u), count / minimumPerTask + 1);
+	size_t perTask = (count + taskCount - 1) / taskCount;
+
+	auto testRange = [&](size_t a_first, size_t a_end) {
+		FrameProfiler::Scope zone("Occlusion test");
+		for (size_t i = a_first; i < a_end; i++) {
+			visible[i] = IsVisible(a_bounds[i]) ? 1 : 0;
+		}
+	};
+
+	std::vector<std::future<void>> tasks;
+	for (size_t task = 1; task < taskCount; task++) {
+		size_t first = task * perTask;
+		size_t end = (std::min)(first + perTask, count);
+		if (first >= end) break;
+		tasks.push_back(std::async(std::launch::async, testRange, first, end));
+	}
+	testRange(0, (std::min)(perTask, count));
+	for (std::future<void>& task : tasks) task.get();
+
+	size_t kept = 0;
+	for (size_t i = 0; i < count; i++) {
+		if (visible[i]) a_indices[kept++] = a_indices[i];
+	}
+	a_indices.resize(kept);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <cstdint>
+#include "Bounds.h"
+
+/// <summary>
+/// Low resolution software depth rasterizer used to skip objects hidden
+/// behind big occluders. Occluder triangles are rasterized 4 pixels at a time
+/// with a coverage mask, the screen is split into horizontal bands that are
+/// filled on worker threads, then a max-depth pyramid is built for testing.
+/// Knows nothing about D3D, everything is plain positions and matrices.
+/// </summary>
+class OcclusionCuller
+{
+public:
+	OcclusionCuller(uint32_t a_width = 320, uint32_t a_height = 180, uint32_t a_bandCount = 4);
+
+	/// <summary>
+	/// Width is rounded up to a multiple of 4
+	/// </summary>
+	void Resize(uint32_t a_width, uint32_t a_height);
+
+	/// <summary>
+	/// Clears depth and queued occluders, a_viewProjection is the same
+	/// row vector matrix used for drawing
+	/// </summary>
+	void BeginFrame(const DirectX::XMFLOAT4X4& a_viewProjection);
+
+	/// <summary>
+	/// Transforms a triangle list and queues it for rasterization.
+	/// Triangles crossing the near plane are dropped, which only ever
+	/// makes the result more conservative.
+	/// </summary>
+	void AddOccluder(
+		const DirectX::XMFLOAT3* a_positions,
+		const uint32_t* a_indices,
+		uint32_t a_indexCount,
+		const DirectX::XMFLOAT4X4& a_world);
+
+	/// <summary>
+	/// Rasterizes every queued occluder and builds the depth pyramid
+	/// </summary>
+	void Rasterize();
+
+	/// <summary>
+	/// False only when the box is certainly behind rasterized occluders
+	/// </summary>
+	bool IsVisible(const Bounds& a_bounds) const;
+
+	/// <summary>
+	/// Removes occluded entries from a_indices in place, a_bounds[i] belongs to a_indices[i].
+	/// Work is split across worker threads.
+	/// </summary>
+	void FilterVisible(const std::vector<Bounds>& a_bounds, std::vector<uint32_t>& a_indices) const;
+
+	struct OverdrawEstimate
+	{
+		uint64_t m_shadedFragments = 0; // fragments that passed a LESS test when they were drawn
+		uint64_t m_coveredPixels = 0;   // pixels left covered, what shading after a depth pre-pass costs
+
+		double GetOverdraw() const { return m_coveredPixels > 0 ? static_cast<double>(m_shadedFragments) / m_coveredPixels : 0.0; }
+	};
+
+	/// <summary>
+	/// Instead of Rasterize, draws the queued triangles one at a time in the order
+	/// they were added, back faces culled like the GPU, and counts how many
+	/// fragments a shading pass in that order would run. Single threaded,
+	/// the order is the whole point. Leaves no pyramid, so nothing is culled.
+	/// </summary>
+	OverdrawEstimate EstimateOverdraw();
+
+	uint32_t GetWidth() const { return m_width; }
+	uint32_t GetHeight() const { return m_height; }
+	size_t GetTriangleCount() const { return m_triangles.size(); }
+	const std::vector<float>& GetDepthBuffer() const { return m_depth; }
+
+private:
+	struct ScreenTriangle
+	{
+		//edge functions and depth as planes over the screen, value = a*x + b*y + c
+		float m_edgeA[3];
+		float m_edgeB[3];
+		float m_edgeC[3];
+		float m_depthA;
+		float m_depthB;
+		float m_depthC;
+		int m_minX;
+		int m_maxX;
+		int m_minY;
+		int m_maxY;
+		bool m_backFacing;
+	};
+
+	uint32_t m_width = 0;
+	uint32_t m_height = 0;
+	uint32_t m_bandCount = 1;
+	DirectX::XMFLOAT4X4 m_viewProjection;
+
+	std::vector<float> m_depth;
+	std::vector<ScreenTriangle> m_triangles;
+
+	//level 0 is 2x2 max of the depth buffer, each level halves again
+	std::vector<std::vector<float>> m_pyramid;
+	std::vector<uint32_t> m_pyramidWidths;
+	std::vector<uint32_t> m_pyramidHeights;
+
+	void RasterizeBand(uint32_t a_firstRow, uint32_t a_endRow);
+	void BuildPyramid();
+};
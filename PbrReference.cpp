@@ -0,0 +1,353 @@
+#include "PbrReference.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+	//just enough float3 to read like the shader
+	struct Float3
+	{
+		float x, y, z;
+	};
+
+	Float3 operator+(Float3 a_a, Float3 a_b) { return { a_a.x + a_b.x, a_a.y + a_b.y, a_a.z + a_b.z }; }
+	Float3 operator-(Float3 a_a, Float3 a_b) { return { a_a.x - a_b.x, a_a.y - a_b.y, a_a.z - a_b.z }; }
+	Float3 operator*(Float3 a_a, Float3 a_b) { return { a_a.x * a_b.x, a_a.y * a_b.y, a_a.z * a_b.z }; }
+	Float3 operator*(Float3 a_a, float a_b) { return { a_a.x * a_b, a_a.y * a_b, a_a.z * a_b }; }
+	Float3 operator*(float a_a, Float3 a_b) { return a_b * a_a; }
+	Float3 operator/(Float3 a_a, float a_b) { return { a_a.x / a_b, a_a.y / a_b, a_a.z / a_b }; }
+	Float3 operator-(float a_a, Float3 a_b) { return { a_a - a_b.x, a_a - a_b.y, a_a - a_b.z }; }
+	Float3 operator+(float a_a, Float3 a_b) { return { a_a + a_b.x, a_a + a_b.y, a_a + a_b.z }; }
+	Float3 operator-(Float3 a_a, float a_b) { return { a_a.x - a_b, a_a.y - a_b, a_a.z - a_b }; }
+
+	Float3 ToFloat3(const XMFLOAT3& a_value) { return { a_value.x, a_value.y, a_value.z }; }
+	float Dot(Float3 a_a, Float3 a_b) { return a_a.x * a_b.x + a_a.y * a_b.y + a_a.z * a_b.z; }
+	float Saturate(float a_value) { return (std::min)((std::max)(a_value, 0.0f), 1.0f); }
+	Float3 Normalize(Float3 a_value) { return a_value / std::sqrt(Dot(a_value, a_value)); }
+	float Pow5(float a_value) { return a_value * a_value * a_value * a_value * a_value; }
+
+	//the Lighting.hlsli functions one for one, names kept so they can be read side by side
+	float Attenuate(const Light& a_light, Float3 a_worldPosition)
+	{
+		Float3 offset = ToFloat3(a_light.m_Position) - a_worldPosition;
+		float dist = std::sqrt(Dot(offset, offset));
+		float att = Saturate(1.0f - (dist * dist / (a_light.m_Range * a_light.m_Range)));
+		return att * att;
+	}
+
+	float D_GGX(Float3 a_normal, Float3 a_halfAngle, float a_roughness)
+	{
+		const float MIN_ROUGHNESS = 0.0000001f;
+		float NdotH = Saturate(Dot(a_normal, a_halfAngle));
+		float NdotH2 = NdotH * NdotH;
+		float a = a_roughness * a_roughness;
+		float a2 = (std::max)(a * a, MIN_ROUGHNESS);
+
+		float denomToSquare = NdotH2 * (a2 - 1) + 1;
+
+		return a2 / (3.14f * denomToSquare * denomToSquare);
+	}
+
+	float G_SchlickGGX(Float3 a_normal, Float3 a_view, float a_roughness)
+	{
+		float k = (a_roughness + 1) * (a_roughness + 1) / 8.0f;
+		float NdotV = Saturate(Dot(a_normal, a_view));
+
+		return 1 / (NdotV * (1 - k) + k);
+	}
+
+	Float3 F_Schlick(Float3 a_view, Float3 a_halfAngle, Float3 a_specularColor)
+	{
+		float VdotH = Saturate(Dot(a_view, a_halfAngle));
+
+		return a_specularColor + (1 - a_specularColor) * Pow5(1 - VdotH);
+	}
+
+	Float3 DiffuseEnergyConserve(Float3 a_diffuse, Float3 a_fresnel, float a_metalness)
+	{
+		return a_diffuse * (1 - a_fresnel) * (1 - a_metalness);
+	}
+
+	Float3 MicrofacetBRDF(Float3 a_n, Float3 a_l, Float3 a_v, float a_roughness, Float3 a_f0)
+	{
+		Float3 halfAngle = Normalize(a_n + a_l);
+		float D = D_GGX(a_n, halfAngle, a_roughness);
+		float G = G_SchlickGGX(a_n, a_v, a_roughness);
+		Float3 F = F_Schlick(a_v, halfAngle, a_f0);
+
+		//dot(n, 1) in the shader, the sum of the normal's components
+		Float3 specularResult = (D * F * G) / 4;
+		return specularResult * Saturate(a_n.x + a_n.y + a_n.z);
+	}
+
+	//shared tail of PointLight and DirectionalLight, only the direction to the light differs
+	Float3 LightSurface(
+		const Light& a_light, Float3 a_directionToLight, Float3 a_worldPosition, Float3 a_normal, Float3 a_cameraPosition,
+		Float3 a_albedoColor, float a_roughness, Float3 a_specularColor, float a_metalness)
+	{
+		Float3 color = ToFloat3(a_light.m_Color);
+		Float3 diffuseTerm = Saturate(Dot(a_normal, a_directionToLight)) * color * a_light.m_Intensity * a_albedoColor;
+
+		Float3 directionToCamera = a_cameraPosition - a_worldPosition;
+		Float3 specularTerm = MicrofacetBRDF(a_normal, a_directionToLight, directionToCamera, a_roughness, a_specularColor);
+
+		Float3 fresnel = F_Schlick(a_normal, a_normal + a_directionToLight, a_specularColor);
+		Float3 balancedDiff = DiffuseEnergyConserve(diffuseTerm, fresnel, a_metalness);
+
+		return (balancedDiff * diffuseTerm + specularTerm) * a_light.m_Intensity * color;
+	}
+
+	//float3 lanes of the batched path
+	struct Vector3
+	{
+		XMVECTOR x, y, z;
+	};
+
+	XMVECTOR Dot(const Vector3& a_a, const Vector3& a_b)
+	{
+		return XMVectorMultiplyAdd(a_a.x, a_b.x, XMVectorMultiplyAdd(a_a.y, a_b.y, XMVectorMultiply(a_a.z, a_b.z)));
+	}
+
+	XMVECTOR Pow5(XMVECTOR a_value)
+	{
+		XMVECTOR squared = XMVectorMultiply(a_value, a_value);
+		return XMVectorMultiply(XMVectorMultiply(squared, squared), a_value);
+	}
+
+	//f0 + (1 - f0) * (1 - cosine)^5 for one channel
+	XMVECTOR Schlick(XMVECTOR a_f0, XMVECTOR a_weight)
+	{
+		return XMVectorMultiplyAdd(XMVectorSubtract(XMVectorSplatOne(), a_f0), a_weight, a_f0);
+	}
+
+	XMVECTOR Load(const std::vector<float>& a_values, size_t a_index)
+	{
+		return XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&a_values[a_index]));
+	}
+
+	void Store(std::vector<float>& a_values, size_t a_index, XMVECTOR a_value)
+	{
+		XMStoreFloat4(reinterpret_cast<XMFLOAT4*>(&a_values[a_index]), a_value);
+	}
+}
+
+void PbrReference::SurfaceBatch::Resize(size_t a_count)
+{
+	m_count = a_count;
+	size_t padded = (a_count + LANES - 1) / LANES * LANES;
+	for (std::vector<float>* values : { &m_positionX, &m_positionY, &m_positionZ, &m_normalX, &m_normalZ,
+		&m_albedoR, &m_albedoG, &m_albedoB, &m_roughness, &m_metalness }) {
+		values->assign(padded, 0.0f);
+	}
+	m_normalY.assign(padded, 1.0f);
+}
+
+void PbrReference::SurfaceBatch::Set(size_t a_index, const Surface& a_surface)
+{
+	m_positionX[a_index] = a_surface.m_position.x;
+	m_positionY[a_index] = a_surface.m_position.y;
+	m_positionZ[a_index] = a_surface.m_position.z;
+	m_normalX[a_index] = a_surface.m_normal.x;
+	m_normalY[a_index] = a_surface.m_normal.y;
+	m_normalZ[a_index] = a_surface.m_normal.z;
+	m_albedoR[a_index] = a_surface.m_albedo.x;
+	m_albedoG[a_index] = a_surface.m_albedo.y;
+	m_albedoB[a_index] = a_surface.m_albedo.z;
+	m_roughness[a_index] = a_surface.m_roughness;
+	m_metalness[a_index] = a_surface.m_metalness;
+}
+
+PbrReference::Surface PbrReference::SurfaceBatch::Get(size_t a_index) const
+{
+	Surface surface;
+	surface.m_position = XMFLOAT3(m_positionX[a_index], m_positionY[a_index], m_positionZ[a_index]);
+	surface.m_normal = XMFLOAT3(m_normalX[a_index], m_normalY[a_index], m_normalZ[a_index]);
+	surface.m_albedo = XMFLOAT3(m_albedoR[a_index], m_albedoG[a_index], m_albedoB[a_index]);
+	surface.m_roughness = m_roughness[a_index];
+	surface.m_metalness = m_metalness[a_index];
+	return surface;
+}
+
+void PbrReference::SetLights(const Light* a_lights, size_t a_count, const XMFLOAT3& a_cameraPosition)
+{
+	m_lights.assign(a_lights, a_lights + a_count);
+	m_cameraPosition = a_cameraPosition;
+
+	m_prepared.clear();
+	for (const Light& light : m_lights) {
+		if (light.m_Type != LIGHT_TYPE_DIRECTIONAL && light.m_Type != LIGHT_TYPE_POINT && light.m_Type != LIGHT_TYPE_SPOT) continue;
+
+		PreparedLight prepared;
+		prepared.m_type = light.m_Type;
+		prepared.m_directionX = XMVectorReplicate(light.m_Direction.x);
+		prepared.m_directionY = XMVectorReplicate(light.m_Direction.y);
+		prepared.m_directionZ = XMVectorReplicate(light.m_Direction.z);
+		prepared.m_positionX = XMVectorReplicate(light.m_Position.x);
+		prepared.m_positionY = XMVectorReplicate(light.m_Position.y);
+		prepared.m_positionZ = XMVectorReplicate(light.m_Position.z);
+		prepared.m_colorR = XMVectorReplicate(light.m_Color.x);
+		prepared.m_colorG = XMVectorReplicate(light.m_Color.y);
+		prepared.m_colorB = XMVectorReplicate(light.m_Color.z);
+		prepared.m_intensity = XMVectorReplicate(light.m_Intensity);
+		prepared.m_inverseRangeSquared = XMVectorReplicate(1.0f / (light.m_Range * light.m_Range));
+
+		float cosOuter = std::cos(light.m_SpotOuterAngle);
+		float cosInner = std::cos(light.m_SpotInnerAngle);
+		prepared.m_cosOuter = XMVectorReplicate(cosOuter);
+		prepared.m_inverseFallOffRange = XMVectorReplicate(1.0f / (cosOuter - cosInner));
+		m_prepared.push_back(prepared);
+	}
+}
+
+XMFLOAT3 PbrReference::ShadeScalar(const Surface& a_surface) const
+{
+	Float3 worldPosition = ToFloat3(a_surface.m_position);
+	Float3 normal = ToFloat3(a_surface.m_normal);
+	Float3 albedoColor = ToFloat3(a_surface.m_albedo);
+	Float3 cameraPosition = ToFloat3(m_cameraPosition);
+	float roughness = a_surface.m_roughness;
+	float metallic = a_surface.m_metalness;
+
+	//lerp(0.04f, albedoColor.rgb, metallic)
+	Float3 specularColor = 0.04f + (albedoColor - 0.04f) * metallic;
+
+	Float3 finalColor = { 0.0f, 0.0f, 0.0f };
+	for (const Light& light : m_lights) {
+		switch (light.m_Type) {
+		case LIGHT_TYPE_DIRECTIONAL: {
+			Float3 directionToLight = { -light.m_Direction.x, -light.m_Direction.y, -light.m_Direction.z };
+			finalColor = finalColor + LightSurface(light, directionToLight, worldPosition, normal, cameraPosition, albedoColor, roughness, specularColor, metallic);
+			break;
+		}
+		case LIGHT_TYPE_POINT: {
+			Float3 directionToLight = ToFloat3(light.m_Position) - worldPosition;
+			Float3 total = LightSurface(light, directionToLight, worldPosition, normal, cameraPosition, albedoColor, roughness, specularColor, metallic);
+			finalColor = finalColor + total * Attenuate(light, worldPosition);
+			break;
+		}
+		case LIGHT_TYPE_SPOT: {
+			Float3 lightToPixel = ToFloat3(light.m_Position) - worldPosition;
+			float pixelAngle = Saturate(Dot(lightToPixel, ToFloat3(light.m_Direction)));
+
+			float cosOuter = std::cos(light.m_SpotOuterAngle);
+			float cosInner = std::cos(light.m_SpotInnerAngle);
+			float fallOffRange = cosOuter - cosInner;
+
+			float spotTerm = Saturate((cosOuter - pixelAngle) / fallOffRange);
+
+			Float3 total = LightSurface(light, lightToPixel, worldPosition, normal, cameraPosition, albedoColor, roughness, specularColor, metallic);
+			finalColor = finalColor + total * Attenuate(light, worldPosition) * spotTerm;
+			break;
+		}
+		}
+	}
+	return XMFLOAT3(finalColor.x, finalColor.y, finalColor.z);
+}
+
+void PbrReference::Shade(const SurfaceBatch& a_surfaces, ColorBatch& a_colors, size_t a_first, size_t a_end) const
+{
+	const XMVECTOR zero = XMVectorZero();
+	const XMVECTOR one = XMVectorSplatOne();
+	const XMVECTOR dielectric = XMVectorReplicate(0.04f);
+	const XMVECTOR minRoughness = XMVectorReplicate(0.0000001f);
+	const XMVECTOR pi = XMVectorReplicate(3.14f);
+	const XMVECTOR quarter = XMVectorReplicate(0.25f);
+	const XMVECTOR eighth = XMVectorReplicate(0.125f);
+	const Vector3 camera = {
+		XMVectorReplicate(m_cameraPosition.x),
+		XMVectorReplicate(m_cameraPosition.y),
+		XMVectorReplicate(m_cameraPosition.z) };
+
+	for (size_t i = a_first; i < a_end; i += LANES) {
+		Vector3 position = { Load(a_surfaces.m_positionX, i), Load(a_surfaces.m_positionY, i), Load(a_surfaces.m_positionZ, i) };
+		Vector3 normal = { Load(a_surfaces.m_normalX, i), Load(a_surfaces.m_normalY, i), Load(a_surfaces.m_normalZ, i) };
+		Vector3 albedo = { Load(a_surfaces.m_albedoR, i), Load(a_surfaces.m_albedoG, i), Load(a_surfaces.m_albedoB, i) };
+		XMVECTOR roughness = Load(a_surfaces.m_roughness, i);
+		XMVECTOR metalness = Load(a_surfaces.m_metalness, i);
+
+		//everything that doesn't depend on the light is done once per sample
+		Vector3 f0 = {
+			XMVectorMultiplyAdd(XMVectorSubtract(albedo.x, dielectric), metalness, dielectric),
+			XMVectorMultiplyAdd(XMVectorSubtract(albedo.y, dielectric), metalness, dielectric),
+			XMVectorMultiplyAdd(XMVectorSubtract(albedo.z, dielectric), metalness, dielectric) };
+		Vector3 toCamera = { XMVectorSubtract(camera.x, position.x), XMVectorSubtract(camera.y, position.y), XMVectorSubtract(camera.z, position.z) };
+
+		XMVECTOR a = XMVectorMultiply(roughness, roughness);
+		XMVECTOR a2 = XMVectorMax(XMVectorMultiply(a, a), minRoughness);
+		XMVECTOR a2MinusOne = XMVectorSubtract(a2, one);
+		XMVECTOR roughnessPlusOne = XMVectorAdd(roughness, one);
+		XMVECTOR k = XMVectorMultiply(XMVectorMultiply(roughnessPlusOne, roughnessPlusOne), eighth);
+		XMVECTOR NdotV = XMVectorSaturate(Dot(normal, toCamera));
+		XMVECTOR G = XMVectorReciprocal(XMVectorMultiplyAdd(NdotV, XMVectorSubtract(one, k), k));
+		XMVECTOR normalSum = XMVectorSaturate(XMVectorAdd(XMVectorAdd(normal.x, normal.y), normal.z));
+		XMVECTOR specularScale = XMVectorMultiply(XMVectorMultiply(G, quarter), normalSum);
+		XMVECTOR oneMinusMetalness = XMVectorSubtract(one, metalness);
+
+		Vector3 color = { zero, zero, zero };
+		for (const PreparedLight& light : m_prepared) {
+			Vector3 toLight;
+			if (light.m_type == LIGHT_TYPE_DIRECTIONAL) {
+				toLight = { XMVectorNegate(light.m_directionX), XMVectorNegate(light.m_directionY), XMVectorNegate(light.m_directionZ) };
+			}
+			else {
+				toLight = {
+					XMVectorSubtract(light.m_positionX, position.x),
+					XMVectorSubtract(light.m_positionY, position.y),
+					XMVectorSubtract(light.m_positionZ, position.z) };
+			}
+
+			//D_GGX at the normalized half vector
+			Vector3 halfAngle = { XMVectorAdd(normal.x, toLight.x), XMVectorAdd(normal.y, toLight.y), XMVectorAdd(normal.z, toLight.z) };
+			XMVECTOR NdotHalf = Dot(normal, halfAngle);
+			XMVECTOR inverseLength = XMVectorReciprocal(XMVectorSqrt(Dot(halfAngle, halfAngle)));
+			XMVECTOR NdotH = XMVectorSaturate(XMVectorMultiply(NdotHalf, inverseLength));
+			XMVECTOR denominator = XMVectorMultiplyAdd(XMVectorMultiply(NdotH, NdotH), a2MinusOne, one);
+			XMVECTOR D = XMVectorDivide(a2, XMVectorMultiply(pi, XMVectorMultiply(denominator, denominator)));
+
+			//F_Schlick of the specular term and of the diffuse balance, the shader feeds the latter n + l unnormalized
+			XMVECTOR VdotH = XMVectorSaturate(XMVectorMultiply(Dot(toCamera, halfAngle), inverseLength));
+			XMVECTOR specularWeight = Pow5(XMVectorSubtract(one, VdotH));
+			XMVECTOR diffuseWeight = Pow5(XMVectorSubtract(one, XMVectorSaturate(NdotHalf)));
+			XMVECTOR specular = XMVectorMultiply(D, specularScale);
+
+			XMVECTOR NdotL = XMVectorSaturate(Dot(normal, toLight));
+			XMVECTOR scale = light.m_intensity;
+			if (light.m_type != LIGHT_TYPE_DIRECTIONAL) {
+				XMVECTOR falloff = XMVectorSaturate(XMVectorNegativeMultiplySubtract(Dot(toLight, toLight), light.m_inverseRangeSquared, one));
+				scale = XMVectorMultiply(scale, XMVectorMultiply(falloff, falloff));
+			}
+			if (light.m_type == LIGHT_TYPE_SPOT) {
+				XMVECTOR pixelAngle = XMVectorSaturate(
+					XMVectorMultiplyAdd(toLight.x, light.m_directionX,
+						XMVectorMultiplyAdd(toLight.y, light.m_directionY, XMVectorMultiply(toLight.z, light.m_directionZ))));
+				scale = XMVectorMultiply(scale, XMVectorSaturate(XMVectorMultiply(XMVectorSubtract(light.m_cosOuter, pixelAngle), light.m_inverseFallOffRange)));
+			}
+
+			//per channel: (diffuse * (1 - fresnel) * (1 - metalness) * diffuse + D * F * G / 4 * sum(n)) * intensity * color
+			auto channel = [&](XMVECTOR a_albedo, XMVECTOR a_f0, XMVECTOR a_lightColor) {
+				XMVECTOR diffuse = XMVectorMultiply(XMVectorMultiply(XMVectorMultiply(NdotL, a_lightColor), light.m_intensity), a_albedo);
+				XMVECTOR balanced = XMVectorMultiply(XMVectorMultiply(diffuse, XMVectorSubtract(one, Schlick(a_f0, diffuseWeight))), oneMinusMetalness);
+				XMVECTOR total = XMVectorMultiplyAdd(balanced, diffuse, XMVectorMultiply(specular, Schlick(a_f0, specularWeight)));
+				return XMVectorMultiply(XMVectorMultiply(total, scale), a_lightColor);
+			};
+			color.x = XMVectorAdd(color.x, channel(albedo.x, f0.x, light.m_colorR));
+			color.y = XMVectorAdd(color.y, channel(albedo.y, f0.y, light.m_colorG));
+			color.z = XMVectorAdd(color.z, channel(albedo.z, f0.z, light.m_colorB));
+		}
+
+		Store(a_colors.m_r, i, color.x);
+		Store(a_colors.m_g, i, color.y);
+		Store(a_colors.m_b, i, color.z);
+	}
+}
+
+void PbrReference::Shade(const SurfaceBatch& a_surfaces, ColorBatch& a_colors) const
+{
+	size_t padded = a_surfaces.m_positionX.size();
+	a_colors.m_r.resize(padded);
+	a_colors.m_g.resize(padded);
+	a_colors.m_b.resize(padded);
+	Shade(a_surfaces, a_colors, 0, padded);
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstddef>
+#include <vector>
+#include "Light.h"
+
+/// <summary>
+/// CPU reference of the direct lighting in Lighting.hlsli, the directional,
+/// point and spot lights the forward pixel shader and the deferred pass add up.
+/// ShadeScalar follows the shader function by function, quirks included, and
+/// Shade runs the same math on SoA batches 4 samples at a time. Shadows, the
+/// sky and the probes need GPU resources and aren't part of it, every light
+/// counts as unshadowed. Results are linear, before the shader's gamma.
+/// Knows nothing about D3D, lights are the same Light structs the GPU gets.
+/// </summary>
+class PbrReference
+{
+public:
+	//samples per XMVECTOR, batches are padded to a multiple of this
+	static constexpr size_t LANES = 4;
+
+	struct Surface
+	{
+		DirectX::XMFLOAT3 m_position = { 0.0f, 0.0f, 0.0f };
+		DirectX::XMFLOAT3 m_normal = { 0.0f, 1.0f, 0.0f }; // normalized, like the shader's input.normal
+		DirectX::XMFLOAT3 m_albedo = { 1.0f, 1.0f, 1.0f }; // linear
+		float m_roughness = 0.5f;
+		float m_metalness = 0.0f;
+	};
+
+	/// <summary>
+	/// Surfaces as one array per component, padding samples are black and pointing up
+	/// </summary>
+	struct SurfaceBatch
+	{
+		std::vector<float> m_positionX, m_positionY, m_positionZ;
+		std::vector<float> m_normalX, m_normalY, m_normalZ;
+		std::vector<float> m_albedoR, m_albedoG, m_albedoB;
+		std::vector<float> m_roughness, m_metalness;
+		size_t m_count = 0;
+
+		void Resize(size_t a_count);
+		void Set(size_t a_index, const Surface& a_surface);
+		Surface Get(size_t a_index) const;
+	};
+
+	struct ColorBatch
+	{
+		std::vector<float> m_r, m_g, m_b;
+
+		DirectX::XMFLOAT3 Get(size_t a_index) const { return DirectX::XMFLOAT3(m_r[a_index], m_g[a_index], m_b[a_index]); }
+	};
+
+	/// <summary>
+	/// Lights in the order the shader gets them, every one is evaluated. The GPU
+	/// can see fewer, a cluster's light BVH budget and the deferred tiles' 255
+	/// light cap drop lights that do contribute, so crowded views can come out
+	/// brighter here. a_cameraPosition is in the same space as the lights and surfaces.
+	/// </summary>
+	void SetLights(const Light* a_lights, size_t a_count, const DirectX::XMFLOAT3& a_cameraPosition);
+
+	/// <summary>
+	/// One sample, a direct port of the shader functions
+	/// </summary>
+	DirectX::XMFLOAT3 ShadeScalar(const Surface& a_surface) const;
+
+	/// <summary>
+	/// Shades samples a_first to a_end of a_surfaces into a_colors, which has to be
+	/// as large as the batch. a_first has to be a multiple of LANES, separate ranges
+	/// can run on separate threads.
+	/// </summary>
+	void Shade(const SurfaceBatch& a_surfaces, ColorBatch& a_colors, size_t a_first, size_t a_end) const;
+
+	/// <summary>
+	/// Sizes a_colors and shades the whole batch
+	/// </summary>
+	void Shade(const SurfaceBatch& a_surfaces, ColorBatch& a_colors) const;
+
+	size_t GetLightCount() const { return m_lights.size(); }
+
+private:
+	//a light's constants replicated across the lanes once instead of per batch
+	struct PreparedLight
+	{
+		int m_type;
+		DirectX::XMVECTOR m_directionX, m_directionY, m_directionZ;
+		DirectX::XMVECTOR m_positionX, m_positionY, m_positionZ;
+		DirectX::XMVECTOR m_colorR, m_colorG, m_colorB;
+		DirectX::XMVECTOR m_intensity;
+		DirectX::XMVECTOR m_inverseRangeSquared;
+		DirectX::XMVECTOR m_cosOuter;
+		DirectX::XMVECTOR m_inverseFallOffRange;
+	};
+
+	std::vector<Light> m_lights;
+	std::vector<PreparedLight> m_prepared;
+	DirectX::XMFLOAT3 m_cameraPosition = { 0.0f, 0.0f, 0.0f };
+};
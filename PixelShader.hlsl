@@ -1,7 +1,18 @@
-#include "ShaderIncludes.hlsli"
-#define LIGHT_TYPE_DIRECTIONAL 0
-#define LIGHT_TYPE_POINT 1
-#define LIGHT_TYPE_SPOT 2
+// Feature bits of ShaderPermutations, the build compiles every key of PixelShaderPermutations.txt
+// with PERMUTATION set. Compiled without it this is the default every missing variant falls back to.
+#ifndef PERMUTATION
+#define PERMUTATION 13
+#endif
+#define PERMUTATION_NORMAL_MAP ((PERMUTATION & 1) != 0)
+#define PERMUTATION_SURFACE_MAPS ((PERMUTATION & 2) != 0)
+#define PERMUTATION_CLUSTERED_LIGHTS ((PERMUTATION & 4) != 0)
+#define PERMUTATION_SHADOWS ((PERMUTATION & 8) != 0)
+#define PERMUTATION_IBL ((PERMUTATION & 16) != 0)
+#define PERMUTATION_PROBES ((PERMUTATION & 32) != 0)
+#define PERMUTATION_DEFERRED ((PERMUTATION & 64) != 0)
+
+#include "Lighting.hlsli"
+#include "GBuffer.hlsli"
 
 Texture2D AlbedoTexture : register(t0);
 Texture2D NormalMap : register(t1);
@@ -10,150 +21,53 @@ Texture2D MetalnessMap : register(t3);
 
 SamplerState BasicSampler : register(s0);
 
-struct Light
-{
-    int type;
-    float3 direction;
-    float range;
-    float3 position;
-    float intensity;
-    float3 color;
-    float spotInnerAngle;
-    float spotOuterAngle;
-    float2 padding;
-};
-
 cbuffer PixelcBuffer : register(b0)
 {
     float4 colorTint; //16
     float2 scale;
     float2 offset; // 16
-    float3 cameraPosition;
-    float timeElapsedMs; //16
-    Light lights[5]; //16
-}
-
-
-float3 Attenuate(Light light, float3 worldPos)
-{
-    float dist = distance(light.position, worldPos);
-    float att = saturate(1.0f - (dist * dist / (light.range * light.range)));
-    return att * att;
-}
-
-float D_GGX(float3 normal, float3 halfAngle, float roughness)
-{
-    float MIN_ROUGHNESS = 0.0000001;
-    float NdotH = saturate(dot(normal, halfAngle));
-    float NdotH2 = NdotH * NdotH;
-    float a = roughness * roughness;
-    float a2 = max(a * a, MIN_ROUGHNESS);
-    
-    float denomToSquare = NdotH2 * (a2 - 1) + 1;
-
-    return a2 / (3.14 * denomToSquare * denomToSquare);
-}
-
-float G_SchlickGGX(float3 normal, float3 view, float roughness)
-{
-    float k = pow(roughness + 1, 2) / 8.0f;
-    float NdotV = saturate(dot(normal, view));
-
-    return 1 / (NdotV * (1 - k) + k);
-
-}
-
-float3 F_Schlick(float3 view, float3 halfAngle, float3 specularColor)
-{
-    float VdotH = saturate(dot(view, halfAngle));
-
-    return specularColor + (1 - specularColor) * pow(1 - VdotH, 5);
+    float timeElapsedMs;
+    uint materialIndex; //16
 }
 
-float3 DiffuseEnergyConserve(float3 diffuse, float3 fresnel, float metalness)
-{ 
-    return diffuse * (1 - fresnel) * (1 - metalness);
-}
-
-float3 MicrofacetBRDF(float3 n, float3 l, float3 v, float roughness, float3 f0)
+struct ClusterRange
 {
-    float3 halfAngle = normalize(n + l);
-    float D = D_GGX(n, halfAngle, roughness);
-    float G = G_SchlickGGX(n, v, roughness);
-    float3 F = F_Schlick(v, halfAngle, f0);
+    uint offset;
+    uint count;
+};
 
-    float3 specularResult = (D * F * G) / 4;
-    return specularResult * saturate(dot(n, 1));
-}
+StructuredBuffer<uint> clusterLightIndices : register(t6);
+StructuredBuffer<ClusterRange> clusterRanges : register(t7);
 
-float3 CalculatePhong(VertexToPixel input, Light light, float3 albedoColor)
+struct MaterialConstants
 {
- float3 refl = reflect(-light.direction, input.normal);
-
-    float RdotV = saturate(dot(refl, normalize(input.worldPosition - cameraPosition)));
-    return pow(RdotV, 256) *
-       light.color *
-       light.intensity *
-       albedoColor.xyz;
-}
-
-float3 PointLight(VertexToPixel input, Light light, float3 albedoColor, float roughness, float3 specularColor, float metalness)
-{
-    //diffuse
-    //float3 directionToLight = -lights[lightIndex].direction;
-    float3 directionToLight = light.position - input.worldPosition;
-    float3 diffuseTerm = saturate(dot(input.normal, directionToLight)) * 
-        light.color * 
-        light.intensity * 
-        albedoColor;  
-
-    //specularlity
-    float3 directionToCamera = cameraPosition - input.worldPosition;
-    float3 specularTerm = MicrofacetBRDF(
-        input.normal, directionToLight, directionToCamera, roughness, specularColor);
-
-    float3 fresnel = F_Schlick(input.normal, input.normal + directionToLight, specularColor);
-    float3 balancedDiff = DiffuseEnergyConserve(diffuseTerm, fresnel, metalness);
+    float4 colorTint;
+    float2 scale;
+    float2 offset;
+};
 
-    float3 total = (balancedDiff * diffuseTerm + specularTerm) * light.intensity * light.color;
+StructuredBuffer<MaterialConstants> materials : register(t4);
 
-    return total * Attenuate(light, input.worldPosition);
-}
+// the sky, ambient and reflections of the IBL variants
+TextureCube SkyCube : register(t11);
+static const float IBL_INTENSITY = 0.25f;
 
-float3 DirectionalLight(VertexToPixel input, Light light, float3 albedoColor, float roughness, float3 specularColor, float metalness)
+// Irradiance over pi of every object, sampled from the baked probe grid at its center, see ProbeGrid
+struct ObjectIrradiance
 {
-    //diffuse
-    float3 directionToLight = -light.direction;
-    float3 diffuseTerm = saturate(dot(input.normal, directionToLight)) * 
-        light.color * 
-        light.intensity * 
-        albedoColor;  
-
-    //specularity
-    float3 directionToCamera = cameraPosition - input.worldPosition;
-    float3 specularTerm = MicrofacetBRDF(
-        input.normal, directionToLight, directionToCamera, roughness, specularColor);
-
-    float3 fresnel = F_Schlick(input.normal, input.normal + directionToLight, specularColor);
-    float3 balancedDiff = DiffuseEnergyConserve(diffuseTerm, fresnel, metalness);
+    float3 sh[9];
+};
 
-    float3 total = (balancedDiff * diffuseTerm + specularTerm) * light.intensity * light.color;
+StructuredBuffer<ObjectIrradiance> objectIrradiance : register(t12);
 
-    return total;
-}
 
-float3 SpotLight(VertexToPixel input, Light light, float3 albedoColor, float roughness, float3 specularColor, float metalness)
+// Froxel this pixel falls in, screen tile in x and y, exponential slice in depth
+uint GetClusterIndex(VertexToPixel input, float viewZ)
 {
-    float3 lightToPixel = light.position - input.worldPosition;
-    float pixelAngle = saturate(dot(lightToPixel, light.direction));
-
-    float cosOuter = cos(light.spotOuterAngle);
-    float cosInner = cos(light.spotInnerAngle);
-    float fallOffRange = cosOuter - cosInner;
-
-    float spotTerm = saturate((cosOuter - pixelAngle) / fallOffRange);
-
-    return PointLight(input, light, albedoColor, roughness, specularColor, metalness) * spotTerm;
+    float slice = log(max(viewZ, 0.0001f)) * clusterSliceScale + clusterSliceBias;
+    uint z = (uint) clamp(slice, 0.0f, (float) (clusterCounts.z - 1));
+    uint2 tile = min((uint2) (input.screenPosition.xy * clusterTileScale), clusterCounts.xy - 1);
+    return (z * clusterCounts.y + tile.y) * clusterCounts.x + tile.x;
 }
 
 float3 CalculateNormals(VertexToPixel input)
@@ -170,6 +84,38 @@ float3 CalculateNormals(VertexToPixel input)
     
     return mul(unpackedNormal, TBN);
 }
+
+// order 2 spherical harmonics at the normal, same basis as SphericalHarmonicsL2
+float3 EvaluateIrradiance(ObjectIrradiance irradiance, float3 n)
+{
+    float3 result = irradiance.sh[0] * 0.282095f;
+    result += irradiance.sh[1] * (0.488603f * n.y);
+    result += irradiance.sh[2] * (0.488603f * n.z);
+    result += irradiance.sh[3] * (0.488603f * n.x);
+    result += irradiance.sh[4] * (1.092548f * n.x * n.y);
+    result += irradiance.sh[5] * (1.092548f * n.y * n.z);
+    result += irradiance.sh[6] * (0.315392f * (3.0f * n.z * n.z - 1.0f));
+    result += irradiance.sh[7] * (1.092548f * n.x * n.z);
+    result += irradiance.sh[8] * (0.546274f * (n.x * n.x - n.y * n.y));
+    return max(result, 0.0f);
+}
+
+// sky cube lookups standing in for prefiltered maps, the cube has a single mip so roughness only fades the reflection
+float3 SkyLight(VertexToPixel input, float3 albedoColor, float roughness, float3 specularColor, float metalness)
+{
+    float3 directionToCamera = normalize(cameraPosition - input.worldPosition);
+    float3 irradiance = pow(SkyCube.Sample(BasicSampler, input.normal).rgb, 2.2);
+    float3 reflection = pow(SkyCube.Sample(BasicSampler, reflect(-directionToCamera, input.normal)).rgb, 2.2);
+
+    float3 fresnel = F_Schlick(directionToCamera, input.normal, specularColor);
+#if PERMUTATION_PROBES
+    // the probes already carry the sky's diffuse light, occluded
+    float3 diffuse = 0;
+#else
+    float3 diffuse = DiffuseEnergyConserve(irradiance * albedoColor, fresnel, metalness);
+#endif
+    return (diffuse + reflection * fresnel * (1 - roughness)) * IBL_INTENSITY;
+}
 // --------------------------------------------------------
 // The entry point (main method) for our pixel shader
 // 
@@ -178,43 +124,83 @@ float3 CalculateNormals(VertexToPixel input)
 // - Has a special semantic (SV_TARGET), which means 
 //    "put the output of this into the current render target"
 // - Named "main" because that's the default the shader compiler looks for
+// - Deferred variants write the G-buffer instead, see DeferredLightingCS.hlsl
 // --------------------------------------------------------
+#if PERMUTATION_DEFERRED
+GBufferOutput main(VertexToPixel input)
+#else
 float4 main(VertexToPixel input) : SV_TARGET
+#endif
 {
+    MaterialConstants material = materials[materialIndex];
+
     float4 albedoColor =
         pow(AlbedoTexture.Sample(BasicSampler, input.uv), 2.2) *
-        colorTint; //* MaskTexture.Sample(BasicSampler, input.uv);
+        material.colorTint; //* MaskTexture.Sample(BasicSampler, input.uv);
 
-    //float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
-    //float metallic = MetalnessMap.Sample(BasicSampler, input.uv).r;
+#if PERMUTATION_SURFACE_MAPS
+    float roughness = RoughnessMap.Sample(BasicSampler, input.uv).r;
+    float metallic = MetalnessMap.Sample(BasicSampler, input.uv).r;
+#else
     float roughness = 0.5;
     float metallic = 0;
+#endif
     float3 specularColor = lerp(0.04f, albedoColor.rgb, metallic);
 
 
-    input.uv = input.uv * scale + offset;
+    input.uv = input.uv * material.scale + material.offset;
     //masking
 
     //normals
+#if PERMUTATION_NORMAL_MAP
     input.normal = CalculateNormals(input);
-    float3 finalColor;
+#else
+    input.normal = normalize(input.normal);
+#endif
+    float3 finalColor = 0;
+
+#if !PERMUTATION_DEFERRED
+    float viewZ = mul(view, float4(input.worldPosition, 1.0f)).z;
 
-    for (int i = 0; i < 5; i++)
+    // only the first directional light casts shadows
+    for (uint i = 0; i < directionalLightCount; i++)
     {
-        switch (lights[i].type)
+        float3 lightColor = DirectionalLight(input, lights[i], albedoColor.xyz, roughness, specularColor, metallic);
+        finalColor += i == 0 ? lightColor * SampleShadow(input.worldPosition, viewZ) : lightColor;
+    }
+
+#if PERMUTATION_CLUSTERED_LIGHTS
+    // only the point and spot lights binned into this pixel's cluster
+    ClusterRange cluster = clusterRanges[GetClusterIndex(input, viewZ)];
+    for (uint j = 0; j < cluster.count; j++)
+    {
+        Light light = lights[directionalLightCount + clusterLightIndices[cluster.offset + j]];
+        switch (light.type)
         {
-            case LIGHT_TYPE_DIRECTIONAL:
-                finalColor += DirectionalLight(input, lights[i], albedoColor.xyz, roughness, specularColor, metallic);
-                break;
             case LIGHT_TYPE_POINT:
-                finalColor += PointLight(input, lights[i], albedoColor.xyz, roughness, specularColor, metallic);
+                finalColor += PointLight(input, light, albedoColor.xyz, roughness, specularColor, metallic) * SampleLocalShadow(light, input.worldPosition);
                 break;
             case LIGHT_TYPE_SPOT:
-                finalColor += SpotLight(input, lights[i], albedoColor.xyz, roughness, specularColor, metallic);
+                finalColor += SpotLight(input, light, albedoColor.xyz, roughness, specularColor, metallic) * SampleLocalShadow(light, input.worldPosition);
                 break;
         }
     }
+#endif
+#endif
+
+#if PERMUTATION_IBL
+    finalColor += SkyLight(input, albedoColor.xyz, roughness, specularColor, metallic);
+#endif
+
+#if PERMUTATION_PROBES
+    finalColor += EvaluateIrradiance(objectIrradiance[input.irradianceIndex], input.normal) * albedoColor.xyz * (1 - metallic);
+#endif
 
+#if PERMUTATION_DEFERRED
+    // the lights are added per screen tile later, only what needs this object is kept
+    return PackGBuffer(albedoColor.rgb, input.normal, roughness, metallic, finalColor);
+#else
     return pow(float4(finalColor, 1), (1.0 / 2.2));
+#endif
 
 }
\ No newline at end of file
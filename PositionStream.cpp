@@ -0,0 +1,52 @@
+#include "PositionStream.h"
+#include <array>
+#include <cstring>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+	using PositionBits = std::array<uint32_t, 3>;
+
+	struct PositionBitsHash
+	{
+		size_t operator()(const PositionBits& a_bits) const
+		{
+			uint64_t hash = a_bits[0];
+			hash = hash * 0x9E3779B97F4A7C15ull + a_bits[1];
+			hash = hash * 0x9E3779B97F4A7C15ull + a_bits[2];
+			return static_cast<size_t>(hash ^ (hash >> 32));
+		}
+	};
+}
+
+void PositionStream::Build(const std::vector<XMFLOAT3>& a_positions, const std::vector<uint32_t>& a_indices)
+{
+	m_positions.clear();
+	m_indices.resize(a_indices.size());
+
+	//bits rather than values, 0 and -0 stay apart so nothing changes after the transform
+	std::unordered_map<PositionBits, uint32_t, PositionBitsHash> welded;
+	std::vector<uint32_t> remap(a_positions.size());
+	for (size_t i = 0; i < a_positions.size(); i++) {
+		PositionBits bits;
+		memcpy(bits.data(), &a_positions[i], sizeof(bits));
+		auto [entry, inserted] = welded.try_emplace(bits, static_cast<uint32_t>(m_positions.size()));
+		if (inserted) m_positions.push_back(a_positions[i]);
+		remap[i] = entry->second;
+	}
+
+	for (size_t i = 0; i < a_indices.size(); i++) {
+		m_indices[i] = remap[a_indices[i]];
+	}
+}
+
+std::vector<uint16_t> PositionStream::GetShortIndices() const
+{
+	std::vector<uint16_t> indices(m_indices.size());
+	for (size_t i = 0; i < m_indices.size(); i++) {
+		indices[i] = static_cast<uint16_t>(m_indices[i]);
+	}
+	return indices;
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// Position only copy of a mesh for depth only passes. Vertices that were
+/// split for their normals or uvs but sit at the same spot are welded back
+/// together, so the stream is 12 bytes a vertex and usually far fewer
+/// vertices, while every triangle still ends up at exactly the same positions.
+/// Knows nothing about D3D, the mesh uploads the result.
+/// </summary>
+class PositionStream
+{
+public:
+	/// <summary>
+	/// Welds a_positions, only bit identical positions are merged so the
+	/// transformed result of every corner stays the same
+	/// </summary>
+	void Build(const std::vector<DirectX::XMFLOAT3>& a_positions, const std::vector<uint32_t>& a_indices);
+
+	const std::vector<DirectX::XMFLOAT3>& GetPositions() const { return m_positions; }
+	const std::vector<uint32_t>& GetIndices() const { return m_indices; }
+
+	/// <summary>
+	/// True when every index fits a 16 bit index buffer
+	/// </summary>
+	bool HasShortIndices() const { return m_positions.size() <= UINT16_MAX + 1u; }
+	std::vector<uint16_t> GetShortIndices() const;
+
+private:
+	std::vector<DirectX::XMFLOAT3> m_positions;
+	std::vector<uint32_t> m_indices;
+};
@@ -0,0 +1,501 @@
+#include "ProbeBaker.h"
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <numbers>
+#include <random>
+#include <thread>
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT3 Subtract(const XMFLOAT3& a_left, const XMFLOAT3& a_right)
+	{
+		return XMFLOAT3(a_left.x - a_right.x, a_left.y - a_right.y, a_left.z - a_right.z);
+	}
+
+	XMFLOAT3 Cross(const XMFLOAT3& a_left, const XMFLOAT3& a_right)
+	{
+		return XMFLOAT3(
+			a_left.y * a_right.z - a_left.z * a_right.y,
+			a_left.z * a_right.x - a_left.x * a_right.z,
+			a_left.x * a_right.y - a_left.y * a_right.x);
+	}
+
+	float Dot(const XMFLOAT3& a_left, const XMFLOAT3& a_right)
+	{
+		return a_left.x * a_right.x + a_left.y * a_right.y + a_left.z * a_right.z;
+	}
+
+	//entry distance of the ray into the box, FLT_MAX when it misses or enters past a_maxDistance
+	float IntersectRayBox(const XMFLOAT3& a_origin, const XMFLOAT3& a_inverseDirection, float a_maxDistance, const XMFLOAT3& a_min, const XMFLOAT3& a_max)
+	{
+		float t0 = (a_min.x - a_origin.x) * a_inverseDirection.x;
+		float t1 = (a_max.x - a_origin.x) * a_inverseDirection.x;
+		float enter = (std::min)(t0, t1);
+		float exit = (std::max)(t0, t1);
+
+		t0 = (a_min.y - a_origin.y) * a_inverseDirection.y;
+		t1 = (a_max.y - a_origin.y) * a_inverseDirection.y;
+		enter = (std::max)(enter, (std::min)(t0, t1));
+		exit = (std::min)(exit, (std::max)(t0, t1));
+
+		t0 = (a_min.z - a_origin.z) * a_inverseDirection.z;
+		t1 = (a_max.z - a_origin.z) * a_inverseDirection.z;
+		enter = (std::max)(enter, (std::min)(t0, t1));
+		exit = (std::min)(exit, (std::max)(t0, t1));
+
+		if (exit < (std::max)(enter, 0.0f) || enter > a_maxDistance) return FLT_MAX;
+		return (std::max)(enter, 0.0f);
+	}
+
+	XMFLOAT3 Inverse(const XMFLOAT3& a_direction)
+	{
+		return XMFLOAT3(1.0f / a_direction.x, 1.0f / a_direction.y, 1.0f / a_direction.z);
+	}
+
+	//hits closer than this are the surface the ray started on
+	constexpr float MIN_HIT_DISTANCE = 1e-4f;
+	constexpr float SURFACE_OFFSET = 1e-3f;
+}
+
+XMFLOAT3 ProbeBaker::Sky::Sample(const XMFLOAT3& a_direction) const
+{
+	if (m_size == 0) return m_fallback;
+
+	//D3D cube addressing, the major axis picks the face and the other two its texel
+	float x = a_direction.x, y = a_direction.y, z = a_direction.z;
+	float ax = std::fabs(x), ay = std::fabs(y), az = std::fabs(z);
+	int face;
+	float s, t, major;
+	if (ax >= ay && ax >= az) {
+		face = x >= 0.0f ? 0 : 1;
+		major = ax;
+		s = x >= 0.0f ? -z : z;
+		t = -y;
+	}
+	else if (ay >= az) {
+		face = y >= 0.0f ? 2 : 3;
+		major = ay;
+		s = x;
+		t = y >= 0.0f ? z : -z;
+	}
+	else {
+		face = z >= 0.0f ? 4 : 5;
+		major = az;
+		s = z >= 0.0f ? x : -x;
+		t = -y;
+	}
+
+	const std::vector<XMFLOAT3>& texels = m_faces[face];
+	if (texels.size() < static_cast<size_t>(m_size) * m_size) return m_fallback;
+
+	float u = (s / major + 1.0f) * 0.5f;
+	float v = (t / major + 1.0f) * 0.5f;
+	uint32_t column = (std::min)(static_cast<uint32_t>(u * m_size), m_size - 1);
+	uint32_t row = (std::min)(static_cast<uint32_t>(v * m_size), m_size - 1);
+	return texels[static_cast<size_t>(row) * m_size + column];
+}
+
+void ProbeBaker::Clear()
+{
+	m_meshes.clear();
+	m_instances.clear();
+	m_instanceBounds.clear();
+	m_instanceBvh.Build({});
+	m_sceneBounds = Bounds();
+	m_lights.clear();
+}
+
+uint32_t ProbeBaker::AddMesh(const std::vector<XMFLOAT3>& a_positions, const std::vector<uint32_t>& a_indices)
+{
+	MeshData mesh;
+	mesh.m_positions = a_positions;
+	mesh.m_indices = a_indices;
+	mesh.m_indices.resize(mesh.m_indices.size() / 3 * 3);
+
+	XMFLOAT3 meshMin(FLT_MAX, FLT_MAX, FLT_MAX);
+	XMFLOAT3 meshMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+	std::vector<Bounds> triangleBounds(mesh.m_indices.size() / 3);
+	for (size_t i = 0; i < triangleBounds.size(); i++) {
+		XMFLOAT3 triangleMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 triangleMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (size_t corner = 0; corner < 3; corner++) {
+			const XMFLOAT3& p = mesh.m_positions[mesh.m_indices[3 * i + corner]];
+			triangleMin = XMFLOAT3((std::min)(triangleMin.x, p.x), (std::min)(triangleMin.y, p.y), (std::min)(triangleMin.z, p.z));
+			triangleMax = XMFLOAT3((std::max)(triangleMax.x, p.x), (std::max)(triangleMax.y, p.y), (std::max)(triangleMax.z, p.z));
+		}
+		triangleBounds[i] = Bounds::FromMinMax(triangleMin, triangleMax);
+		meshMin = XMFLOAT3((std::min)(meshMin.x, triangleMin.x), (std::min)(meshMin.y, triangleMin.y), (std::min)(meshMin.z, triangleMin.z));
+		meshMax = XMFLOAT3((std::max)(meshMax.x, triangleMax.x), (std::max)(meshMax.y, triangleMax.y), (std::max)(meshMax.z, triangleMax.z));
+	}
+
+	mesh.m_pBvh = std::make_unique<Bvh>();
+	mesh.m_pBvh->Build(triangleBounds);
+	mesh.m_localBounds = triangleBounds.empty() ? Bounds() : Bounds::FromMinMax(meshMin, meshMax);
+	m_meshes.push_back(std::move(mesh));
+	return static_cast<uint32_t>(m_meshes.size() - 1);
+}
+
+void ProbeBaker::AddInstance(uint32_t a_mesh, const XMFLOAT4X4& a_world, const XMFLOAT3& a_albedo)
+{
+	XMMATRIX world = XMLoadFloat4x4(&a_world);
+	XMMATRIX worldToLocal = XMMatrixInverse(nullptr, world);
+
+	Instance instance;
+	instance.m_mesh = a_mesh;
+	instance.m_albedo = a_albedo;
+	XMStoreFloat4x4(&instance.m_worldToLocal, worldToLocal);
+	XMStoreFloat4x4(&instance.m_normalToWorld, XMMatrixTranspose(worldToLocal));
+	m_instances.push_back(instance);
+	m_instanceBounds.push_back(m_meshes[a_mesh].m_localBounds.Transformed(a_world));
+}
+
+void ProbeBaker::SetLights(const Light* a_lights, size_t a_count)
+{
+	m_lights.assign(a_lights, a_lights + a_count);
+}
+
+void ProbeBaker::SetSky(Sky a_sky)
+{
+	m_sky = std::move(a_sky);
+}
+
+void ProbeBaker::BuildScene()
+{
+	auto start = std::chrono::steady_clock::now();
+	m_instanceBvh.Build(m_instanceBounds);
+
+	m_sceneBounds = Bounds();
+	if (!m_instanceBounds.empty()) {
+		XMFLOAT3 sceneMin(FLT_MAX, FLT_MAX, FLT_MAX);
+		XMFLOAT3 sceneMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (const Bounds& bounds : m_instanceBounds) {
+			sceneMin = XMFLOAT3(
+				(std::min)(sceneMin.x, bounds.m_center.x - bounds.m_extents.x),
+				(std::min)(sceneMin.y, bounds.m_center.y - bounds.m_extents.y),
+				(std::min)(sceneMin.z, bounds.m_center.z - bounds.m_extents.z));
+			sceneMax = XMFLOAT3(
+				(std::max)(sceneMax.x, bounds.m_center.x + bounds.m_extents.x),
+				(std::max)(sceneMax.y, bounds.m_center.y + bounds.m_extents.y),
+				(std::max)(sceneMax.z, bounds.m_center.z + bounds.m_extents.z));
+		}
+		m_sceneBounds = Bounds::FromMinMax(sceneMin, sceneMax);
+	}
+
+	m_report.m_meshCount = m_meshes.size();
+	m_report.m_instanceCount = m_instances.size();
+	m_report.m_triangleCount = 0;
+	for (const MeshData& mesh : m_meshes) m_report.m_triangleCount += mesh.m_indices.size() / 3;
+	m_report.m_buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <bool ANY_HIT>
+bool ProbeBaker::Trace(const XMFLOAT3& a_origin, const XMFLOAT3& a_direction, float a_maxDistance, Hit* a_pHit) const
+{
+	if (m_instanceBvh.GetNodeCount() == 0) return false;
+
+	//reused by every ray of a thread, traversal never allocates after the first few
+	thread_local std::vector<uint32_t> instanceStack;
+	thread_local std::vector<uint32_t> triangleStack;
+
+	const std::vector<Bvh::Node>& nodes = m_instanceBvh.GetNodes();
+	const std::vector<uint32_t>& slots = m_instanceBvh.GetObjectSlots();
+	XMFLOAT3 inverseDirection = Inverse(a_direction);
+	float closest = a_maxDistance;
+	bool hit = false;
+	uint32_t hitInstance = 0;
+	XMFLOAT3 hitNormal(0.0f, 1.0f, 0.0f);
+
+	instanceStack.clear();
+	if (IntersectRayBox(a_origin, inverseDirection, closest, nodes[0].m_min, nodes[0].m_max) != FLT_MAX) instanceStack.push_back(0);
+
+	while (!instanceStack.empty()) {
+		const Bvh::Node& node = nodes[instanceStack.back()];
+		instanceStack.pop_back();
+
+		if (!node.IsLeaf()) {
+			uint32_t nearChild = node.m_leftOrFirst;
+			uint32_t farChild = node.m_leftOrFirst + 1;
+			float nearDistance = IntersectRayBox(a_origin, inverseDirection, closest, nodes[nearChild].m_min, nodes[nearChild].m_max);
+			float farDistance = IntersectRayBox(a_origin, inverseDirection, closest, nodes[farChild].m_min, nodes[farChild].m_max);
+			if (farDistance < nearDistance) {
+				std::swap(nearChild, farChild);
+				std::swap(nearDistance, farDistance);
+			}
+			if (farDistance != FLT_MAX) instanceStack.push_back(farChild);
+			if (nearDistance != FLT_MAX) instanceStack.push_back(nearChild);
+			continue;
+		}
+
+		for (uint32_t slot = node.m_leftOrFirst; slot < node.m_leftOrFirst + node.m_count; slot++) {
+			uint32_t instanceIndex = slots[slot];
+			const Instance& instance = m_instances[instanceIndex];
+			const MeshData& mesh = m_meshes[instance.m_mesh];
+			if (mesh.m_pBvh->GetNodeCount() == 0) continue;
+
+			//the local direction keeps the world length per unit, so distances stay in world units
+			XMFLOAT3 origin, direction;
+			XMMATRIX worldToLocal = XMLoadFloat4x4(&instance.m_worldToLocal);
+			XMStoreFloat3(&origin, XMVector3TransformCoord(XMLoadFloat3(&a_origin), worldToLocal));
+			XMStoreFloat3(&direction, XMVector3TransformNormal(XMLoadFloat3(&a_direction), worldToLocal));
+			XMFLOAT3 localInverseDirection = Inverse(direction);
+
+			const std::vector<Bvh::Node>& meshNodes = mesh.m_pBvh->GetNodes();
+			const std::vector<uint32_t>& triangles = mesh.m_pBvh->GetObjectSlots();
+			triangleStack.clear();
+			if (IntersectRayBox(origin, localInverseDirection, closest, meshNodes[0].m_min, meshNodes[0].m_max) != FLT_MAX) triangleStack.push_back(0);
+
+			while (!triangleStack.empty()) {
+				const Bvh::Node& meshNode = meshNodes[triangleStack.back()];
+				triangleStack.pop_back();
+
+				if (!meshNode.IsLeaf()) {
+					uint32_t nearChild = meshNode.m_leftOrFirst;
+					uint32_t farChild = meshNode.m_leftOrFirst + 1;
+					float nearDistance = IntersectRayBox(origin, localInverseDirection, closest, meshNodes[nearChild].m_min, meshNodes[nearChild].m_max);
+					float farDistance = IntersectRayBox(origin, localInverseDirection, closest, meshNodes[farChild].m_min, meshNodes[farChild].m_max);
+					if (farDistance < nearDistance) {
+						std::swap(nearChild, farChild);
+						std::swap(nearDistance, farDistance);
+					}
+					if (farDistance != FLT_MAX) triangleStack.push_back(farChild);
+					if (nearDistance != FLT_MAX) triangleStack.push_back(nearChild);
+					continue;
+				}
+
+				//Moller-Trumbore, both sides count
+				for (uint32_t triangleSlot = meshNode.m_leftOrFirst; triangleSlot < meshNode.m_leftOrFirst + meshNode.m_count; triangleSlot++) {
+					size_t first = 3 * static_cast<size_t>(triangles[triangleSlot]);
+					const XMFLOAT3& v0 = mesh.m_positions[mesh.m_indices[first]];
+					XMFLOAT3 edge1 = Subtract(mesh.m_positions[mesh.m_indices[first + 1]], v0);
+					XMFLOAT3 edge2 = Subtract(mesh.m_positions[mesh.m_indices[first + 2]], v0);
+
+					XMFLOAT3 p = Cross(direction, edge2);
+					float determinant = Dot(edge1, p);
+					if (std::fabs(determinant) < 1e-12f) continue;
+					float inverseDeterminant = 1.0f / determinant;
+
+					XMFLOAT3 s = Subtract(origin, v0);
+					float u = Dot(s, p) * inverseDeterminant;
+					if (u < 0.0f || u > 1.0f) continue;
+					XMFLOAT3 q = Cross(s, edge1);
+					float v = Dot(direction, q) * inverseDeterminant;
+					if (v < 0.0f || u + v > 1.0f) continue;
+
+					float distance = Dot(edge2, q) * inverseDeterminant;
+					if (distance <= MIN_HIT_DISTANCE || distance >= closest) continue;
+
+					if constexpr (ANY_HIT) return true;
+					closest = distance;
+					hit = true;
+					hitInstance = instanceIndex;
+					hitNormal = Cross(edge1, edge2);
+				}
+			}
+
+			//the hit normal is moved to world space once the closest triangle of this instance is known
+			if (hit && hitInstance == instanceIndex) {
+				XMStoreFloat3(&hitNormal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&hitNormal), XMLoadFloat4x4(&instance.m_normalToWorld))));
+			}
+		}
+	}
+
+	if (hit && a_pHit) {
+		a_pHit->m_distance = closest;
+		a_pHit->m_instance = hitInstance;
+		if (Dot(hitNormal, a_direction) > 0.0f) hitNormal = XMFLOAT3(-hitNormal.x, -hitNormal.y, -hitNormal.z);
+		a_pHit->m_normal = hitNormal;
+	}
+	return hit;
+}
+
+bool ProbeBaker::Intersect(const XMFLOAT3& a_origin, const XMFLOAT3& a_direction, float a_maxDistance, Hit& a_hit) const
+{
+	return Trace<false>(a_origin, a_direction, a_maxDistance, &a_hit);
+}
+
+bool ProbeBaker::IsOccluded(const XMFLOAT3& a_origin, const XMFLOAT3& a_direction, float a_maxDistance) const
+{
+	return Trace<true>(a_origin, a_direction, a_maxDistance, nullptr);
+}
+
+XMFLOAT3 ProbeBaker::GetDirectLight(const XMFLOAT3& a_position, const XMFLOAT3& a_normal) const
+{
+	//same units as the pixel shader, a light's color times intensity is what a surface facing it reflects per unit albedo
+	XMFLOAT3 result(0.0f, 0.0f, 0.0f);
+	XMFLOAT3 origin(
+		a_position.x + a_normal.x * SURFACE_OFFSET,
+		a_position.y + a_normal.y * SURFACE_OFFSET,
+		a_position.z + a_normal.z * SURFACE_OFFSET);
+
+	for (const Light& light : m_lights) {
+		XMFLOAT3 toLight;
+		float distance;
+		float attenuation = 1.0f;
+		if (light.m_Type == LIGHT_TYPE_DIRECTIONAL) {
+			XMStoreFloat3(&toLight, XMVector3Normalize(XMVectorNegate(XMLoadFloat3(&light.m_Direction))));
+			distance = FLT_MAX;
+		}
+		else {
+			toLight = Subtract(light.m_Position, a_position);
+			distance = std::sqrt(Dot(toLight, toLight));
+			if (distance >= light.m_Range || distance <= 0.0f) continue;
+			toLight = XMFLOAT3(toLight.x / distance, toLight.y / distance, toLight.z / distance);
+
+			float falloff = std::clamp(1.0f - distance * distance / (light.m_Range * light.m_Range), 0.0f, 1.0f);
+			attenuation = falloff * falloff;
+
+			if (light.m_Type == LIGHT_TYPE_SPOT) {
+				XMFLOAT3 spotDirection;
+				XMStoreFloat3(&spotDirection, XMVector3Normalize(XMLoadFloat3(&light.m_Direction)));
+				float cosAngle = -Dot(toLight, spotDirection);
+				float cosOuter = std::cos(light.m_SpotOuterAngle);
+				float cosInner = std::cos(light.m_SpotInnerAngle);
+				attenuation *= std::clamp((cosAngle - cosOuter) / (std::max)(cosInner - cosOuter, 1e-4f), 0.0f, 1.0f);
+			}
+		}
+
+		float lambert = Dot(a_normal, toLight) * attenuation;
+		if (lambert <= 0.0f) continue;
+		if (IsOccluded(origin, toLight, distance)) continue;
+
+		result.x += light.m_Color.x * light.m_Intensity * lambert;
+		result.y += light.m_Color.y * light.m_Intensity * lambert;
+		result.z += light.m_Color.z * light.m_Intensity * lambert;
+	}
+	return result;
+}
+
+XMFLOAT3 ProbeBaker::GetIncomingRadiance(const XMFLOAT3& a_origin, const XMFLOAT3& a_direction, float a_rayLength) const
+{
+	Hit hit;
+	if (!Intersect(a_origin, a_direction, a_rayLength, hit)) return m_sky.Sample(a_direction);
+
+	XMFLOAT3 position(
+		a_origin.x + a_direction.x * hit.m_distance,
+		a_origin.y + a_direction.y * hit.m_distance,
+		a_origin.z + a_direction.z * hit.m_distance);
+	XMFLOAT3 light = GetDirectLight(position, hit.m_normal);
+	const XMFLOAT3& albedo = m_instances[hit.m_instance].m_albedo;
+	return XMFLOAT3(light.x * albedo.x, light.y * albedo.y, light.z * albedo.z);
+}
+
+ProbeGrid ProbeBaker::Bake(const Settings& a_settings)
+{
+	//the grid's corner probes sit on the grown scene box
+	const Bounds& scene = m_sceneBounds;
+	XMFLOAT3 gridMin(
+		scene.m_center.x - scene.m_extents.x - a_settings.m_margin,
+		scene.m_center.y - scene.m_extents.y - a_settings.m_margin,
+		scene.m_center.z - scene.m_extents.z - a_settings.m_margin);
+	XMFLOAT3 gridSize(
+		2.0f * (scene.m_extents.x + a_settings.m_margin),
+		2.0f * (scene.m_extents.y + a_settings.m_margin),
+		2.0f * (scene.m_extents.z + a_settings.m_margin));
+
+	uint32_t countX = (std::max)(a_settings.m_countX, 1u);
+	uint32_t countY = (std::max)(a_settings.m_countY, 1u);
+	uint32_t countZ = (std::max)(a_settings.m_countZ, 1u);
+	auto spacing = [](float a_size, uint32_t a_count) { return a_count > 1 ? (std::max)(a_size / (a_count - 1), 1e-3f) : 1.0f; };
+
+	ProbeGrid grid;
+	grid.Reset(gridMin, XMFLOAT3(spacing(gridSize.x, countX), spacing(gridSize.y, countY), spacing(gridSize.z, countZ)), countX, countY, countZ);
+	Bake(grid, a_settings);
+	return grid;
+}
+
+void ProbeBaker::Bake(ProbeGrid& a_grid, const Settings& a_settings)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<SphericalHarmonicsL2>& probes = a_grid.GetProbes();
+	size_t probeCount = probes.size();
+	uint32_t rounds = std::clamp(a_settings.m_rounds, 1u, 16u);
+	uint32_t totalSamples = (std::max)(a_settings.m_samplesPerProbe, 1u << (rounds - 1));
+
+	//per probe and round, squared change from the round before and squared size, summed after the threads finish
+	std::vector<double> changes(probeCount * rounds, 0.0);
+	std::vector<double> sizes(probeCount * rounds, 0.0);
+
+	std::atomic<size_t> nextProbe = 0;
+	auto bakeProbes = [&]() -> uint64_t {
+		uint64_t rays = 0;
+		for (size_t probe = nextProbe++; probe < probeCount; probe = nextProbe++) {
+			uint32_t x = static_cast<uint32_t>(probe % a_grid.GetCountX());
+			uint32_t y = static_cast<uint32_t>(probe / a_grid.GetCountX() % a_grid.GetCountY());
+			uint32_t z = static_cast<uint32_t>(probe / (static_cast<size_t>(a_grid.GetCountX()) * a_grid.GetCountY()));
+			XMFLOAT3 position = a_grid.GetProbePosition(x, y, z);
+
+			//seeded by probe, the same probe gets the same rays on any thread
+			std::seed_seq seed = { a_settings.m_seed, static_cast<uint32_t>(probe) };
+			std::mt19937 random(seed);
+			std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+			SphericalHarmonicsL2 radiance;
+			SphericalHarmonicsL2 previous;
+			uint32_t taken = 0;
+			for (uint32_t round = 0; round < rounds; round++) {
+				uint32_t target = totalSamples >> (rounds - 1 - round);
+				for (; taken < target; taken++) {
+					float cosTheta = 1.0f - 2.0f * uniform(random);
+					float sinTheta = std::sqrt((std::max)(0.0f, 1.0f - cosTheta * cosTheta));
+					float phi = 2.0f * std::numbers::pi_v<float> * uniform(random);
+					XMFLOAT3 direction(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+
+					uint64_t before = rays;
+					radiance.AddSample(direction, GetIncomingRadiance(position, direction, a_settings.m_rayLength), 1.0f);
+					rays = before + 1 + m_lights.size();
+				}
+
+				//uniform sphere samples each cover 4 pi / n of solid angle
+				SphericalHarmonicsL2 estimate = radiance;
+				estimate.Scale(4.0f * std::numbers::pi_v<float> / taken);
+				estimate = estimate.ConvolvedWithCosine();
+
+				double change = 0.0, size = 0.0;
+				for (int i = 0; i < SphericalHarmonicsL2::COEFFICIENT_COUNT; i++) {
+					const XMFLOAT3& now = estimate.m_coefficients[i];
+					const XMFLOAT3& before = previous.m_coefficients[i];
+					change += (now.x - before.x) * (now.x - before.x) + (now.y - before.y) * (now.y - before.y) + (now.z - before.z) * (now.z - before.z);
+					size += now.x * now.x + now.y * now.y + now.z * now.z;
+				}
+				changes[probe * rounds + round] = change;
+				sizes[probe * rounds + round] = size;
+				previous = estimate;
+			}
+			probes[probe] = previous;
+		}
+		return rays;
+	};
+
+	uint32_t threadCount = static_cast<uint32_t>((std::min<size_t>)(
+		(std::min)((std::max)(std::thread::hardware_concurrency(), 1u), (std::max)(a_settings.m_maxThreads, 1u)),
+		(std::max<size_t>)(probeCount, 1)));
+	std::vector<std::future<uint64_t>> tasks;
+	for (uint32_t i = 1; i < threadCount; i++) {
+		tasks.push_back(std::async(std::launch::async, bakeProbes));
+	}
+	uint64_t rays = bakeProbes();
+	for (std::future<uint64_t>& task : tasks) rays += task.get();
+
+	m_report.m_probeCount = probeCount;
+	m_report.m_threads = threadCount;
+	m_report.m_rays = rays;
+	m_report.m_roundSamples.clear();
+	m_report.m_roundChange.clear();
+	for (uint32_t round = 1; round < rounds; round++) {
+		double change = 0.0, size = 0.0;
+		for (size_t probe = 0; probe < probeCount; probe++) {
+			change += changes[probe * rounds + round];
+			size += sizes[probe * rounds + round];
+		}
+		m_report.m_roundSamples.push_back(totalSamples >> (rounds - 1 - round));
+		m_report.m_roundChange.push_back(size > 0.0 ? static_cast<float>(std::sqrt(change / size)) : 0.0f);
+	}
+	m_report.m_bakeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
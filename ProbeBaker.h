@@ -0,0 +1,170 @@
+#pragma once
+#include <DirectXMath.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "Bounds.h"
+#include "Bvh.h"
+#include "Light.h"
+#include "ProbeGrid.h"
+#include "SphericalHarmonics.h"
+
+/// <summary>
+/// Offline CPU baker for a ProbeGrid. Every probe casts random rays into a two
+/// level scene, a Bvh over instance boxes whose leaves are per mesh triangle Bvhs.
+/// Rays that escape return the sky, rays that hit return one bounce of the
+/// analytic lights off the hit surface, so the result is indirect light only and
+/// adds to the shader's direct lighting without counting it twice.
+/// Probes are split across threads, each with its own random sequence so the
+/// result doesn't depend on the thread count.
+/// Knows nothing about D3D, meshes are plain positions and indices.
+/// </summary>
+class ProbeBaker
+{
+public:
+	/// <summary>
+	/// Linear sky radiance as six square faces in D3D cube order, +x -x +y -y +z -z
+	/// </summary>
+	struct Sky
+	{
+		uint32_t m_size = 0;
+		std::array<std::vector<DirectX::XMFLOAT3>, 6> m_faces;
+
+		//radiance of an empty sky, used when no faces were given
+		DirectX::XMFLOAT3 m_fallback = { 0.2f, 0.2f, 0.25f };
+
+		DirectX::XMFLOAT3 Sample(const DirectX::XMFLOAT3& a_direction) const;
+	};
+
+	struct Settings
+	{
+		uint32_t m_countX = 8;
+		uint32_t m_countY = 4;
+		uint32_t m_countZ = 8;
+
+		//the grid covers the scene bounds grown by this on every side
+		float m_margin = 1.0f;
+
+		uint32_t m_samplesPerProbe = 512;
+
+		//convergence is measured at this many sample counts, each double the last and ending at m_samplesPerProbe
+		uint32_t m_rounds = 5;
+
+		float m_rayLength = 200.0f;
+		uint32_t m_maxThreads = 8;
+		uint32_t m_seed = 1;
+	};
+
+	struct Report
+	{
+		size_t m_meshCount = 0;
+		size_t m_triangleCount = 0;
+		size_t m_instanceCount = 0;
+		size_t m_probeCount = 0;
+		double m_buildMs = 0.0;
+		double m_bakeMs = 0.0;
+		uint64_t m_rays = 0;
+		uint32_t m_threads = 0;
+
+		//samples per probe after each round and the RMS change of every probe's irradiance it made, relative to its size
+		std::vector<uint32_t> m_roundSamples;
+		std::vector<float> m_roundChange;
+	};
+
+	struct Hit
+	{
+		float m_distance = 0.0f;
+		uint32_t m_instance = 0;
+		DirectX::XMFLOAT3 m_normal = { 0.0f, 1.0f, 0.0f }; // world space, facing the ray
+	};
+
+	/// <summary>
+	/// Drops every mesh, instance and light
+	/// </summary>
+	void Clear();
+
+	/// <summary>
+	/// Builds the triangle Bvh of one mesh, the returned id is used by AddInstance
+	/// </summary>
+	uint32_t AddMesh(const std::vector<DirectX::XMFLOAT3>& a_positions, const std::vector<uint32_t>& a_indices);
+
+	/// <summary>
+	/// Places a mesh in the world, a_albedo is the diffuse color the bounce picks up
+	/// </summary>
+	void AddInstance(uint32_t a_mesh, const DirectX::XMFLOAT4X4& a_world, const DirectX::XMFLOAT3& a_albedo);
+
+	void SetLights(const Light* a_lights, size_t a_count);
+	void SetSky(Sky a_sky);
+
+	/// <summary>
+	/// Builds the instance Bvh, call after the last AddInstance and before tracing
+	/// </summary>
+	void BuildScene();
+
+	/// <summary>
+	/// World box around every instance, empty Bounds without instances
+	/// </summary>
+	const Bounds& GetSceneBounds() const { return m_sceneBounds; }
+
+	/// <summary>
+	/// Places a grid over the scene bounds and bakes every probe
+	/// </summary>
+	ProbeGrid Bake(const Settings& a_settings);
+
+	/// <summary>
+	/// Bakes the probes of an already placed grid, its coefficients are overwritten
+	/// </summary>
+	void Bake(ProbeGrid& a_grid, const Settings& a_settings);
+
+	/// <summary>
+	/// Closest triangle along the ray closer than a_maxDistance, a_direction normalized
+	/// </summary>
+	bool Intersect(const DirectX::XMFLOAT3& a_origin, const DirectX::XMFLOAT3& a_direction, float a_maxDistance, Hit& a_hit) const;
+
+	/// <summary>
+	/// Whether any triangle is along the ray closer than a_maxDistance, stops at the first one
+	/// </summary>
+	bool IsOccluded(const DirectX::XMFLOAT3& a_origin, const DirectX::XMFLOAT3& a_direction, float a_maxDistance) const;
+
+	/// <summary>
+	/// Irradiance over pi the analytic lights give a surface at a_position facing a_normal, shadow rays included
+	/// </summary>
+	DirectX::XMFLOAT3 GetDirectLight(const DirectX::XMFLOAT3& a_position, const DirectX::XMFLOAT3& a_normal) const;
+
+	const Report& GetReport() const { return m_report; }
+
+private:
+	struct MeshData
+	{
+		std::vector<DirectX::XMFLOAT3> m_positions;
+		std::vector<uint32_t> m_indices;
+		std::unique_ptr<Bvh> m_pBvh; // over triangles, object i is the triangle at m_indices[3 * i]
+		Bounds m_localBounds;
+	};
+
+	struct Instance
+	{
+		uint32_t m_mesh;
+		DirectX::XMFLOAT4X4 m_worldToLocal;
+		DirectX::XMFLOAT4X4 m_normalToWorld; // inverse transpose, row vector
+		DirectX::XMFLOAT3 m_albedo;
+	};
+
+	std::vector<MeshData> m_meshes;
+	std::vector<Instance> m_instances;
+	std::vector<Bounds> m_instanceBounds;
+	Bvh m_instanceBvh;
+	Bounds m_sceneBounds;
+	std::vector<Light> m_lights;
+	Sky m_sky;
+	Report m_report;
+
+	template <bool ANY_HIT>
+	bool Trace(const DirectX::XMFLOAT3& a_origin, const DirectX::XMFLOAT3& a_direction, float a_maxDistance, Hit* a_pHit) const;
+
+	/// <summary>
+	/// Radiance arriving at a_origin from a_direction, the sky or one bounce off what the ray hits
+	/// </summary>
+	DirectX::XMFLOAT3 GetIncomingRadiance(const DirectX::XMFLOAT3& a_origin, const DirectX::XMFLOAT3& a_direction, float a_rayLength) const;
+};
@@ -0,0 +1,116 @@
+#include "ProbeGrid.h"
+#include <DirectXPackedVector.h>
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+using namespace DirectX;
+
+void ProbeGrid::Reset(const XMFLOAT3& a_origin, const XMFLOAT3& a_spacing, uint32_t a_countX, uint32_t a_countY, uint32_t a_countZ)
+{
+	m_origin = a_origin;
+	m_spacing = a_spacing;
+	m_countX = a_countX;
+	m_countY = a_countY;
+	m_countZ = a_countZ;
+	m_probes.assign(static_cast<size_t>(a_countX) * a_countY * a_countZ, SphericalHarmonicsL2());
+}
+
+XMFLOAT3 ProbeGrid::GetProbePosition(uint32_t a_x, uint32_t a_y, uint32_t a_z) const
+{
+	return XMFLOAT3(
+		m_origin.x + a_x * m_spacing.x,
+		m_origin.y + a_y * m_spacing.y,
+		m_origin.z + a_z * m_spacing.z);
+}
+
+SphericalHarmonicsL2 ProbeGrid::Sample(const XMFLOAT3& a_position) const
+{
+	if (m_probes.empty()) return SphericalHarmonicsL2();
+
+	//NaN survives the clamp below and would index past the probes
+	if (!std::isfinite(a_position.x) || !std::isfinite(a_position.y) || !std::isfinite(a_position.z)) return SphericalHarmonicsL2();
+
+	//lower probe and blend weight per axis, single probe axes always use probe 0
+	auto axis = [](float a_position, float a_origin, float a_spacing, uint32_t a_count, uint32_t& a_first, float& a_weight) {
+		float cell = std::clamp((a_position - a_origin) / a_spacing, 0.0f, static_cast<float>(a_count - 1));
+		a_first = (std::min)(static_cast<uint32_t>(cell), a_count > 1 ? a_count - 2 : 0u);
+		a_weight = a_count > 1 ? cell - a_first : 0.0f;
+	};
+
+	uint32_t x, y, z;
+	float weightX, weightY, weightZ;
+	axis(a_position.x, m_origin.x, m_spacing.x, m_countX, x, weightX);
+	axis(a_position.y, m_origin.y, m_spacing.y, m_countY, y, weightY);
+	axis(a_position.z, m_origin.z, m_spacing.z, m_countZ, z, weightZ);
+
+	SphericalHarmonicsL2 result;
+	for (uint32_t corner = 0; corner < 8; corner++) {
+		uint32_t dx = corner & 1, dy = (corner >> 1) & 1, dz = (corner >> 2) & 1;
+		float weight = (dx ? weightX : 1.0f - weightX) * (dy ? weightY : 1.0f - weightY) * (dz ? weightZ : 1.0f - weightZ);
+		if (weight <= 0.0f) continue;
+		result.Add(m_probes[GetIndex(x + dx, y + dy, z + dz)], weight);
+	}
+	return result;
+}
+
+size_t ProbeGrid::GetFileSize() const
+{
+	return sizeof(FileHeader) + m_probes.size() * SphericalHarmonicsL2::COEFFICIENT_COUNT * 3 * sizeof(PackedVector::HALF);
+}
+
+bool ProbeGrid::Save(const std::wstring& a_path) const
+{
+	std::ofstream file(std::filesystem::path(a_path), std::ios::binary);
+	if (!file) return false;
+
+	FileHeader header = { FILE_MAGIC, FILE_VERSION, m_countX, m_countY, m_countZ,
+		{ m_origin.x, m_origin.y, m_origin.z }, { m_spacing.x, m_spacing.y, m_spacing.z } };
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	//irradiance stays well inside half range, a third of the float size is worth the precision
+	std::vector<PackedVector::HALF> values;
+	values.reserve(m_probes.size() * SphericalHarmonicsL2::COEFFICIENT_COUNT * 3);
+	for (const SphericalHarmonicsL2& probe : m_probes) {
+		for (const XMFLOAT3& coefficient : probe.m_coefficients) {
+			values.push_back(PackedVector::XMConvertFloatToHalf(coefficient.x));
+			values.push_back(PackedVector::XMConvertFloatToHalf(coefficient.y));
+			values.push_back(PackedVector::XMConvertFloatToHalf(coefficient.z));
+		}
+	}
+	file.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(PackedVector::HALF));
+	return static_cast<bool>(file);
+}
+
+bool ProbeGrid::Load(const std::wstring& a_path)
+{
+	std::ifstream file(std::filesystem::path(a_path), std::ios::binary);
+	if (!file) return false;
+
+	FileHeader header = {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if (!file || header.m_magic != FILE_MAGIC || header.m_version != FILE_VERSION) return false;
+
+	size_t probeCount = static_cast<size_t>(header.m_countX) * header.m_countY * header.m_countZ;
+	if (probeCount == 0 || probeCount > MAX_FILE_PROBES) return false;
+	if (!(header.m_spacing[0] > 0.0f && header.m_spacing[1] > 0.0f && header.m_spacing[2] > 0.0f)) return false;
+	std::vector<PackedVector::HALF> values(probeCount * SphericalHarmonicsL2::COEFFICIENT_COUNT * 3);
+	file.read(reinterpret_cast<char*>(values.data()), values.size() * sizeof(PackedVector::HALF));
+	if (!file) return false;
+
+	Reset(
+		XMFLOAT3(header.m_origin[0], header.m_origin[1], header.m_origin[2]),
+		XMFLOAT3(header.m_spacing[0], header.m_spacing[1], header.m_spacing[2]),
+		header.m_countX, header.m_countY, header.m_countZ);
+
+	const PackedVector::HALF* value = values.data();
+	for (SphericalHarmonicsL2& probe : m_probes) {
+		for (XMFLOAT3& coefficient : probe.m_coefficients) {
+			coefficient.x = PackedVector::XMConvertHalfToFloat(*value++);
+			coefficient.y = PackedVector::XMConvertHalfToFloat(*value++);
+			coefficient.z = PackedVector::XMConvertHalfToFloat(*value++);
+		}
+	}
+	return true;
+}
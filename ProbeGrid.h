@@ -0,0 +1,80 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SphericalHarmonics.h"
+
+//pixel shader register of the per object irradiance sampled from the grid
+inline constexpr unsigned int OBJECT_IRRADIANCE_SLOT = 12;
+
+/// <summary>
+/// Regular 3D grid of irradiance probes in world space, probe (x, y, z) sits at
+/// origin + (x, y, z) * spacing. Stored on disk as a small header followed by
+/// every probe's coefficients in half precision, x fastest.
+/// Knows nothing about D3D, sampling is plain trilinear blending on the CPU.
+/// </summary>
+class ProbeGrid
+{
+public:
+	static constexpr uint32_t FILE_MAGIC = 0x47504853; // "SHPG"
+	static constexpr uint32_t FILE_VERSION = 1;
+
+	//files claiming more are treated as corrupt rather than allocated
+	static constexpr size_t MAX_FILE_PROBES = 1u << 22;
+
+	/// <summary>
+	/// Drops every probe and makes room for a_countX * a_countY * a_countZ zeroed ones
+	/// </summary>
+	void Reset(const DirectX::XMFLOAT3& a_origin, const DirectX::XMFLOAT3& a_spacing, uint32_t a_countX, uint32_t a_countY, uint32_t a_countZ);
+
+	/// <summary>
+	/// Irradiance at a_position blended from the eight surrounding probes,
+	/// positions outside the grid use its nearest face. Empty grids and
+	/// non-finite positions give zero irradiance.
+	/// </summary>
+	SphericalHarmonicsL2 Sample(const DirectX::XMFLOAT3& a_position) const;
+
+	bool Save(const std::wstring& a_path) const;
+
+	/// <summary>
+	/// Replaces the grid with a_path's, false and unchanged when it's missing or not a probe file
+	/// </summary>
+	bool Load(const std::wstring& a_path);
+
+	/// <summary>
+	/// Bytes Save writes for this grid
+	/// </summary>
+	size_t GetFileSize() const;
+
+	size_t GetIndex(uint32_t a_x, uint32_t a_y, uint32_t a_z) const { return (static_cast<size_t>(a_z) * m_countY + a_y) * m_countX + a_x; }
+	DirectX::XMFLOAT3 GetProbePosition(uint32_t a_x, uint32_t a_y, uint32_t a_z) const;
+
+	bool IsEmpty() const { return m_probes.empty(); }
+	uint32_t GetCountX() const { return m_countX; }
+	uint32_t GetCountY() const { return m_countY; }
+	uint32_t GetCountZ() const { return m_countZ; }
+	const DirectX::XMFLOAT3& GetOrigin() const { return m_origin; }
+	const DirectX::XMFLOAT3& GetSpacing() const { return m_spacing; }
+	std::vector<SphericalHarmonicsL2>& GetProbes() { return m_probes; }
+	const std::vector<SphericalHarmonicsL2>& GetProbes() const { return m_probes; }
+
+private:
+	struct FileHeader
+	{
+		uint32_t m_magic;
+		uint32_t m_version;
+		uint32_t m_countX;
+		uint32_t m_countY;
+		uint32_t m_countZ;
+		float m_origin[3];
+		float m_spacing[3];
+	};
+
+	DirectX::XMFLOAT3 m_origin = { 0.0f, 0.0f, 0.0f };
+	DirectX::XMFLOAT3 m_spacing = { 1.0f, 1.0f, 1.0f };
+	uint32_t m_countX = 0;
+	uint32_t m_countY = 0;
+	uint32_t m_countZ = 0;
+	std::vector<SphericalHarmonicsL2> m_probes;
+};
@@ -0,0 +1,128 @@
+#include "RecordingRenderBackend.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+void RecordingRenderBackend::Execute(const RenderCommandList& a_commands)
+{
+	for (const RenderCommand::Header& header : a_commands) {
+		m_recorded.Append(header);
+		m_counts[static_cast<size_t>(header.m_type)]++;
+	}
+}
+
+void RecordingRenderBackend::Clear()
+{
+	m_recorded.Clear();
+	m_counts = {};
+}
+
+size_t RecordingRenderBackend::GetCount(RenderCommand::Type a_type) const
+{
+	return m_counts[static_cast<size_t>(a_type)];
+}
+
+size_t RecordingRenderBackend::GetDrawCount() const
+{
+	return GetCount(RenderCommand::Type::DRAW_INDEXED) + GetCount(RenderCommand::Type::DRAW_INDEXED_INSTANCED);
+}
+
+std::string RecordingRenderBackend::ToString() const
+{
+	std::string output;
+	for (const RenderCommand::Header& header : m_recorded) {
+		output += Describe(header);
+		output += '\n';
+	}
+	return output;
+}
+
+std::string RecordingRenderBackend::Describe(const RenderCommand::Header& a_command)
+{
+	using namespace RenderCommand;
+
+	char line[256];
+	const char* name = GetName(a_command.m_type);
+	auto stageName = [](Stage a_stage) { return a_stage == Stage::VERTEX ? "VS" : "PS"; };
+
+	switch (a_command.m_type) {
+	case Type::BIND_PIPELINE: {
+		const BindPipeline& command = RenderCommandList::As<BindPipeline>(a_command);
+		snprintf(line, sizeof(line), "%s vs=%p ps=%p", name, command.m_vertexShader, command.m_pixelShader);
+		break;
+	}
+	case Type::SET_RENDER_STATE: {
+		const SetRenderState& command = RenderCommandList::As<SetRenderState>(a_command);
+		snprintf(line, sizeof(line), "%s rasterizer=%p depthStencil=%p ref=%u",
+			name, command.m_rasterizerState, command.m_depthStencilState, command.m_stencilRef);
+		break;
+	}
+	case Type::BIND_SHADER_RESOURCE: {
+		const BindShaderResource& command = RenderCommandList::As<BindShaderResource>(a_command);
+		snprintf(line, sizeof(line), "%s %s t%u=%p", name, stageName(command.m_stage), command.m_slot, command.m_view);
+		break;
+	}
+	case Type::BIND_SAMPLER: {
+		const BindSampler& command = RenderCommandList::As<BindSampler>(a_command);
+		snprintf(line, sizeof(line), "%s %s s%u=%p", name, stageName(command.m_stage), command.m_slot, command.m_sampler);
+		break;
+	}
+	case Type::BIND_SHADER_RESOURCES: {
+		const BindShaderResources& command = RenderCommandList::As<BindShaderResources>(a_command);
+		snprintf(line, sizeof(line), "%s %s t%u..t%u", name, stageName(command.m_stage), command.m_firstSlot, command.m_firstSlot + command.m_count - 1);
+		break;
+	}
+	case Type::BIND_SAMPLERS: {
+		const BindSamplers& command = RenderCommandList::As<BindSamplers>(a_command);
+		snprintf(line, sizeof(line), "%s %s s%u..s%u", name, stageName(command.m_stage), command.m_firstSlot, command.m_firstSlot + command.m_count - 1);
+		break;
+	}
+	case Type::BIND_CONSTANT_BUFFER: {
+		const BindConstantBuffer& command = RenderCommandList::As<BindConstantBuffer>(a_command);
+		snprintf(line, sizeof(line), "%s %s b%u=%p offset=%u size=%u",
+			name, stageName(command.m_stage), command.m_slot, command.m_buffer, command.m_offsetInBytes, command.m_sizeInBytes);
+		break;
+	}
+	case Type::UPDATE_CONSTANT_BUFFER: {
+		const UpdateConstantBuffer& command = RenderCommandList::As<UpdateConstantBuffer>(a_command);
+		snprintf(line, sizeof(line), "%s %s b%u size=%u", name, stageName(command.m_stage), command.m_slot, command.m_sizeInBytes);
+		break;
+	}
+	case Type::BIND_GEOMETRY: {
+		const BindGeometry& command = RenderCommandList::As<BindGeometry>(a_command);
+		snprintf(line, sizeof(line), "%s vb=%p ib=%p stride=%u index=%u",
+			name, command.m_vertexBuffer, command.m_indexBuffer, command.m_stride, command.m_indexSizeInBytes);
+		break;
+	}
+	case Type::DRAW_INDEXED: {
+		const DrawIndexed& command = RenderCommandList::As<DrawIndexed>(a_command);
+		snprintf(line, sizeof(line), "%s indices=%u start=%u base=%d",
+			name, command.m_indexCount, command.m_startIndex, command.m_baseVertex);
+		break;
+	}
+	case Type::DRAW_INDEXED_INSTANCED: {
+		const DrawIndexedInstanced& command = RenderCommandList::As<DrawIndexedInstanced>(a_command);
+		snprintf(line, sizeof(line), "%s indices=%u instances=%u start=%u base=%d firstInstance=%u",
+			name, command.m_indexCount, command.m_instanceCount, command.m_startIndex, command.m_baseVertex, command.m_startInstance);
+		break;
+	}
+	default:
+		snprintf(line, sizeof(line), "%s", name);
+		break;
+	}
+	return line;
+}
+
+size_t RecordingRenderBackend::FindFirstDifference(const RenderCommandList& a_first, const RenderCommandList& a_second)
+{
+	//commands are zero padded, so equal commands are equal bytes
+	RenderCommandList::Iterator first = a_first.begin();
+	RenderCommandList::Iterator second = a_second.begin();
+	size_t index = 0;
+	for (; first != a_first.end() && second != a_second.end(); ++first, ++second, index++) {
+		if ((*first).m_size != (*second).m_size || memcmp(&*first, &*second, (*first).m_size) != 0) {
+			return index;
+		}
+	}
+	return a_first.GetCommandCount() == a_second.GetCommandCount() ? SIZE_MAX : index;
+}
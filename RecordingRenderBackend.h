@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <string>
+#include "RenderBackend.h"
+
+/// <summary>
+/// Headless backend, keeps a copy of every command it is given instead of
+/// calling an API. Lets submission run and be inspected without a device:
+/// command counts, a readable dump and diffs between two recordings.
+/// </summary>
+class RecordingRenderBackend : public RenderBackend
+{
+public:
+	void Execute(const RenderCommandList& a_commands) override;
+
+	void Clear();
+
+	const RenderCommandList& GetRecorded() const { return m_recorded; }
+	size_t GetCount(RenderCommand::Type a_type) const;
+
+	/// <summary>
+	/// DrawIndexed and DrawIndexedInstanced together
+	/// </summary>
+	size_t GetDrawCount() const;
+
+	/// <summary>
+	/// One line per recorded command
+	/// </summary>
+	std::string ToString() const;
+
+	/// <summary>
+	/// One command as text, handles are printed as addresses
+	/// </summary>
+	static std::string Describe(const RenderCommand::Header& a_command);
+
+	/// <summary>
+	/// Index of the first command that differs between the lists, or SIZE_MAX when they match
+	/// </summary>
+	static size_t FindFirstDifference(const RenderCommandList& a_first, const RenderCommandList& a_second);
+
+private:
+	RenderCommandList m_recorded;
+	std::array<size_t, static_cast<size_t>(RenderCommand::Type::COUNT)> m_counts = {};
+};
@@ -0,0 +1,17 @@
+#pragma once
+#include "RenderCommandList.h"
+
+/// <summary>
+/// Replays command lists, one implementation per graphics API plus a
+/// headless one that only records what it was given.
+/// </summary>
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() = default;
+
+	/// <summary>
+	/// Replays every command of a_commands in order
+	/// </summary>
+	virtual void Execute(const RenderCommandList& a_commands) = 0;
+};
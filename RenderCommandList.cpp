@@ -0,0 +1,144 @@
+#include "RenderCommandList.h"
+#include <cstring>
+
+const char* RenderCommand::GetName(Type a_type)
+{
+	switch (a_type) {
+	case Type::BIND_PIPELINE: return "BindPipeline";
+	case Type::SET_RENDER_STATE: return "SetRenderState";
+	case Type::BIND_SHADER_RESOURCE: return "BindShaderResource";
+	case Type::BIND_SAMPLER: return "BindSampler";
+	case Type::BIND_SHADER_RESOURCES: return "BindShaderResources";
+	case Type::BIND_SAMPLERS: return "BindSamplers";
+	case Type::BIND_CONSTANT_BUFFER: return "BindConstantBuffer";
+	case Type::UPDATE_CONSTANT_BUFFER: return "UpdateConstantBuffer";
+	case Type::BIND_GEOMETRY: return "BindGeometry";
+	case Type::DRAW_INDEXED: return "DrawIndexed";
+	case Type::DRAW_INDEXED_INSTANCED: return "DrawIndexedInstanced";
+	default: return "Unknown";
+	}
+}
+
+void RenderCommandList::Clear()
+{
+	m_bytes.clear();
+	m_commandCount = 0;
+}
+
+void* RenderCommandList::Allocate(RenderCommand::Type a_type, size_t a_sizeInBytes)
+{
+	size_t size = (a_sizeInBytes + RenderCommand::ALIGNMENT - 1) & ~(RenderCommand::ALIGNMENT - 1);
+	size_t offset = m_bytes.size();
+
+	//resize zero fills, so padding is identical and lists can be compared byte for byte
+	m_bytes.resize(offset + size);
+	m_commandCount++;
+
+	RenderCommand::Header* header = reinterpret_cast<RenderCommand::Header*>(m_bytes.data() + offset);
+	header->m_type = a_type;
+	header->m_size = static_cast<uint32_t>(size);
+	return header;
+}
+
+void RenderCommandList::BindPipeline(RenderHandle a_vertexShader, RenderHandle a_pixelShader)
+{
+	RenderCommand::BindPipeline& command = Push<RenderCommand::BindPipeline>();
+	command.m_vertexShader = a_vertexShader;
+	command.m_pixelShader = a_pixelShader;
+}
+
+void RenderCommandList::SetRenderState(RenderHandle a_rasterizerState, RenderHandle a_depthStencilState, uint32_t a_stencilRef)
+{
+	RenderCommand::SetRenderState& command = Push<RenderCommand::SetRenderState>();
+	command.m_rasterizerState = a_rasterizerState;
+	command.m_depthStencilState = a_depthStencilState;
+	command.m_stencilRef = a_stencilRef;
+}
+
+void RenderCommandList::BindShaderResource(RenderCommand::Stage a_stage, uint32_t a_slot, RenderHandle a_view)
+{
+	RenderCommand::BindShaderResource& command = Push<RenderCommand::BindShaderResource>();
+	command.m_stage = a_stage;
+	command.m_slot = a_slot;
+	command.m_view = a_view;
+}
+
+void RenderCommandList::BindSampler(RenderCommand::Stage a_stage, uint32_t a_slot, RenderHandle a_sampler)
+{
+	RenderCommand::BindSampler& command = Push<RenderCommand::BindSampler>();
+	command.m_stage = a_stage;
+	command.m_slot = a_slot;
+	command.m_sampler = a_sampler;
+}
+
+void RenderCommandList::BindShaderResources(RenderCommand::Stage a_stage, uint32_t a_firstSlot, uint32_t a_count, const RenderHandle* a_views)
+{
+	RenderCommand::BindShaderResources& command = Push<RenderCommand::BindShaderResources>(a_count * sizeof(RenderHandle));
+	command.m_stage = a_stage;
+	command.m_firstSlot = a_firstSlot;
+	command.m_count = a_count;
+	memcpy(&command + 1, a_views, a_count * sizeof(RenderHandle));
+}
+
+void RenderCommandList::BindSamplers(RenderCommand::Stage a_stage, uint32_t a_firstSlot, uint32_t a_count, const RenderHandle* a_samplers)
+{
+	RenderCommand::BindSamplers& command = Push<RenderCommand::BindSamplers>(a_count * sizeof(RenderHandle));
+	command.m_stage = a_stage;
+	command.m_firstSlot = a_firstSlot;
+	command.m_count = a_count;
+	memcpy(&command + 1, a_samplers, a_count * sizeof(RenderHandle));
+}
+
+void RenderCommandList::BindConstantBuffer(RenderCommand::Stage a_stage, uint32_t a_slot, RenderHandle a_buffer, uint32_t a_offsetInBytes, uint32_t a_sizeInBytes)
+{
+	RenderCommand::BindConstantBuffer& command = Push<RenderCommand::BindConstantBuffer>();
+	command.m_stage = a_stage;
+	command.m_slot = a_slot;
+	command.m_buffer = a_buffer;
+	command.m_offsetInBytes = a_offsetInBytes;
+	command.m_sizeInBytes = a_sizeInBytes;
+}
+
+void RenderCommandList::UpdateConstantBuffer(RenderCommand::Stage a_stage, uint32_t a_slot, const void* a_data, uint32_t a_sizeInBytes)
+{
+	RenderCommand::UpdateConstantBuffer& command = Push<RenderCommand::UpdateConstantBuffer>(a_sizeInBytes);
+	command.m_stage = a_stage;
+	command.m_slot = a_slot;
+	command.m_sizeInBytes = a_sizeInBytes;
+	memcpy(&command + 1, a_data, a_sizeInBytes);
+}
+
+void RenderCommandList::BindGeometry(RenderHandle a_vertexBuffer, RenderHandle a_indexBuffer, uint32_t a_stride, uint32_t a_indexSizeInBytes)
+{
+	RenderCommand::BindGeometry& command = Push<RenderCommand::BindGeometry>();
+	command.m_vertexBuffer = a_vertexBuffer;
+	command.m_indexBuffer = a_indexBuffer;
+	command.m_stride = a_stride;
+	command.m_indexSizeInBytes = a_indexSizeInBytes;
+}
+
+void RenderCommandList::DrawIndexed(uint32_t a_indexCount, uint32_t a_startIndex, int32_t a_baseVertex)
+{
+	RenderCommand::DrawIndexed& command = Push<RenderCommand::DrawIndexed>();
+	command.m_indexCount = a_indexCount;
+	command.m_startIndex = a_startIndex;
+	command.m_baseVertex = a_baseVertex;
+}
+
+void RenderCommandList::DrawIndexedInstanced(uint32_t a_indexCount, uint32_t a_instanceCount, uint32_t a_startIndex, int32_t a_baseVertex, uint32_t a_startInstance)
+{
+	RenderCommand::DrawIndexedInstanced& command = Push<RenderCommand::DrawIndexedInstanced>();
+	command.m_indexCount = a_indexCount;
+	command.m_instanceCount = a_instanceCount;
+	command.m_startIndex = a_startIndex;
+	command.m_baseVertex = a_baseVertex;
+	command.m_startInstance = a_startInstance;
+}
+
+void RenderCommandList::Append(const RenderCommand::Header& a_command)
+{
+	size_t offset = m_bytes.size();
+	m_bytes.resize(offset + a_command.m_size);
+	memcpy(m_bytes.data() + offset, &a_command, a_command.m_size);
+	m_commandCount++;
+}
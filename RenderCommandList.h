@@ -0,0 +1,231 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Opaque pointer to a backend object (shader, buffer, view or state),
+/// only the backend that replays the list knows the real type
+/// </summary>
+using RenderHandle = void*;
+
+namespace RenderCommand
+{
+	enum class Type : uint8_t
+	{
+		BIND_PIPELINE,
+		SET_RENDER_STATE,
+		BIND_SHADER_RESOURCE,
+		BIND_SAMPLER,
+		BIND_SHADER_RESOURCES,
+		BIND_SAMPLERS,
+		BIND_CONSTANT_BUFFER,
+		UPDATE_CONSTANT_BUFFER,
+		BIND_GEOMETRY,
+		DRAW_INDEXED,
+		DRAW_INDEXED_INSTANCED,
+		COUNT
+	};
+
+	enum class Stage : uint8_t
+	{
+		VERTEX,
+		PIXEL
+	};
+
+	//every command starts with this, m_size covers the whole command including trailing data
+	struct Header
+	{
+		Type m_type;
+		uint32_t m_size;
+	};
+
+	//commands are padded to this so the pointers inside stay aligned
+	constexpr size_t ALIGNMENT = 8;
+
+	struct BindPipeline
+	{
+		static constexpr Type TYPE = Type::BIND_PIPELINE;
+		Header m_header;
+		RenderHandle m_vertexShader;
+		RenderHandle m_pixelShader;
+	};
+
+	//null states go back to the pipeline defaults
+	struct SetRenderState
+	{
+		static constexpr Type TYPE = Type::SET_RENDER_STATE;
+		Header m_header;
+		RenderHandle m_rasterizerState;
+		RenderHandle m_depthStencilState;
+		uint32_t m_stencilRef;
+	};
+
+	struct BindShaderResource
+	{
+		static constexpr Type TYPE = Type::BIND_SHADER_RESOURCE;
+		Header m_header;
+		Stage m_stage;
+		uint32_t m_slot;
+		RenderHandle m_view;
+	};
+
+	struct BindSampler
+	{
+		static constexpr Type TYPE = Type::BIND_SAMPLER;
+		Header m_header;
+		Stage m_stage;
+		uint32_t m_slot;
+		RenderHandle m_sampler;
+	};
+
+	//contiguous slots bound in one call, m_count handles follow the command
+	struct alignas(ALIGNMENT) BindShaderResources
+	{
+		static constexpr Type TYPE = Type::BIND_SHADER_RESOURCES;
+		Header m_header;
+		Stage m_stage;
+		uint32_t m_firstSlot;
+		uint32_t m_count;
+
+		const RenderHandle* GetViews() const { return reinterpret_cast<const RenderHandle*>(this + 1); }
+	};
+
+	struct alignas(ALIGNMENT) BindSamplers
+	{
+		static constexpr Type TYPE = Type::BIND_SAMPLERS;
+		Header m_header;
+		Stage m_stage;
+		uint32_t m_firstSlot;
+		uint32_t m_count;
+
+		const RenderHandle* GetSamplers() const { return reinterpret_cast<const RenderHandle*>(this + 1); }
+	};
+
+	//a range of a buffer that already holds the constants
+	struct BindConstantBuffer
+	{
+		static constexpr Type TYPE = Type::BIND_CONSTANT_BUFFER;
+		Header m_header;
+		Stage m_stage;
+		uint32_t m_slot;
+		RenderHandle m_buffer;
+		uint32_t m_offsetInBytes;
+		uint32_t m_sizeInBytes;
+	};
+
+	//constants stored in the list itself, the backend uploads and binds them
+	struct UpdateConstantBuffer
+	{
+		static constexpr Type TYPE = Type::UPDATE_CONSTANT_BUFFER;
+		Header m_header;
+		Stage m_stage;
+		uint32_t m_slot;
+		uint32_t m_sizeInBytes;
+
+		const void* GetData() const { return this + 1; }
+	};
+
+	struct BindGeometry
+	{
+		static constexpr Type TYPE = Type::BIND_GEOMETRY;
+		Header m_header;
+		RenderHandle m_vertexBuffer;
+		RenderHandle m_indexBuffer;
+		uint32_t m_stride;
+		uint32_t m_indexSizeInBytes;
+	};
+
+	struct DrawIndexed
+	{
+		static constexpr Type TYPE = Type::DRAW_INDEXED;
+		Header m_header;
+		uint32_t m_indexCount;
+		uint32_t m_startIndex;
+		int32_t m_baseVertex;
+	};
+
+	struct DrawIndexedInstanced
+	{
+		static constexpr Type TYPE = Type::DRAW_INDEXED_INSTANCED;
+		Header m_header;
+		uint32_t m_indexCount;
+		uint32_t m_instanceCount;
+		uint32_t m_startIndex;
+		int32_t m_baseVertex;
+		uint32_t m_startInstance;
+	};
+
+	const char* GetName(Type a_type);
+}
+
+/// <summary>
+/// Backend agnostic list of binds, constant updates and draws, packed back
+/// to back as POD commands in one byte buffer.
+/// The scene emits into it without touching the API, a RenderBackend replays it.
+/// </summary>
+class RenderCommandList
+{
+public:
+	/// <summary>
+	/// Walks the packed commands, dereferences to the current header
+	/// </summary>
+	class Iterator
+	{
+	public:
+		explicit Iterator(const uint8_t* a_pCommand) : m_pCommand(a_pCommand) {}
+		const RenderCommand::Header& operator*() const { return *reinterpret_cast<const RenderCommand::Header*>(m_pCommand); }
+		Iterator& operator++() { m_pCommand += (**this).m_size; return *this; }
+		bool operator!=(const Iterator& a_other) const { return m_pCommand != a_other.m_pCommand; }
+
+	private:
+		const uint8_t* m_pCommand;
+	};
+
+	void Clear();
+
+	void BindPipeline(RenderHandle a_vertexShader, RenderHandle a_pixelShader);
+	void SetRenderState(RenderHandle a_rasterizerState, RenderHandle a_depthStencilState, uint32_t a_stencilRef = 0);
+	void BindShaderResource(RenderCommand::Stage a_stage, uint32_t a_slot, RenderHandle a_view);
+	void BindSampler(RenderCommand::Stage a_stage, uint32_t a_slot, RenderHandle a_sampler);
+	void BindShaderResources(RenderCommand::Stage a_stage, uint32_t a_firstSlot, uint32_t a_count, const RenderHandle* a_views);
+	void BindSamplers(RenderCommand::Stage a_stage, uint32_t a_firstSlot, uint32_t a_count, const RenderHandle* a_samplers);
+	void BindConstantBuffer(RenderCommand::Stage a_stage, uint32_t a_slot, RenderHandle a_buffer, uint32_t a_offsetInBytes, uint32_t a_sizeInBytes);
+	void UpdateConstantBuffer(RenderCommand::Stage a_stage, uint32_t a_slot, const void* a_data, uint32_t a_sizeInBytes);
+	void BindGeometry(RenderHandle a_vertexBuffer, RenderHandle a_indexBuffer, uint32_t a_stride, uint32_t a_indexSizeInBytes);
+	void DrawIndexed(uint32_t a_indexCount, uint32_t a_startIndex = 0, int32_t a_baseVertex = 0);
+	void DrawIndexedInstanced(uint32_t a_indexCount, uint32_t a_instanceCount, uint32_t a_startIndex = 0, int32_t a_baseVertex = 0, uint32_t a_startInstance = 0);
+
+	/// <summary>
+	/// Copies one command, including its trailing data, from another list
+	/// </summary>
+	void Append(const RenderCommand::Header& a_command);
+
+	/// <summary>
+	/// The command behind a header, a_command.m_type has to match T
+	/// </summary>
+	template<typename T>
+	static const T& As(const RenderCommand::Header& a_command)
+	{
+		return *reinterpret_cast<const T*>(&a_command);
+	}
+
+	Iterator begin() const { return Iterator(m_bytes.data()); }
+	Iterator end() const { return Iterator(m_bytes.data() + m_bytes.size()); }
+
+	size_t GetCommandCount() const { return m_commandCount; }
+	size_t GetSizeInBytes() const { return m_bytes.size(); }
+
+private:
+	//the buffer only grows, Clear keeps its capacity for the next frame
+	std::vector<uint8_t> m_bytes;
+	size_t m_commandCount = 0;
+
+	void* Allocate(RenderCommand::Type a_type, size_t a_sizeInBytes);
+
+	template<typename T>
+	T& Push(size_t a_extraBytes = 0)
+	{
+		return *static_cast<T*>(Allocate(T::TYPE, sizeof(T) + a_extraBytes));
+	}
+};
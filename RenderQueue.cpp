@@ -0,0 +1,413 @@
+#include "RenderQueue.h"
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include "Graphics.h"
+#include "FrameProfiler.h"
+
+void RenderQueue::SetInstancedVertexShader(
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pVertexShader,
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pInstancedVertexShader)
+{
+	m_pVertexShader = a_pVertexShader;
+	m_pInstancedVertexShader = a_pInstancedVertexShader;
+}
+
+void RenderQueue::SetDepthOnlyVertexShaders(
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pVertexShader,
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pInstancedVertexShader)
+{
+	m_pDepthOnlyVertexShader = a_pVertexShader;
+	m_pDepthOnlyInstancedVertexShader = a_pInstancedVertexShader;
+}
+
+void RenderQueue::Clear()
+{
+	m_items.clear();
+	m_frontToBackItems.clear();
+	m_entities.clear();
+	m_stateIds.clear();
+	m_depths.clear();
+}
+
+void RenderQueue::Add(GameEntity* a_pEntity, RenderPass a_pass, float a_depth)
+{
+	std::shared_ptr<Material> material = a_pEntity->GetMaterial();
+	uint32_t materialId = GetMaterialId(material.get());
+	uint32_t meshId = GetMeshId(a_pEntity->GetMesh().get());
+	uint64_t key = RenderSortKey::Make(
+		a_pass,
+		GetShaderId(material->GetVertexShader().Get(), material->GetPixelShader().Get()),
+		materialId,
+		meshId,
+		a_depth);
+
+	m_items.push_back({ key, static_cast<uint32_t>(m_entities.size()) });
+	m_entities.push_back(a_pEntity);
+
+	//full width ids, the key's truncated fields could alias
+	m_stateIds.push_back((static_cast<uint64_t>(materialId) << 32) | meshId);
+	m_depths.push_back(a_depth);
+}
+
+void RenderQueue::Sort()
+{
+	FrameProfiler::Scope zone("Sort queue");
+	auto start = std::chrono::steady_clock::now();
+	RenderSortKey::RadixSort(m_items, m_scratch);
+	auto end = std::chrono::steady_clock::now();
+	m_stats.m_sortMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void RenderQueue::SortFrontToBack()
+{
+	auto start = std::chrono::steady_clock::now();
+	m_frontToBackItems.resize(m_items.size());
+	for (size_t i = 0; i < m_items.size(); i++) {
+		uint32_t index = m_items[i].m_index;
+		m_frontToBackItems[i] = {
+			RenderSortKey::MakeFrontToBack(
+				static_cast<RenderPass>(m_items[i].m_key >> RenderSortKey::PASS_SHIFT),
+				static_cast<uint32_t>(m_stateIds[index]),
+				m_depths[index]),
+			index };
+	}
+	RenderSortKey::RadixSort(m_frontToBackItems, m_scratch);
+	auto end = std::chrono::steady_clock::now();
+	m_depthOnlyStats.m_sortMs = std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void RenderQueue::SubmitDepthOnly(std::shared_ptr<Camera> a_camera, float a_interpolationAlpha)
+{
+	FrameProfiler::Scope zone("Depth pre-pass");
+	if (!HasDepthOnlyShaders()) return;
+	SortFrontToBack();
+
+	//an entity's depth has to come out of the same transform in both passes,
+	//so whatever the shading pass will instance is instanced here as well
+	PlanBatches();
+	m_entityInstanced.assign(m_entities.size(), 0);
+	for (size_t b = 0; b < m_batches.size(); b++) {
+		if (!m_batchInstanced[b]) continue;
+		for (uint32_t i = m_batches[b].m_first; i < m_batches[b].m_first + m_batches[b].m_count; i++) {
+			m_entityInstanced[m_items[i].m_index] = 1;
+		}
+	}
+
+	//only materials using the shader the depth only variants were written for
+	m_depthItems.clear();
+	m_depthStateIds.resize(m_entities.size());
+	for (const RenderSortKey::Item& item : m_frontToBackItems) {
+		if (m_entities[item.m_index]->GetMaterial()->GetVertexShader() != m_pVertexShader) continue;
+		m_depthItems.push_back(item);
+		m_depthStateIds[item.m_index] = ((m_stateIds[item.m_index] & UINT32_MAX) << 1) | m_entityInstanced[item.m_index];
+	}
+
+	//no material to bind, a batch is a run of one mesh drawn the same way
+	RenderSortKey::BuildBatches(m_depthItems, m_depthStateIds, UINT32_MAX, m_batches);
+	m_batchInstanced.resize(m_batches.size());
+	for (size_t b = 0; b < m_batches.size(); b++) {
+		m_batchInstanced[b] = m_depthStateIds[m_depthItems[m_batches[b].m_first].m_index] & 1;
+	}
+
+	SubmitBatches(m_depthItems, true, a_camera, a_interpolationAlpha, m_depthOnlyStats);
+}
+
+void RenderQueue::Submit(std::shared_ptr<Camera> a_camera, float a_interpolationAlpha)
+{
+	FrameProfiler::Scope zone("Submit");
+	PlanBatches();
+	SubmitBatches(m_items, false, a_camera, a_interpolationAlpha, m_stats);
+}
+
+void RenderQueue::PlanBatches()
+{
+	//sorted keys put identical mesh/material pairs next to each other
+	RenderSortKey::BuildBatches(m_items, m_stateIds, m_instancingEnabled ? UINT32_MAX : 1, m_batches);
+	m_batchInstanced.resize(m_batches.size());
+	for (size_t i = 0; i < m_batches.size(); i++) {
+		m_batchInstanced[i] = IsInstanced(m_batches[i]);
+	}
+}
+
+void RenderQueue::SubmitBatches(
+	const std::vector<RenderSortKey::Item>& a_items,
+	bool a_depthOnly,
+	std::shared_ptr<Camera> a_camera,
+	float a_interpolationAlpha,
+	Stats& a_stats)
+{
+	//gather every instanced entity's matrices so the buffer is mapped once per pass
+	const Double3& origin = a_camera->GetRenderOrigin();
+	m_instanceData.clear();
+	for (size_t b = 0; b < m_batches.size(); b++) {
+		if (!m_batchInstanced[b]) continue;
+		const RenderSortKey::Batch& batch = m_batches[b];
+		for (uint32_t i = batch.m_first; i < batch.m_first + batch.m_count; i++) {
+			m_instanceData.emplace_back();
+			m_entities[a_items[i].m_index]->FillInstanceData(origin, a_interpolationAlpha, m_instanceData.back());
+		}
+	}
+	UploadInstanceData();
+	UploadDrawConstants(a_items, a_depthOnly, a_camera, a_interpolationAlpha);
+
+	auto start = std::chrono::steady_clock::now();
+
+	//everything the draws need is uploaded, recording only binds and draws
+	size_t maxChunks = m_deferredContextsEnabled ? static_cast<size_t>((std::max)(m_maxRecordingThreads, 1)) : 1;
+	std::vector<CommandChunk> chunks = CommandRecording::PlanChunks(m_batches.size(), maxChunks, m_minBatchesPerChunk);
+	m_chunkStats.assign(chunks.size(), Stats());
+	if (m_chunkCommands.size() < chunks.size()) m_chunkCommands.resize(chunks.size());
+
+	if (chunks.size() <= 1) {
+		if (!chunks.empty()) {
+			m_chunkCommands[0].Clear();
+			EmitBatches(a_items, a_depthOnly, chunks[0], m_chunkCommands[0], m_chunkStats[0]);
+			D3D11RenderBackend().Execute(m_chunkCommands[0]);
+		}
+	}
+	else {
+		while (m_deferredSinks.size() < chunks.size()) {
+			m_deferredSinks.push_back(std::make_unique<DeferredContextSink>());
+		}
+
+		m_baseline.Capture(Graphics::Context.Get());
+		std::vector<CommandSink*> sinks;
+		for (size_t i = 0; i < chunks.size(); i++) {
+			m_deferredSinks[i]->SetBaseline(&m_baseline);
+			sinks.push_back(m_deferredSinks[i].get());
+		}
+
+		CommandRecording::RecordAndExecute(chunks, sinks,
+			[this, &a_items, a_depthOnly](size_t a_chunkIndex, const CommandChunk& a_chunk) {
+				FrameProfiler::Scope zone("Record chunk");
+				RenderCommandList& commands = m_chunkCommands[a_chunkIndex];
+				commands.Clear();
+				EmitBatches(a_items, a_depthOnly, a_chunk, commands, m_chunkStats[a_chunkIndex]);
+				D3D11RenderBackend(m_deferredSinks[a_chunkIndex]->GetState()).Execute(commands);
+			});
+	}
+
+	double sortMs = a_stats.m_sortMs;
+	a_stats = Stats();
+	a_stats.m_sortMs = sortMs;
+	a_stats.m_chunks = chunks.size();
+	a_stats.m_recordMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	for (size_t i = 0; i < chunks.size(); i++) {
+		a_stats.m_commandBytes += m_chunkCommands[i].GetSizeInBytes();
+	}
+	for (const Stats& chunkStats : m_chunkStats) {
+		a_stats.m_draws += chunkStats.m_draws;
+		a_stats.m_shaderBinds += chunkStats.m_shaderBinds;
+		a_stats.m_materialBinds += chunkStats.m_materialBinds;
+		a_stats.m_meshBinds += chunkStats.m_meshBinds;
+		a_stats.m_instances += chunkStats.m_instances;
+		a_stats.m_instancedDraws += chunkStats.m_instancedDraws;
+	}
+}
+
+void RenderQueue::EmitBatches(
+	const std::vector<RenderSortKey::Item>& a_items,
+	bool a_depthOnly,
+	const CommandChunk& a_chunk,
+	RenderCommandList& a_commands,
+	Stats& a_stats)
+{
+	//the key groups the draws, but skipping compares the real objects
+	//so ids that wrapped past their key bits can never skip a needed bind
+	ID3D11VertexShader* lastVertexShader = nullptr;
+	ID3D11PixelShader* lastPixelShader = nullptr;
+	Material* lastMaterial = nullptr;
+	Mesh* lastMesh = nullptr;
+
+	for (size_t b = a_chunk.m_first; b < a_chunk.m_first + a_chunk.m_count; b++) {
+		const RenderSortKey::Batch& batch = m_batches[b];
+		GameEntity* firstEntity = m_entities[a_items[batch.m_first].m_index];
+		Material* material = firstEntity->GetMaterial().get();
+		Mesh* mesh = firstEntity->GetMesh().get();
+		bool instanced = m_batchInstanced[b];
+		size_t drawIndex = m_batchFirstDraw[b];
+
+		//depth only draws have no pixel shader, early depth is all they are for
+		ID3D11VertexShader* vertexShader = a_depthOnly
+			? (instanced ? m_pDepthOnlyInstancedVertexShader.Get() : m_pDepthOnlyVertexShader.Get())
+			: (instanced ? m_pInstancedVertexShader.Get() : material->GetVertexShader().Get());
+		ID3D11PixelShader* pixelShader = a_depthOnly ? nullptr : material->GetPixelShader().Get();
+		if (vertexShader != lastVertexShader || pixelShader != lastPixelShader) {
+			a_commands.BindPipeline(vertexShader, pixelShader);
+			lastVertexShader = vertexShader;
+			lastPixelShader = pixelShader;
+			a_stats.m_shaderBinds++;
+		}
+
+		if (!a_depthOnly && material != lastMaterial) {
+			material->BindTexturesAndSamplers(a_commands, !m_materialRangeBinds);
+			lastMaterial = material;
+			a_stats.m_materialBinds++;
+		}
+
+		if (mesh != lastMesh) {
+			if (a_depthOnly) mesh->BindPositions(a_commands);
+			else mesh->Bind(a_commands);
+			lastMesh = mesh;
+			a_stats.m_meshBinds++;
+		}
+
+		if (instanced) {
+			BindDrawConstants(m_drawConstants[drawIndex], sizeof(InstanceBatchConstantBuffer), !a_depthOnly, a_commands);
+			mesh->DrawIndexedInstanced(batch.m_count, a_commands);
+			a_stats.m_instancedDraws++;
+			a_stats.m_draws++;
+		}
+		else {
+			for (uint32_t i = 0; i < batch.m_count; i++) {
+				BindDrawConstants(m_drawConstants[drawIndex + i], sizeof(VertexShaderConstantBuffer), !a_depthOnly, a_commands);
+				mesh->DrawIndexed(a_commands);
+				a_stats.m_draws++;
+			}
+		}
+		a_stats.m_instances += batch.m_count;
+	}
+}
+
+void RenderQueue::UploadDrawConstants(
+	const std::vector<RenderSortKey::Item>& a_items,
+	bool a_depthOnly,
+	std::shared_ptr<Camera> a_camera,
+	float a_interpolationAlpha)
+{
+	m_drawConstants.clear();
+
+	//depth only draws skip the pixel constants entirely
+	const unsigned int vertexSize = ConstantBufferRing::Align(sizeof(VertexShaderConstantBuffer));
+	const unsigned int batchSize = ConstantBufferRing::Align(sizeof(InstanceBatchConstantBuffer));
+	const unsigned int pixelSize = a_depthOnly ? 0 : ConstantBufferRing::Align(sizeof(PSConstantBuffer));
+
+	unsigned int totalSize = 0;
+	for (size_t b = 0; b < m_batches.size(); b++) {
+		totalSize += m_batchInstanced[b] ? batchSize + pixelSize : m_batches[b].m_count * (vertexSize + pixelSize);
+	}
+	if (totalSize == 0) return;
+
+	//one map for the whole frame, each draw only binds its range afterwards
+	m_constantAllocation = Graphics::MapNextConstantBuffer(totalSize);
+	unsigned char* data = static_cast<unsigned char*>(m_constantAllocation.m_pData);
+	unsigned int cursor = 0;
+	unsigned int firstInstance = 0;
+
+	m_batchFirstDraw.resize(m_batches.size());
+	for (size_t b = 0; b < m_batches.size(); b++) {
+		const RenderSortKey::Batch& batch = m_batches[b];
+		m_batchFirstDraw[b] = m_drawConstants.size();
+
+		if (m_batchInstanced[b]) {
+			InstanceBatchConstantBuffer batchBuffer;
+			batchBuffer.m_firstInstance = firstInstance;
+			memcpy(data + cursor, &batchBuffer, sizeof(batchBuffer));
+
+			//pixel constants come from the material, so the first entity speaks for the batch
+			if (!a_depthOnly) {
+				GameEntity* firstEntity = m_entities[a_items[batch.m_first].m_index];
+				firstEntity->UpdatePixelConstantBufferData(a_camera);
+				memcpy(data + cursor + batchSize, &firstEntity->m_PSConstantBuffer, sizeof(PSConstantBuffer));
+			}
+
+			m_drawConstants.push_back({ m_constantAllocation.m_offsetInBytes + cursor, m_constantAllocation.m_offsetInBytes + cursor + batchSize });
+			cursor += batchSize + pixelSize;
+			firstInstance += batch.m_count;
+			continue;
+		}
+
+		for (uint32_t i = batch.m_first; i < batch.m_first + batch.m_count; i++) {
+			GameEntity* entity = m_entities[a_items[i].m_index];
+			entity->UpdateConstantBufferData(a_camera, a_interpolationAlpha);
+
+			memcpy(data + cursor, &entity->m_VSConstantBuffer, sizeof(VertexShaderConstantBuffer));
+			if (!a_depthOnly) memcpy(data + cursor + vertexSize, &entity->m_PSConstantBuffer, sizeof(PSConstantBuffer));
+
+			m_drawConstants.push_back({ m_constantAllocation.m_offsetInBytes + cursor, m_constantAllocation.m_offsetInBytes + cursor + vertexSize });
+			cursor += vertexSize + pixelSize;
+		}
+	}
+
+	Graphics::UnmapConstantBuffer(m_constantAllocation);
+}
+
+void RenderQueue::BindDrawConstants(const DrawConstants& a_constants, unsigned int a_vertexSizeInBytes, bool a_bindPixel, RenderCommandList& a_commands)
+{
+	a_commands.BindConstantBuffer(
+		RenderCommand::Stage::VERTEX,
+		0,
+		m_constantAllocation.m_pBuffer,
+		a_constants.m_vertexOffset,
+		a_vertexSizeInBytes);
+	if (!a_bindPixel) return;
+	a_commands.BindConstantBuffer(
+		RenderCommand::Stage::PIXEL,
+		0,
+		m_constantAllocation.m_pBuffer,
+		a_constants.m_pixelOffset,
+		sizeof(PSConstantBuffer));
+}
+
+bool RenderQueue::IsInstanced(const RenderSortKey::Batch& a_batch)
+{
+	if (!m_instancingEnabled || a_batch.m_count < 2 || m_pInstancedVertexShader == nullptr) return false;
+
+	//only materials using the shader the instanced variant was written for
+	GameEntity* entity = m_entities[m_items[a_batch.m_first].m_index];
+	return entity->GetMaterial()->GetVertexShader() == m_pVertexShader;
+}
+
+void RenderQueue::UploadInstanceData()
+{
+	if (m_instanceData.empty()) return;
+
+	//grow by doubling so a slowly rising count doesn't recreate every frame
+	if (m_instanceData.size() > m_instanceCapacity) {
+		m_instanceCapacity = (std::max)(m_instanceData.size(), m_instanceCapacity * 2);
+		m_pInstanceBuffer.Reset();
+		m_pInstanceSRV.Reset();
+
+		D3D11_BUFFER_DESC bufferDesc = {};
+		bufferDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		bufferDesc.ByteWidth = static_cast<UINT>(m_instanceCapacity * sizeof(InstanceData));
+		bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+		bufferDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+		bufferDesc.StructureByteStride = sizeof(InstanceData);
+		Graphics::Device->CreateBuffer(&bufferDesc, 0, m_pInstanceBuffer.GetAddressOf());
+
+		D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+		srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+		srvDesc.Buffer.FirstElement = 0;
+		srvDesc.Buffer.NumElements = static_cast<UINT>(m_instanceCapacity);
+		Graphics::Device->CreateShaderResourceView(m_pInstanceBuffer.Get(), &srvDesc, m_pInstanceSRV.GetAddressOf());
+	}
+
+	D3D11_MAPPED_SUBRESOURCE mappedBuffer = {};
+	Graphics::Context->Map(m_pInstanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mappedBuffer);
+	memcpy(mappedBuffer.pData, m_instanceData.data(), m_instanceData.size() * sizeof(InstanceData));
+	Graphics::Context->Unmap(m_pInstanceBuffer.Get(), 0);
+
+	Graphics::State.VSSetShaderResource(0, m_pInstanceSRV.Get());
+}
+
+uint32_t RenderQueue::GetShaderId(const void* a_pVertexShader, const void* a_pPixelShader)
+{
+	auto [entry, inserted] = m_shaderIds.try_emplace({ a_pVertexShader, a_pPixelShader }, static_cast<uint32_t>(m_shaderIds.size()));
+	return entry->second;
+}
+
+uint32_t RenderQueue::GetMaterialId(const void* a_pMaterial)
+{
+	auto [entry, inserted] = m_materialIds.try_emplace(a_pMaterial, static_cast<uint32_t>(m_materialIds.size()));
+	return entry->second;
+}
+
+uint32_t RenderQueue::GetMeshId(const void* a_pMesh)
+{
+	auto [entry, inserted] = m_meshIds.try_emplace(a_pMesh, static_cast<uint32_t>(m_meshIds.size()));
+	return entry->second;
+}
@@ -0,0 +1,193 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <map>
+#include <unordered_map>
+#include <cstdint>
+#include <d3d11.h>
+#include <wrl/client.h>
+#include "RenderSortKey.h"
+#include "GameEntity.h"
+#include "Camera.h"
+#include "Graphics.h"
+#include "CommandRecording.h"
+#include "DeferredContextSink.h"
+#include "RenderCommandList.h"
+#include "D3D11RenderBackend.h"
+
+/// <summary>
+/// Collects visible entities for a frame, sorts them by packed state key
+/// and submits them, only binding shaders, materials and meshes when they
+/// differ from the previous draw.
+/// Runs of entities sharing a mesh and material are drawn with one
+/// DrawIndexedInstanced when their material uses the instanceable vertex shader.
+/// An optional depth only pass lays down depth front to back first, so the
+/// shading pass keeps its state order without paying for overdraw.
+/// </summary>
+class RenderQueue
+{
+public:
+	struct Stats
+	{
+		size_t m_draws = 0;
+		size_t m_shaderBinds = 0;
+		size_t m_materialBinds = 0;
+		size_t m_meshBinds = 0;
+		size_t m_instances = 0;
+		size_t m_instancedDraws = 0;
+		size_t m_chunks = 0;
+		size_t m_commandBytes = 0;
+		double m_sortMs = 0.0;
+		double m_recordMs = 0.0;
+	};
+
+	/// <summary>
+	/// Materials using a_pVertexShader may be drawn instanced with a_pInstancedVertexShader
+	/// </summary>
+	void SetInstancedVertexShader(
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pVertexShader,
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pInstancedVertexShader);
+
+	/// <summary>
+	/// Position only variants of the two shaders above, used by SubmitDepthOnly
+	/// </summary>
+	void SetDepthOnlyVertexShaders(
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pVertexShader,
+		Microsoft::WRL::ComPtr<ID3D11VertexShader> a_pInstancedVertexShader);
+	bool HasDepthOnlyShaders() const { return m_pDepthOnlyVertexShader != nullptr && m_pDepthOnlyInstancedVertexShader != nullptr; }
+
+	bool m_instancingEnabled = true;
+
+	//one bind for all of a material's textures and one for its samplers, off binds slot by slot
+	bool m_materialRangeBinds = true;
+
+	//record chunks of batches on deferred contexts in parallel, small queues stay on the immediate context
+	bool m_deferredContextsEnabled = true;
+	int m_maxRecordingThreads = 4;
+	size_t m_minBatchesPerChunk = 256;
+
+	void Clear();
+
+	/// <summary>
+	/// Queues an entity, a_depth is its view depth scaled to 0..1
+	/// </summary>
+	void Add(GameEntity* a_pEntity, RenderPass a_pass, float a_depth);
+
+	void Sort();
+	void Submit(std::shared_ptr<Camera> a_camera, float a_interpolationAlpha);
+
+	/// <summary>
+	/// Orders the queued entities front to back by view depth into GetFrontToBackItems,
+	/// Sort's state order is left alone for the shading pass
+	/// </summary>
+	void SortFrontToBack();
+
+	/// <summary>
+	/// Draws the depth of every queued entity whose material uses the instanceable
+	/// vertex shader, front to back, from the position streams and without a pixel
+	/// shader. Entities Submit will instance are instanced here as well, so both
+	/// passes compute the same depth. Call after Sort and before Submit with the
+	/// position only input layout bound.
+	/// </summary>
+	void SubmitDepthOnly(std::shared_ptr<Camera> a_camera, float a_interpolationAlpha);
+
+	size_t Size() const { return m_items.size(); }
+	const Stats& GetStats() const { return m_stats; }
+	const Stats& GetDepthOnlyStats() const { return m_depthOnlyStats; }
+
+	//queued entities in Add order, the sorted items index into it
+	const std::vector<GameEntity*>& GetEntities() const { return m_entities; }
+	const std::vector<RenderSortKey::Item>& GetItems() const { return m_items; }
+	const std::vector<RenderSortKey::Item>& GetFrontToBackItems() const { return m_frontToBackItems; }
+
+private:
+	std::vector<RenderSortKey::Item> m_items;
+	std::vector<RenderSortKey::Item> m_scratch;
+	std::vector<GameEntity*> m_entities;
+	std::vector<float> m_depths;
+	Stats m_stats;
+
+	//depth only pass, every entity front to back and the ones it actually draws
+	std::vector<RenderSortKey::Item> m_frontToBackItems;
+	std::vector<RenderSortKey::Item> m_depthItems;
+	std::vector<uint64_t> m_depthStateIds; // mesh id, low bit set when the shading pass instances the entity
+	std::vector<uint8_t> m_entityInstanced;
+	Stats m_depthOnlyStats;
+
+	//material and mesh ids per entity, equal ids can share an instanced draw
+	std::vector<uint64_t> m_stateIds;
+	std::vector<RenderSortKey::Batch> m_batches;
+	std::vector<uint8_t> m_batchInstanced;
+	std::vector<size_t> m_batchFirstDraw;
+
+	//one deferred context per recording thread, created on first use
+	std::vector<std::unique_ptr<DeferredContextSink>> m_deferredSinks;
+	std::vector<Stats> m_chunkStats;
+	std::vector<RenderCommandList> m_chunkCommands;
+	PipelineBaseline m_baseline;
+
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pVertexShader;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pInstancedVertexShader;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pDepthOnlyVertexShader;
+	Microsoft::WRL::ComPtr<ID3D11VertexShader> m_pDepthOnlyInstancedVertexShader;
+
+	//every instanced entity this frame, uploaded in one map
+	std::vector<InstanceData> m_instanceData;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> m_pInstanceBuffer;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pInstanceSRV;
+	size_t m_instanceCapacity = 0;
+
+	//where each draw's VS and PS constants landed in the ring this frame
+	struct DrawConstants
+	{
+		unsigned int m_vertexOffset;
+		unsigned int m_pixelOffset;
+	};
+	std::vector<DrawConstants> m_drawConstants;
+	Graphics::ConstantBufferAllocation m_constantAllocation = {};
+
+	bool IsInstanced(const RenderSortKey::Batch& a_batch);
+
+	/// <summary>
+	/// Batches of the state sorted items and whether each goes out instanced
+	/// </summary>
+	void PlanBatches();
+
+	/// <summary>
+	/// Uploads, records and executes the planned batches of a_items, shared by both passes
+	/// </summary>
+	void SubmitBatches(
+		const std::vector<RenderSortKey::Item>& a_items,
+		bool a_depthOnly,
+		std::shared_ptr<Camera> a_camera,
+		float a_interpolationAlpha,
+		Stats& a_stats);
+
+	void UploadInstanceData();
+	void UploadDrawConstants(
+		const std::vector<RenderSortKey::Item>& a_items,
+		bool a_depthOnly,
+		std::shared_ptr<Camera> a_camera,
+		float a_interpolationAlpha);
+	void BindDrawConstants(const DrawConstants& a_constants, unsigned int a_vertexSizeInBytes, bool a_bindPixel, RenderCommandList& a_commands);
+
+	/// <summary>
+	/// Emits the binds and draws of the batches in a_chunk, safe to run on any thread
+	/// once the pass's constants and instance data are uploaded
+	/// </summary>
+	void EmitBatches(
+		const std::vector<RenderSortKey::Item>& a_items,
+		bool a_depthOnly,
+		const CommandChunk& a_chunk,
+		RenderCommandList& a_commands,
+		Stats& a_stats);
+
+	//small persistent ids so keys stay stable between frames
+	std::map<std::pair<const void*, const void*>, uint32_t> m_shaderIds;
+	std::unordered_map<const void*, uint32_t> m_materialIds;
+	std::unordered_map<const void*, uint32_t> m_meshIds;
+
+	uint32_t GetShaderId(const void* a_pVertexShader, const void* a_pPixelShader);
+	uint32_t GetMaterialId(const void* a_pMaterial);
+	uint32_t GetMeshId(const void* a_pMesh);
+};
@@ -0,0 +1,172 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <array>
+#include <utility>
+
+/// <summary>
+/// Which pass a draw belongs to, lowest bits of the key's top field so
+/// passes are submitted in this order
+/// </summary>
+enum class RenderPass : uint8_t
+{
+	OPAQUE_GEOMETRY = 0,
+	TRANSPARENT_GEOMETRY = 1
+};
+
+/// <summary>
+/// 64 bit draw sort key, most significant field first:
+/// pass (4) | shader (12) | material (16) | mesh (16) | depth (16).
+/// Sorting by the whole key groups draws so the most expensive state
+/// changes happen least often, depth only orders draws that share everything else.
+/// </summary>
+namespace RenderSortKey
+{
+	constexpr int PASS_SHIFT = 60;
+	constexpr int SHADER_SHIFT = 48;
+	constexpr int MATERIAL_SHIFT = 32;
+	constexpr int MESH_SHIFT = 16;
+
+	constexpr uint64_t PASS_MASK = 0xF;
+	constexpr uint64_t SHADER_MASK = 0xFFF;
+	constexpr uint64_t MATERIAL_MASK = 0xFFFF;
+	constexpr uint64_t MESH_MASK = 0xFFFF;
+	constexpr uint64_t DEPTH_MASK = 0xFFFF;
+
+	/// <summary>
+	/// a_depth is 0 at the camera and 1 at the far plane, values outside are clamped
+	/// </summary>
+	inline uint64_t Make(RenderPass a_pass, uint32_t a_shaderId, uint32_t a_materialId, uint32_t a_meshId, float a_depth)
+	{
+		float depth = a_depth < 0.0f ? 0.0f : (a_depth > 1.0f ? 1.0f : a_depth);
+		uint64_t quantizedDepth = static_cast<uint64_t>(depth * DEPTH_MASK);
+
+		return
+			((static_cast<uint64_t>(a_pass) & PASS_MASK) << PASS_SHIFT) |
+			((a_shaderId & SHADER_MASK) << SHADER_SHIFT) |
+			((a_materialId & MATERIAL_MASK) << MATERIAL_SHIFT) |
+			((a_meshId & MESH_MASK) << MESH_SHIFT) |
+			(quantizedDepth & DEPTH_MASK);
+	}
+
+	constexpr int SLICE_SHIFT = 52;
+	constexpr int FRONT_TO_BACK_MESH_SHIFT = 36;
+	constexpr uint64_t SLICE_MASK = 0xFF;
+
+	/// <summary>
+	/// Key for depth only passes, where state is cheap and order is everything:
+	/// pass (4) | depth slice (8) | mesh (16) | unused (20) | depth (16).
+	/// Draws go front to back a slice at a time, inside a slice the same
+	/// meshes still end up next to each other for instancing.
+	/// </summary>
+	inline uint64_t MakeFrontToBack(RenderPass a_pass, uint32_t a_meshId, float a_depth)
+	{
+		float depth = a_depth < 0.0f ? 0.0f : (a_depth > 1.0f ? 1.0f : a_depth);
+		uint64_t quantizedDepth = static_cast<uint64_t>(depth * DEPTH_MASK);
+
+		return
+			((static_cast<uint64_t>(a_pass) & PASS_MASK) << PASS_SHIFT) |
+			(((quantizedDepth >> 8) & SLICE_MASK) << SLICE_SHIFT) |
+			((a_meshId & MESH_MASK) << FRONT_TO_BACK_MESH_SHIFT) |
+			(quantizedDepth & DEPTH_MASK);
+	}
+
+	inline uint32_t GetShader(uint64_t a_key) { return static_cast<uint32_t>((a_key >> SHADER_SHIFT) & SHADER_MASK); }
+	inline uint32_t GetMaterial(uint64_t a_key) { return static_cast<uint32_t>((a_key >> MATERIAL_SHIFT) & MATERIAL_MASK); }
+	inline uint32_t GetMesh(uint64_t a_key) { return static_cast<uint32_t>((a_key >> MESH_SHIFT) & MESH_MASK); }
+
+	/// <summary>
+	/// Key plus the index of whatever it describes
+	/// </summary>
+	struct Item
+	{
+		uint64_t m_key;
+		uint32_t m_index;
+	};
+
+	/// <summary>
+	/// Stable LSD radix sort on the key, 8 bits per pass.
+	/// All histograms are built in one read and passes where every key
+	/// has the same byte are skipped, so mostly-equal keys sort quickly.
+	/// </summary>
+	inline void RadixSort(std::vector<Item>& a_items, std::vector<Item>& a_scratch)
+	{
+		size_t count = a_items.size();
+		if (count < 2) return;
+		a_scratch.resize(count);
+
+		std::array<std::array<uint32_t, 256>, 8> histograms = {};
+		for (const Item& item : a_items) {
+			for (int pass = 0; pass < 8; pass++) {
+				histograms[pass][(item.m_key >> (pass * 8)) & 0xFF]++;
+			}
+		}
+
+		std::vector<Item>* source = &a_items;
+		std::vector<Item>* destination = &a_scratch;
+		for (int pass = 0; pass < 8; pass++) {
+			std::array<uint32_t, 256>& histogram = histograms[pass];
+
+			//one bucket holding everything means this byte can't change the order
+			uint32_t firstByte = (a_items[0].m_key >> (pass * 8)) & 0xFF;
+			if (histogram[firstByte] == count) continue;
+
+			uint32_t offset = 0;
+			for (uint32_t& bucket : histogram) {
+				uint32_t bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+			}
+
+			for (const Item& item : *source) {
+				(*destination)[histogram[(item.m_key >> (pass * 8)) & 0xFF]++] = item;
+			}
+			std::swap(source, destination);
+		}
+
+		if (source != &a_items) a_items.swap(a_scratch);
+	}
+
+	/// <summary>
+	/// Run of consecutive sorted items that can go out as one instanced draw
+	/// </summary>
+	struct Batch
+	{
+		uint32_t m_first;
+		uint32_t m_count;
+	};
+
+	/// <summary>
+	/// Splits sorted items into runs sharing the same pass and state id.
+	/// a_stateIds is indexed by Item::m_index and must only be equal for
+	/// items with the same mesh and material, runs are capped at a_maxInstances.
+	/// </summary>
+	inline void BuildBatches(
+		const std::vector<Item>& a_items,
+		const std::vector<uint64_t>& a_stateIds,
+		uint32_t a_maxInstances,
+		std::vector<Batch>& a_batches)
+	{
+		a_batches.clear();
+		if (a_maxInstances == 0) a_maxInstances = 1;
+
+		uint32_t count = static_cast<uint32_t>(a_items.size());
+		uint32_t first = 0;
+		while (first < count) {
+			uint64_t pass = a_items[first].m_key >> PASS_SHIFT;
+			uint64_t state = a_stateIds[a_items[first].m_index];
+
+			uint32_t last = first + 1;
+			while (last < count &&
+				last - first < a_maxInstances &&
+				(a_items[last].m_key >> PASS_SHIFT) == pass &&
+				a_stateIds[a_items[last].m_index] == state) {
+				last++;
+			}
+
+			a_batches.push_back({ first, last - first });
+			first = last;
+		}
+	}
+}
@@ -19,6 +19,7 @@ struct VertexToPixel
     float3 normal			: NORMAL;
     float3 worldPosition	: POSITION;
     float3 tangent			: TANGENT;
+    nointerpolation uint irradianceIndex : IRRADIANCE; // element of objectIrradiance, constant per object
 };
 
 struct VertexToPixel_Sky
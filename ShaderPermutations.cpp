@@ -0,0 +1,89 @@
+#include "ShaderPermutations.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+uint32_t ShaderPermutations::GetMaterialFeatures(bool a_hasNormalMap, bool a_hasRoughnessMap, bool a_hasMetalnessMap)
+{
+	//the shader reads both maps or neither, one without the other keeps the constants
+	uint32_t features = 0;
+	if (a_hasNormalMap) features |= NORMAL_MAP;
+	if (a_hasRoughnessMap && a_hasMetalnessMap) features |= SURFACE_MAPS;
+	return features;
+}
+
+uint32_t ShaderPermutations::GetFrameFeatures(bool a_hasLocalLights, bool a_shadowsEnabled, bool a_iblEnabled, bool a_probesEnabled, bool a_deferred)
+{
+	uint32_t features = 0;
+	if (a_deferred) features |= DEFERRED;
+	else {
+		if (a_hasLocalLights) features |= CLUSTERED_LIGHTS;
+		if (a_shadowsEnabled) features |= SHADOWS;
+	}
+	if (a_iblEnabled) features |= IBL;
+	if (a_probesEnabled) features |= PROBES;
+	return features;
+}
+
+const char* ShaderPermutations::GetFeatureName(uint32_t a_feature)
+{
+	switch (a_feature) {
+	case NORMAL_MAP: return "normal map";
+	case SURFACE_MAPS: return "surface maps";
+	case CLUSTERED_LIGHTS: return "clustered lights";
+	case SHADOWS: return "shadows";
+	case IBL: return "ibl";
+	case PROBES: return "probes";
+	case DEFERRED: return "deferred";
+	default: return "unknown";
+	}
+}
+
+std::string ShaderPermutations::Describe(uint32_t a_key)
+{
+	std::string description;
+	for (uint32_t bit = 0; bit < FEATURE_COUNT; bit++) {
+		if ((a_key & (1u << bit)) == 0) continue;
+		if (!description.empty()) description += " | ";
+		description += GetFeatureName(1u << bit);
+	}
+	return description.empty() ? "none" : description;
+}
+
+std::wstring ShaderPermutations::GetFileName(uint32_t a_key)
+{
+	return L"PixelShader_" + std::to_wstring(a_key) + L".cso";
+}
+
+std::string ShaderPermutations::BuildManifest()
+{
+	std::string manifest;
+	for (uint32_t key = 0; key < VARIANT_COUNT; key++) {
+		if (!IsValidKey(key)) continue;
+		manifest += std::to_string(key);
+		manifest += '\n';
+	}
+	return manifest;
+}
+
+std::vector<uint32_t> ShaderPermutations::ParseManifest(const std::string& a_manifest)
+{
+	std::vector<uint32_t> keys;
+	std::istringstream lines(a_manifest);
+	std::string line;
+	while (std::getline(lines, line)) {
+		if (!line.empty() && line.back() == '\r') line.pop_back();
+		if (line.empty() || line.size() > 9 || line.find_first_not_of("0123456789") != std::string::npos) continue;
+		unsigned long key = std::stoul(line);
+		if (IsValidKey(static_cast<uint32_t>(key))) keys.push_back(static_cast<uint32_t>(key));
+	}
+	return keys;
+}
+
+bool ShaderPermutations::WriteManifest(const std::wstring& a_path)
+{
+	std::ofstream file(std::filesystem::path(a_path), std::ios::binary);
+	if (!file) return false;
+	file << BuildManifest();
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// <summary>
+/// Feature bits PixelShader.hlsl is specialized on. A key is the bits OR'd
+/// together, the build compiles every key of the manifest with PERMUTATION=key
+/// into PixelShader_key.cso. Material bits are fixed when a material is loaded,
+/// frame bits follow the scene and renderer settings.
+/// Knows nothing about D3D, keys are plain integers and the manifest plain text.
+/// </summary>
+class ShaderPermutations
+{
+public:
+	//same bits as the PERMUTATION_ defines at the top of PixelShader.hlsl
+	enum Feature : uint32_t
+	{
+		NORMAL_MAP = 1u << 0,
+		SURFACE_MAPS = 1u << 1, // roughness and metalness maps
+		CLUSTERED_LIGHTS = 1u << 2, // point and spot lights, without it only directional lights are lit
+		SHADOWS = 1u << 3,
+		IBL = 1u << 4, // sky cube ambient and reflections
+		PROBES = 1u << 5, // per object irradiance from the baked probe grid
+		DEFERRED = 1u << 6, // writes the G-buffer, lights are added by DeferredLightingCS.hlsl
+	};
+
+	static constexpr uint32_t FEATURE_COUNT = 7;
+	static constexpr uint32_t VARIANT_COUNT = 1u << FEATURE_COUNT;
+	static constexpr uint32_t MATERIAL_FEATURES = NORMAL_MAP | SURFACE_MAPS;
+	static constexpr uint32_t FRAME_FEATURES = CLUSTERED_LIGHTS | SHADOWS | IBL | PROBES | DEFERRED;
+
+	//what PixelShader.cso without PERMUTATION does, missing variants fall back to it
+	static constexpr uint32_t DEFAULT_KEY = NORMAL_MAP | CLUSTERED_LIGHTS | SHADOWS;
+
+	/// <summary>
+	/// Material half of a key, from which of the albedo, normal, roughness and metalness slots are filled
+	/// </summary>
+	static uint32_t GetMaterialFeatures(bool a_hasNormalMap, bool a_hasRoughnessMap, bool a_hasMetalnessMap);
+
+	/// <summary>
+	/// Frame half of a key. Deferred variants leave lights and shadows to the
+	/// lighting pass, so those bits are dropped with a_deferred.
+	/// </summary>
+	static uint32_t GetFrameFeatures(bool a_hasLocalLights, bool a_shadowsEnabled, bool a_iblEnabled, bool a_probesEnabled, bool a_deferred = false);
+
+	/// <summary>
+	/// False for keys GetFrameFeatures never builds, deferred with lights or shadows
+	/// </summary>
+	static bool IsValidKey(uint32_t a_key)
+	{
+		return a_key < VARIANT_COUNT && ((a_key & DEFERRED) == 0 || (a_key & (CLUSTERED_LIGHTS | SHADOWS)) == 0);
+	}
+
+	static uint32_t Combine(uint32_t a_materialFeatures, uint32_t a_frameFeatures)
+	{
+		return (a_materialFeatures & MATERIAL_FEATURES) | (a_frameFeatures & FRAME_FEATURES);
+	}
+
+	static const char* GetFeatureName(uint32_t a_feature);
+
+	/// <summary>
+	/// Feature names of a_key separated by " | ", "none" without any
+	/// </summary>
+	static std::string Describe(uint32_t a_key);
+
+	/// <summary>
+	/// Compiled file of a_key, PixelShader_13.cso for 13
+	/// </summary>
+	static std::wstring GetFileName(uint32_t a_key);
+
+	/// <summary>
+	/// Every valid key the build compiles, one decimal key per line. Keys a material
+	/// can't reach are still listed, materials are resolved after the build.
+	/// </summary>
+	static std::string BuildManifest();
+
+	/// <summary>
+	/// Keys of a manifest, lines that aren't a valid key are skipped
+	/// </summary>
+	static std::vector<uint32_t> ParseManifest(const std::string& a_manifest);
+
+	/// <summary>
+	/// Writes BuildManifest to a_path, false when the file couldn't be opened
+	/// </summary>
+	static bool WriteManifest(const std::wstring& a_path);
+};
@@ -0,0 +1,134 @@
+#include "ShadowAtlas.h"
+#include <algorithm>
+
+namespace
+{
+	uint32_t RoundUpToPowerOfTwo(uint32_t a_value)
+	{
+		uint32_t result = 1;
+		while (result < a_value) result <<= 1;
+		return result;
+	}
+
+	bool Overlaps(const ShadowAtlasTile& a_first, const ShadowAtlasTile& a_second)
+	{
+		return a_first.m_x < a_second.m_x + a_second.m_size && a_second.m_x < a_first.m_x + a_first.m_size &&
+			a_first.m_y < a_second.m_y + a_second.m_size && a_second.m_y < a_first.m_y + a_first.m_size;
+	}
+}
+
+ShadowAtlas::ShadowAtlas(uint32_t a_size, uint32_t a_minTileSize)
+{
+	Reset(a_size, a_minTileSize);
+}
+
+void ShadowAtlas::Reset(uint32_t a_size, uint32_t a_minTileSize)
+{
+	m_size = RoundUpToPowerOfTwo((std::max)(a_size, 1u));
+	m_minTileSize = (std::min)(RoundUpToPowerOfTwo((std::max)(a_minTileSize, 1u)), m_size);
+	m_tileCount = 0;
+	m_usedArea = 0;
+
+	m_freeNodes.assign(GetLevel(m_minTileSize) + 1, {});
+	m_freeNodes[0].push_back({ 0, 0, m_size });
+}
+
+uint32_t ShadowAtlas::GetLevel(uint32_t a_size) const
+{
+	uint32_t level = 0;
+	for (uint32_t size = m_size; size > a_size; size >>= 1) level++;
+	return level;
+}
+
+bool ShadowAtlas::SplitDownTo(uint32_t a_level)
+{
+	if (!m_freeNodes[a_level].empty()) return true;
+	if (a_level == 0 || !SplitDownTo(a_level - 1)) return false;
+
+	//quarter the parent, children go on the free list in reverse so the top left is used first
+	ShadowAtlasTile parent = m_freeNodes[a_level - 1].back();
+	m_freeNodes[a_level - 1].pop_back();
+	uint32_t half = parent.m_size / 2;
+	m_freeNodes[a_level].push_back({ parent.m_x + half, parent.m_y + half, half });
+	m_freeNodes[a_level].push_back({ parent.m_x, parent.m_y + half, half });
+	m_freeNodes[a_level].push_back({ parent.m_x + half, parent.m_y, half });
+	m_freeNodes[a_level].push_back({ parent.m_x, parent.m_y, half });
+	return true;
+}
+
+ShadowAtlasTile ShadowAtlas::Allocate(uint32_t a_size)
+{
+	uint32_t size = std::clamp(RoundUpToPowerOfTwo((std::max)(a_size, 1u)), m_minTileSize, m_size);
+	uint32_t level = GetLevel(size);
+	if (!SplitDownTo(level)) return {};
+
+	ShadowAtlasTile tile = m_freeNodes[level].back();
+	m_freeNodes[level].pop_back();
+	m_tileCount++;
+	m_usedArea += static_cast<uint64_t>(tile.m_size) * tile.m_size;
+	return tile;
+}
+
+void ShadowAtlas::Free(const ShadowAtlasTile& a_tile)
+{
+	if (!a_tile.IsValid()) return;
+	m_tileCount--;
+	m_usedArea -= static_cast<uint64_t>(a_tile.m_size) * a_tile.m_size;
+
+	ShadowAtlasTile node = a_tile;
+	for (uint32_t level = GetLevel(node.m_size); level > 0; level--) {
+		//the other three quarters of the parent, all of them have to be free to merge
+		uint32_t parentSize = node.m_size * 2;
+		uint32_t parentX = node.m_x - node.m_x % parentSize;
+		uint32_t parentY = node.m_y - node.m_y % parentSize;
+
+		std::vector<ShadowAtlasTile>& freeNodes = m_freeNodes[level];
+		size_t siblings[3];
+		size_t siblingCount = 0;
+		for (size_t i = 0; i < freeNodes.size() && siblingCount < 3; i++) {
+			const ShadowAtlasTile& other = freeNodes[i];
+			if (other.m_x - other.m_x % parentSize == parentX && other.m_y - other.m_y % parentSize == parentY) {
+				siblings[siblingCount++] = i;
+			}
+		}
+		if (siblingCount < 3) {
+			freeNodes.push_back(node);
+			return;
+		}
+
+		//highest index first so the lower ones stay valid
+		for (int i = 2; i >= 0; i--) {
+			freeNodes[siblings[i]] = freeNodes.back();
+			freeNodes.pop_back();
+		}
+		node = { parentX, parentY, parentSize };
+	}
+	m_freeNodes[0].push_back(node);
+}
+
+size_t ShadowAtlas::GetFreeNodeCount() const
+{
+	size_t count = 0;
+	for (const std::vector<ShadowAtlasTile>& level : m_freeNodes) count += level.size();
+	return count;
+}
+
+bool ShadowAtlas::Validate(const std::vector<ShadowAtlasTile>& a_used) const
+{
+	std::vector<ShadowAtlasTile> tiles = a_used;
+	for (const std::vector<ShadowAtlasTile>& level : m_freeNodes) {
+		tiles.insert(tiles.end(), level.begin(), level.end());
+	}
+
+	uint64_t area = 0;
+	for (size_t i = 0; i < tiles.size(); i++) {
+		const ShadowAtlasTile& tile = tiles[i];
+		if (tile.m_x + tile.m_size > m_size || tile.m_y + tile.m_size > m_size) return false;
+		if (tile.m_x % tile.m_size != 0 || tile.m_y % tile.m_size != 0) return false;
+		for (size_t j = i + 1; j < tiles.size(); j++) {
+			if (Overlaps(tile, tiles[j])) return false;
+		}
+		area += static_cast<uint64_t>(tile.m_size) * tile.m_size;
+	}
+	return area == static_cast<uint64_t>(m_size) * m_size;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/// <summary>
+/// Square region of the atlas in texels, a size of 0 means nothing was allocated
+/// </summary>
+struct ShadowAtlasTile
+{
+	uint32_t m_x = 0;
+	uint32_t m_y = 0;
+	uint32_t m_size = 0;
+
+	bool IsValid() const { return m_size != 0; }
+};
+
+/// <summary>
+/// Quad tree packer for one big shadow texture. Every tile is a power of two
+/// node of the tree, allocating splits the smallest free node that fits into
+/// quarters and freeing merges four free siblings back into their parent.
+/// Knows nothing about D3D, only texel rectangles.
+/// </summary>
+class ShadowAtlas
+{
+public:
+	ShadowAtlas(uint32_t a_size = 4096, uint32_t a_minTileSize = 128);
+
+	/// <summary>
+	/// Forgets every tile, a_size and a_minTileSize are rounded up to powers of two
+	/// </summary>
+	void Reset(uint32_t a_size, uint32_t a_minTileSize);
+
+	/// <summary>
+	/// Tile of at least a_size texels, rounded up to a power of two and clamped
+	/// to the atlas. The returned tile is invalid when no node that big is free.
+	/// </summary>
+	ShadowAtlasTile Allocate(uint32_t a_size);
+	void Free(const ShadowAtlasTile& a_tile);
+
+	uint32_t GetSize() const { return m_size; }
+	uint32_t GetMinTileSize() const { return m_minTileSize; }
+	size_t GetTileCount() const { return m_tileCount; }
+	uint64_t GetUsedArea() const { return m_usedArea; }
+	size_t GetFreeNodeCount() const;
+
+	/// <summary>
+	/// Checks the free nodes don't overlap a_used or each other and that used plus
+	/// free covers the whole atlas, a_used being every tile handed out. For tests.
+	/// </summary>
+	bool Validate(const std::vector<ShadowAtlasTile>& a_used) const;
+
+private:
+	uint32_t m_size = 0;
+	uint32_t m_minTileSize = 0;
+	size_t m_tileCount = 0;
+	uint64_t m_usedArea = 0;
+
+	//free nodes per level, level 0 is the whole atlas and each level below halves the size
+	std::vector<std::vector<ShadowAtlasTile>> m_freeNodes;
+
+	uint32_t GetLevel(uint32_t a_size) const;
+	bool SplitDownTo(uint32_t a_level);
+};
@@ -0,0 +1,94 @@
+#include "ShadowCascades.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace DirectX;
+
+void ShadowCascades::ComputeSplits(float a_near, float a_far, uint32_t a_count, float a_lambda, float* a_splits)
+{
+	//practical split scheme, logarithmic keeps near cascades sharp, uniform stops far ones getting huge
+	for (uint32_t i = 0; i <= a_count; i++) {
+		float fraction = static_cast<float>(i) / a_count;
+		float logarithmic = a_near * std::pow(a_far / a_near, fraction);
+		float uniform = a_near + (a_far - a_near) * fraction;
+		a_splits[i] = a_lambda * logarithmic + (1.0f - a_lambda) * uniform;
+	}
+
+	//exact ends, the blend can drift by rounding
+	a_splits[0] = a_near;
+	a_splits[a_count] = a_far;
+}
+
+void ShadowCascades::Fit(
+	const XMFLOAT4X4& a_view,
+	const XMFLOAT4X4& a_projection,
+	float a_nearPlane,
+	float a_farPlane,
+	bool a_orthographic,
+	const XMFLOAT3& a_lightDirection,
+	const Double3& a_renderOrigin)
+{
+	m_cascadeCount = std::clamp(m_cascadeCount, 1u, MAX_CASCADES);
+	float splits[MAX_CASCADES + 1];
+	ComputeSplits(a_nearPlane, (std::max)((std::min)(a_farPlane, m_maxDistance), a_nearPlane * 2.0f), m_cascadeCount, m_splitLambda, splits);
+
+	XMMATRIX inverseView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&a_view));
+
+	XMVECTOR direction = XMVector3Normalize(XMLoadFloat3(&a_lightDirection));
+	XMFLOAT3 directionValues;
+	XMStoreFloat3(&directionValues, direction);
+	XMVECTOR up = std::fabs(directionValues.y) > 0.99f ? XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f) : XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
+
+	//light space without translation, the snapping grid lives here
+	XMMATRIX lightRotation = XMMatrixLookToLH(XMVectorZero(), direction, up);
+	XMMATRIX inverseLightRotation = XMMatrixTranspose(lightRotation);
+	XMFLOAT4X4 rotation;
+	XMStoreFloat4x4(&rotation, lightRotation);
+
+	//render origin in light space, in double so far away worlds still snap exactly
+	double originX = a_renderOrigin.x * rotation._11 + a_renderOrigin.y * rotation._21 + a_renderOrigin.z * rotation._31;
+	double originY = a_renderOrigin.x * rotation._12 + a_renderOrigin.y * rotation._22 + a_renderOrigin.z * rotation._32;
+
+	for (uint32_t i = 0; i < m_cascadeCount; i++) {
+		ShadowCascade& cascade = m_cascades[i];
+		cascade.m_nearDepth = splits[i];
+		cascade.m_farDepth = splits[i + 1];
+
+		//the slice only depends on the projection, so its sphere keeps its size while the camera turns
+		float centerDepth = (cascade.m_nearDepth + cascade.m_farDepth) * 0.5f;
+		float radius = 0.0f;
+		for (float depth : { cascade.m_nearDepth, cascade.m_farDepth }) {
+			float halfWidth = (a_orthographic ? 1.0f : depth) / a_projection._11;
+			float halfHeight = (a_orthographic ? 1.0f : depth) / a_projection._22;
+			float offset = depth - centerDepth;
+			radius = (std::max)(radius, std::sqrt(halfWidth * halfWidth + halfHeight * halfHeight + offset * offset));
+		}
+		radius = std::ceil(radius * 16.0f) / 16.0f;
+
+		XMVECTOR center = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, centerDepth, 1.0f), inverseView);
+
+		//move the center to whole texels of the absolute light space grid
+		double texel = 2.0 * radius / m_resolution;
+		XMFLOAT3 lightCenter;
+		XMStoreFloat3(&lightCenter, XMVector3TransformCoord(center, lightRotation));
+		lightCenter.x = static_cast<float>(std::floor((lightCenter.x + originX) / texel) * texel - originX);
+		lightCenter.y = static_cast<float>(std::floor((lightCenter.y + originY) / texel) * texel - originY);
+		center = XMVector3TransformCoord(XMLoadFloat3(&lightCenter), inverseLightRotation);
+
+		XMVECTOR eye = XMVectorSubtract(center, XMVectorScale(direction, radius + m_casterDistance));
+		XMMATRIX view = XMMatrixLookToLH(eye, direction, up);
+		XMMATRIX projection = XMMatrixOrthographicLH(2.0f * radius, 2.0f * radius, 0.0f, 2.0f * radius + m_casterDistance);
+
+		XMStoreFloat3(&cascade.m_center, center);
+		cascade.m_radius = radius;
+		XMStoreFloat4x4(&cascade.m_view, view);
+		XMStoreFloat4x4(&cascade.m_projection, projection);
+		XMStoreFloat4x4(&cascade.m_viewProjection, XMMatrixMultiply(view, projection));
+		m_frustums[i].ExtractPlanes(cascade.m_viewProjection);
+	}
+}
+
+void ShadowCascades::CullCasters(uint32_t a_cascade, const BoundsSoA& a_bounds, std::vector<uint32_t>& a_casters) const
+{
+	m_frustums[a_cascade].Cull(a_bounds, a_casters);
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <DirectXMath.h>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "Bounds.h"
+#include "Double3.h"
+#include "Frustum.h"
+
+/// <summary>
+/// One slice of the camera frustum and the light matrices covering it
+/// </summary>
+struct ShadowCascade
+{
+	DirectX::XMFLOAT4X4 m_view;
+	DirectX::XMFLOAT4X4 m_projection;
+	DirectX::XMFLOAT4X4 m_viewProjection;
+
+	//camera view depth range this cascade is used for
+	float m_nearDepth = 0.0f;
+	float m_farDepth = 0.0f;
+
+	//sphere around the slice, relative to the render origin
+	DirectX::XMFLOAT3 m_center = { 0.0f, 0.0f, 0.0f };
+	float m_radius = 0.0f;
+};
+
+/// <summary>
+/// Cascade partitioning and fitting for a directional light.
+/// Splits blend logarithmic and uniform spacing, each slice is wrapped in a
+/// sphere so its size doesn't change as the camera turns, and the light space
+/// origin is snapped to whole shadow map texels in absolute world space so
+/// edges don't shimmer while the camera moves.
+/// Knows nothing about D3D, everything is plain matrices and bounds.
+/// </summary>
+class ShadowCascades
+{
+public:
+	static constexpr uint32_t MAX_CASCADES = 4;
+
+	/// <summary>
+	/// a_count + 1 depths from a_near to a_far, a_lambda 0 is uniform and 1 is logarithmic
+	/// </summary>
+	static void ComputeSplits(float a_near, float a_far, uint32_t a_count, float a_lambda, float* a_splits);
+
+	/// <summary>
+	/// Fits every cascade to the camera, a_view is relative to a_renderOrigin like the rest
+	/// of the frame. a_lightDirection is the direction the light travels.
+	/// </summary>
+	void Fit(
+		const DirectX::XMFLOAT4X4& a_view,
+		const DirectX::XMFLOAT4X4& a_projection,
+		float a_nearPlane,
+		float a_farPlane,
+		bool a_orthographic,
+		const DirectX::XMFLOAT3& a_lightDirection,
+		const Double3& a_renderOrigin);
+
+	/// <summary>
+	/// Indices of the bounds that can cast into a cascade, anything between the
+	/// light and the cascade counts since the near plane is pulled back to it
+	/// </summary>
+	void CullCasters(uint32_t a_cascade, const BoundsSoA& a_bounds, std::vector<uint32_t>& a_casters) const;
+
+	const ShadowCascade& GetCascade(uint32_t a_cascade) const { return m_cascades[a_cascade]; }
+	uint32_t GetCascadeCount() const { return m_cascadeCount; }
+
+	//settings, read by the next Fit
+	uint32_t m_cascadeCount = MAX_CASCADES;
+	float m_splitLambda = 0.75f;
+	uint32_t m_resolution = 2048;
+
+	//cascades stop here even if the camera sees further
+	float m_maxDistance = 150.0f;
+
+	//how far behind a cascade casters are still rendered
+	float m_casterDistance = 100.0f;
+
+private:
+	std::array<ShadowCascade, MAX_CASCADES> m_cascades;
+	std::array<Frustum, MAX_CASCADES> m_frustums;
+};
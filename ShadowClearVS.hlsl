@@ -0,0 +1,10 @@
+// --------------------------------------------------------
+// Clears one shadow atlas tile. Depth clears ignore the viewport,
+// so a triangle covering the viewport is drawn at the far plane
+// with the depth test set to always pass.
+// --------------------------------------------------------
+float4 main(uint vertexId : SV_VertexID) : SV_POSITION
+{
+    float2 uv = float2((vertexId << 1) & 2, vertexId & 2);
+    return float4(uv * float2(2.0f, -2.0f) + float2(-1.0f, 1.0f), 1.0f, 1.0f);
+}
@@ -0,0 +1,75 @@
+#include "ShadowMap.h"
+#include "Graphics.h"
+
+void ShadowMap::Create(unsigned int a_resolution, unsigned int a_sliceCount)
+{
+	//the bias lives in the rasterizer state, rebuild it on its own when tweaked
+	if (!m_pRasterizerState || m_depthBias != m_createdDepthBias || m_slopeScaledDepthBias != m_createdSlopeScaledDepthBias) {
+		m_pRasterizerState.Reset();
+		D3D11_RASTERIZER_DESC rasterizerDesc = {};
+		rasterizerDesc.FillMode = D3D11_FILL_SOLID;
+		rasterizerDesc.CullMode = D3D11_CULL_BACK;
+		//casters behind the light's near plane are flattened onto it instead of clipped
+		rasterizerDesc.DepthClipEnable = false;
+		rasterizerDesc.DepthBias = m_depthBias;
+		rasterizerDesc.SlopeScaledDepthBias = m_slopeScaledDepthBias;
+		Graphics::Device->CreateRasterizerState(&rasterizerDesc, m_pRasterizerState.GetAddressOf());
+		m_createdDepthBias = m_depthBias;
+		m_createdSlopeScaledDepthBias = m_slopeScaledDepthBias;
+	}
+
+	if (!m_pComparisonSampler) {
+		//outside the map counts as lit
+		D3D11_SAMPLER_DESC samplerDesc = {};
+		samplerDesc.Filter = D3D11_FILTER_COMPARISON_MIN_MAG_LINEAR_MIP_POINT;
+		samplerDesc.AddressU = D3D11_TEXTURE_ADDRESS_BORDER;
+		samplerDesc.AddressV = D3D11_TEXTURE_ADDRESS_BORDER;
+		samplerDesc.AddressW = D3D11_TEXTURE_ADDRESS_BORDER;
+		samplerDesc.BorderColor[0] = 1.0f;
+		samplerDesc.BorderColor[1] = 1.0f;
+		samplerDesc.BorderColor[2] = 1.0f;
+		samplerDesc.BorderColor[3] = 1.0f;
+		samplerDesc.ComparisonFunc = D3D11_COMPARISON_LESS_EQUAL;
+		samplerDesc.MaxLOD = D3D11_FLOAT32_MAX;
+		Graphics::Device->CreateSamplerState(&samplerDesc, m_pComparisonSampler.GetAddressOf());
+	}
+
+	if (m_pTexture && a_resolution == m_resolution && a_sliceCount == m_sliceCount) return;
+	m_resolution = a_resolution;
+	m_sliceCount = a_sliceCount;
+	m_pTexture.Reset();
+	m_pSRV.Reset();
+	m_DSVs.clear();
+
+	//typeless so the same memory can be a depth target and a float texture
+	D3D11_TEXTURE2D_DESC textureDesc = {};
+	textureDesc.Width = a_resolution;
+	textureDesc.Height = a_resolution;
+	textureDesc.MipLevels = 1;
+	textureDesc.ArraySize = a_sliceCount;
+	textureDesc.Format = DXGI_FORMAT_R32_TYPELESS;
+	textureDesc.SampleDesc.Count = 1;
+	textureDesc.Usage = D3D11_USAGE_DEFAULT;
+	textureDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL | D3D11_BIND_SHADER_RESOURCE;
+	Graphics::Device->CreateTexture2D(&textureDesc, 0, m_pTexture.GetAddressOf());
+
+	m_DSVs.resize(a_sliceCount);
+	for (unsigned int i = 0; i < a_sliceCount; i++) {
+		D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc = {};
+		dsvDesc.Format = DXGI_FORMAT_D32_FLOAT;
+		dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+		dsvDesc.Texture2DArray.MipSlice = 0;
+		dsvDesc.Texture2DArray.FirstArraySlice = i;
+		dsvDesc.Texture2DArray.ArraySize = 1;
+		Graphics::Device->CreateDepthStencilView(m_pTexture.Get(), &dsvDesc, m_DSVs[i].GetAddressOf());
+	}
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_R32_FLOAT;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	srvDesc.Texture2DArray.MostDetailedMip = 0;
+	srvDesc.Texture2DArray.MipLevels = 1;
+	srvDesc.Texture2DArray.FirstArraySlice = 0;
+	srvDesc.Texture2DArray.ArraySize = a_sliceCount;
+	Graphics::Device->CreateShaderResourceView(m_pTexture.Get(), &srvDesc, m_pSRV.GetAddressOf());
+}
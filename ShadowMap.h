@@ -0,0 +1,48 @@
+#pragma once
+#include <d3d11.h>
+#include <wrl/client.h>
+#include <vector>
+
+//pixel shader registers of the cascade depth maps and their constants
+inline constexpr unsigned int SHADOW_MAP_SLOT = 8;
+inline constexpr unsigned int SHADOW_SAMPLER_SLOT = 2;
+inline constexpr unsigned int SHADOW_CONSTANT_BUFFER_SLOT = 2;
+
+/// <summary>
+/// Depth texture array with one slice per shadow cascade, written through a
+/// depth view per slice and read back through one array view with a
+/// comparison sampler for hardware PCF.
+/// </summary>
+class ShadowMap
+{
+public:
+	/// <summary>
+	/// (Re)creates the array, does nothing if the size and slice count already match
+	/// </summary>
+	void Create(unsigned int a_resolution, unsigned int a_sliceCount);
+
+	ID3D11Texture2D* GetTexture() const { return m_pTexture.Get(); }
+	ID3D11DepthStencilView* GetDSV(unsigned int a_slice) const { return m_DSVs[a_slice].Get(); }
+	ID3D11ShaderResourceView* GetSRV() const { return m_pSRV.Get(); }
+	ID3D11SamplerState* GetComparisonSampler() const { return m_pComparisonSampler.Get(); }
+	ID3D11RasterizerState* GetRasterizerState() const { return m_pRasterizerState.Get(); }
+
+	unsigned int GetResolution() const { return m_resolution; }
+	unsigned int GetSliceCount() const { return m_sliceCount; }
+
+	//slope scaled bias of the depth pass, read by the next Create
+	int m_depthBias = 1000;
+	float m_slopeScaledDepthBias = 2.0f;
+
+private:
+	unsigned int m_resolution = 0;
+	unsigned int m_sliceCount = 0;
+	int m_createdDepthBias = 0;
+	float m_createdSlopeScaledDepthBias = 0.0f;
+
+	Microsoft::WRL::ComPtr<ID3D11Texture2D> m_pTexture;
+	std::vector<Microsoft::WRL::ComPtr<ID3D11DepthStencilView>> m_DSVs;
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_pSRV;
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> m_pComparisonSampler;
+	Microsoft::WRL::ComPtr<ID3D11RasterizerState> m_pRasterizerState;
+};
@@ -81,30 +81,32 @@ Sky::~Sky()
 {
 }
 
-void Sky::Draw(std::shared_ptr<Camera> a_pCamera) {
-	Graphics::Context->RSSetState(m_pRasterizer.Get());
-	Graphics::Context->OMSetDepthStencilState(m_pDepthStencil.Get(), 0);
-	Graphics::Context->VSSetShader(m_pVertexShader.Get(), 0, 0);
-	Graphics::Context->PSSetShader(m_pPixelShader.Get(), 0, 0);
+ID3D11ShaderResourceView* Sky::GetSRV() const
+{
+	return m_pSRV.Get();
+}
+
+void Sky::Draw(std::shared_ptr<Camera> a_pCamera, RenderCommandList& a_commands) {
+	a_commands.SetRenderState(m_pRasterizer.Get(), m_pDepthStencil.Get());
+	a_commands.BindPipeline(m_pVertexShader.Get(), m_pPixelShader.Get());
 
-	Graphics::Context->PSSetSamplers(0, 1, m_pSampler.GetAddressOf());
-	Graphics::Context->PSSetShaderResources(0, 1, m_pSRV.GetAddressOf());
+	a_commands.BindSampler(RenderCommand::Stage::PIXEL, 0, m_pSampler.Get());
+	a_commands.BindShaderResource(RenderCommand::Stage::PIXEL, 0, m_pSRV.Get());
 
 	m_skyBuffer.m_projectionMatrix = a_pCamera->GetProjectionMatrix();
 	m_skyBuffer.m_viewMatrix = a_pCamera->GetViewMatrix();
 	//Vertex Cbuffer
-	Graphics::FillAndBindNextConstantBuffer(
+	a_commands.UpdateConstantBuffer(
+		RenderCommand::Stage::VERTEX,
+		0,
 		&m_skyBuffer,
-		sizeof(SkyVSConstantBuffer),
-		D3D11_VERTEX_SHADER,
-		0
+		sizeof(SkyVSConstantBuffer)
 	);
 
-	m_pMesh->Draw();
+	m_pMesh->Draw(a_commands);
 
-	//reset
-	Graphics::Context->RSSetState(0);
-	Graphics::Context->OMSetDepthStencilState(0, 0);
+	//reset, entities expect the default states
+	a_commands.SetRenderState(nullptr, nullptr);
 }
 
 // --------------------------------------------------------
@@ -34,6 +34,9 @@ class Sky
 		const wchar_t* front,
 		const wchar_t* back);
 public:
+	//pixel shader register of the cube for the lit shader's IBL variants, after the local shadow atlas
+	static constexpr unsigned int SHADER_SLOT = 11;
+
 	Sky();
 	Sky(
 		std::shared_ptr<Mesh> a_pMesh,
@@ -47,6 +50,7 @@ public:
 		std::wstring a_skyPixelShaderFilePath,
 		Microsoft::WRL::ComPtr<ID3D11SamplerState> a_pSamplerState);
 	~Sky();
-	void Draw(std::shared_ptr<Camera> a_pCamera);
+	void Draw(std::shared_ptr<Camera> a_pCamera, RenderCommandList& a_commands);
+	ID3D11ShaderResourceView* GetSRV() const;
 };
 
@@ -0,0 +1,95 @@
+#pragma once
+#include <DirectXMath.h>
+#include <array>
+
+/// <summary>
+/// Order 2 spherical harmonics, nine coefficients with an RGB value each.
+/// Radiance is projected in with AddSample, ConvolvedWithCosine turns it into
+/// irradiance divided by pi so Evaluate(normal) times albedo is the diffuse light.
+/// Same layout as ObjectIrradiance in PixelShader.hlsl, 108 bytes.
+/// </summary>
+struct SphericalHarmonicsL2
+{
+	static constexpr int COEFFICIENT_COUNT = 9;
+
+	std::array<DirectX::XMFLOAT3, COEFFICIENT_COUNT> m_coefficients = {};
+
+	/// <summary>
+	/// Real basis functions at a normalized direction, same order and constants as the shader
+	/// </summary>
+	static void EvaluateBasis(const DirectX::XMFLOAT3& a_direction, float* a_basis)
+	{
+		const float x = a_direction.x;
+		const float y = a_direction.y;
+		const float z = a_direction.z;
+		a_basis[0] = 0.282095f;
+		a_basis[1] = 0.488603f * y;
+		a_basis[2] = 0.488603f * z;
+		a_basis[3] = 0.488603f * x;
+		a_basis[4] = 1.092548f * x * y;
+		a_basis[5] = 1.092548f * y * z;
+		a_basis[6] = 0.315392f * (3.0f * z * z - 1.0f);
+		a_basis[7] = 1.092548f * x * z;
+		a_basis[8] = 0.546274f * (x * x - y * y);
+	}
+
+	/// <summary>
+	/// Adds a_value arriving from a_direction, a_weight is the sample's solid angle
+	/// </summary>
+	void AddSample(const DirectX::XMFLOAT3& a_direction, const DirectX::XMFLOAT3& a_value, float a_weight)
+	{
+		float basis[COEFFICIENT_COUNT];
+		EvaluateBasis(a_direction, basis);
+		for (int i = 0; i < COEFFICIENT_COUNT; i++) {
+			m_coefficients[i].x += a_value.x * basis[i] * a_weight;
+			m_coefficients[i].y += a_value.y * basis[i] * a_weight;
+			m_coefficients[i].z += a_value.z * basis[i] * a_weight;
+		}
+	}
+
+	void Add(const SphericalHarmonicsL2& a_other, float a_weight)
+	{
+		for (int i = 0; i < COEFFICIENT_COUNT; i++) {
+			m_coefficients[i].x += a_other.m_coefficients[i].x * a_weight;
+			m_coefficients[i].y += a_other.m_coefficients[i].y * a_weight;
+			m_coefficients[i].z += a_other.m_coefficients[i].z * a_weight;
+		}
+	}
+
+	void Scale(float a_scale)
+	{
+		for (DirectX::XMFLOAT3& coefficient : m_coefficients) {
+			coefficient.x *= a_scale;
+			coefficient.y *= a_scale;
+			coefficient.z *= a_scale;
+		}
+	}
+
+	/// <summary>
+	/// Radiance to irradiance over pi, the clamped cosine lobe scales band l by 1, 2/3 and 1/4
+	/// </summary>
+	SphericalHarmonicsL2 ConvolvedWithCosine() const
+	{
+		static constexpr float bandScale[COEFFICIENT_COUNT] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+		SphericalHarmonicsL2 result;
+		for (int i = 0; i < COEFFICIENT_COUNT; i++) {
+			result.m_coefficients[i].x = m_coefficients[i].x * bandScale[i];
+			result.m_coefficients[i].y = m_coefficients[i].y * bandScale[i];
+			result.m_coefficients[i].z = m_coefficients[i].z * bandScale[i];
+		}
+		return result;
+	}
+
+	DirectX::XMFLOAT3 Evaluate(const DirectX::XMFLOAT3& a_direction) const
+	{
+		float basis[COEFFICIENT_COUNT];
+		EvaluateBasis(a_direction, basis);
+		DirectX::XMFLOAT3 result(0.0f, 0.0f, 0.0f);
+		for (int i = 0; i < COEFFICIENT_COUNT; i++) {
+			result.x += m_coefficients[i].x * basis[i];
+			result.y += m_coefficients[i].y * basis[i];
+			result.z += m_coefficients[i].z * basis[i];
+		}
+		return result;
+	}
+};
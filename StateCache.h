@@ -0,0 +1,313 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <cstddef>
+#include <d3d11.h>
+
+/// <summary>
+/// Shadows the pipeline state bound through it and drops calls that would
+/// set what is already bound. Templated on the context so the filtering can
+/// be driven by a mock that only records calls.
+/// Anything that binds state behind its back (ImGui, another context)
+/// must be followed by Invalidate().
+/// </summary>
+template <typename TContext>
+class StateCache
+{
+public:
+	enum Category
+	{
+		SHADERS,
+		SHADER_RESOURCES,
+		SAMPLERS,
+		CONSTANT_BUFFERS,
+		INPUT_ASSEMBLER,
+		PIPELINE_STATES,
+		CATEGORY_COUNT
+	};
+
+	struct Counters
+	{
+		std::array<uint32_t, CATEGORY_COUNT> m_issued = {};
+		std::array<uint32_t, CATEGORY_COUNT> m_skipped = {};
+
+		uint32_t TotalIssued() const
+		{
+			uint32_t total = 0;
+			for (uint32_t count : m_issued) total += count;
+			return total;
+		}
+
+		uint32_t TotalSkipped() const
+		{
+			uint32_t total = 0;
+			for (uint32_t count : m_skipped) total += count;
+			return total;
+		}
+	};
+
+	//slots past these are passed straight through
+	static constexpr unsigned int SHADER_RESOURCE_SLOTS = 16;
+	static constexpr unsigned int SAMPLER_SLOTS = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+	static constexpr unsigned int CONSTANT_BUFFER_SLOTS = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+
+	void SetContext(TContext* a_pContext)
+	{
+		m_pContext = a_pContext;
+		Invalidate();
+	}
+
+	/// <summary>
+	/// Forgets everything, the next call for each piece of state is always issued
+	/// </summary>
+	void Invalidate()
+	{
+		m_vertexShader = {};
+		m_pixelShader = {};
+		m_vertexShaderResources = {};
+		m_pixelShaderResources = {};
+		m_pixelSamplers = {};
+		m_vertexConstantBuffers = {};
+		m_pixelConstantBuffers = {};
+		m_inputLayout = {};
+		m_topology = {};
+		m_vertexBuffer = {};
+		m_indexBuffer = {};
+		m_rasterizerState = {};
+		m_depthStencilState = {};
+	}
+
+	void ResetCounters() { m_counters = Counters(); }
+	const Counters& GetCounters() const { return m_counters; }
+
+	/// <summary>
+	/// Folds in counts from another cache, e.g. one that recorded on a deferred context
+	/// </summary>
+	void AddCounters(const Counters& a_counters)
+	{
+		for (int i = 0; i < CATEGORY_COUNT; i++) {
+			m_counters.m_issued[i] += a_counters.m_issued[i];
+			m_counters.m_skipped[i] += a_counters.m_skipped[i];
+		}
+	}
+
+	/// <summary>
+	/// The context calls are forwarded to, for draws and anything not shadowed
+	/// </summary>
+	TContext* GetContext() const { return m_pContext; }
+
+	void VSSetShader(ID3D11VertexShader* a_pShader)
+	{
+		if (Filter(m_vertexShader, a_pShader, SHADERS)) m_pContext->VSSetShader(a_pShader, 0, 0);
+	}
+
+	void PSSetShader(ID3D11PixelShader* a_pShader)
+	{
+		if (Filter(m_pixelShader, a_pShader, SHADERS)) m_pContext->PSSetShader(a_pShader, 0, 0);
+	}
+
+	void VSSetShaderResource(unsigned int a_slot, ID3D11ShaderResourceView* a_pView)
+	{
+		if (Filter(SlotShadow(m_vertexShaderResources, a_slot), a_pView, SHADER_RESOURCES)) {
+			m_pContext->VSSetShaderResources(a_slot, 1, &a_pView);
+		}
+	}
+
+	void PSSetShaderResource(unsigned int a_slot, ID3D11ShaderResourceView* a_pView)
+	{
+		if (Filter(SlotShadow(m_pixelShaderResources, a_slot), a_pView, SHADER_RESOURCES)) {
+			m_pContext->PSSetShaderResources(a_slot, 1, &a_pView);
+		}
+	}
+
+	void PSSetSampler(unsigned int a_slot, ID3D11SamplerState* a_pSampler)
+	{
+		if (Filter(SlotShadow(m_pixelSamplers, a_slot), a_pSampler, SAMPLERS)) {
+			m_pContext->PSSetSamplers(a_slot, 1, &a_pSampler);
+		}
+	}
+
+	/// <summary>
+	/// Binds a_count contiguous slots in one call, issued whole when any of them changed
+	/// </summary>
+	void PSSetShaderResources(unsigned int a_firstSlot, unsigned int a_count, ID3D11ShaderResourceView* const* a_ppViews)
+	{
+		if (FilterRange(m_pixelShaderResources, a_firstSlot, a_count, a_ppViews, SHADER_RESOURCES)) {
+			m_pContext->PSSetShaderResources(a_firstSlot, a_count, a_ppViews);
+		}
+	}
+
+	void PSSetSamplers(unsigned int a_firstSlot, unsigned int a_count, ID3D11SamplerState* const* a_ppSamplers)
+	{
+		if (FilterRange(m_pixelSamplers, a_firstSlot, a_count, a_ppSamplers, SAMPLERS)) {
+			m_pContext->PSSetSamplers(a_firstSlot, a_count, a_ppSamplers);
+		}
+	}
+
+	/// <summary>
+	/// Binds a range of a constant buffer, in 16 byte constants
+	/// </summary>
+	void VSSetConstantBuffer(unsigned int a_slot, ID3D11Buffer* a_pBuffer, unsigned int a_firstConstant, unsigned int a_numConstants)
+	{
+		ConstantBufferRange range = { a_pBuffer, a_firstConstant, a_numConstants };
+		if (Filter(SlotShadow(m_vertexConstantBuffers, a_slot), range, CONSTANT_BUFFERS)) {
+			m_pContext->VSSetConstantBuffers1(a_slot, 1, &a_pBuffer, &a_firstConstant, &a_numConstants);
+		}
+	}
+
+	void PSSetConstantBuffer(unsigned int a_slot, ID3D11Buffer* a_pBuffer, unsigned int a_firstConstant, unsigned int a_numConstants)
+	{
+		ConstantBufferRange range = { a_pBuffer, a_firstConstant, a_numConstants };
+		if (Filter(SlotShadow(m_pixelConstantBuffers, a_slot), range, CONSTANT_BUFFERS)) {
+			m_pContext->PSSetConstantBuffers1(a_slot, 1, &a_pBuffer, &a_firstConstant, &a_numConstants);
+		}
+	}
+
+	void IASetInputLayout(ID3D11InputLayout* a_pInputLayout)
+	{
+		if (Filter(m_inputLayout, a_pInputLayout, INPUT_ASSEMBLER)) m_pContext->IASetInputLayout(a_pInputLayout);
+	}
+
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY a_topology)
+	{
+		if (Filter(m_topology, a_topology, INPUT_ASSEMBLER)) m_pContext->IASetPrimitiveTopology(a_topology);
+	}
+
+	/// <summary>
+	/// Only slot 0 is shadowed, every mesh uses a single interleaved stream
+	/// </summary>
+	void IASetVertexBuffer(ID3D11Buffer* a_pBuffer, unsigned int a_stride, unsigned int a_offset)
+	{
+		VertexBufferBinding binding = { a_pBuffer, a_stride, a_offset };
+		if (Filter(m_vertexBuffer, binding, INPUT_ASSEMBLER)) {
+			m_pContext->IASetVertexBuffers(0, 1, &a_pBuffer, &a_stride, &a_offset);
+		}
+	}
+
+	void IASetIndexBuffer(ID3D11Buffer* a_pBuffer, DXGI_FORMAT a_format, unsigned int a_offset)
+	{
+		IndexBufferBinding binding = { a_pBuffer, a_format, a_offset };
+		if (Filter(m_indexBuffer, binding, INPUT_ASSEMBLER)) m_pContext->IASetIndexBuffer(a_pBuffer, a_format, a_offset);
+	}
+
+	void RSSetState(ID3D11RasterizerState* a_pState)
+	{
+		if (Filter(m_rasterizerState, a_pState, PIPELINE_STATES)) m_pContext->RSSetState(a_pState);
+	}
+
+	void OMSetDepthStencilState(ID3D11DepthStencilState* a_pState, unsigned int a_stencilRef)
+	{
+		DepthStencilBinding binding = { a_pState, a_stencilRef };
+		if (Filter(m_depthStencilState, binding, PIPELINE_STATES)) m_pContext->OMSetDepthStencilState(a_pState, a_stencilRef);
+	}
+
+private:
+	//null is a real binding, so unknown needs its own flag
+	template <typename T>
+	struct Shadowed
+	{
+		T m_value = {};
+		bool m_known = false;
+	};
+
+	struct ConstantBufferRange
+	{
+		ID3D11Buffer* m_pBuffer;
+		unsigned int m_firstConstant;
+		unsigned int m_numConstants;
+		bool operator==(const ConstantBufferRange&) const = default;
+	};
+
+	struct VertexBufferBinding
+	{
+		ID3D11Buffer* m_pBuffer;
+		unsigned int m_stride;
+		unsigned int m_offset;
+		bool operator==(const VertexBufferBinding&) const = default;
+	};
+
+	struct IndexBufferBinding
+	{
+		ID3D11Buffer* m_pBuffer;
+		DXGI_FORMAT m_format;
+		unsigned int m_offset;
+		bool operator==(const IndexBufferBinding&) const = default;
+	};
+
+	struct DepthStencilBinding
+	{
+		ID3D11DepthStencilState* m_pState;
+		unsigned int m_stencilRef;
+		bool operator==(const DepthStencilBinding&) const = default;
+	};
+
+	TContext* m_pContext = nullptr;
+	Counters m_counters;
+
+	Shadowed<ID3D11VertexShader*> m_vertexShader;
+	Shadowed<ID3D11PixelShader*> m_pixelShader;
+	std::array<Shadowed<ID3D11ShaderResourceView*>, SHADER_RESOURCE_SLOTS> m_vertexShaderResources;
+	std::array<Shadowed<ID3D11ShaderResourceView*>, SHADER_RESOURCE_SLOTS> m_pixelShaderResources;
+	std::array<Shadowed<ID3D11SamplerState*>, SAMPLER_SLOTS> m_pixelSamplers;
+	std::array<Shadowed<ConstantBufferRange>, CONSTANT_BUFFER_SLOTS> m_vertexConstantBuffers;
+	std::array<Shadowed<ConstantBufferRange>, CONSTANT_BUFFER_SLOTS> m_pixelConstantBuffers;
+	Shadowed<ID3D11InputLayout*> m_inputLayout;
+	Shadowed<D3D11_PRIMITIVE_TOPOLOGY> m_topology;
+	Shadowed<VertexBufferBinding> m_vertexBuffer;
+	Shadowed<IndexBufferBinding> m_indexBuffer;
+	Shadowed<ID3D11RasterizerState*> m_rasterizerState;
+	Shadowed<DepthStencilBinding> m_depthStencilState;
+
+	/// <summary>
+	/// Records a_value as bound, returns false when it already was and the call can be dropped
+	/// </summary>
+	template <typename T>
+	bool Filter(Shadowed<T>& a_shadow, const T& a_value, Category a_category)
+	{
+		return Filter(&a_shadow, a_value, a_category);
+	}
+
+	//a null shadow is an untracked slot, always issued
+	template <typename T>
+	bool Filter(Shadowed<T>* a_pShadow, const T& a_value, Category a_category)
+	{
+		if (a_pShadow != nullptr && a_pShadow->m_known && a_pShadow->m_value == a_value) {
+			m_counters.m_skipped[a_category]++;
+			return false;
+		}
+		if (a_pShadow != nullptr) {
+			a_pShadow->m_value = a_value;
+			a_pShadow->m_known = true;
+		}
+		m_counters.m_issued[a_category]++;
+		return true;
+	}
+
+	/// <summary>
+	/// Filter for a range of slots, counted as one call
+	/// </summary>
+	template <typename T, size_t Count>
+	bool FilterRange(std::array<Shadowed<T>, Count>& a_slots, unsigned int a_firstSlot, unsigned int a_count, const T* a_values, Category a_category)
+	{
+		bool changed = false;
+		for (unsigned int i = 0; i < a_count; i++) {
+			Shadowed<T>* shadow = SlotShadow(a_slots, a_firstSlot + i);
+			if (shadow != nullptr && shadow->m_known && shadow->m_value == a_values[i]) continue;
+			if (shadow != nullptr) {
+				shadow->m_value = a_values[i];
+				shadow->m_known = true;
+			}
+			changed = true;
+		}
+
+		if (changed) m_counters.m_issued[a_category]++;
+		else m_counters.m_skipped[a_category]++;
+		return changed;
+	}
+
+	template <typename T, size_t Count>
+	static Shadowed<T>* SlotShadow(std::array<Shadowed<T>, Count>& a_slots, unsigned int a_slot)
+	{
+		return a_slot < Count ? &a_slots[a_slot] : nullptr;
+	}
+};
@@ -0,0 +1,96 @@
+#include "Bvh.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	template <typename Function>
+	double TimeMs(Function a_function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		a_function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Run(int a_objectCount, const Frustum& a_frustum)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+		std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+		std::vector<Bounds> bounds(a_objectCount);
+		BoundsSoA boundsSoA;
+		boundsSoA.Reserve(a_objectCount);
+		for (Bounds& box : bounds) {
+			XMFLOAT3 center(position(random), position(random), position(random));
+			float halfSize = size(random);
+			box = Bounds::FromMinMax(
+				XMFLOAT3(center.x - halfSize, center.y - halfSize, center.z - halfSize),
+				XMFLOAT3(center.x + halfSize, center.y + halfSize, center.z + halfSize));
+			boundsSoA.Add(box);
+		}
+
+		Bvh bvh;
+		double buildMs = TimeMs([&]() { bvh.Build(bounds); });
+
+		//everything drifts a little, worst case for a refit
+		for (Bounds& box : bounds) box.m_center.y += 1.0f;
+		double refitMs = TimeMs([&]() { bvh.Refit(bounds); });
+		for (Bounds& box : bounds) box.m_center.y -= 1.0f;
+		bvh.Refit(bounds);
+
+		std::vector<uint32_t> results;
+		results.reserve(a_objectCount);
+		double frustumMs = TimeMs([&]() { bvh.QueryFrustum(a_frustum, results); });
+		double frustumBruteForceMs = TimeMs([&]() { a_frustum.Cull(boundsSoA, results); });
+
+		XMFLOAT3 sphereCenter(0.0f, 0.0f, 0.0f);
+		float sphereRadius = 50.0f;
+		double sphereMs = TimeMs([&]() { bvh.QuerySphere(sphereCenter, sphereRadius, results); });
+		double sphereBruteForceMs = TimeMs([&]() {
+			results.clear();
+			for (uint32_t i = 0; i < bounds.size(); i++) {
+				const Bounds& box = bounds[i];
+				float x = (std::max)(std::fabs(sphereCenter.x - box.m_center.x) - box.m_extents.x, 0.0f);
+				float y = (std::max)(std::fabs(sphereCenter.y - box.m_center.y) - box.m_extents.y, 0.0f);
+				float z = (std::max)(std::fabs(sphereCenter.z - box.m_center.z) - box.m_extents.z, 0.0f);
+				if (x * x + y * y + z * z <= sphereRadius * sphereRadius) results.push_back(i);
+			}
+		});
+
+		//average over a batch of random rays
+		const int rayCount = 1000;
+		double rayMs = TimeMs([&]() {
+			for (int i = 0; i < rayCount; i++) {
+				XMFLOAT3 origin(position(random), position(random), position(random));
+				XMFLOAT3 direction(position(random), position(random), position(random));
+				uint32_t hitObject = 0;
+				float hitDistance = 0.0f;
+				bvh.Raycast(origin, direction, 1.0f, hitObject, hitDistance);
+			}
+		}) / rayCount;
+
+		printf("%8d %9.2f %9.2f %9.3f %9.3f %9.3f %9.3f %9.4f\n", a_objectCount,
+			buildMs, refitMs, frustumMs, frustumBruteForceMs, sphereMs, sphereBruteForceMs, rayMs);
+	}
+}
+
+/// <summary>
+/// Build, refit and query timings of the BVH against brute force
+/// at 10k, 100k and 1M random boxes, all in milliseconds
+/// </summary>
+int main()
+{
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 2.0f, -10.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(XM_PIDIV2 * 0.75f, 16.0f / 9.0f, 0.1f, 1000.0f)));
+	Frustum frustum;
+	frustum.ExtractPlanes(viewProjection);
+
+	printf(" Objects     Build     Refit   Frustum     Brute    Sphere     Brute       Ray\n");
+	for (int objectCount : { 10000, 100000, 1000000 }) Run(objectCount, frustum);
+	return 0;
+}
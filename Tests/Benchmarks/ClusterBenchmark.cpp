@@ -0,0 +1,54 @@
+#include "LightClusters.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	void Run(int a_lightCount, unsigned int a_threads, const XMFLOAT4X4& a_projection, float a_nearPlane, float a_farPlane)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> side(-a_farPlane * 0.5f, a_farPlane * 0.5f);
+		std::uniform_real_distribution<float> depth(0.0f, a_farPlane);
+		std::uniform_real_distribution<float> range(1.0f, 6.0f);
+
+		std::vector<XMFLOAT4> spheres(a_lightCount);
+		for (XMFLOAT4& sphere : spheres) sphere = XMFLOAT4(side(random), side(random), depth(random), range(random));
+
+		LightClusters clusters;
+		clusters.m_maxThreads = a_threads;
+		clusters.SetProjection(a_projection, a_nearPlane, a_farPlane, false);
+
+		//first bin sizes the scratch buffers, the timed ones reuse them like a real frame
+		clusters.Bin(spheres);
+
+		const int iterations = 20;
+		auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < iterations; i++) clusters.Bin(spheres);
+		double binMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+		printf("%7d %7u %9.3f %9.2f %7u %9zu\n", a_lightCount, a_threads, binMs,
+			static_cast<double>(clusters.GetIndices().size()) / clusters.GetClusterCount(),
+			clusters.GetMaxLightsInCluster(), clusters.GetOverflowCount());
+	}
+}
+
+/// <summary>
+/// Bins random point lights in front of a 16x9x24 cluster grid, the
+/// scene's default, at 1k to 16k lights on one and four threads
+/// </summary>
+int main()
+{
+	const float nearPlane = 0.1f;
+	const float farPlane = 200.0f;
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, nearPlane, farPlane));
+
+	printf(" Lights Threads    Bin ms   Average     Max  Overflow\n");
+	for (int lightCount : { 1024, 4096, 16384 }) {
+		for (unsigned int threads : { 1u, 4u }) Run(lightCount, threads, projection, nearPlane, farPlane);
+	}
+	return 0;
+}
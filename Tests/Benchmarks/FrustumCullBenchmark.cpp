@@ -0,0 +1,57 @@
+#include "Frustum.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+/// <summary>
+/// Culls a million random boxes around a camera with the batched path and
+/// with one IntersectsBox call per box
+/// </summary>
+int main()
+{
+	const int objectCount = 1000000;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> size(0.5f, 4.0f);
+
+	std::vector<Bounds> boxes;
+	BoundsSoA bounds;
+	boxes.reserve(objectCount);
+	bounds.Reserve(objectCount);
+	for (int i = 0; i < objectCount; i++) {
+		XMFLOAT3 center(position(random), position(random), position(random));
+		float halfSize = size(random);
+		boxes.push_back(Bounds::FromMinMax(
+			XMFLOAT3(center.x - halfSize, center.y - halfSize, center.z - halfSize),
+			XMFLOAT3(center.x + halfSize, center.y + halfSize, center.z + halfSize)));
+		bounds.Add(boxes.back());
+	}
+
+	XMMATRIX view = XMMatrixLookToLH(XMVectorSet(0.0f, 2.0f, -10.0f, 0.0f), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(XM_PIDIV2 * 0.75f, 16.0f / 9.0f, 0.1f, 1000.0f)));
+	Frustum frustum;
+	frustum.ExtractPlanes(viewProjection);
+
+	std::vector<uint32_t> visible;
+	visible.reserve(objectCount);
+
+	const int iterations = 10;
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) frustum.Cull(bounds, visible);
+	double batchedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+	size_t singleVisible = 0;
+	start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++) {
+		singleVisible = 0;
+		for (const Bounds& box : boxes) singleVisible += frustum.IntersectsBox(box.m_center, box.m_extents) ? 1 : 0;
+	}
+	double singleMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / iterations;
+
+	printf("%d objects, %zu visible\n", objectCount, visible.size());
+	printf("batched: %.3fms, one at a time: %.3fms (%zu visible)\n", batchedMs, singleMs, singleVisible);
+	return 0;
+}
@@ -0,0 +1,81 @@
+#include "LightBvh.h"
+#include "LightClusters.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	template <typename Function>
+	double TimeMs(Function a_function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		a_function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Run(int a_lightCount, uint32_t a_budget)
+	{
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> range(2.0f, 10.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<Light> lights(a_lightCount);
+		for (Light& light : lights) {
+			light = {};
+			light.m_Type = unit(random) < 0.3f ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+			light.m_Position = XMFLOAT3(position(random), position(random) * 0.2f, position(random));
+			light.m_Direction = XMFLOAT3(unit(random) - 0.5f, -1.0f, unit(random) - 0.5f);
+			light.m_Range = range(random);
+			light.m_Intensity = unit(random) * 2.0f;
+			light.m_Color = XMFLOAT3(unit(random), unit(random), unit(random));
+			light.m_SpotOuterAngle = 0.6f;
+		}
+
+		LightBvh bvh;
+		double buildMs = TimeMs([&]() { bvh.Update(lights.data(), lights.size()); });
+		for (Light& light : lights) light.m_Position.x += 0.1f;
+		double refitMs = TimeMs([&]() { bvh.Update(lights.data(), lights.size()); });
+
+		//the scene's default grid, looking down +z from the middle of the lights
+		XMFLOAT4X4 projection, viewToWorld;
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 200.0f));
+		XMStoreFloat4x4(&viewToWorld, XMMatrixTranslation(0.0f, 2.0f, -100.0f));
+		LightClusters clusters;
+		clusters.SetProjection(projection, 0.1f, 200.0f, false);
+		clusters.SelectFromBvh(bvh, viewToWorld, a_budget);
+		double clusterMs = TimeMs([&]() { clusters.SelectFromBvh(bvh, viewToWorld, a_budget); });
+
+		LightBvh::QueryScratch scratch;
+		std::vector<uint32_t> selected;
+		std::vector<XMFLOAT3> boxMin(1000), boxMax(1000);
+		for (size_t i = 0; i < boxMin.size(); i++) {
+			XMFLOAT3 center(position(random), position(random) * 0.2f, position(random));
+			float halfSize = 0.5f + unit(random) * 4.0f;
+			boxMin[i] = XMFLOAT3(center.x - halfSize, center.y - halfSize, center.z - halfSize);
+			boxMax[i] = XMFLOAT3(center.x + halfSize, center.y + halfSize, center.z + halfSize);
+		}
+		double objectMs = TimeMs([&]() {
+			for (size_t i = 0; i < boxMin.size(); i++) bvh.QueryTopLights(boxMin[i], boxMax[i], 8, selected, scratch);
+		});
+		double bruteForceMs = TimeMs([&]() {
+			for (size_t i = 0; i < boxMin.size(); i++) bvh.FindTopLightsBruteForce(boxMin[i], boxMax[i], 8, selected);
+		});
+
+		printf("%7d %8.3f %8.3f %11.3f %9.3f %9.3f\n", a_lightCount, buildMs, refitMs, clusterMs, objectMs, bruteForceMs);
+	}
+}
+
+/// <summary>
+/// Light BVH build and refit, top 32 per cluster for a 16x9x24 grid and
+/// top 8 for 1000 object boxes against scoring every light, in milliseconds
+/// </summary>
+int main()
+{
+	printf(" Lights    Build    Refit Top32/grid Top8/1000     Brute\n");
+	for (int lightCount : { 1000, 10000, 100000 }) Run(lightCount, 32);
+	return 0;
+}
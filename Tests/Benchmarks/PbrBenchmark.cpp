@@ -0,0 +1,89 @@
+#include "PbrReference.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	template <typename Function>
+	double TimeMs(Function a_function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		a_function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Run(size_t a_lightCount, size_t a_sampleCount)
+	{
+		//one sun plus point and spot lights scattered around the camera
+		std::mt19937 random(49);
+		std::uniform_real_distribution<float> offset(-20.0f, 20.0f);
+		std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+		std::vector<Light> lights(a_lightCount);
+		for (size_t i = 0; i < a_lightCount; i++) {
+			Light& light = lights[i];
+			light.m_Type = i == 0 ? LIGHT_TYPE_DIRECTIONAL : (i % 2 ? LIGHT_TYPE_POINT : LIGHT_TYPE_SPOT);
+			light.m_Position = XMFLOAT3(offset(random), offset(random), offset(random));
+			XMStoreFloat3(&light.m_Direction, XMVector3Normalize(XMVectorSet(axis(random), axis(random), axis(random), 0.0f)));
+			light.m_Color = XMFLOAT3(unit(random), unit(random), unit(random));
+			light.m_Intensity = 1.0f;
+			light.m_Range = 10.0f;
+			light.m_SpotInnerAngle = 0.3f;
+			light.m_SpotOuterAngle = 0.6f;
+		}
+		PbrReference reference;
+		reference.SetLights(lights.data(), lights.size(), XMFLOAT3(0.0f, 2.0f, 0.0f));
+
+		PbrReference::SurfaceBatch surfaces;
+		surfaces.Resize(a_sampleCount);
+		for (size_t i = 0; i < a_sampleCount; i++) {
+			PbrReference::Surface surface;
+			surface.m_position = XMFLOAT3(offset(random), offset(random), offset(random));
+			XMStoreFloat3(&surface.m_normal, XMVector3Normalize(XMVectorSet(axis(random), axis(random), axis(random), 0.0f)));
+			surface.m_albedo = XMFLOAT3(unit(random), unit(random), unit(random));
+			surface.m_roughness = unit(random);
+			surface.m_metalness = unit(random);
+			surfaces.Set(i, surface);
+		}
+
+		std::vector<XMFLOAT3> scalar(a_sampleCount);
+		double scalarMs = TimeMs([&]() {
+			for (size_t i = 0; i < a_sampleCount; i++) scalar[i] = reference.ShadeScalar(surfaces.Get(i));
+		});
+
+		PbrReference::ColorBatch colors;
+		double batchedMs = TimeMs([&]() { reference.Shade(surfaces, colors); });
+
+		//relative to the larger of 1 and the scalar result
+		float maxDifference = 0.0f;
+		for (size_t i = 0; i < a_sampleCount; i++) {
+			XMFLOAT3 batched = colors.Get(i);
+			const float expected[3] = { scalar[i].x, scalar[i].y, scalar[i].z };
+			const float actual[3] = { batched.x, batched.y, batched.z };
+			for (int c = 0; c < 3; c++) {
+				maxDifference = (std::max)(maxDifference, std::fabs(actual[c] - expected[c]) / (std::max)(std::fabs(expected[c]), 1.0f));
+			}
+		}
+
+		printf("%8zu %8zu %10.2f %10.2f %8.1fx %10.2g\n", a_lightCount, a_sampleCount,
+			a_sampleCount / (std::max)(scalarMs, 1e-6) / 1e3, a_sampleCount / (std::max)(batchedMs, 1e-6) / 1e3,
+			scalarMs / (std::max)(batchedMs, 1e-6), maxDifference);
+	}
+}
+
+/// <summary>
+/// CPU reference of the direct lighting on one core, sample by sample against
+/// 4 wide batches, in millions of samples a second
+/// </summary>
+int main()
+{
+	printf("  Lights  Samples  ScalarM/s BatchedM/s  Speedup    MaxDiff\n");
+	for (size_t lightCount : { 1, 8, 64 }) Run(lightCount, 1 << 16);
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include "ShaderPermutations.h"
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+	template <typename Function>
+	double TimeMs(Function a_function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		a_function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Run(int a_materialCount, int a_lookupCount)
+	{
+		//the variant table the way Game fills it, half the keys never built so they fall back
+		std::array<const void*, ShaderPermutations::VARIANT_COUNT> variants = {};
+		static int fallbackShader = 0;
+		for (uint32_t key = 0; key < ShaderPermutations::VARIANT_COUNT; key++) {
+			if (ShaderPermutations::IsValidKey(key) && key % 2 == 0) variants[key] = &variants[key];
+		}
+		auto lookup = [&](uint32_t a_key) {
+			const void* variant = variants[a_key];
+			return variant ? variant : static_cast<const void*>(&fallbackShader);
+		};
+
+		std::mt19937 random(45);
+		std::vector<uint32_t> materialFeatures(a_materialCount);
+		for (uint32_t& features : materialFeatures) {
+			features = ShaderPermutations::GetMaterialFeatures(random() % 2, random() % 2, random() % 2);
+		}
+
+		size_t fallbacks = 0;
+		double lookupMs = TimeMs([&]() {
+			for (int i = 0; i < a_lookupCount; i++) {
+				uint32_t key = ShaderPermutations::Combine(materialFeatures[i % materialFeatures.size()], static_cast<uint32_t>(i));
+				if (lookup(key) == &fallbackShader) fallbacks++;
+			}
+		});
+
+		//what ResolveShaderPermutations does when the frame half changes
+		std::vector<const void*> resolved(a_materialCount);
+		double resolveMs = TimeMs([&]() {
+			uint32_t frame = ShaderPermutations::GetFrameFeatures(true, true, true, false);
+			for (int i = 0; i < a_materialCount; i++) {
+				resolved[i] = lookup(ShaderPermutations::Combine(materialFeatures[i], frame));
+			}
+		});
+
+		size_t manifestKeys = 0;
+		double manifestMs = TimeMs([&]() {
+			manifestKeys = ShaderPermutations::ParseManifest(ShaderPermutations::BuildManifest()).size();
+		});
+
+		printf("%10d %10d %8.2f %10zu %10.4f %10.4f %8zu\n", a_materialCount, a_lookupCount,
+			lookupMs * 1.0e6 / a_lookupCount, fallbacks, resolveMs, manifestMs, manifestKeys);
+	}
+}
+
+/// <summary>
+/// Shader variant selection: building a key and looking it up in nanoseconds,
+/// resolving every material for a new frame half and a manifest round trip in milliseconds
+/// </summary>
+int main()
+{
+	printf(" Materials    Lookups Lookupns  Fallbacks  ResolveMs ManifestMs     Keys\n");
+	for (int materialCount : { 16, 1000, 100000 }) Run(materialCount, 1000000);
+	return 0;
+}
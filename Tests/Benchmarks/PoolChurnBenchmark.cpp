@@ -0,0 +1,58 @@
+#include "ObjectPool.h"
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+	//about the size of an entity, transform and a couple of pointers
+	struct Payload
+	{
+		float m_transform[16];
+		void* m_pMesh;
+		void* m_pMaterial;
+	};
+
+	void Churn(int a_objectCount)
+	{
+		ObjectPool<Payload> pool;
+		std::vector<Payload*> spawned;
+		spawned.reserve(a_objectCount);
+
+		std::mt19937 random(1234);
+		size_t allocations = 0;
+
+		auto start = std::chrono::steady_clock::now();
+		for (int round = 0; round < 10; round++) {
+			//fill up
+			while (spawned.size() < static_cast<size_t>(a_objectCount)) {
+				spawned.push_back(pool.Create());
+				allocations++;
+			}
+
+			//despawn a random half
+			for (int i = 0; i < a_objectCount / 2; i++) {
+				size_t victim = random() % spawned.size();
+				pool.Destroy(spawned[victim]);
+				spawned[victim] = spawned.back();
+				spawned.pop_back();
+			}
+		}
+		auto end = std::chrono::steady_clock::now();
+
+		double seconds = std::chrono::duration<double>(end - start).count();
+		printf("%7d objects: %6.1fM allocations/sec, %.1f%% fragmented after churn\n",
+			a_objectCount, seconds > 0.0 ? allocations / seconds / 1e6 : 0.0, pool.GetFragmentation() * 100.0f);
+	}
+}
+
+/// <summary>
+/// Spawns and despawns objects in a pool to measure allocation throughput
+/// and how fragmented the pool ends up
+/// </summary>
+int main()
+{
+	for (int objectCount : { 1000, 10000, 100000 }) Churn(objectCount);
+	return 0;
+}
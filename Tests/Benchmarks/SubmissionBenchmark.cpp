@@ -0,0 +1,101 @@
+#include "RenderSortKey.h"
+#include "RecordingRenderBackend.h"
+#include "Vertex.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+namespace
+{
+	template <typename Function>
+	double TimeMs(Function a_function)
+	{
+		auto start = std::chrono::steady_clock::now();
+		a_function();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	void Run(int a_drawCount)
+	{
+		//a prop heavy scene, 64 materials over 16 shaders and 128 meshes
+		std::mt19937 random(1234);
+		std::uniform_int_distribution<uint32_t> material(0, 63);
+		std::uniform_int_distribution<uint32_t> mesh(0, 127);
+		std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+		std::vector<uint32_t> shaders(a_drawCount), materials(a_drawCount), meshes(a_drawCount);
+		std::vector<uint64_t> stateIds(a_drawCount);
+		std::vector<float> depths(a_drawCount);
+		for (int i = 0; i < a_drawCount; i++) {
+			materials[i] = material(random);
+			shaders[i] = materials[i] % 16;
+			meshes[i] = mesh(random);
+			stateIds[i] = (static_cast<uint64_t>(materials[i]) << 32) | meshes[i];
+			depths[i] = depth(random);
+		}
+
+		std::vector<RenderSortKey::Item> items(a_drawCount);
+		double keyMs = TimeMs([&]() {
+			for (int i = 0; i < a_drawCount; i++) {
+				items[i].m_key = RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, shaders[i], materials[i], meshes[i], depths[i]);
+				items[i].m_index = i;
+			}
+		});
+
+		std::vector<RenderSortKey::Item> comparisonItems = items;
+		std::vector<RenderSortKey::Item> scratch;
+		double radixMs = TimeMs([&]() { RenderSortKey::RadixSort(items, scratch); });
+		double stdSortMs = TimeMs([&]() {
+			std::sort(comparisonItems.begin(), comparisonItems.end(),
+				[](const RenderSortKey::Item& a_left, const RenderSortKey::Item& a_right) { return a_left.m_key < a_right.m_key; });
+		});
+
+		std::vector<RenderSortKey::Batch> batches;
+		double batchMs = TimeMs([&]() { RenderSortKey::BuildBatches(items, stateIds, UINT32_MAX, batches); });
+
+		//fake handles stand in for the shaders, textures and buffers
+		auto handle = [](uint32_t a_kind, uint32_t a_id) {
+			return reinterpret_cast<RenderHandle>((static_cast<uintptr_t>(a_kind) << 24) | (a_id + 1));
+		};
+		RenderCommandList commands;
+		double emitMs = TimeMs([&]() {
+			uint32_t lastShader = UINT32_MAX, lastMaterial = UINT32_MAX, lastMesh = UINT32_MAX;
+			for (const RenderSortKey::Batch& batch : batches) {
+				uint32_t index = items[batch.m_first].m_index;
+				if (shaders[index] != lastShader) {
+					commands.BindPipeline(handle(1, shaders[index]), handle(2, shaders[index]));
+					lastShader = shaders[index];
+				}
+				if (materials[index] != lastMaterial) {
+					commands.BindShaderResource(RenderCommand::Stage::PIXEL, 0, handle(3, materials[index]));
+					commands.BindSampler(RenderCommand::Stage::PIXEL, 0, handle(4, 0));
+					lastMaterial = materials[index];
+				}
+				if (meshes[index] != lastMesh) {
+					commands.BindGeometry(handle(5, meshes[index]), handle(6, meshes[index]), sizeof(Vertex), sizeof(uint32_t));
+					lastMesh = meshes[index];
+				}
+				commands.BindConstantBuffer(RenderCommand::Stage::VERTEX, 0, handle(7, 0), batch.m_first * 256, 256);
+				commands.DrawIndexedInstanced(36, batch.m_count);
+			}
+		});
+
+		RecordingRenderBackend backend;
+		double replayMs = TimeMs([&]() { backend.Execute(commands); });
+
+		printf("%8d %8.3f %8.3f %8.3f %8.3f %8zu %8.3f %10zu %8.3f\n", a_drawCount,
+			keyMs, radixMs, stdSortMs, batchMs, batches.size(), emitMs, commands.GetSizeInBytes(), replayMs);
+	}
+}
+
+/// <summary>
+/// Draw submission without a device: key packing, radix sort against
+/// std::sort, batching, command emission and a headless replay, in milliseconds
+/// </summary>
+int main()
+{
+	printf("   Draws      Key    Radix std::sort    Batch  Batches     Emit      Bytes   Replay\n");
+	for (int drawCount : { 10000, 100000, 1000000 }) Run(drawCount);
+	return 0;
+}
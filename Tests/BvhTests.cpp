@@ -0,0 +1,244 @@
+#include "TestHarness.h"
+#include "Bvh.h"
+#include "Double3.h"
+#include <algorithm>
+#include <cfloat>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	std::vector<Bounds> RandomBoxes(size_t a_count, unsigned int a_seed, float a_spread = 200.0f)
+	{
+		std::mt19937 random(a_seed);
+		std::uniform_real_distribution<float> position(-a_spread, a_spread);
+		std::uniform_real_distribution<float> size(0.2f, 4.0f);
+
+		std::vector<Bounds> boxes(a_count);
+		for (Bounds& box : boxes) {
+			XMFLOAT3 center(position(random), position(random), position(random));
+			float halfSize = size(random);
+			box = Bounds::FromMinMax(
+				XMFLOAT3(center.x - halfSize, center.y - halfSize * 0.5f, center.z - halfSize),
+				XMFLOAT3(center.x + halfSize, center.y + halfSize * 0.5f, center.z + halfSize));
+		}
+		return boxes;
+	}
+
+	Frustum TestFrustum()
+	{
+		XMMATRIX view = XMMatrixLookToLH(XMVectorSet(10.0f, 5.0f, -80.0f, 0.0f), XMVectorSet(0.2f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(1.0f, 1.5f, 0.1f, 150.0f)));
+		Frustum frustum;
+		frustum.ExtractPlanes(viewProjection);
+		return frustum;
+	}
+
+	//the same box test the tree runs on its leaves, from min and max
+	bool BoxInFrustum(const Frustum& a_frustum, const Bounds& a_box)
+	{
+		XMFLOAT3 min(a_box.m_center.x - a_box.m_extents.x, a_box.m_center.y - a_box.m_extents.y, a_box.m_center.z - a_box.m_extents.z);
+		XMFLOAT3 max(a_box.m_center.x + a_box.m_extents.x, a_box.m_center.y + a_box.m_extents.y, a_box.m_center.z + a_box.m_extents.z);
+		XMFLOAT3 center((min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f);
+		return a_frustum.IntersectsBox(center, XMFLOAT3(max.x - center.x, max.y - center.y, max.z - center.z));
+	}
+
+	std::vector<uint32_t> Sorted(std::vector<uint32_t> a_indices)
+	{
+		std::sort(a_indices.begin(), a_indices.end());
+		return a_indices;
+	}
+
+	std::vector<uint32_t> FrustumBruteForce(const Frustum& a_frustum, const std::vector<Bounds>& a_boxes)
+	{
+		std::vector<uint32_t> results;
+		for (uint32_t i = 0; i < a_boxes.size(); i++) {
+			if (BoxInFrustum(a_frustum, a_boxes[i])) results.push_back(i);
+		}
+		return results;
+	}
+
+	std::vector<uint32_t> SphereBruteForce(const XMFLOAT3& a_center, float a_radius, const std::vector<Bounds>& a_boxes)
+	{
+		std::vector<uint32_t> results;
+		for (uint32_t i = 0; i < a_boxes.size(); i++) {
+			const Bounds& box = a_boxes[i];
+			float x = (std::max)(std::fabs(a_center.x - box.m_center.x) - box.m_extents.x, 0.0f);
+			float y = (std::max)(std::fabs(a_center.y - box.m_center.y) - box.m_extents.y, 0.0f);
+			float z = (std::max)(std::fabs(a_center.z - box.m_center.z) - box.m_extents.z, 0.0f);
+			if (x * x + y * y + z * z <= a_radius * a_radius) results.push_back(i);
+		}
+		return results;
+	}
+
+	//closest entry distance over every box, FLT_MAX on a miss
+	float RayBruteForce(const XMFLOAT3& a_origin, const XMFLOAT3& a_direction, float a_maxDistance, const std::vector<Bounds>& a_boxes)
+	{
+		float closest = FLT_MAX;
+		for (const Bounds& box : a_boxes) {
+			float entry = 0.0f;
+			float exit = a_maxDistance;
+			float origin[3] = { a_origin.x, a_origin.y, a_origin.z };
+			float direction[3] = { a_direction.x, a_direction.y, a_direction.z };
+			float center[3] = { box.m_center.x, box.m_center.y, box.m_center.z };
+			float extents[3] = { box.m_extents.x, box.m_extents.y, box.m_extents.z };
+			for (int axis = 0; axis < 3; axis++) {
+				float t1 = (center[axis] - extents[axis] - origin[axis]) / direction[axis];
+				float t2 = (center[axis] + extents[axis] - origin[axis]) / direction[axis];
+				entry = (std::max)(entry, (std::min)(t1, t2));
+				exit = (std::min)(exit, (std::max)(t1, t2));
+			}
+			if (entry <= exit) closest = (std::min)(closest, entry);
+		}
+		return closest;
+	}
+
+	//every node holds its children and objects, every object is in exactly one leaf
+	bool TreeIsConsistent(const Bvh& a_bvh, const std::vector<Bounds>& a_boxes)
+	{
+		const std::vector<Bvh::Node>& nodes = a_bvh.GetNodes();
+		std::vector<int> seen(a_boxes.size(), 0);
+		auto contains = [](const Bvh::Node& a_node, const XMFLOAT3& a_min, const XMFLOAT3& a_max) {
+			return a_node.m_min.x <= a_min.x && a_node.m_min.y <= a_min.y && a_node.m_min.z <= a_min.z &&
+				a_node.m_max.x >= a_max.x && a_node.m_max.y >= a_max.y && a_node.m_max.z >= a_max.z;
+		};
+
+		std::vector<uint32_t> stack = { 0 };
+		while (!stack.empty()) {
+			const Bvh::Node& node = nodes[stack.back()];
+			stack.pop_back();
+			if (node.IsLeaf()) {
+				for (uint32_t i = node.m_leftOrFirst; i < node.m_leftOrFirst + node.m_count; i++) {
+					uint32_t object = a_bvh.GetObjectSlots()[i];
+					const Bounds& box = a_boxes[object];
+					XMFLOAT3 min(box.m_center.x - box.m_extents.x, box.m_center.y - box.m_extents.y, box.m_center.z - box.m_extents.z);
+					XMFLOAT3 max(box.m_center.x + box.m_extents.x, box.m_center.y + box.m_extents.y, box.m_center.z + box.m_extents.z);
+					if (!contains(node, min, max)) return false;
+					seen[object]++;
+				}
+				continue;
+			}
+			for (uint32_t child = node.m_leftOrFirst; child <= node.m_leftOrFirst + 1; child++) {
+				if (!contains(node, nodes[child].m_min, nodes[child].m_max)) return false;
+				stack.push_back(child);
+			}
+		}
+		return std::all_of(seen.begin(), seen.end(), [](int a_count) { return a_count == 1; });
+	}
+}
+
+TEST_CASE(BuildKeepsEveryObjectInsideItsNodes)
+{
+	for (size_t count : { size_t(1), size_t(7), size_t(1000), size_t(40000) }) {
+		std::vector<Bounds> boxes = RandomBoxes(count, 7);
+		Bvh bvh;
+		bvh.Build(boxes);
+		CHECK(bvh.GetObjectCount() == count);
+		CHECK(TreeIsConsistent(bvh, boxes));
+	}
+}
+
+TEST_CASE(FrustumQueryMatchesBruteForce)
+{
+	std::vector<Bounds> boxes = RandomBoxes(20000, 11);
+	Bvh bvh;
+	bvh.Build(boxes);
+
+	Frustum frustum = TestFrustum();
+	std::vector<uint32_t> results;
+	bvh.QueryFrustum(frustum, results);
+	std::vector<uint32_t> expected = FrustumBruteForce(frustum, boxes);
+	CHECK(!expected.empty());
+	CHECK(Sorted(results) == expected);
+}
+
+TEST_CASE(SphereQueryMatchesBruteForce)
+{
+	std::vector<Bounds> boxes = RandomBoxes(20000, 12);
+	Bvh bvh;
+	bvh.Build(boxes);
+
+	std::mt19937 random(5);
+	std::uniform_real_distribution<float> position(-200.0f, 200.0f);
+	for (int i = 0; i < 50; i++) {
+		XMFLOAT3 center(position(random), position(random), position(random));
+		float radius = 5.0f + i;
+		std::vector<uint32_t> results;
+		bvh.QuerySphere(center, radius, results);
+		CHECK(Sorted(results) == SphereBruteForce(center, radius, boxes));
+	}
+}
+
+TEST_CASE(RaycastFindsTheClosestBox)
+{
+	std::vector<Bounds> boxes = RandomBoxes(5000, 13);
+	Bvh bvh;
+	bvh.Build(boxes);
+
+	std::mt19937 random(6);
+	std::uniform_real_distribution<float> position(-250.0f, 250.0f);
+	int hits = 0;
+	for (int i = 0; i < 500; i++) {
+		XMFLOAT3 origin(position(random), position(random), position(random));
+		XMFLOAT3 direction(position(random), position(random), position(random));
+		uint32_t object = 0;
+		float distance = 0.0f;
+		bool hit = bvh.Raycast(origin, direction, 1.0f, object, distance);
+		float expected = RayBruteForce(origin, direction, 1.0f, boxes);
+		CHECK(hit == (expected != FLT_MAX));
+		if (!hit) continue;
+		hits++;
+		CHECK_NEAR(distance, expected, 1e-4);
+	}
+	CHECK(hits > 0);
+}
+
+TEST_CASE(RefitAndUpdateTrackMovedObjects)
+{
+	//big enough for the threaded refit
+	std::vector<Bounds> boxes = RandomBoxes(30000, 14);
+	Bvh bvh;
+	bvh.Build(boxes);
+
+	for (Bounds& box : boxes) box.m_center.y += 3.0f;
+	bvh.Refit(boxes);
+	CHECK(TreeIsConsistent(bvh, boxes));
+
+	std::mt19937 random(8);
+	for (int i = 0; i < 200; i++) {
+		uint32_t object = random() % boxes.size();
+		boxes[object].m_center.x += 50.0f;
+		bvh.UpdateObject(object, boxes[object]);
+	}
+	CHECK(TreeIsConsistent(bvh, boxes));
+
+	Frustum frustum = TestFrustum();
+	std::vector<uint32_t> results;
+	bvh.QueryFrustum(frustum, results);
+	CHECK(Sorted(results) == FrustumBruteForce(frustum, boxes));
+}
+
+TEST_CASE(RebasedBoxesStaySeparableFarFromOrigin)
+{
+	//centimeter apart crates a million units out, what the scene BVH sees once
+	//bounds are relative to the render origin
+	Double3 origin(1e6, 0.0, -1e6);
+	std::vector<Bounds> boxes;
+	for (int i = 0; i < 64; i++) {
+		Double3 world = origin + Double3(i * 0.01, 0.0, 0.0);
+		XMFLOAT3 relative = world.RelativeTo(origin);
+		boxes.push_back(Bounds::FromMinMax(
+			XMFLOAT3(relative.x - 0.002f, relative.y - 0.002f, relative.z - 0.002f),
+			XMFLOAT3(relative.x + 0.002f, relative.y + 0.002f, relative.z + 0.002f)));
+	}
+	Bvh bvh;
+	bvh.Build(boxes, 1);
+
+	for (int i = 0; i < 64; i++) {
+		std::vector<uint32_t> results;
+		bvh.QuerySphere((origin + Double3(i * 0.01, 0.0, 0.0)).RelativeTo(origin), 0.001f, results);
+		CHECK(results.size() == 1 && results[0] == static_cast<uint32_t>(i));
+	}
+}
@@ -0,0 +1,121 @@
+#include "TestHarness.h"
+#include "RecordingCommandSink.h"
+#include <chrono>
+#include <memory>
+#include <thread>
+
+namespace
+{
+	bool Contiguous(const std::vector<CommandChunk>& a_chunks, size_t a_itemCount)
+	{
+		size_t next = 0;
+		for (const CommandChunk& chunk : a_chunks) {
+			if (chunk.m_first != next || chunk.m_count == 0) return false;
+			next += chunk.m_count;
+		}
+		return next == a_itemCount;
+	}
+
+	struct Recording
+	{
+		RecordingCommandSink::Log m_log;
+		std::vector<std::unique_ptr<RecordingCommandSink>> m_sinks;
+		std::vector<CommandSink*> m_sinkPointers;
+
+		explicit Recording(size_t a_chunkCount)
+		{
+			for (size_t i = 0; i < a_chunkCount; i++) {
+				m_sinks.push_back(std::make_unique<RecordingCommandSink>(i, m_log));
+				m_sinkPointers.push_back(m_sinks.back().get());
+			}
+		}
+
+		//later chunks sleep longer first, so the recording threads finish in reverse
+		void Run(const std::vector<CommandChunk>& a_chunks)
+		{
+			CommandRecording::RecordAndExecute(a_chunks, m_sinkPointers, [this, &a_chunks](size_t a_chunkIndex, const CommandChunk& a_chunk) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(2 * (a_chunks.size() - a_chunkIndex)));
+				for (size_t i = a_chunk.m_first; i < a_chunk.m_first + a_chunk.m_count; i++) m_sinks[a_chunkIndex]->Record(i);
+			});
+		}
+	};
+}
+
+TEST_CASE(ChunksAreContiguousAndEven)
+{
+	for (size_t itemCount : { 1, 7, 100, 1000, 1001, 4095, 100000 }) {
+		for (size_t maxChunks : { 1, 2, 3, 8, 64 }) {
+			std::vector<CommandChunk> chunks = CommandRecording::PlanChunks(itemCount, maxChunks, 64);
+			CHECK(Contiguous(chunks, itemCount));
+			CHECK(!chunks.empty() && chunks.size() <= maxChunks);
+
+			//sizes differ by at most one, and only the first chunks take the extra item
+			bool even = true;
+			for (size_t i = 1; i < chunks.size(); i++) {
+				even = even && chunks[i].m_count <= chunks[i - 1].m_count && chunks[0].m_count - chunks[i].m_count <= 1;
+			}
+			CHECK(even);
+
+			//no chunk goes under the minimum unless there is only one
+			bool big = true;
+			for (const CommandChunk& chunk : chunks) big = big && (chunks.size() == 1 || chunk.m_count >= 64);
+			CHECK(big);
+		}
+	}
+
+	CHECK(CommandRecording::PlanChunks(0, 4, 64).empty());
+	CHECK(CommandRecording::PlanChunks(100, 0, 0).size() == 1);
+	CHECK(CommandRecording::PlanChunks(100, 4, 0).size() == 4);
+}
+
+TEST_CASE(ChunksExecuteInOrder)
+{
+	std::vector<CommandChunk> chunks = CommandRecording::PlanChunks(10000, 8, 64);
+	CHECK(chunks.size() == 8);
+
+	Recording recording(chunks.size());
+	recording.Run(chunks);
+
+	bool chunkOrder = recording.m_log.m_executedChunks.size() == chunks.size();
+	for (size_t i = 0; chunkOrder && i < chunks.size(); i++) chunkOrder = recording.m_log.m_executedChunks[i] == i;
+	CHECK(chunkOrder);
+
+	//replayed items come out in the original item order, each exactly once
+	bool itemOrder = recording.m_log.m_executedItems.size() == 10000;
+	for (size_t i = 0; itemOrder && i < 10000; i++) itemOrder = recording.m_log.m_executedItems[i] == i;
+	CHECK(itemOrder);
+
+	for (const std::unique_ptr<RecordingCommandSink>& sink : recording.m_sinks) {
+		CHECK(sink->m_began && sink->m_finished);
+		CHECK(!sink->m_executedOutOfOrder);
+		CHECK(sink->m_executingThread == std::this_thread::get_id());
+	}
+}
+
+TEST_CASE(ChunksRecordOnTheirOwnThreads)
+{
+	std::vector<CommandChunk> chunks = CommandRecording::PlanChunks(1000, 4, 64);
+	Recording recording(chunks.size());
+	recording.Run(chunks);
+
+	//the first chunk is recorded by the caller, the rest off it and overlapping
+	CHECK(recording.m_sinks[0]->m_recordingThread == std::this_thread::get_id());
+	bool offCaller = true;
+	for (size_t i = 1; i < recording.m_sinks.size(); i++) {
+		offCaller = offCaller && recording.m_sinks[i]->m_recordingThread != std::this_thread::get_id();
+	}
+	CHECK(offCaller);
+	CHECK(recording.m_log.m_mostRecordingAtOnce > 1);
+	CHECK(recording.m_log.m_recordingNow == 0);
+}
+
+TEST_CASE(SingleChunkStaysOnTheCaller)
+{
+	std::vector<CommandChunk> chunks = CommandRecording::PlanChunks(10, 8, 64);
+	CHECK(chunks.size() == 1);
+
+	Recording recording(chunks.size());
+	recording.Run(chunks);
+	CHECK(recording.m_sinks[0]->m_recordingThread == std::this_thread::get_id());
+	CHECK(recording.m_log.m_executedItems.size() == 10);
+}
@@ -0,0 +1,138 @@
+#include "TestHarness.h"
+#include "ConstantBufferRing.h"
+#include <deque>
+#include <random>
+
+namespace
+{
+	struct Range
+	{
+		uint64_t m_frame;
+		unsigned int m_offset;
+		unsigned int m_size;
+	};
+
+	bool Overlaps(const Range& a_first, const Range& a_second)
+	{
+		return a_first.m_offset < a_second.m_offset + a_second.m_size && a_second.m_offset < a_first.m_offset + a_first.m_size;
+	}
+}
+
+TEST_CASE(AllocationsAreAligned)
+{
+	CHECK(ConstantBufferRing::Align(1) == 256);
+	CHECK(ConstantBufferRing::Align(256) == 256);
+	CHECK(ConstantBufferRing::Align(257) == 512);
+
+	ConstantBufferRing ring;
+	ring.Reset(4096 + 100);
+	CHECK(ring.GetCapacity() == 4096);
+
+	ring.BeginFrame(1, 0);
+	unsigned int first = 1, second = 1;
+	CHECK(ring.Allocate(64, first));
+	CHECK(ring.Allocate(300, second));
+	CHECK(first == 0);
+	CHECK(second == 256);
+	CHECK(ring.GetFrameBytes() == 768);
+
+	unsigned int unused = 0;
+	CHECK(!ring.Allocate(0, unused));
+	CHECK(!ring.Allocate(8192, unused));
+	CHECK(ring.GetFrameBytes() == 768);
+}
+
+TEST_CASE(FramesStayReservedUntilTheirFence)
+{
+	ConstantBufferRing ring;
+	ring.Reset(1024);
+
+	unsigned int offset = 0;
+	ring.BeginFrame(1, 0);
+	CHECK(ring.Allocate(512, offset));
+	ring.BeginFrame(2, 0);
+	CHECK(ring.Allocate(512, offset));
+	CHECK(offset == 512);
+
+	//frame 1 still in flight, nothing left
+	ring.BeginFrame(3, 0);
+	CHECK(!ring.Allocate(256, offset));
+	CHECK(ring.GetBytesInFlight() == 1024);
+
+	//the fence for frame 1 comes in mid frame, Retire frees its half
+	ring.Retire(1);
+	CHECK(ring.GetBytesInFlight() == 512);
+	CHECK(ring.Allocate(256, offset));
+	CHECK(offset == 0);
+	CHECK(ring.Allocate(256, offset));
+	CHECK(offset == 256);
+	CHECK(!ring.Allocate(256, offset));
+	CHECK(ring.GetHighWaterBytes() == 1024);
+}
+
+TEST_CASE(WrapChargesTheSkippedTail)
+{
+	ConstantBufferRing ring;
+	ring.Reset(1024);
+
+	unsigned int offset = 0;
+	ring.BeginFrame(1, 0);
+	CHECK(ring.Allocate(768, offset));
+	ring.BeginFrame(2, 1);
+	CHECK(ring.GetBytesInFlight() == 0);
+
+	//nothing in flight starts again from the front
+	CHECK(ring.Allocate(512, offset));
+	CHECK(offset == 0);
+	ring.BeginFrame(3, 1);
+	CHECK(ring.Allocate(256, offset));
+	CHECK(offset == 512);
+
+	//512 doesn't fit in the last 256, it wraps only once frame 2 has retired
+	ring.BeginFrame(4, 1);
+	CHECK(!ring.Allocate(512, offset));
+	ring.Retire(2);
+	CHECK(ring.Allocate(512, offset));
+	CHECK(offset == 0);
+	CHECK(ring.GetFrameBytes() == 768);
+
+	//retiring the wrapped frame gives the skipped bytes back too
+	ring.BeginFrame(5, 4);
+	CHECK(ring.GetBytesInFlight() == 0);
+}
+
+TEST_CASE(LiveRangesNeverOverlap)
+{
+	//three frames in flight with random draw sizes, anything handed out must
+	//stay clear of every range the GPU could still be reading
+	ConstantBufferRing ring;
+	ring.Reset(64 * 1024);
+	std::mt19937 random(36);
+	std::uniform_int_distribution<unsigned int> size(16, 1024);
+	std::uniform_int_distribution<int> drawCount(0, 60);
+
+	std::deque<Range> live;
+	bool overlapFree = true;
+	size_t failures = 0;
+	for (uint64_t frame = 1; frame <= 2000; frame++) {
+		uint64_t completed = frame > 3 ? frame - 3 : 0;
+		ring.BeginFrame(frame, completed);
+		while (!live.empty() && live.front().m_frame <= completed) live.pop_front();
+
+		for (int draw = drawCount(random); draw > 0; draw--) {
+			Range range = { frame, 0, ConstantBufferRing::Align(size(random)) };
+			if (!ring.Allocate(range.m_size, range.m_offset)) {
+				failures++;
+				continue;
+			}
+			overlapFree = overlapFree && range.m_offset % ConstantBufferRing::ALIGNMENT == 0;
+			overlapFree = overlapFree && range.m_offset + range.m_size <= ring.GetCapacity();
+			for (const Range& other : live) overlapFree = overlapFree && !Overlaps(range, other);
+			live.push_back(range);
+		}
+	}
+	CHECK(overlapFree);
+	//some frames overrun on purpose, 60 draws at up to 1k against 64k over three frames
+	CHECK(failures > 0);
+	CHECK(ring.GetHighWaterBytes() <= ring.GetCapacity());
+}
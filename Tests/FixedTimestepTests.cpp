@@ -0,0 +1,136 @@
+#include "TestHarness.h"
+#include "FixedTimestep.h"
+#include <limits>
+
+//quarter second steps and eighths of a second keep every sum exact in binary
+TEST_CASE(FractionalTimeLeavesAlpha)
+{
+	FixedTimestep timestep(0.25, 8);
+	CHECK(timestep.Advance(0.625) == 2);
+	CHECK(timestep.GetAlpha() == 0.5f);
+	CHECK(timestep.GetTickCount() == 2);
+	CHECK(timestep.GetLastSubstepCount() == 2);
+
+	//the leftover carries into the next frame
+	CHECK(timestep.Advance(0.125) == 1);
+	CHECK(timestep.GetAlpha() == 0.0f);
+	CHECK(timestep.GetTickCount() == 3);
+}
+
+TEST_CASE(ExactMultiplesLeaveNoAlpha)
+{
+	FixedTimestep timestep(0.25, 8);
+	CHECK(timestep.Advance(0.75) == 3);
+	CHECK(timestep.GetAlpha() == 0.0f);
+	CHECK(timestep.Advance(0.25) == 1);
+	CHECK(timestep.GetAlpha() == 0.0f);
+	CHECK(timestep.GetDroppedSeconds() == 0.0);
+}
+
+TEST_CASE(CatchUpIsCappedAndDropsWholeSteps)
+{
+	//a stall worth 8.5 steps runs 4 and drops 4, the fraction stays
+	FixedTimestep timestep(0.25, 4);
+	CHECK(timestep.Advance(2.125) == 4);
+	CHECK(timestep.GetDroppedSeconds() == 1.0);
+	CHECK(timestep.GetAlpha() == 0.5f);
+	CHECK(timestep.GetTickCount() == 4);
+
+	//dropped time adds up over stalls
+	CHECK(timestep.Advance(1.5) == 4);
+	CHECK(timestep.GetDroppedSeconds() == 1.5);
+	CHECK(timestep.GetAlpha() == 0.5f);
+}
+
+TEST_CASE(AlphaMatchesTheLeftoverTime)
+{
+	//uneven frame times, 17ms steps, a fake clock summed against what was paid out
+	const double step = 0.017;
+	FixedTimestep timestep(step, 8);
+	double elapsed = 0.0;
+	bool inRange = true, matches = true;
+	for (int frame = 0; frame < 1000; frame++) {
+		double delta = 0.001 + (frame * 7919 % 40) * 0.001;
+		elapsed += delta;
+		timestep.Advance(delta);
+
+		float alpha = timestep.GetAlpha();
+		double leftover = elapsed - timestep.GetTickCount() * step - timestep.GetDroppedSeconds();
+		inRange = inRange && alpha >= 0.0f && alpha < 1.0f;
+		matches = matches && std::fabs(alpha - leftover / step) < 1e-4;
+	}
+	CHECK(inRange);
+	CHECK(matches);
+	CHECK(timestep.GetDroppedSeconds() == 0.0);
+}
+
+TEST_CASE(ZeroNegativeAndNanPassNoTime)
+{
+	FixedTimestep timestep(0.25, 8);
+	timestep.Advance(0.625);
+	float alpha = timestep.GetAlpha();
+
+	for (double elapsed : { 0.0, -0.5, std::numeric_limits<double>::quiet_NaN() }) {
+		CHECK(timestep.Advance(elapsed) == 0);
+		CHECK(timestep.GetLastSubstepCount() == 0);
+		CHECK(timestep.GetAlpha() == alpha);
+		CHECK(timestep.GetTickCount() == 2);
+	}
+
+	//still counts normally afterwards
+	CHECK(timestep.Advance(0.125) == 1);
+}
+
+TEST_CASE(ChangingTheStepKeepsAlpha)
+{
+	FixedTimestep timestep(0.25, 8);
+	timestep.Advance(0.125);
+	CHECK(timestep.GetAlpha() == 0.5f);
+
+	timestep.SetStepSeconds(0.5);
+	CHECK(timestep.GetStepSeconds() == 0.5);
+	CHECK(timestep.GetAlpha() == 0.5f);
+
+	//half of the new step was already accumulated
+	CHECK(timestep.Advance(0.25) == 1);
+	CHECK(timestep.GetAlpha() == 0.0f);
+}
+
+TEST_CASE(InvalidSettingsAreRejected)
+{
+	FixedTimestep timestep(0.25, 4);
+	timestep.SetMaxSubsteps(0);
+	timestep.SetMaxSubsteps(-3);
+	CHECK(timestep.GetMaxSubsteps() == 4);
+	timestep.SetMaxSubsteps(2);
+	CHECK(timestep.GetMaxSubsteps() == 2);
+	CHECK(timestep.Advance(1.0) == 2);
+
+	timestep.SetStepSeconds(0.0);
+	timestep.SetStepSeconds(-1.0);
+	timestep.SetStepSeconds(std::numeric_limits<double>::quiet_NaN());
+	CHECK(timestep.GetStepSeconds() == 0.25);
+
+	//the constructor falls back the same way
+	FixedTimestep fallback(-1.0, 0);
+	CHECK_NEAR(fallback.GetStepSeconds(), 1.0 / 60.0, 1e-12);
+	CHECK(fallback.GetMaxSubsteps() == 1);
+}
+
+TEST_CASE(ResetClearsAccumulatorAndDroppedTime)
+{
+	FixedTimestep timestep(0.25, 2);
+	timestep.Advance(2.125);
+	CHECK(timestep.GetDroppedSeconds() > 0.0);
+	CHECK(timestep.GetAlpha() > 0.0f);
+
+	timestep.Reset();
+	CHECK(timestep.GetAlpha() == 0.0f);
+	CHECK(timestep.GetDroppedSeconds() == 0.0);
+	CHECK(timestep.GetTickCount() == 0);
+	CHECK(timestep.GetLastSubstepCount() == 0);
+
+	//nothing left over from before the reset
+	CHECK(timestep.Advance(0.125) == 0);
+	CHECK(timestep.GetAlpha() == 0.5f);
+}
@@ -0,0 +1,312 @@
+#include "TestHarness.h"
+#include "FrameProfiler.h"
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <thread>
+
+namespace
+{
+	//the zones the last finished frame holds for a_thread, by start
+	std::vector<FrameProfiler::Zone> GetZones(uint32_t a_thread)
+	{
+		std::vector<FrameProfiler::Zone> zones;
+		for (const FrameProfiler::Zone& zone : FrameProfiler::GetFrame(0).m_zones) {
+			if (zone.m_thread == a_thread) zones.push_back(zone);
+		}
+		return zones;
+	}
+
+	std::vector<FrameProfiler::Zone> GetWorkerZones()
+	{
+		std::vector<FrameProfiler::Zone> zones;
+		for (const FrameProfiler::Zone& zone : FrameProfiler::GetFrame(0).m_zones) {
+			if (zone.m_thread != FrameProfiler::GetMainThread()) zones.push_back(zone);
+		}
+		return zones;
+	}
+
+	size_t CountNamed(const std::vector<FrameProfiler::Zone>& a_zones, const char* a_name)
+	{
+		size_t count = 0;
+		for (const FrameProfiler::Zone& zone : a_zones) {
+			if (strcmp(zone.m_name, a_name) == 0) count++;
+		}
+		return count;
+	}
+
+	//just enough of a JSON reader to tell whether the whole text is one valid value
+	class JsonValidator
+	{
+	public:
+		explicit JsonValidator(const std::string& a_text) : m_text(a_text) {}
+
+		bool IsValid()
+		{
+			SkipSpace();
+			if (!Value()) return false;
+			SkipSpace();
+			return m_position == m_text.size();
+		}
+
+	private:
+		const std::string& m_text;
+		size_t m_position = 0;
+
+		char Peek() const { return m_position < m_text.size() ? m_text[m_position] : '\0'; }
+
+		void SkipSpace()
+		{
+			while (m_position < m_text.size() && isspace(static_cast<unsigned char>(m_text[m_position]))) m_position++;
+		}
+
+		bool Literal(const char* a_word)
+		{
+			size_t length = strlen(a_word);
+			if (m_text.compare(m_position, length, a_word) != 0) return false;
+			m_position += length;
+			return true;
+		}
+
+		bool String()
+		{
+			if (Peek() != '"') return false;
+			m_position++;
+			while (m_position < m_text.size()) {
+				unsigned char c = m_text[m_position++];
+				if (c == '"') return true;
+				if (c < 0x20) return false;
+				if (c == '\\') {
+					if (m_position >= m_text.size() || !strchr("\"\\/bfnrtu", m_text[m_position])) return false;
+					m_position++;
+				}
+			}
+			return false;
+		}
+
+		bool Number()
+		{
+			size_t start = m_position;
+			if (Peek() == '-') m_position++;
+			if (!isdigit(static_cast<unsigned char>(Peek()))) return false;
+			while (isdigit(static_cast<unsigned char>(Peek()))) m_position++;
+			if (Peek() == '.') {
+				m_position++;
+				if (!isdigit(static_cast<unsigned char>(Peek()))) return false;
+				while (isdigit(static_cast<unsigned char>(Peek()))) m_position++;
+			}
+			return m_position > start;
+		}
+
+		bool Sequence(char a_close, bool a_keyed)
+		{
+			m_position++;
+			SkipSpace();
+			if (Peek() == a_close) {
+				m_position++;
+				return true;
+			}
+			while (true) {
+				SkipSpace();
+				if (a_keyed) {
+					if (!String()) return false;
+					SkipSpace();
+					if (Peek() != ':') return false;
+					m_position++;
+					SkipSpace();
+				}
+				if (!Value()) return false;
+				SkipSpace();
+				if (Peek() == a_close) {
+					m_position++;
+					return true;
+				}
+				if (Peek() != ',') return false;
+				m_position++;
+			}
+		}
+
+		bool Value()
+		{
+			switch (Peek()) {
+			case '{': return Sequence('}', true);
+			case '[': return Sequence(']', false);
+			case '"': return String();
+			case 't': return Literal("true");
+			case 'f': return Literal("false");
+			case 'n': return Literal("null");
+			default: return Number();
+			}
+		}
+	};
+
+	size_t CountOccurrences(const std::string& a_text, const std::string& a_pattern)
+	{
+		size_t count = 0;
+		for (size_t at = a_text.find(a_pattern); at != std::string::npos; at = a_text.find(a_pattern, at + 1)) count++;
+		return count;
+	}
+}
+
+TEST_CASE(NestedScopesGetTheirDepth)
+{
+	//the first call only opens a frame, later ones flush whatever earlier tests left
+	FrameProfiler::BeginFrame();
+	{
+		FrameProfiler::Scope outer("Outer");
+		{
+			FrameProfiler::Scope middle("Middle");
+			FrameProfiler::Scope inner("Inner");
+		}
+		FrameProfiler::Scope sibling("Sibling");
+	}
+	FrameProfiler::BeginFrame();
+
+	std::vector<FrameProfiler::Zone> zones = GetZones(FrameProfiler::GetMainThread());
+	CHECK(zones.size() == 4);
+	if (zones.size() != 4) return;
+	CHECK(strcmp(zones[0].m_name, "Outer") == 0 && zones[0].m_depth == 0);
+	CHECK(strcmp(zones[1].m_name, "Middle") == 0 && zones[1].m_depth == 1);
+	CHECK(strcmp(zones[2].m_name, "Inner") == 0 && zones[2].m_depth == 2);
+	CHECK(strcmp(zones[3].m_name, "Sibling") == 0 && zones[3].m_depth == 1);
+
+	//children sit inside their parent
+	CHECK(zones[0].m_start <= zones[1].m_start && zones[1].m_end <= zones[0].m_end);
+	CHECK(zones[1].m_start <= zones[2].m_start && zones[2].m_end <= zones[1].m_end);
+	CHECK(zones[1].m_end <= zones[3].m_start && zones[3].m_end <= zones[0].m_end);
+	CHECK(FrameProfiler::GetFrame(0).m_dropped == 0);
+}
+
+TEST_CASE(ZoneBelongsToTheFrameItEndsIn)
+{
+	FrameProfiler::BeginFrame();
+	FrameProfiler::BeginZone("Crossing");
+	FrameProfiler::BeginFrame();
+	CHECK(CountNamed(GetZones(FrameProfiler::GetMainThread()), "Crossing") == 0);
+
+	{
+		FrameProfiler::Scope inside("Inside");
+	}
+	FrameProfiler::EndZone();
+	FrameProfiler::BeginFrame();
+
+	const FrameProfiler::Frame& frame = FrameProfiler::GetFrame(0);
+	std::vector<FrameProfiler::Zone> zones = GetZones(FrameProfiler::GetMainThread());
+	CHECK(zones.size() == 2);
+	if (zones.size() != 2) return;
+	CHECK(strcmp(zones[0].m_name, "Crossing") == 0 && zones[0].m_depth == 0);
+	CHECK(zones[0].m_start < frame.m_start);
+	CHECK(zones[0].m_end >= frame.m_start && zones[0].m_end <= frame.m_end);
+
+	//still open around the zones of the later frame
+	CHECK(strcmp(zones[1].m_name, "Inside") == 0 && zones[1].m_depth == 1);
+	CHECK(FrameProfiler::GetFrame(1).m_index + 1 == frame.m_index);
+}
+
+TEST_CASE(FullRingDropsWholeZones)
+{
+	FrameProfiler::BeginFrame();
+	FrameProfiler::BeginZone("Outer");
+	for (size_t i = 0; i < FrameProfiler::EVENTS_PER_THREAD; i++) {
+		FrameProfiler::BeginZone("Filler");
+		FrameProfiler::EndZone();
+	}
+
+	//the ring is full, whatever begins inside a dropped zone goes with it
+	FrameProfiler::BeginZone("Dropped");
+	FrameProfiler::BeginZone("Nested");
+	FrameProfiler::EndZone();
+	FrameProfiler::EndZone();
+
+	//room was kept for the end of the zone open around all of it
+	FrameProfiler::EndZone();
+	FrameProfiler::BeginFrame();
+
+	std::vector<FrameProfiler::Zone> zones = GetZones(FrameProfiler::GetMainThread());
+	size_t fillers = CountNamed(zones, "Filler");
+	CHECK(CountNamed(zones, "Outer") == 1);
+	CHECK(CountNamed(zones, "Dropped") == 0);
+	CHECK(CountNamed(zones, "Nested") == 0);
+	CHECK(fillers > 0 && fillers < FrameProfiler::EVENTS_PER_THREAD);
+	CHECK(2 * fillers + 2 <= FrameProfiler::EVENTS_PER_THREAD);
+	CHECK(fillers + FrameProfiler::GetFrame(0).m_dropped == FrameProfiler::EVENTS_PER_THREAD + 2);
+
+	bool paired = !zones.empty() && zones[0].m_depth == 0;
+	for (size_t i = 1; i < zones.size(); i++) {
+		paired = paired && zones[i].m_depth == 1 && zones[i].m_start >= zones[0].m_start && zones[i].m_end <= zones[0].m_end;
+	}
+	CHECK(paired);
+
+	//the next frame records again
+	{
+		FrameProfiler::Scope again("Again");
+	}
+	FrameProfiler::BeginFrame();
+	CHECK(CountNamed(GetZones(FrameProfiler::GetMainThread()), "Again") == 1);
+	CHECK(FrameProfiler::GetFrame(0).m_dropped == 0);
+}
+
+TEST_CASE(HandedOnRingForgetsTheExitedThreadsZones)
+{
+	FrameProfiler::BeginFrame();
+
+	//exits with a zone still open, and its events still unread
+	std::thread([]() {
+		{
+			FrameProfiler::Scope finished("Finished");
+		}
+		FrameProfiler::BeginZone("Abandoned");
+	}).join();
+	std::thread([]() {
+		FrameProfiler::Scope next("Next");
+	}).join();
+	FrameProfiler::BeginFrame();
+
+	std::vector<FrameProfiler::Zone> zones = GetWorkerZones();
+	CHECK(zones.size() == 2);
+	if (zones.size() != 2) return;
+	CHECK(zones[0].m_thread == zones[1].m_thread);
+	CHECK(strcmp(zones[0].m_name, "Finished") == 0 && zones[0].m_depth == 0);
+	CHECK(strcmp(zones[1].m_name, "Next") == 0 && zones[1].m_depth == 0);
+
+	//the same with the open begin already drained into an earlier frame
+	std::thread([]() { FrameProfiler::BeginZone("Abandoned"); }).join();
+	FrameProfiler::BeginFrame();
+	std::thread([]() {
+		FrameProfiler::Scope next("Next");
+	}).join();
+	FrameProfiler::BeginFrame();
+
+	zones = GetWorkerZones();
+	CHECK(zones.size() == 1);
+	CHECK(CountNamed(zones, "Abandoned") == 0);
+	CHECK(!zones.empty() && strcmp(zones[0].m_name, "Next") == 0 && zones[0].m_depth == 0);
+}
+
+TEST_CASE(ChromeTraceIsValidJson)
+{
+	FrameProfiler::BeginFrame();
+	{
+		FrameProfiler::Scope quoted("Say \"hi\" to C:\\temp");
+		FrameProfiler::Scope control("Tab\there");
+	}
+	FrameProfiler::BeginFrame();
+
+	std::string trace = FrameProfiler::ExportChromeTrace();
+	CHECK(JsonValidator(trace).IsValid());
+	CHECK(trace.find("\"traceEvents\":[") != std::string::npos);
+	CHECK(trace.find("\"name\":\"Say \\\"hi\\\" to C:\\\\temp\"") != std::string::npos);
+	CHECK(trace.find("\"name\":\"Tabhere\"") != std::string::npos);
+
+	//a span per kept frame in its own lane, plus one per zone
+	size_t zoneCount = 0;
+	for (size_t age = 0; age < FrameProfiler::GetFrameCount(); age++) zoneCount += FrameProfiler::GetFrame(age).m_zones.size();
+	CHECK(CountOccurrences(trace, "{\"name\":\"Frame ") == FrameProfiler::GetFrameCount());
+	CHECK(CountOccurrences(trace, "\"ph\":\"X\"") == FrameProfiler::GetFrameCount() + zoneCount);
+	CHECK(CountOccurrences(trace, "\"name\":\"thread_name\"") == FrameProfiler::GetThreadCount() + 1);
+
+	//the validator itself turns broken text down
+	CHECK(!JsonValidator("{\"traceEvents\":[{\"name\":\"a\"},]}").IsValid());
+	CHECK(!JsonValidator("{\"name\":\"a\"b\"}").IsValid());
+	CHECK(!JsonValidator("{\"traceEvents\":[").IsValid());
+}
@@ -0,0 +1,104 @@
+#include "TestHarness.h"
+#include "Frustum.h"
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT4X4 PerspectiveViewProjection(const XMFLOAT3& a_eye, const XMFLOAT3& a_forward)
+	{
+		XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&a_eye), XMLoadFloat3(&a_forward), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMMATRIX projection = XMMatrixPerspectiveFovLH(XM_PIDIV2 * 0.75f, 16.0f / 9.0f, 0.1f, 200.0f);
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, projection));
+		return viewProjection;
+	}
+
+	Bounds Box(const XMFLOAT3& a_center, float a_halfSize)
+	{
+		return Bounds::FromMinMax(
+			XMFLOAT3(a_center.x - a_halfSize, a_center.y - a_halfSize, a_center.z - a_halfSize),
+			XMFLOAT3(a_center.x + a_halfSize, a_center.y + a_halfSize, a_center.z + a_halfSize));
+	}
+}
+
+TEST_CASE(BoxesInFrontAreInsideAndBehindAreOutside)
+{
+	Frustum frustum;
+	frustum.ExtractPlanes(PerspectiveViewProjection(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 0.0f, 1.0f)));
+
+	CHECK(frustum.IntersectsBox(XMFLOAT3(0.0f, 0.0f, 10.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	CHECK(!frustum.IntersectsBox(XMFLOAT3(0.0f, 0.0f, -10.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	CHECK(!frustum.IntersectsBox(XMFLOAT3(0.0f, 0.0f, 300.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	CHECK(!frustum.IntersectsBox(XMFLOAT3(100.0f, 0.0f, 10.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+
+	//straddling the far plane still counts
+	CHECK(frustum.IntersectsBox(XMFLOAT3(0.0f, 0.0f, 200.5f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+	CHECK(frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, 10.0f), 0.5f));
+	CHECK(!frustum.IntersectsSphere(XMFLOAT3(0.0f, 0.0f, -10.0f), 0.5f));
+}
+
+TEST_CASE(PlanesFaceInwards)
+{
+	Frustum frustum;
+	frustum.ExtractPlanes(PerspectiveViewProjection(XMFLOAT3(3.0f, 2.0f, 1.0f), XMFLOAT3(1.0f, 0.0f, 1.0f)));
+
+	XMFLOAT3 inside(13.0f, 2.0f, 11.0f);
+	for (int i = 0; i < Frustum::PLANE_COUNT; i++) {
+		const XMFLOAT4& plane = frustum.GetPlane(static_cast<Frustum::Plane>(i));
+		CHECK(plane.x * inside.x + plane.y * inside.y + plane.z * inside.z + plane.w > 0.0f);
+		CHECK_NEAR(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z, 1.0, 1e-5);
+	}
+}
+
+TEST_CASE(OrthographicFrustumIsABox)
+{
+	XMMATRIX view = XMMatrixLookToLH(XMVectorZero(), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+	XMFLOAT4X4 viewProjection;
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, XMMatrixOrthographicLH(20.0f, 10.0f, 1.0f, 50.0f)));
+
+	Frustum frustum;
+	frustum.ExtractPlanes(viewProjection);
+	CHECK(frustum.IntersectsBox(XMFLOAT3(9.5f, 4.5f, 10.0f), XMFLOAT3(0.1f, 0.1f, 0.1f)));
+	CHECK(!frustum.IntersectsBox(XMFLOAT3(10.5f, 0.0f, 10.0f), XMFLOAT3(0.1f, 0.1f, 0.1f)));
+	CHECK(!frustum.IntersectsBox(XMFLOAT3(0.0f, 5.5f, 10.0f), XMFLOAT3(0.1f, 0.1f, 0.1f)));
+	CHECK(!frustum.IntersectsBox(XMFLOAT3(0.0f, 0.0f, 0.5f), XMFLOAT3(0.1f, 0.1f, 0.1f)));
+}
+
+TEST_CASE(BatchedCullMatchesSingleTests)
+{
+	Frustum frustum;
+	frustum.ExtractPlanes(PerspectiveViewProjection(XMFLOAT3(5.0f, 3.0f, -20.0f), XMFLOAT3(0.3f, -0.1f, 1.0f)));
+
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-150.0f, 150.0f);
+	std::uniform_real_distribution<float> size(0.1f, 6.0f);
+
+	//an odd count so the last batch is partly padding
+	std::vector<Bounds> boxes;
+	BoundsSoA bounds;
+	for (int i = 0; i < 10001; i++) {
+		boxes.push_back(Box(XMFLOAT3(position(random), position(random), position(random)), size(random)));
+		bounds.Add(boxes.back());
+	}
+
+	std::vector<uint32_t> visible;
+	frustum.Cull(bounds, visible);
+
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < boxes.size(); i++) {
+		if (frustum.IntersectsBox(boxes[i].m_center, boxes[i].m_extents)) expected.push_back(i);
+	}
+	CHECK(!expected.empty());
+	CHECK(visible == expected);
+}
+
+TEST_CASE(CullOfEmptyBoundsIsEmpty)
+{
+	Frustum frustum;
+	BoundsSoA bounds;
+	std::vector<uint32_t> visible = { 1, 2, 3 };
+	frustum.Cull(bounds, visible);
+	CHECK(visible.empty());
+}
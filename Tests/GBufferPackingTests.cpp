@@ -0,0 +1,98 @@
+#include "TestHarness.h"
+#include "GBufferPacking.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	std::vector<XMFLOAT3> RandomNormals(size_t a_count, unsigned int a_seed)
+	{
+		std::mt19937 random(a_seed);
+		std::normal_distribution<float> gaussian;
+		std::vector<XMFLOAT3> normals;
+		while (normals.size() < a_count) {
+			XMFLOAT3 n(gaussian(random), gaussian(random), gaussian(random));
+			float length = std::sqrt(n.x * n.x + n.y * n.y + n.z * n.z);
+			if (length < 1e-3f) continue;
+			normals.push_back(XMFLOAT3(n.x / length, n.y / length, n.z / length));
+		}
+
+		//the axes and the octahedron's fold lines are where encodings go wrong
+		for (float sign : { 1.0f, -1.0f }) {
+			normals.push_back(XMFLOAT3(sign, 0.0f, 0.0f));
+			normals.push_back(XMFLOAT3(0.0f, sign, 0.0f));
+			normals.push_back(XMFLOAT3(0.0f, 0.0f, sign));
+			normals.push_back(XMFLOAT3(0.70710678f * sign, 0.70710678f, 0.0f));
+			normals.push_back(XMFLOAT3(0.57735027f * sign, -0.57735027f, -0.57735027f));
+		}
+		return normals;
+	}
+
+	float Angle(const XMFLOAT3& a_first, const XMFLOAT3& a_second)
+	{
+		float dot = a_first.x * a_second.x + a_first.y * a_second.y + a_first.z * a_second.z;
+		return std::acos((std::min)(1.0f, (std::max)(-1.0f, dot)));
+	}
+}
+
+TEST_CASE(OctahedralRoundTripsExactly)
+{
+	float worst = 0.0f;
+	for (const XMFLOAT3& normal : RandomNormals(10000, 1)) {
+		XMFLOAT2 encoded = GBufferPacking::EncodeOctahedral(normal);
+		CHECK(std::fabs(encoded.x) <= 1.0f && std::fabs(encoded.y) <= 1.0f);
+		worst = (std::max)(worst, Angle(normal, GBufferPacking::DecodeOctahedral(encoded)));
+	}
+	CHECK(worst < 1e-3f);
+}
+
+TEST_CASE(UpperHemisphereStaysInsideTheDiamond)
+{
+	bool inside = true, outside = true;
+	for (const XMFLOAT3& normal : RandomNormals(2000, 2)) {
+		XMFLOAT2 encoded = GBufferPacking::EncodeOctahedral(normal);
+		float sum = std::fabs(encoded.x) + std::fabs(encoded.y);
+		if (normal.z > 0.0f) inside = inside && sum <= 1.0f + 1e-5f;
+		if (normal.z < 0.0f) outside = outside && sum >= 1.0f - 1e-5f;
+	}
+	CHECK(inside);
+	CHECK(outside);
+
+	XMFLOAT2 up = GBufferPacking::EncodeOctahedral(XMFLOAT3(0.0f, 0.0f, 1.0f));
+	CHECK(up.x == 0.0f && up.y == 0.0f);
+	XMFLOAT2 down = GBufferPacking::EncodeOctahedral(XMFLOAT3(0.0f, 0.0f, -1.0f));
+	CHECK(std::fabs(down.x) == 1.0f && std::fabs(down.y) == 1.0f);
+}
+
+TEST_CASE(PackedNormalsStayWithinQuantization)
+{
+	//12 bits over [-1, 1] per axis, the octahedron stretches a step to at most about 0.1 degrees
+	float worst = 0.0f;
+	for (const XMFLOAT3& normal : RandomNormals(20000, 3)) {
+		XMFLOAT3 unpacked = GBufferPacking::UnpackNormal(GBufferPacking::PackNormal(normal));
+		CHECK_NEAR(unpacked.x * unpacked.x + unpacked.y * unpacked.y + unpacked.z * unpacked.z, 1.0, 1e-5);
+		worst = (std::max)(worst, Angle(normal, unpacked));
+	}
+	printf("  worst packed normal error %.4f degrees\n", worst * 180.0f / 3.14159265f);
+	CHECK(worst < 0.002f);
+}
+
+TEST_CASE(PackedBytesMatchTheShader)
+{
+	//+z sits in the middle, 2048 on both axes
+	std::array<uint8_t, 3> up = GBufferPacking::PackNormal(XMFLOAT3(0.0f, 0.0f, 1.0f));
+	CHECK(up[0] == 0x80 && up[1] == 0x08 && up[2] == 0x00);
+
+	//+x is the right corner, 4095 and 2048
+	std::array<uint8_t, 3> right = GBufferPacking::PackNormal(XMFLOAT3(1.0f, 0.0f, 0.0f));
+	CHECK(right[0] == 0xFF && right[1] == 0xF8 && right[2] == 0x00);
+
+	//every byte pattern decodes to a unit vector, zero is -z
+	XMFLOAT3 zero = GBufferPacking::UnpackNormal({ 0, 0, 0 });
+	CHECK_NEAR(zero.z, -1.0, 1e-6);
+	XMFLOAT3 full = GBufferPacking::UnpackNormal({ 0xFF, 0xFF, 0xFF });
+	CHECK_NEAR(full.z, -1.0, 1e-6);
+	CHECK(GBufferPacking::NORMAL_MAX == 4095);
+}
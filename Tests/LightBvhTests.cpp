@@ -0,0 +1,194 @@
+#include "TestHarness.h"
+#include "LightBvh.h"
+#include "LightClusters.h"
+#include <algorithm>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	std::vector<Light> RandomLights(size_t a_count, unsigned int a_seed, float a_spotFraction)
+	{
+		std::mt19937 random(a_seed);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> range(2.0f, 10.0f);
+		std::uniform_real_distribution<float> unit(0.05f, 1.0f);
+
+		std::vector<Light> lights(a_count);
+		for (Light& light : lights) {
+			light = {};
+			light.m_Type = unit(random) < a_spotFraction ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+			light.m_Position = XMFLOAT3(position(random), position(random) * 0.2f, position(random));
+			light.m_Direction = XMFLOAT3(unit(random) - 0.5f, -1.0f, unit(random) - 0.5f);
+			light.m_Range = range(random);
+			light.m_Intensity = unit(random) * 2.0f;
+			light.m_Color = XMFLOAT3(unit(random), unit(random), unit(random));
+			light.m_SpotOuterAngle = 0.6f;
+		}
+		return lights;
+	}
+
+	//ties can pick different lights, so lists are compared by importance rather than index
+	size_t CountMismatches(const LightBvh& a_bvh, size_t a_boxCount, uint32_t a_maxLights, unsigned int a_seed)
+	{
+		std::mt19937 random(a_seed);
+		std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+		std::uniform_real_distribution<float> size(0.5f, 8.0f);
+
+		LightBvh::QueryScratch scratch;
+		std::vector<uint32_t> selected, expected;
+		size_t mismatches = 0;
+		for (size_t i = 0; i < a_boxCount; i++) {
+			XMFLOAT3 center(position(random), position(random) * 0.2f, position(random));
+			float halfSize = size(random);
+			XMFLOAT3 boxMin(center.x - halfSize, center.y - halfSize, center.z - halfSize);
+			XMFLOAT3 boxMax(center.x + halfSize, center.y + halfSize, center.z + halfSize);
+
+			a_bvh.QueryTopLights(boxMin, boxMax, a_maxLights, selected, scratch);
+			a_bvh.FindTopLightsBruteForce(boxMin, boxMax, a_maxLights, expected);
+			bool match = selected.size() == expected.size();
+			for (size_t k = 0; match && k < selected.size(); k++) {
+				match = a_bvh.GetImportance(selected[k], boxMin, boxMax) == a_bvh.GetImportance(expected[k], boxMin, boxMax);
+			}
+			if (!match) mismatches++;
+		}
+		return mismatches;
+	}
+
+	bool Contains(const Bounds& a_bounds, const XMFLOAT3& a_point)
+	{
+		const float slack = 1e-4f;
+		return std::fabs(a_point.x - a_bounds.m_center.x) <= a_bounds.m_extents.x + slack &&
+			std::fabs(a_point.y - a_bounds.m_center.y) <= a_bounds.m_extents.y + slack &&
+			std::fabs(a_point.z - a_bounds.m_center.z) <= a_bounds.m_extents.z + slack;
+	}
+}
+
+TEST_CASE(TopLightsMatchBruteForce)
+{
+	LightBvh bvh;
+	std::vector<Light> lights = RandomLights(10000, 1, 0.3f);
+	bvh.Update(lights.data(), lights.size());
+	CHECK(bvh.GetLightCount() == 10000);
+
+	for (uint32_t maxLights : { 1u, 8u, 64u }) {
+		CHECK(CountMismatches(bvh, 300, maxLights, maxLights) == 0);
+	}
+}
+
+TEST_CASE(ResultsAreMostImportantFirst)
+{
+	LightBvh bvh;
+	std::vector<Light> lights = RandomLights(2000, 2, 0.3f);
+	bvh.Update(lights.data(), lights.size());
+
+	XMFLOAT3 boxMin(-20.0f, -5.0f, -20.0f), boxMax(20.0f, 5.0f, 20.0f);
+	LightBvh::QueryScratch scratch;
+	std::vector<uint32_t> selected;
+	bvh.QueryTopLights(boxMin, boxMax, 16, selected, scratch);
+	CHECK(selected.size() == 16);
+
+	bool ordered = true;
+	for (size_t i = 0; i < selected.size(); i++) {
+		float importance = bvh.GetImportance(selected[i], boxMin, boxMax);
+		ordered = ordered && importance > 0.0f;
+		if (i > 0) ordered = ordered && importance <= bvh.GetImportance(selected[i - 1], boxMin, boxMax);
+	}
+	CHECK(ordered);
+
+	//a box nothing reaches gets nothing, not the least bad lights
+	bvh.QueryTopLights(XMFLOAT3(500.0f, 500.0f, 500.0f), XMFLOAT3(501.0f, 501.0f, 501.0f), 16, selected, scratch);
+	CHECK(selected.empty());
+}
+
+TEST_CASE(RefitsUntilTheLimitThenRebuilds)
+{
+	LightBvh bvh;
+	bvh.m_maxRefits = 3;
+	std::vector<Light> lights = RandomLights(500, 3, 0.3f);
+	bvh.Update(lights.data(), lights.size());
+	CHECK(bvh.WasRebuilt());
+
+	for (int frame = 1; frame <= 3; frame++) {
+		for (Light& light : lights) light.m_Position.x += 2.0f;
+		bvh.Update(lights.data(), lights.size());
+		CHECK(!bvh.WasRebuilt());
+		//moved lights are found where they are now, not where the tree was built
+		CHECK(CountMismatches(bvh, 100, 8, frame) == 0);
+	}
+
+	bvh.Update(lights.data(), lights.size());
+	CHECK(bvh.WasRebuilt());
+
+	lights.pop_back();
+	bvh.Update(lights.data(), lights.size());
+	CHECK(bvh.WasRebuilt());
+	CHECK(bvh.GetLightCount() == 499);
+}
+
+TEST_CASE(LightBoundsCoverTheirReach)
+{
+	Light point = {};
+	point.m_Type = LIGHT_TYPE_POINT;
+	point.m_Position = XMFLOAT3(1.0f, 2.0f, 3.0f);
+	point.m_Range = 4.0f;
+	Bounds pointBounds = LightBvh::GetLightBounds(point);
+	CHECK_NEAR(pointBounds.m_center.x, 1.0, 1e-5);
+	CHECK_NEAR(pointBounds.m_extents.y, 4.0, 1e-5);
+
+	//a spot pointing down holds its apex and the centre and rim of its cap,
+	//and is tighter than a point light of the same range
+	Light spot = point;
+	spot.m_Type = LIGHT_TYPE_SPOT;
+	spot.m_Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+	spot.m_SpotOuterAngle = 0.5f;
+	Bounds spotBounds = LightBvh::GetLightBounds(spot);
+	float rim = std::sin(0.5f) * 4.0f;
+	CHECK(Contains(spotBounds, spot.m_Position));
+	CHECK(Contains(spotBounds, XMFLOAT3(1.0f, -2.0f, 3.0f)));
+	CHECK(Contains(spotBounds, XMFLOAT3(1.0f + rim, 2.0f - std::cos(0.5f) * 4.0f, 3.0f)));
+	CHECK(spotBounds.m_extents.x < pointBounds.m_extents.x);
+	CHECK(spotBounds.m_center.y + spotBounds.m_extents.y <= 2.0f + 1e-4f);
+}
+
+TEST_CASE(ClusterSelectionMatchesBinning)
+{
+	//with a budget nothing reaches, picking by importance keeps exactly the lights binning finds
+	std::vector<Light> lights = RandomLights(1500, 5, 0.0f);
+	for (Light& light : lights) light.m_Position.z += 100.0f;
+
+	std::vector<XMFLOAT4> spheres;
+	for (const Light& light : lights) spheres.push_back(XMFLOAT4(light.m_Position.x, light.m_Position.y, light.m_Position.z, light.m_Range));
+
+	LightBvh bvh;
+	bvh.Update(lights.data(), lights.size());
+
+	XMFLOAT4X4 projection, identity;
+	XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, 0.1f, 200.0f));
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	LightClusters binned, selected;
+	binned.SetProjection(projection, 0.1f, 200.0f, false);
+	selected.SetProjection(projection, 0.1f, 200.0f, false);
+	binned.Bin(spheres);
+	selected.SelectFromBvh(bvh, identity, LightClusters::MAX_LIGHTS_PER_CLUSTER);
+	CHECK(!binned.GetIndices().empty());
+	CHECK(binned.GetMaxLightsInCluster() < LightClusters::MAX_LIGHTS_PER_CLUSTER);
+
+	bool same = true;
+	for (uint32_t cluster = 0; cluster < binned.GetClusterCount(); cluster++) {
+		const ClusterRange& binnedRange = binned.GetRanges()[cluster];
+		const ClusterRange& selectedRange = selected.GetRanges()[cluster];
+		std::vector<uint32_t> binnedLights(binned.GetIndices().begin() + binnedRange.m_offset, binned.GetIndices().begin() + binnedRange.m_offset + binnedRange.m_count);
+		std::vector<uint32_t> selectedLights(selected.GetIndices().begin() + selectedRange.m_offset, selected.GetIndices().begin() + selectedRange.m_offset + selectedRange.m_count);
+		std::sort(binnedLights.begin(), binnedLights.end());
+		std::sort(selectedLights.begin(), selectedLights.end());
+		same = same && binnedLights == selectedLights;
+	}
+	CHECK(same);
+
+	//a small budget keeps every cluster under it
+	selected.SelectFromBvh(bvh, identity, 4);
+	CHECK(selected.GetMaxLightsInCluster() <= 4);
+}
@@ -0,0 +1,131 @@
+#include "TestHarness.h"
+#include "LightClusters.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT4X4 Perspective(float a_nearPlane, float a_farPlane)
+	{
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, XMMatrixPerspectiveFovLH(XM_PIDIV4, 16.0f / 9.0f, a_nearPlane, a_farPlane));
+		return projection;
+	}
+
+	std::vector<XMFLOAT4> RandomSpheres(size_t a_count, float a_farPlane, unsigned int a_seed)
+	{
+		std::mt19937 random(a_seed);
+		std::uniform_real_distribution<float> side(-a_farPlane * 0.5f, a_farPlane * 0.5f);
+		std::uniform_real_distribution<float> depth(-2.0f, a_farPlane + 2.0f);
+		std::uniform_real_distribution<float> range(0.5f, 6.0f);
+
+		std::vector<XMFLOAT4> spheres(a_count);
+		for (XMFLOAT4& sphere : spheres) sphere = XMFLOAT4(side(random), side(random) * 0.5f, depth(random), range(random));
+		return spheres;
+	}
+
+	//per cluster sorted light lists, from Bin's output
+	std::vector<std::vector<uint32_t>> BinnedLists(const LightClusters& a_clusters)
+	{
+		std::vector<std::vector<uint32_t>> lists(a_clusters.GetClusterCount());
+		for (uint32_t cluster = 0; cluster < lists.size(); cluster++) {
+			const ClusterRange& range = a_clusters.GetRanges()[cluster];
+			lists[cluster].assign(a_clusters.GetIndices().begin() + range.m_offset, a_clusters.GetIndices().begin() + range.m_offset + range.m_count);
+			std::sort(lists[cluster].begin(), lists[cluster].end());
+		}
+		return lists;
+	}
+
+	std::vector<std::vector<uint32_t>> BruteForceLists(const LightClusters& a_clusters, const std::vector<XMFLOAT4>& a_spheres)
+	{
+		std::vector<std::vector<uint32_t>> lists(a_clusters.GetClusterCount());
+		for (uint32_t light = 0; light < a_spheres.size(); light++) {
+			for (uint32_t cluster : a_clusters.FindClustersBruteForce(a_spheres[light])) lists[cluster].push_back(light);
+		}
+		return lists;
+	}
+}
+
+TEST_CASE(BinMatchesBruteForce)
+{
+	for (bool orthographic : { false, true }) {
+		LightClusters clusters;
+		XMFLOAT4X4 projection = Perspective(0.1f, 100.0f);
+		if (orthographic) XMStoreFloat4x4(&projection, XMMatrixOrthographicLH(80.0f, 45.0f, 0.1f, 100.0f));
+		clusters.SetProjection(projection, 0.1f, 100.0f, orthographic);
+
+		std::vector<XMFLOAT4> spheres = RandomSpheres(2000, 100.0f, orthographic ? 2 : 1);
+		clusters.Bin(spheres);
+		CHECK(clusters.GetOverflowCount() == 0);
+		CHECK(BinnedLists(clusters) == BruteForceLists(clusters, spheres));
+	}
+}
+
+TEST_CASE(RangesPackTheIndexList)
+{
+	LightClusters clusters(8, 4, 12);
+	clusters.SetProjection(Perspective(0.1f, 50.0f), 0.1f, 50.0f, false);
+	clusters.Bin(RandomSpheres(500, 50.0f, 3));
+
+	CHECK(clusters.GetRanges().size() == clusters.GetClusterCount());
+	uint32_t next = 0;
+	uint32_t most = 0;
+	bool packed = true;
+	for (const ClusterRange& range : clusters.GetRanges()) {
+		packed = packed && range.m_offset == next;
+		next += range.m_count;
+		most = (std::max)(most, range.m_count);
+	}
+	CHECK(packed);
+	CHECK(next == clusters.GetIndices().size());
+	CHECK(most == clusters.GetMaxLightsInCluster());
+}
+
+TEST_CASE(ThreadCountDoesNotChangeTheResult)
+{
+	std::vector<XMFLOAT4> spheres = RandomSpheres(3000, 100.0f, 4);
+	LightClusters single, threaded;
+	single.m_maxThreads = 1;
+	threaded.m_maxThreads = 8;
+	single.SetProjection(Perspective(0.1f, 100.0f), 0.1f, 100.0f, false);
+	threaded.SetProjection(Perspective(0.1f, 100.0f), 0.1f, 100.0f, false);
+	single.Bin(spheres);
+	threaded.Bin(spheres);
+	CHECK(single.GetIndices() == threaded.GetIndices());
+
+	//scratch is reused between frames, binning again gives the same lists
+	threaded.Bin(spheres);
+	CHECK(single.GetIndices() == threaded.GetIndices());
+}
+
+TEST_CASE(CrowdedClustersOverflow)
+{
+	//more lights than a cluster holds all on the same spot
+	LightClusters clusters;
+	clusters.SetProjection(Perspective(0.1f, 100.0f), 0.1f, 100.0f, false);
+	std::vector<XMFLOAT4> spheres(LightClusters::MAX_LIGHTS_PER_CLUSTER + 40, XMFLOAT4(0.0f, 0.0f, 20.0f, 0.5f));
+	clusters.Bin(spheres);
+
+	CHECK(clusters.GetMaxLightsInCluster() == LightClusters::MAX_LIGHTS_PER_CLUSTER);
+	CHECK(clusters.GetOverflowCount() > 0);
+	bool capped = true;
+	for (const ClusterRange& range : clusters.GetRanges()) capped = capped && range.m_count <= LightClusters::MAX_LIGHTS_PER_CLUSTER;
+	CHECK(capped);
+}
+
+TEST_CASE(SlicesSpanNearToFar)
+{
+	LightClusters clusters(16, 9, 24);
+	clusters.SetProjection(Perspective(0.5f, 200.0f), 0.5f, 200.0f, false);
+
+	//the shader's slice formula puts the near plane at 0 and the far plane at the last slice's end
+	CHECK_NEAR(std::log(0.5f) * clusters.GetSliceScale() + clusters.GetSliceBias(), 0.0, 1e-4);
+	CHECK_NEAR(std::log(200.0f) * clusters.GetSliceScale() + clusters.GetSliceBias(), 24.0, 1e-3);
+
+	//a light behind the camera touches nothing
+	clusters.Bin({ XMFLOAT4(0.0f, 0.0f, -10.0f, 2.0f) });
+	CHECK(clusters.GetIndices().empty());
+}
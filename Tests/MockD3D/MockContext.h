@@ -0,0 +1,53 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <d3d11.h>
+
+/// <summary>
+/// Device context stand-in for StateCache, records every call that reaches
+/// it instead of binding anything. Only the first handle of a range is kept.
+/// </summary>
+class MockContext
+{
+public:
+	struct Call
+	{
+		std::string m_function;
+		unsigned int m_slot;
+		unsigned int m_count;
+		const void* m_value;
+	};
+
+	std::vector<Call> m_calls;
+
+	void VSSetShader(ID3D11VertexShader* a_pShader, void*, unsigned int) { Record("VSSetShader", 0, 1, a_pShader); }
+	void PSSetShader(ID3D11PixelShader* a_pShader, void*, unsigned int) { Record("PSSetShader", 0, 1, a_pShader); }
+
+	void VSSetShaderResources(unsigned int a_slot, unsigned int a_count, ID3D11ShaderResourceView* const* a_ppViews) { Record("VSSetShaderResources", a_slot, a_count, a_ppViews[0]); }
+	void PSSetShaderResources(unsigned int a_slot, unsigned int a_count, ID3D11ShaderResourceView* const* a_ppViews) { Record("PSSetShaderResources", a_slot, a_count, a_ppViews[0]); }
+	void PSSetSamplers(unsigned int a_slot, unsigned int a_count, ID3D11SamplerState* const* a_ppSamplers) { Record("PSSetSamplers", a_slot, a_count, a_ppSamplers[0]); }
+
+	void VSSetConstantBuffers1(unsigned int a_slot, unsigned int a_count, ID3D11Buffer* const* a_ppBuffers, const unsigned int*, const unsigned int*) { Record("VSSetConstantBuffers1", a_slot, a_count, a_ppBuffers[0]); }
+	void PSSetConstantBuffers1(unsigned int a_slot, unsigned int a_count, ID3D11Buffer* const* a_ppBuffers, const unsigned int*, const unsigned int*) { Record("PSSetConstantBuffers1", a_slot, a_count, a_ppBuffers[0]); }
+
+	void IASetInputLayout(ID3D11InputLayout* a_pInputLayout) { Record("IASetInputLayout", 0, 1, a_pInputLayout); }
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY) { Record("IASetPrimitiveTopology", 0, 1, nullptr); }
+	void IASetVertexBuffers(unsigned int a_slot, unsigned int a_count, ID3D11Buffer* const* a_ppBuffers, const unsigned int*, const unsigned int*) { Record("IASetVertexBuffers", a_slot, a_count, a_ppBuffers[0]); }
+	void IASetIndexBuffer(ID3D11Buffer* a_pBuffer, DXGI_FORMAT, unsigned int) { Record("IASetIndexBuffer", 0, 1, a_pBuffer); }
+
+	void RSSetState(ID3D11RasterizerState* a_pState) { Record("RSSetState", 0, 1, a_pState); }
+	void OMSetDepthStencilState(ID3D11DepthStencilState* a_pState, unsigned int) { Record("OMSetDepthStencilState", 0, 1, a_pState); }
+
+	/// <summary>
+	/// Fake interface pointer, distinct per id and never dereferenced
+	/// </summary>
+	template <typename T>
+	static T* Handle(uintptr_t a_id) { return reinterpret_cast<T*>(a_id * 16); }
+
+private:
+	void Record(const char* a_function, unsigned int a_slot, unsigned int a_count, const void* a_value)
+	{
+		m_calls.push_back({ a_function, a_slot, a_count, a_value });
+	}
+};
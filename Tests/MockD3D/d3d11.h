@@ -0,0 +1,31 @@
+#pragma once
+
+// Stand-in for the Windows SDK header, only what the templated state code names.
+// The interfaces are never defined, tests use their addresses as handles.
+
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11ShaderResourceView;
+struct ID3D11SamplerState;
+struct ID3D11Buffer;
+struct ID3D11InputLayout;
+struct ID3D11RasterizerState;
+struct ID3D11DepthStencilState;
+
+#define D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT 16
+#define D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT 14
+
+enum D3D11_PRIMITIVE_TOPOLOGY
+{
+	D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED = 0,
+	D3D11_PRIMITIVE_TOPOLOGY_POINTLIST = 1,
+	D3D11_PRIMITIVE_TOPOLOGY_LINELIST = 2,
+	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4
+};
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32_UINT = 42,
+	DXGI_FORMAT_R16_UINT = 57
+};
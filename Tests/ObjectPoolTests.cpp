@@ -0,0 +1,130 @@
+#include "TestHarness.h"
+#include "ObjectPool.h"
+#include <set>
+#include <stdexcept>
+
+namespace
+{
+	int liveCount = 0;
+
+	struct Tracked
+	{
+		int m_value;
+		explicit Tracked(int a_value) : m_value(a_value) { liveCount++; }
+		~Tracked() { liveCount--; }
+	};
+
+	struct ThrowsOnNegative
+	{
+		int m_value;
+		explicit ThrowsOnNegative(int a_value) : m_value(a_value)
+		{
+			if (a_value < 0) throw std::runtime_error("negative");
+		}
+	};
+}
+
+TEST_CASE(PointersStayValidAcrossChunks)
+{
+	ObjectPool<Tracked, 4> pool;
+	std::vector<Tracked*> objects;
+	for (int i = 0; i < 19; i++) objects.push_back(pool.Create(i));
+
+	CHECK(pool.Count() == 19);
+	CHECK(pool.ChunkCount() == 5);
+	CHECK(pool.Capacity() == 20);
+	for (int i = 0; i < 19; i++) CHECK(objects[i]->m_value == i);
+}
+
+TEST_CASE(DestroyedSlotsAreReused)
+{
+	ObjectPool<Tracked, 4> pool;
+	Tracked* a = pool.Create(1);
+	Tracked* b = pool.Create(2);
+	pool.Destroy(a);
+	CHECK(pool.Count() == 1);
+
+	Tracked* c = pool.Create(3);
+	CHECK(c == a);
+	CHECK(b->m_value == 2);
+	CHECK(pool.ChunkCount() == 1);
+	CHECK(pool.TotalCreated() == 3);
+	CHECK(pool.TotalDestroyed() == 1);
+}
+
+TEST_CASE(DestroyIgnoresNullAndDeadObjects)
+{
+	ObjectPool<Tracked, 4> pool;
+	Tracked* a = pool.Create(1);
+	pool.Destroy(nullptr);
+	pool.Destroy(a);
+	pool.Destroy(a);
+	CHECK(pool.Count() == 0);
+	CHECK(pool.TotalDestroyed() == 1);
+}
+
+TEST_CASE(DenseListHoldsEveryLiveObject)
+{
+	ObjectPool<Tracked, 8> pool;
+	std::vector<Tracked*> objects;
+	for (int i = 0; i < 30; i++) objects.push_back(pool.Create(i));
+	for (int i = 0; i < 30; i += 3) pool.Destroy(objects[i]);
+
+	std::set<int> seen;
+	for (Tracked* object : pool) seen.insert(object->m_value);
+	CHECK(seen.size() == pool.Count());
+	for (int i = 0; i < 30; i++) CHECK((seen.count(i) == 1) == (i % 3 != 0));
+}
+
+TEST_CASE(ClearAndDestructionRunDestructors)
+{
+	liveCount = 0;
+	{
+		ObjectPool<Tracked, 4> pool;
+		for (int i = 0; i < 10; i++) pool.Create(i);
+		pool.Clear();
+		CHECK(liveCount == 0);
+		CHECK(pool.Capacity() == 12);
+
+		for (int i = 0; i < 6; i++) pool.Create(i);
+		CHECK(liveCount == 6);
+	}
+	CHECK(liveCount == 0);
+}
+
+TEST_CASE(ThrowingConstructorLeavesPoolUnchanged)
+{
+	ObjectPool<ThrowsOnNegative, 4> pool;
+	ThrowsOnNegative* first = pool.Create(1);
+	ThrowsOnNegative* freed = pool.Create(2);
+	pool.Destroy(freed);
+
+	bool threw = false;
+	try {
+		pool.Create(-1);
+	}
+	catch (const std::runtime_error&) {
+		threw = true;
+	}
+	CHECK(threw);
+	CHECK(pool.Count() == 1);
+	CHECK(pool.TotalCreated() == 2);
+	CHECK(first->m_value == 1);
+
+	//the slot the failed object was going into is handed out next
+	ThrowsOnNegative* next = pool.Create(3);
+	CHECK(next == freed);
+	CHECK(pool.Count() == 2);
+}
+
+TEST_CASE(FragmentationIsUnusedFractionOfSlots)
+{
+	ObjectPool<Tracked, 10> pool;
+	CHECK(pool.GetFragmentation() == 0.0f);
+
+	std::vector<Tracked*> objects;
+	for (int i = 0; i < 10; i++) objects.push_back(pool.Create(i));
+	CHECK_NEAR(pool.GetFragmentation(), 0.0, 1e-6);
+	for (int i = 0; i < 4; i++) pool.Destroy(objects[i]);
+	CHECK_NEAR(pool.GetFragmentation(), 0.4, 1e-6);
+}
@@ -0,0 +1,256 @@
+#include "TestHarness.h"
+#include "TestMeshes.h"
+#include "OcclusionCuller.h"
+#include "Frustum.h"
+#include <cfloat>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	struct Box
+	{
+		XMFLOAT3 m_min;
+		XMFLOAT3 m_max;
+	};
+
+	const XMFLOAT3 EYE(2.0f, 1.7f, -6.0f);
+
+	XMFLOAT4X4 StreetViewProjection()
+	{
+		XMMATRIX view = XMMatrixLookToLH(XMLoadFloat3(&EYE), XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		XMFLOAT4X4 viewProjection;
+		XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(view, XMMatrixPerspectiveFovLH(1.0f, 16.0f / 9.0f, 0.1f, 500.0f)));
+		return viewProjection;
+	}
+
+	Bounds ToBounds(const Box& a_box)
+	{
+		return Bounds::FromMinMax(a_box.m_min, a_box.m_max);
+	}
+
+	void AddBox(OcclusionCuller& a_culler, const Box& a_box)
+	{
+		a_culler.AddOccluder(TestMeshes::CUBE_POSITIONS.data(), TestMeshes::CUBE_INDICES.data(),
+			static_cast<uint32_t>(TestMeshes::CUBE_INDICES.size()), TestMeshes::BoxWorld(a_box.m_min, a_box.m_max));
+	}
+
+	/// <summary>
+	/// Eight by eight blocks of 16m square buildings between 8m streets, the
+	/// camera stands in the street along z = 0..8 looking down it
+	/// </summary>
+	std::vector<Box> CityBlocks()
+	{
+		std::vector<Box> buildings;
+		for (int blockX = -4; blockX < 4; blockX++) {
+			for (int blockZ = 0; blockZ < 8; blockZ++) {
+				float x = blockX * 24.0f + 4.0f;
+				float z = blockZ * 24.0f;
+				float height = 12.0f + static_cast<float>((blockX * 7 + blockZ * 3) & 7) * 3.0f;
+				buildings.push_back({ XMFLOAT3(x, 0.0f, z), XMFLOAT3(x + 16.0f, height, z + 16.0f) });
+			}
+		}
+		return buildings;
+	}
+
+	bool Inside(const Box& a_box, const XMFLOAT3& a_point, float a_margin)
+	{
+		return a_point.x > a_box.m_min.x - a_margin && a_point.x < a_box.m_max.x + a_margin &&
+			a_point.y > a_box.m_min.y - a_margin && a_point.y < a_box.m_max.y + a_margin &&
+			a_point.z > a_box.m_min.z - a_margin && a_point.z < a_box.m_max.z + a_margin;
+	}
+
+	//segment from the eye against every building grown by a_margin
+	bool LineOfSight(const std::vector<Box>& a_buildings, const XMFLOAT3& a_target, float a_margin)
+	{
+		float direction[3] = { a_target.x - EYE.x, a_target.y - EYE.y, a_target.z - EYE.z };
+		float origin[3] = { EYE.x, EYE.y, EYE.z };
+		for (const Box& building : a_buildings) {
+			float min[3] = { building.m_min.x - a_margin, building.m_min.y - a_margin, building.m_min.z - a_margin };
+			float max[3] = { building.m_max.x + a_margin, building.m_max.y + a_margin, building.m_max.z + a_margin };
+			float entry = 0.0f;
+			float exit = 1.0f;
+			for (int axis = 0; axis < 3; axis++) {
+				if (std::fabs(direction[axis]) < 1e-9f) {
+					if (origin[axis] < min[axis] || origin[axis] > max[axis]) exit = -1.0f;
+					continue;
+				}
+				float t1 = (min[axis] - origin[axis]) / direction[axis];
+				float t2 = (max[axis] - origin[axis]) / direction[axis];
+				entry = (std::max)(entry, (std::min)(t1, t2));
+				exit = (std::min)(exit, (std::max)(t1, t2));
+			}
+			if (entry <= exit) return false;
+		}
+		return true;
+	}
+}
+
+TEST_CASE(BoxBehindWallIsOccluded)
+{
+	OcclusionCuller culler(320, 180, 4);
+	culler.BeginFrame(StreetViewProjection());
+	AddBox(culler, { XMFLOAT3(-20.0f, 0.0f, 10.0f), XMFLOAT3(20.0f, 20.0f, 11.0f) });
+	culler.Rasterize();
+	CHECK(culler.GetTriangleCount() > 0);
+
+	CHECK(!culler.IsVisible(ToBounds({ XMFLOAT3(1.0f, 0.0f, 20.0f), XMFLOAT3(3.0f, 2.0f, 22.0f) })));
+	CHECK(culler.IsVisible(ToBounds({ XMFLOAT3(1.0f, 0.0f, 5.0f), XMFLOAT3(3.0f, 2.0f, 7.0f) })));
+
+	//pokes out over the top of the wall
+	CHECK(culler.IsVisible(ToBounds({ XMFLOAT3(1.0f, 0.0f, 20.0f), XMFLOAT3(3.0f, 40.0f, 22.0f) })));
+
+	//behind the camera or across the near plane is never culled
+	CHECK(culler.IsVisible(ToBounds({ XMFLOAT3(1.0f, 0.0f, -20.0f), XMFLOAT3(3.0f, 2.0f, -18.0f) })));
+	CHECK(culler.IsVisible(ToBounds({ XMFLOAT3(1.0f, 1.0f, -7.0f), XMFLOAT3(3.0f, 2.0f, 30.0f) })));
+}
+
+TEST_CASE(EmptyBufferCullsNothing)
+{
+	OcclusionCuller culler;
+	Bounds box = ToBounds({ XMFLOAT3(1.0f, 0.0f, 20.0f), XMFLOAT3(3.0f, 2.0f, 22.0f) });
+	CHECK(culler.IsVisible(box));
+
+	culler.BeginFrame(StreetViewProjection());
+	culler.Rasterize();
+	CHECK(culler.IsVisible(box));
+}
+
+TEST_CASE(NearPlaneCrossingOccludersAreDropped)
+{
+	OcclusionCuller culler;
+	culler.BeginFrame(StreetViewProjection());
+	AddBox(culler, { XMFLOAT3(-20.0f, 0.0f, -10.0f), XMFLOAT3(20.0f, 20.0f, 11.0f) });
+	culler.Rasterize();
+
+	//the camera is inside this box, the faces it sees from inside cross the near plane
+	CHECK(culler.GetTriangleCount() < 12);
+}
+
+TEST_CASE(FilterVisibleMatchesIsVisible)
+{
+	OcclusionCuller culler(256, 144, 3);
+	culler.BeginFrame(StreetViewProjection());
+	std::vector<Box> buildings = CityBlocks();
+	for (const Box& building : buildings) AddBox(culler, building);
+	culler.Rasterize();
+
+	std::mt19937 random(42);
+	std::uniform_real_distribution<float> x(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> z(-4.0f, 190.0f);
+	std::vector<Bounds> bounds;
+	std::vector<uint32_t> indices;
+	for (uint32_t i = 0; i < 5000; i++) {
+		XMFLOAT3 center(x(random), 1.0f, z(random));
+		bounds.push_back(ToBounds({ XMFLOAT3(center.x - 1.0f, 0.0f, center.z - 1.0f), XMFLOAT3(center.x + 1.0f, 2.0f, center.z + 1.0f) }));
+		indices.push_back(i * 3);
+	}
+
+	std::vector<uint32_t> expected;
+	for (uint32_t i = 0; i < bounds.size(); i++) {
+		if (culler.IsVisible(bounds[i])) expected.push_back(indices[i]);
+	}
+	culler.FilterVisible(bounds, indices);
+	CHECK(indices == expected);
+}
+
+TEST_CASE(CityBlockOccludedFraction)
+{
+	OcclusionCuller culler(320, 180, 4);
+	XMFLOAT4X4 viewProjection = StreetViewProjection();
+	culler.BeginFrame(viewProjection);
+	std::vector<Box> buildings = CityBlocks();
+	for (const Box& building : buildings) AddBox(culler, building);
+	culler.Rasterize();
+
+	Frustum frustum;
+	frustum.ExtractPlanes(viewProjection);
+
+	//cars and props on the streets, only the ones the frustum keeps count
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> x(-92.0f, 100.0f);
+	std::uniform_real_distribution<float> z(-4.0f, 188.0f);
+	size_t candidates = 0;
+	size_t occluded = 0;
+	size_t wronglyCulled = 0;
+	while (candidates < 4000) {
+		XMFLOAT3 center(x(random), 1.0f, z(random));
+		bool inBuilding = false;
+		for (const Box& building : buildings) inBuilding |= Inside(building, center, 1.5f);
+		if (inBuilding) continue;
+
+		Box prop = { XMFLOAT3(center.x - 1.0f, 0.0f, center.z - 1.0f), XMFLOAT3(center.x + 1.0f, 2.0f, center.z + 1.0f) };
+		Bounds bounds = ToBounds(prop);
+		if (!frustum.IntersectsBox(bounds.m_center, bounds.m_extents)) continue;
+		candidates++;
+
+		if (culler.IsVisible(bounds)) continue;
+		occluded++;
+
+		//culling must stay conservative, a prop in clear view by a margin of
+		//a couple of buffer pixels is never hidden
+		if (LineOfSight(buildings, center, 2.0f)) wronglyCulled++;
+	}
+
+	double fraction = static_cast<double>(occluded) / candidates;
+	printf("  city block: %zu of %zu props in the frustum occluded (%.1f%%), %zu culled in clear view\n",
+		occluded, candidates, fraction * 100.0, wronglyCulled);
+	CHECK(fraction > 0.6);
+	CHECK(wronglyCulled == 0);
+
+	//straight down the street stays visible
+	for (float distance = 10.0f; distance < 180.0f; distance += 10.0f) {
+		CHECK(culler.IsVisible(ToBounds({ XMFLOAT3(1.0f, 0.0f, distance), XMFLOAT3(3.0f, 2.0f, distance + 2.0f) })));
+	}
+}
+
+TEST_CASE(OverdrawDependsOnDrawOrder)
+{
+	//two walls straight ahead, only their fronts face the eye and the far one is
+	//big enough to be behind every pixel of the near one
+	Box nearWall = { XMFLOAT3(-3.0f, 0.0f, 10.0f), XMFLOAT3(7.0f, 3.0f, 11.0f) };
+	Box farWall = { XMFLOAT3(-10.0f, -5.0f, 20.0f), XMFLOAT3(14.0f, 8.0f, 21.0f) };
+	OcclusionCuller culler(320, 180, 4);
+	auto estimate = [&](const Box& a_first, const Box& a_second) {
+		culler.BeginFrame(StreetViewProjection());
+		AddBox(culler, a_first);
+		AddBox(culler, a_second);
+		return culler.EstimateOverdraw();
+	};
+
+	//front to back every covered pixel is shaded once, back faces never count
+	OcclusionCuller::OverdrawEstimate frontToBack = estimate(nearWall, farWall);
+	CHECK(frontToBack.m_coveredPixels > 0);
+	CHECK(frontToBack.m_shadedFragments == frontToBack.m_coveredPixels);
+	CHECK(frontToBack.GetOverdraw() == 1.0);
+
+	//back to front shades the near wall's pixels twice, same pixels end up covered
+	OcclusionCuller::OverdrawEstimate backToFront = estimate(farWall, nearWall);
+	CHECK(backToFront.m_coveredPixels == frontToBack.m_coveredPixels);
+	CHECK(backToFront.m_shadedFragments > frontToBack.m_shadedFragments);
+
+	//the near wall alone, its pixels are exactly the extra fragments
+	culler.BeginFrame(StreetViewProjection());
+	AddBox(culler, nearWall);
+	OcclusionCuller::OverdrawEstimate nearOnly = culler.EstimateOverdraw();
+	CHECK(backToFront.m_shadedFragments == frontToBack.m_shadedFragments + nearOnly.m_coveredPixels);
+	printf("  back to front %.2fx, front to back %.2fx\n", backToFront.GetOverdraw(), frontToBack.GetOverdraw());
+
+	//nothing drawn is no overdraw rather than a division by zero
+	culler.BeginFrame(StreetViewProjection());
+	CHECK(culler.EstimateOverdraw().GetOverdraw() == 0.0);
+}
+
+TEST_CASE(OverdrawEstimateLeavesNothingCulled)
+{
+	OcclusionCuller culler(320, 180, 4);
+	culler.BeginFrame(StreetViewProjection());
+	AddBox(culler, { XMFLOAT3(-20.0f, 0.0f, 10.0f), XMFLOAT3(20.0f, 20.0f, 11.0f) });
+	Bounds hidden = ToBounds({ XMFLOAT3(1.0f, 0.0f, 20.0f), XMFLOAT3(3.0f, 2.0f, 22.0f) });
+
+	culler.Rasterize();
+	CHECK(!culler.IsVisible(hidden));
+	culler.EstimateOverdraw();
+	CHECK(culler.IsVisible(hidden));
+}
@@ -0,0 +1,162 @@
+#include "TestHarness.h"
+#include "PbrReference.h"
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	Light MakeLight(int a_type, const XMFLOAT3& a_position, const XMFLOAT3& a_direction, const XMFLOAT3& a_color, float a_intensity)
+	{
+		Light light = {};
+		light.m_Type = a_type;
+		light.m_Position = a_position;
+		light.m_Direction = a_direction;
+		light.m_Color = a_color;
+		light.m_Intensity = a_intensity;
+		light.m_Range = 4.0f;
+		light.m_SpotInnerAngle = 0.3f;
+		light.m_SpotOuterAngle = 0.6f;
+		light.m_ShadowIndex = -1;
+		return light;
+	}
+
+	//a floor sample at the origin seen from straight above
+	PbrReference::Surface Floor(float a_roughness, float a_metalness, const XMFLOAT3& a_albedo = XMFLOAT3(1.0f, 1.0f, 1.0f))
+	{
+		PbrReference::Surface surface;
+		surface.m_albedo = a_albedo;
+		surface.m_roughness = a_roughness;
+		surface.m_metalness = a_metalness;
+		return surface;
+	}
+
+	//shades a_surface both ways, the batched result is padded next to three other samples
+	void CheckGolden(const Light& a_light, const PbrReference::Surface& a_surface, const XMFLOAT3& a_expected)
+	{
+		PbrReference reference;
+		reference.SetLights(&a_light, 1, XMFLOAT3(0.0f, 1.0f, 0.0f));
+
+		XMFLOAT3 scalar = reference.ShadeScalar(a_surface);
+		CHECK_NEAR(scalar.x, a_expected.x, 1e-5 * (std::max)(1.0f, a_expected.x));
+		CHECK_NEAR(scalar.y, a_expected.y, 1e-5 * (std::max)(1.0f, a_expected.y));
+		CHECK_NEAR(scalar.z, a_expected.z, 1e-5 * (std::max)(1.0f, a_expected.z));
+
+		PbrReference::SurfaceBatch batch;
+		batch.Resize(3);
+		batch.Set(1, a_surface);
+		PbrReference::ColorBatch colors;
+		reference.Shade(batch, colors);
+		XMFLOAT3 batched = colors.Get(1);
+		CHECK_NEAR(batched.x, a_expected.x, 1e-4 * (std::max)(1.0f, a_expected.x));
+		CHECK_NEAR(batched.y, a_expected.y, 1e-4 * (std::max)(1.0f, a_expected.y));
+		CHECK_NEAR(batched.z, a_expected.z, 1e-4 * (std::max)(1.0f, a_expected.z));
+	}
+}
+
+//expected values are worked by hand from Lighting.hlsli, 3.14 for pi and all
+
+TEST_CASE(DirectionalGolden)
+{
+	//D = 1 / 3.14 at roughness 1, F = G = 1 head on, 0.96 of the diffuse survives the fresnel balance
+	Light sun = MakeLight(LIGHT_TYPE_DIRECTIONAL, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 1.0f);
+	CheckGolden(sun, Floor(1.0f, 0.0f), XMFLOAT3(0.9631847f, 0.9631847f, 0.9631847f));
+
+	//fully metal keeps only the specular, tinted by the albedo
+	CheckGolden(sun, Floor(1.0f, 1.0f, XMFLOAT3(1.0f, 0.5f, 0.0f)), XMFLOAT3(0.0796178f, 0.0398089f, 0.0f));
+}
+
+TEST_CASE(PointGolden)
+{
+	//the shader leaves the direction to a point light unnormalized, 2m away the diffuse is doubled
+	//and then squared by the balance, before the (1 - 4 / 16)^2 falloff
+	Light point = MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(1.0f, 0.5f, 0.25f), 2.0f);
+	CheckGolden(point, Floor(0.5f, 0.0f), XMFLOAT3(4.3773248f, 0.5686624f, 0.0818312f));
+
+	//out of range adds nothing
+	point.m_Position = XMFLOAT3(0.0f, 4.5f, 0.0f);
+	CheckGolden(point, Floor(0.5f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+}
+
+TEST_CASE(SpotGolden)
+{
+	//the spot term compares the unnormalized pixel to light vector with the light's direction,
+	//here 0.9 between cos 0.6 and cos 0.3 scales the point result by 0.5743376
+	Light spot = MakeLight(LIGHT_TYPE_SPOT, XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.8930286f, 0.45f, 0.0f), XMFLOAT3(1.0f, 0.5f, 0.25f), 2.0f);
+	CheckGolden(spot, Floor(0.5f, 0.0f), XMFLOAT3(2.5140616f, 0.3266039f, 0.0469987f));
+
+	//from the inner angle's cosine up it's fully on, from the outer one's down off
+	spot.m_Direction = XMFLOAT3(0.0f, 1.0f, 0.0f);
+	CheckGolden(spot, Floor(0.5f, 0.0f), XMFLOAT3(4.3773248f, 0.5686624f, 0.0818312f));
+	spot.m_Direction = XMFLOAT3(0.0f, -1.0f, 0.0f);
+	CheckGolden(spot, Floor(0.5f, 0.0f), XMFLOAT3(0.0f, 0.0f, 0.0f));
+}
+
+TEST_CASE(LightsAddUp)
+{
+	Light lights[] = {
+		MakeLight(LIGHT_TYPE_DIRECTIONAL, XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 1.0f),
+		MakeLight(LIGHT_TYPE_POINT, XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(1.0f, 0.5f, 0.25f), 2.0f),
+		MakeLight(7, XMFLOAT3(0.0f, 2.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 100.0f), // unknown types are skipped
+	};
+	PbrReference reference;
+	reference.SetLights(lights, 3, XMFLOAT3(0.0f, 1.0f, 0.0f));
+	CHECK(reference.GetLightCount() == 3);
+	CHECK_NEAR(reference.ShadeScalar(Floor(0.5f, 0.0f)).z, 0.0818312 + 1.0109554, 1e-5);
+}
+
+TEST_CASE(BatchedMatchesScalar)
+{
+	//random lights and surfaces, a ragged batch so the last lanes are padding
+	std::mt19937 random(49);
+	std::uniform_real_distribution<float> offset(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> axis(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	std::vector<Light> lights;
+	for (int i = 0; i < 24; i++) {
+		XMFLOAT3 direction;
+		XMStoreFloat3(&direction, XMVector3Normalize(XMVectorSet(axis(random), axis(random), axis(random), 0.0f)));
+		Light light = MakeLight(i % 3, XMFLOAT3(offset(random), offset(random), offset(random)), direction,
+			XMFLOAT3(unit(random), unit(random), unit(random)), 0.5f + unit(random));
+		light.m_Range = 3.0f + 10.0f * unit(random);
+		lights.push_back(light);
+	}
+	PbrReference reference;
+	reference.SetLights(lights.data(), lights.size(), XMFLOAT3(1.0f, 2.0f, -3.0f));
+
+	const size_t count = 1001;
+	PbrReference::SurfaceBatch surfaces;
+	surfaces.Resize(count);
+	CHECK(surfaces.m_positionX.size() == 1004);
+	for (size_t i = 0; i < count; i++) {
+		PbrReference::Surface surface;
+		surface.m_position = XMFLOAT3(offset(random), offset(random), offset(random));
+		XMStoreFloat3(&surface.m_normal, XMVector3Normalize(XMVectorSet(axis(random), axis(random), axis(random), 0.0f)));
+		surface.m_albedo = XMFLOAT3(unit(random), unit(random), unit(random));
+		surface.m_roughness = unit(random);
+		surface.m_metalness = unit(random);
+		surfaces.Set(i, surface);
+	}
+
+	PbrReference::ColorBatch colors;
+	reference.Shade(surfaces, colors);
+	float worst = 0.0f;
+	for (size_t i = 0; i < count; i++) {
+		XMFLOAT3 expected = reference.ShadeScalar(surfaces.Get(i));
+		XMFLOAT3 actual = colors.Get(i);
+		worst = (std::max)(worst, std::fabs(actual.x - expected.x) / (std::max)(std::fabs(expected.x), 1.0f));
+		worst = (std::max)(worst, std::fabs(actual.y - expected.y) / (std::max)(std::fabs(expected.y), 1.0f));
+		worst = (std::max)(worst, std::fabs(actual.z - expected.z) / (std::max)(std::fabs(expected.z), 1.0f));
+	}
+	CHECK(worst < 1e-3f);
+
+	//ranges shaded separately give the same colors
+	PbrReference::ColorBatch split;
+	split.m_r.resize(1004);
+	split.m_g.resize(1004);
+	split.m_b.resize(1004);
+	reference.Shade(surfaces, split, 0, 500);
+	reference.Shade(surfaces, split, 500, 1004);
+	CHECK(split.m_r == colors.m_r && split.m_g == colors.m_g && split.m_b == colors.m_b);
+}
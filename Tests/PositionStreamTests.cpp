@@ -0,0 +1,75 @@
+#include "TestHarness.h"
+#include "TestMeshes.h"
+#include "PositionStream.h"
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	bool SameBits(const XMFLOAT3& a_first, const XMFLOAT3& a_second)
+	{
+		return memcmp(&a_first, &a_second, sizeof(XMFLOAT3)) == 0;
+	}
+}
+
+TEST_CASE(SplitVerticesAreWelded)
+{
+	//every corner its own vertex, the way normals and uvs split a cube into 36
+	std::vector<XMFLOAT3> positions;
+	std::vector<uint32_t> indices;
+	for (uint32_t index : TestMeshes::CUBE_INDICES) {
+		indices.push_back(static_cast<uint32_t>(positions.size()));
+		positions.push_back(TestMeshes::CUBE_POSITIONS[index]);
+	}
+
+	PositionStream stream;
+	stream.Build(positions, indices);
+	CHECK(stream.GetPositions().size() == 8);
+	CHECK(stream.GetIndices().size() == 36);
+
+	//every triangle corner still lands on exactly the same position
+	bool same = true;
+	for (size_t i = 0; i < indices.size(); i++) {
+		same = same && stream.GetIndices()[i] < stream.GetPositions().size();
+		same = same && SameBits(stream.GetPositions()[stream.GetIndices()[i]], positions[indices[i]]);
+	}
+	CHECK(same);
+}
+
+TEST_CASE(OnlyIdenticalBitsWeld)
+{
+	std::vector<XMFLOAT3> positions = {
+		XMFLOAT3(0.0f, 1.0f, 2.0f),
+		XMFLOAT3(-0.0f, 1.0f, 2.0f), // same value, other bits
+		XMFLOAT3(0.0f, std::nextafter(1.0f, 2.0f), 2.0f),
+		XMFLOAT3(0.0f, 1.0f, 2.0f),
+	};
+	PositionStream stream;
+	stream.Build(positions, { 0, 1, 2, 3, 2, 1 });
+	CHECK(stream.GetPositions().size() == 3);
+	CHECK(stream.GetIndices() == std::vector<uint32_t>({ 0, 1, 2, 0, 2, 1 }));
+
+	//unreferenced positions are kept, rebuilding replaces everything
+	stream.Build(positions, {});
+	CHECK(stream.GetPositions().size() == 3);
+	CHECK(stream.GetIndices().empty());
+	stream.Build({}, {});
+	CHECK(stream.GetPositions().empty());
+}
+
+TEST_CASE(ShortIndicesFitSixteenBits)
+{
+	std::vector<XMFLOAT3> positions(UINT16_MAX + 1);
+	for (size_t i = 0; i < positions.size(); i++) positions[i] = XMFLOAT3(static_cast<float>(i), 0.0f, 0.0f);
+	std::vector<uint32_t> indices = { 0, UINT16_MAX, 1234 };
+
+	PositionStream stream;
+	stream.Build(positions, indices);
+	CHECK(stream.HasShortIndices());
+	CHECK(stream.GetShortIndices() == std::vector<uint16_t>({ 0, UINT16_MAX, 1234 }));
+
+	positions.push_back(XMFLOAT3(-1.0f, 0.0f, 0.0f));
+	stream.Build(positions, indices);
+	CHECK(!stream.HasShortIndices());
+}
@@ -0,0 +1,77 @@
+#include "TestHarness.h"
+#include "Double3.h"
+#include "Light.h"
+#include "Transform.h"
+
+namespace
+{
+	constexpr double FAR_AWAY = 1e6;
+	constexpr double SUB_MILLIMETER = 1e-4;
+}
+
+TEST_CASE(FloatLosesMillimetersAtAMillionUnits)
+{
+	//what the doubles are for, float spacing at 1e6 is 1/16 of a unit
+	float position = static_cast<float>(FAR_AWAY);
+	CHECK(position + 0.001f == position);
+	CHECK(static_cast<float>(FAR_AWAY + 0.03) - static_cast<float>(FAR_AWAY) == 0.0f);
+}
+
+TEST_CASE(RelativeToKeepsSubMillimeterOffsets)
+{
+	Double3 origin(FAR_AWAY, -FAR_AWAY, FAR_AWAY);
+	for (int step = 0; step < 1000; step++) {
+		double offset = step * 0.00037;
+		DirectX::XMFLOAT3 relative = (origin + Double3(offset, 2.0 * offset, -offset)).RelativeTo(origin);
+		CHECK_NEAR(relative.x, offset, SUB_MILLIMETER);
+		CHECK_NEAR(relative.y, 2.0 * offset, SUB_MILLIMETER);
+		CHECK_NEAR(relative.z, -offset, SUB_MILLIMETER);
+	}
+}
+
+TEST_CASE(TransformStepsAccumulateFarFromOrigin)
+{
+	//a thousand half millimeter steps at 1e6 units, a float position wouldn't move at all
+	Transform transform;
+	transform.SetPosition(Double3(FAR_AWAY, 10.0, FAR_AWAY));
+	for (int step = 0; step < 1000; step++) transform.MoveAbsolute(0.0005f, 0.0f, -0.0005f);
+
+	Double3 origin(FAR_AWAY, 0.0, FAR_AWAY);
+	DirectX::XMFLOAT4X4 world = transform.GetRelativeWorldMatrix(origin);
+	CHECK_NEAR(world._41, 0.5, SUB_MILLIMETER);
+	CHECK_NEAR(world._42, 10.0, SUB_MILLIMETER);
+	CHECK_NEAR(world._43, -0.5, SUB_MILLIMETER);
+}
+
+TEST_CASE(InterpolatedMatrixIsStableFarFromOrigin)
+{
+	Transform transform;
+	transform.SetPosition(Double3(FAR_AWAY, 0.0, -FAR_AWAY));
+	transform.SavePreviousState();
+	transform.MoveAbsolute(0.001f, 0.0f, 0.0f);
+
+	Double3 origin(FAR_AWAY, 0.0, -FAR_AWAY);
+	DirectX::XMFLOAT4X4 world;
+	DirectX::XMFLOAT4X4 inverseTranspose;
+	for (int i = 0; i <= 10; i++) {
+		float alpha = i / 10.0f;
+		transform.GetInterpolatedRelativeWorldMatrices(origin, alpha, world, inverseTranspose);
+		CHECK_NEAR(world._41, 0.001 * alpha, SUB_MILLIMETER * 0.1);
+		CHECK_NEAR(world._43, 0.0, SUB_MILLIMETER * 0.1);
+	}
+}
+
+TEST_CASE(SceneLightsAreRebasedInDouble)
+{
+	SceneLight light;
+	light.m_light.m_Type = LIGHT_TYPE_POINT;
+	light.m_light.m_Range = 5.0f;
+	light.m_position = Double3(FAR_AWAY + 0.0003, FAR_AWAY, -FAR_AWAY - 0.0007);
+
+	Light relative = light.RelativeTo(Double3(FAR_AWAY, FAR_AWAY, -FAR_AWAY));
+	CHECK_NEAR(relative.m_Position.x, 0.0003, SUB_MILLIMETER * 0.1);
+	CHECK_NEAR(relative.m_Position.y, 0.0, SUB_MILLIMETER * 0.1);
+	CHECK_NEAR(relative.m_Position.z, -0.0007, SUB_MILLIMETER * 0.1);
+	CHECK(relative.m_Range == 5.0f);
+	CHECK(relative.m_Type == LIGHT_TYPE_POINT);
+}
@@ -0,0 +1,204 @@
+#include "TestHarness.h"
+#include "ProbeBaker.h"
+
+using namespace DirectX;
+
+namespace
+{
+	//a 2x2 quad in the xz plane around the origin, normal up
+	uint32_t AddQuad(ProbeBaker& a_baker)
+	{
+		return a_baker.AddMesh(
+			{ XMFLOAT3(-1.0f, 0.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, -1.0f), XMFLOAT3(1.0f, 0.0f, 1.0f), XMFLOAT3(-1.0f, 0.0f, 1.0f) },
+			{ 0, 2, 1, 0, 3, 2 });
+	}
+
+	XMFLOAT4X4 World(float a_scale, const XMFLOAT3& a_position)
+	{
+		XMFLOAT4X4 world;
+		XMStoreFloat4x4(&world, XMMatrixScaling(a_scale, a_scale, a_scale) * XMMatrixTranslation(a_position.x, a_position.y, a_position.z));
+		return world;
+	}
+
+	Light Directional(const XMFLOAT3& a_direction, float a_intensity)
+	{
+		Light light = {};
+		light.m_Type = LIGHT_TYPE_DIRECTIONAL;
+		light.m_Direction = a_direction;
+		light.m_Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
+		light.m_Intensity = a_intensity;
+		return light;
+	}
+
+	//a big white floor at y = 0 lit straight from above
+	void BuildFloor(ProbeBaker& a_baker, float a_albedo)
+	{
+		a_baker.Clear();
+		a_baker.AddInstance(AddQuad(a_baker), World(50.0f, XMFLOAT3(0.0f, 0.0f, 0.0f)), XMFLOAT3(a_albedo, a_albedo, a_albedo));
+		Light sun = Directional(XMFLOAT3(0.0f, -1.0f, 0.0f), 2.0f);
+		a_baker.SetLights(&sun, 1);
+		a_baker.BuildScene();
+	}
+}
+
+TEST_CASE(SkyFacesFollowCubeOrder)
+{
+	ProbeBaker::Sky sky;
+	CHECK(sky.Sample(XMFLOAT3(0.0f, 1.0f, 0.0f)).z == sky.m_fallback.z);
+
+	sky.m_size = 2;
+	for (int face = 0; face < 6; face++) sky.m_faces[face].assign(4, XMFLOAT3(static_cast<float>(face), 0.0f, 0.0f));
+	CHECK(sky.Sample(XMFLOAT3(1.0f, 0.1f, 0.2f)).x == 0.0f);
+	CHECK(sky.Sample(XMFLOAT3(-1.0f, 0.1f, 0.2f)).x == 1.0f);
+	CHECK(sky.Sample(XMFLOAT3(0.1f, 1.0f, 0.2f)).x == 2.0f);
+	CHECK(sky.Sample(XMFLOAT3(0.1f, -1.0f, 0.2f)).x == 3.0f);
+	CHECK(sky.Sample(XMFLOAT3(0.1f, 0.2f, 1.0f)).x == 4.0f);
+	CHECK(sky.Sample(XMFLOAT3(0.1f, 0.2f, -1.0f)).x == 5.0f);
+
+	//+z face, +x is to the right and +y up, so the top left texel is -x +y
+	sky.m_faces[4] = { XMFLOAT3(10.0f, 0.0f, 0.0f), XMFLOAT3(11.0f, 0.0f, 0.0f), XMFLOAT3(12.0f, 0.0f, 0.0f), XMFLOAT3(13.0f, 0.0f, 0.0f) };
+	CHECK(sky.Sample(XMFLOAT3(-0.5f, 0.5f, 1.0f)).x == 10.0f);
+	CHECK(sky.Sample(XMFLOAT3(0.5f, 0.5f, 1.0f)).x == 11.0f);
+	CHECK(sky.Sample(XMFLOAT3(-0.5f, -0.5f, 1.0f)).x == 12.0f);
+
+	//a face short of texels falls back
+	sky.m_faces[5].resize(1);
+	CHECK(sky.Sample(XMFLOAT3(0.0f, 0.0f, -1.0f)).z == sky.m_fallback.z);
+}
+
+TEST_CASE(RaysHitTransformedInstances)
+{
+	ProbeBaker baker;
+	uint32_t quad = AddQuad(baker);
+	baker.AddInstance(quad, World(2.0f, XMFLOAT3(0.0f, 5.0f, 0.0f)), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	baker.AddInstance(quad, World(1.0f, XMFLOAT3(0.0f, 2.0f, 0.0f)), XMFLOAT3(0.5f, 0.5f, 0.5f));
+	baker.BuildScene();
+	CHECK(baker.GetReport().m_meshCount == 1 && baker.GetReport().m_instanceCount == 2 && baker.GetReport().m_triangleCount == 2);
+	CHECK_NEAR(baker.GetSceneBounds().m_extents.x, 2.0, 1e-5);
+	CHECK_NEAR(baker.GetSceneBounds().m_center.y, 3.5, 1e-5);
+
+	//the lower quad is closer and only covers |x| < 1
+	ProbeBaker::Hit hit;
+	CHECK(baker.Intersect(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 100.0f, hit));
+	CHECK_NEAR(hit.m_distance, 2.0, 1e-4);
+	CHECK(hit.m_instance == 1);
+	CHECK_NEAR(hit.m_normal.y, -1.0, 1e-4);
+
+	CHECK(baker.Intersect(XMFLOAT3(1.5f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 100.0f, hit));
+	CHECK_NEAR(hit.m_distance, 5.0, 1e-4);
+	CHECK(hit.m_instance == 0);
+
+	//from above the normal still faces the ray
+	CHECK(baker.Intersect(XMFLOAT3(0.0f, 10.0f, 0.0f), XMFLOAT3(0.0f, -1.0f, 0.0f), 100.0f, hit));
+	CHECK_NEAR(hit.m_normal.y, 1.0, 1e-4);
+
+	CHECK(!baker.Intersect(XMFLOAT3(3.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 100.0f, hit));
+	CHECK(!baker.IsOccluded(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 1.5f));
+	CHECK(baker.IsOccluded(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(0.0f, 1.0f, 0.0f), 2.5f));
+}
+
+TEST_CASE(DirectLightIsShadowed)
+{
+	ProbeBaker baker;
+	uint32_t quad = AddQuad(baker);
+	baker.AddInstance(quad, World(1.0f, XMFLOAT3(0.0f, 3.0f, 0.0f)), XMFLOAT3(1.0f, 1.0f, 1.0f));
+	baker.BuildScene();
+	Light sun = Directional(XMFLOAT3(0.0f, -1.0f, 0.0f), 2.0f);
+	baker.SetLights(&sun, 1);
+
+	XMFLOAT3 up(0.0f, 1.0f, 0.0f);
+	CHECK_NEAR(baker.GetDirectLight(XMFLOAT3(5.0f, 0.0f, 0.0f), up).x, 2.0, 1e-5);
+	CHECK_NEAR(baker.GetDirectLight(XMFLOAT3(0.0f, 0.0f, 0.0f), up).x, 0.0, 0.0);
+	CHECK_NEAR(baker.GetDirectLight(XMFLOAT3(5.0f, 0.0f, 0.0f), XMFLOAT3(0.6f, 0.8f, 0.0f)).x, 1.6, 1e-5);
+
+	//a point light fades to nothing at its range
+	Light point = {};
+	point.m_Type = LIGHT_TYPE_POINT;
+	point.m_Position = XMFLOAT3(10.0f, 1.0f, 0.0f);
+	point.m_Range = 2.0f;
+	point.m_Color = XMFLOAT3(1.0f, 1.0f, 1.0f);
+	point.m_Intensity = 1.0f;
+	baker.SetLights(&point, 1);
+	CHECK_NEAR(baker.GetDirectLight(XMFLOAT3(10.0f, 0.0f, 0.0f), up).x, 0.75 * 0.75, 1e-5);
+	CHECK_NEAR(baker.GetDirectLight(XMFLOAT3(10.0f, -1.5f, 0.0f), up).x, 0.0, 0.0);
+}
+
+TEST_CASE(EmptySceneBakesTheSky)
+{
+	ProbeBaker baker;
+	ProbeBaker::Sky sky;
+	sky.m_fallback = XMFLOAT3(0.25f, 0.5f, 1.0f);
+	baker.SetSky(sky);
+	baker.BuildScene();
+
+	ProbeGrid grid;
+	grid.Reset(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 2, 2, 2);
+	ProbeBaker::Settings settings;
+	settings.m_samplesPerProbe = 256;
+	settings.m_rounds = 3;
+	baker.Bake(grid, settings);
+
+	//a uniform sky is exact in the constant band, the rest is sampling noise
+	for (const SphericalHarmonicsL2& probe : grid.GetProbes()) {
+		XMFLOAT3 value = probe.Evaluate(XMFLOAT3(0.0f, 0.0f, 1.0f));
+		CHECK_NEAR(value.x, 0.25, 0.05);
+		CHECK_NEAR(value.z, 1.0, 0.2);
+		CHECK_NEAR(probe.m_coefficients[0].y * 0.282095f, 0.5, 1e-4);
+	}
+	CHECK(baker.GetReport().m_probeCount == 8);
+	CHECK(baker.GetReport().m_rays == 8 * 256);
+	CHECK(baker.GetReport().m_roundSamples.size() == 2 && baker.GetReport().m_roundSamples.back() == 256);
+}
+
+TEST_CASE(FloorBouncesLightUpwards)
+{
+	ProbeBaker baker;
+	BuildFloor(baker, 0.5f);
+	ProbeBaker::Sky sky;
+	sky.m_fallback = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	baker.SetSky(sky);
+
+	ProbeGrid grid;
+	grid.Reset(XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 1, 1, 1);
+	ProbeBaker::Settings settings;
+	settings.m_samplesPerProbe = 4096;
+	baker.Bake(grid, settings);
+
+	//a black sky above and a floor below giving back albedo times the sun, the
+	//surface facing down sees the bounce and the one facing up next to nothing
+	XMFLOAT3 down = grid.GetProbes()[0].Evaluate(XMFLOAT3(0.0f, -1.0f, 0.0f));
+	XMFLOAT3 up = grid.GetProbes()[0].Evaluate(XMFLOAT3(0.0f, 1.0f, 0.0f));
+	CHECK_NEAR(down.x, 1.0, 0.15);
+	CHECK(up.x < 0.15f);
+	CHECK(baker.GetReport().m_roundChange.back() < baker.GetReport().m_roundChange.front());
+}
+
+TEST_CASE(BakeDoesNotDependOnTheThreadCount)
+{
+	ProbeBaker baker;
+	BuildFloor(baker, 0.8f);
+	ProbeBaker::Settings settings;
+	settings.m_countX = 3;
+	settings.m_countY = 2;
+	settings.m_countZ = 3;
+	settings.m_samplesPerProbe = 64;
+
+	settings.m_maxThreads = 1;
+	ProbeGrid single = baker.Bake(settings);
+	settings.m_maxThreads = 4;
+	ProbeGrid threaded = baker.Bake(settings);
+
+	CHECK(single.GetProbes().size() == 18);
+	bool same = single.GetProbes().size() == threaded.GetProbes().size();
+	for (size_t i = 0; same && i < single.GetProbes().size(); i++) {
+		for (int c = 0; c < SphericalHarmonicsL2::COEFFICIENT_COUNT; c++) {
+			same = same && single.GetProbes()[i].m_coefficients[c].x == threaded.GetProbes()[i].m_coefficients[c].x;
+		}
+	}
+	CHECK(same);
+
+	//the grid's corners sit on the scene box grown by the margin
+	CHECK_NEAR(single.GetOrigin().x, -51.0, 1e-4);
+	CHECK_NEAR(single.GetProbePosition(2, 1, 2).x, 51.0, 1e-3);
+	CHECK_NEAR(single.GetProbePosition(2, 1, 2).y, 1.0, 1e-3);
+}
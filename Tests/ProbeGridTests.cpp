@@ -0,0 +1,162 @@
+#include "TestHarness.h"
+#include "ProbeGrid.h"
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+using namespace DirectX;
+
+namespace
+{
+	//constant irradiance a_value in every direction, only the first coefficient is set
+	SphericalHarmonicsL2 Constant(float a_value)
+	{
+		SphericalHarmonicsL2 sh;
+		sh.m_coefficients[0] = XMFLOAT3(a_value / 0.282095f, 2.0f * a_value / 0.282095f, 0.0f);
+		return sh;
+	}
+
+	//a 3x2x2 grid where each probe's value is its x plus ten times its z
+	ProbeGrid RampGrid()
+	{
+		ProbeGrid grid;
+		grid.Reset(XMFLOAT3(-1.0f, 0.0f, 2.0f), XMFLOAT3(2.0f, 1.0f, 4.0f), 3, 2, 2);
+		for (uint32_t z = 0; z < 2; z++) {
+			for (uint32_t y = 0; y < 2; y++) {
+				for (uint32_t x = 0; x < 3; x++) grid.GetProbes()[grid.GetIndex(x, y, z)] = Constant(x + 10.0f * z);
+			}
+		}
+		return grid;
+	}
+
+	float ValueAt(const ProbeGrid& a_grid, const XMFLOAT3& a_position)
+	{
+		return a_grid.Sample(a_position).Evaluate(XMFLOAT3(0.0f, 1.0f, 0.0f)).x;
+	}
+
+	std::filesystem::path TempPath(const char* a_name)
+	{
+		return std::filesystem::temp_directory_path() / a_name;
+	}
+}
+
+TEST_CASE(ProbesSitOnTheLattice)
+{
+	ProbeGrid grid = RampGrid();
+	CHECK(grid.GetProbes().size() == 12);
+	CHECK(grid.GetIndex(2, 1, 1) == 11);
+	XMFLOAT3 position = grid.GetProbePosition(2, 1, 1);
+	CHECK(position.x == 3.0f && position.y == 1.0f && position.z == 6.0f);
+}
+
+TEST_CASE(SamplingBlendsTrilinearly)
+{
+	ProbeGrid grid = RampGrid();
+	CHECK_NEAR(ValueAt(grid, grid.GetProbePosition(1, 0, 1)), 11.0, 1e-4);
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(0.0f, 0.5f, 2.0f)), 0.5, 1e-4);
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(2.0f, 0.25f, 5.0f)), 1.5 + 7.5, 1e-4);
+
+	//every corner weight counted once, a constant field stays constant
+	SphericalHarmonicsL2 second = grid.Sample(XMFLOAT3(0.3f, 0.7f, 3.1f));
+	CHECK_NEAR(second.m_coefficients[0].y, 2.0 * second.m_coefficients[0].x, 1e-3);
+}
+
+TEST_CASE(SamplingOutsideClampsToTheNearestFace)
+{
+	ProbeGrid grid = RampGrid();
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(-50.0f, -3.0f, -50.0f)), 0.0, 1e-4);
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(50.0f, 9.0f, 50.0f)), 12.0, 1e-4);
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(2.0f, 9.0f, -50.0f)), 1.5, 1e-4);
+}
+
+TEST_CASE(SingleProbeAxesAndEmptyGrids)
+{
+	ProbeGrid grid;
+	CHECK(grid.IsEmpty());
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(1.0f, 2.0f, 3.0f)), 0.0, 0.0);
+
+	grid.Reset(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f), 2, 1, 1);
+	grid.GetProbes()[0] = Constant(1.0f);
+	grid.GetProbes()[1] = Constant(3.0f);
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(0.5f, 7.0f, -7.0f)), 2.0, 1e-4);
+	CHECK_NEAR(ValueAt(grid, XMFLOAT3(9.0f, 0.0f, 0.0f)), 3.0, 1e-4);
+}
+
+TEST_CASE(NonFinitePositionsSampleNothing)
+{
+	ProbeGrid grid = RampGrid();
+	float nan = std::numeric_limits<float>::quiet_NaN();
+	float infinity = std::numeric_limits<float>::infinity();
+	bool empty = true;
+	for (XMFLOAT3 position : { XMFLOAT3(nan, 0.5f, 3.0f), XMFLOAT3(0.0f, nan, 3.0f), XMFLOAT3(0.0f, 0.5f, nan),
+		XMFLOAT3(infinity, 0.5f, 3.0f), XMFLOAT3(0.0f, -infinity, 3.0f) }) {
+		SphericalHarmonicsL2 sh = grid.Sample(position);
+		for (const XMFLOAT3& coefficient : sh.m_coefficients) {
+			empty = empty && coefficient.x == 0.0f && coefficient.y == 0.0f && coefficient.z == 0.0f;
+		}
+	}
+	CHECK(empty);
+}
+
+TEST_CASE(SaveAndLoadRoundTrip)
+{
+	ProbeGrid grid = RampGrid();
+	grid.GetProbes()[5].m_coefficients[8] = XMFLOAT3(-0.125f, 0.0625f, 1000.0f);
+	std::filesystem::path path = TempPath("ProbeGridTests.shpg");
+	CHECK(grid.Save(path.wstring()));
+	CHECK(std::filesystem::file_size(path) == grid.GetFileSize());
+
+	ProbeGrid loaded;
+	CHECK(loaded.Load(path.wstring()));
+	std::filesystem::remove(path);
+	CHECK(loaded.GetCountX() == 3 && loaded.GetCountY() == 2 && loaded.GetCountZ() == 2);
+	CHECK(loaded.GetOrigin().x == -1.0f && loaded.GetOrigin().z == 2.0f);
+	CHECK(loaded.GetSpacing().x == 2.0f && loaded.GetSpacing().z == 4.0f);
+
+	//half precision keeps three significant digits
+	bool close = true;
+	for (size_t probe = 0; probe < grid.GetProbes().size(); probe++) {
+		for (int i = 0; i < SphericalHarmonicsL2::COEFFICIENT_COUNT; i++) {
+			const XMFLOAT3& before = grid.GetProbes()[probe].m_coefficients[i];
+			const XMFLOAT3& after = loaded.GetProbes()[probe].m_coefficients[i];
+			close = close && std::fabs(before.x - after.x) <= 1e-3f * (std::max)(1.0f, std::fabs(before.x));
+			close = close && std::fabs(before.y - after.y) <= 1e-3f * (std::max)(1.0f, std::fabs(before.y));
+			close = close && std::fabs(before.z - after.z) <= 1e-3f * (std::max)(1.0f, std::fabs(before.z));
+		}
+	}
+	CHECK(close);
+}
+
+TEST_CASE(BadFilesLeaveTheGridAlone)
+{
+	ProbeGrid grid = RampGrid();
+	std::filesystem::path path = TempPath("ProbeGridTests.bad");
+	CHECK(!grid.Load(TempPath("ProbeGridTests.missing").wstring()));
+
+	//not a probe file
+	{
+		std::ofstream file(path, std::ios::binary);
+		file << "definitely not spherical harmonics";
+	}
+	CHECK(!grid.Load(path.wstring()));
+
+	//cut off half way through the coefficients
+	CHECK(RampGrid().Save(path.wstring()));
+	std::filesystem::resize_file(path, RampGrid().GetFileSize() / 2);
+	CHECK(!grid.Load(path.wstring()));
+
+	//a header claiming more probes than the limit
+	CHECK(RampGrid().Save(path.wstring()));
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		uint32_t huge = 1u << 16;
+		file.seekp(2 * sizeof(uint32_t));
+		file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+		file.write(reinterpret_cast<const char*>(&huge), sizeof(huge));
+	}
+	CHECK(!grid.Load(path.wstring()));
+	std::filesystem::remove(path);
+
+	CHECK(grid.GetCountX() == 3 && grid.GetProbes().size() == 12);
+	CHECK_NEAR(ValueAt(grid, grid.GetProbePosition(2, 0, 1)), 12.0, 1e-4);
+}
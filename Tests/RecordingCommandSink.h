@@ -0,0 +1,66 @@
+#pragma once
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "CommandRecording.h"
+
+/// <summary>
+/// CommandSink that records item indices instead of GPU commands. Every
+/// callback is logged so tests can check which thread recorded a chunk and
+/// that Execute replays the chunks in order, on the submitting thread.
+/// </summary>
+class RecordingCommandSink : public CommandSink
+{
+public:
+	//shared by the sinks of one RecordAndExecute call
+	struct Log
+	{
+		std::vector<size_t> m_executedChunks;
+		std::vector<size_t> m_executedItems;
+		std::atomic<int> m_recordingNow = 0;
+		std::atomic<int> m_mostRecordingAtOnce = 0;
+	};
+
+	RecordingCommandSink(size_t a_chunkIndex, Log& a_log) : m_chunkIndex(a_chunkIndex), m_pLog(&a_log) {}
+
+	void BeginRecording() override
+	{
+		m_began = true;
+		m_items.clear();
+		m_recordingThread = std::this_thread::get_id();
+		int recording = ++m_pLog->m_recordingNow;
+		int most = m_pLog->m_mostRecordingAtOnce.load();
+		while (recording > most && !m_pLog->m_mostRecordingAtOnce.compare_exchange_weak(most, recording)) {
+		}
+	}
+
+	void FinishRecording() override
+	{
+		m_finished = true;
+		m_pLog->m_recordingNow--;
+	}
+
+	void Execute() override
+	{
+		m_executedOutOfOrder = !m_finished;
+		m_executingThread = std::this_thread::get_id();
+		m_pLog->m_executedChunks.push_back(m_chunkIndex);
+		m_pLog->m_executedItems.insert(m_pLog->m_executedItems.end(), m_items.begin(), m_items.end());
+	}
+
+	/// <summary>
+	/// What the record callback calls for each of the chunk's items
+	/// </summary>
+	void Record(size_t a_item) { m_items.push_back(a_item); }
+
+	bool m_began = false;
+	bool m_finished = false;
+	bool m_executedOutOfOrder = false;
+	std::thread::id m_recordingThread;
+	std::thread::id m_executingThread;
+
+private:
+	size_t m_chunkIndex;
+	Log* m_pLog;
+	std::vector<size_t> m_items;
+};
@@ -0,0 +1,149 @@
+#include "TestHarness.h"
+#include "RecordingRenderBackend.h"
+#include <cstring>
+
+namespace
+{
+	RenderHandle Handle(uintptr_t a_id)
+	{
+		return reinterpret_cast<RenderHandle>(a_id * 16);
+	}
+
+	//one of every command, in the order a material draw emits them
+	void EmitDraw(RenderCommandList& a_commands, uint32_t a_mesh, float a_tint)
+	{
+		using RenderCommand::Stage;
+		RenderHandle textures[3] = { Handle(10), Handle(11), Handle(12) };
+		RenderHandle samplers[2] = { Handle(20), Handle(21) };
+		float constants[4] = { a_tint, 0.5f, 0.25f, 1.0f };
+
+		a_commands.BindPipeline(Handle(1), Handle(2));
+		a_commands.SetRenderState(Handle(3), nullptr, 1);
+		a_commands.BindShaderResources(Stage::PIXEL, 0, 3, textures);
+		a_commands.BindSamplers(Stage::PIXEL, 0, 2, samplers);
+		a_commands.BindShaderResource(Stage::PIXEL, 7, Handle(13));
+		a_commands.BindSampler(Stage::PIXEL, 3, Handle(22));
+		a_commands.UpdateConstantBuffer(Stage::PIXEL, 0, constants, sizeof(constants));
+		a_commands.BindConstantBuffer(Stage::VERTEX, 0, Handle(30), 256, 64);
+		a_commands.BindGeometry(Handle(40 + a_mesh), Handle(50 + a_mesh), 44, 4);
+		a_commands.DrawIndexed(36);
+		a_commands.DrawIndexedInstanced(36, 12, 0, 0, 5);
+	}
+}
+
+TEST_CASE(EmitPacksAlignedCommands)
+{
+	RenderCommandList commands;
+	EmitDraw(commands, 0, 1.0f);
+	CHECK(commands.GetCommandCount() == 11);
+
+	size_t count = 0;
+	size_t bytes = 0;
+	bool aligned = true;
+	for (const RenderCommand::Header& header : commands) {
+		aligned = aligned && header.m_size % RenderCommand::ALIGNMENT == 0;
+		aligned = aligned && reinterpret_cast<uintptr_t>(&header) % RenderCommand::ALIGNMENT == 0;
+		bytes += header.m_size;
+		count++;
+	}
+	CHECK(aligned);
+	CHECK(count == 11);
+	CHECK(bytes == commands.GetSizeInBytes());
+
+	//Clear keeps nothing
+	commands.Clear();
+	CHECK(commands.GetCommandCount() == 0);
+	CHECK(commands.GetSizeInBytes() == 0);
+	CHECK(!(commands.begin() != commands.end()));
+}
+
+TEST_CASE(EmitKeepsTrailingData)
+{
+	RenderCommandList commands;
+	EmitDraw(commands, 3, 0.75f);
+
+	bool sawViews = false, sawSamplers = false, sawConstants = false, sawInstanced = false;
+	for (const RenderCommand::Header& header : commands) {
+		using namespace RenderCommand;
+		if (header.m_type == Type::BIND_SHADER_RESOURCES) {
+			const BindShaderResources& command = RenderCommandList::As<BindShaderResources>(header);
+			sawViews = command.m_count == 3 && command.GetViews()[0] == Handle(10) && command.GetViews()[2] == Handle(12);
+		}
+		else if (header.m_type == Type::BIND_SAMPLERS) {
+			const BindSamplers& command = RenderCommandList::As<BindSamplers>(header);
+			sawSamplers = command.m_count == 2 && command.GetSamplers()[1] == Handle(21);
+		}
+		else if (header.m_type == Type::UPDATE_CONSTANT_BUFFER) {
+			const UpdateConstantBuffer& command = RenderCommandList::As<UpdateConstantBuffer>(header);
+			float constants[4] = {};
+			memcpy(constants, command.GetData(), sizeof(constants));
+			sawConstants = command.m_sizeInBytes == sizeof(constants) && constants[0] == 0.75f && constants[3] == 1.0f;
+		}
+		else if (header.m_type == Type::DRAW_INDEXED_INSTANCED) {
+			const DrawIndexedInstanced& command = RenderCommandList::As<DrawIndexedInstanced>(header);
+			sawInstanced = command.m_indexCount == 36 && command.m_instanceCount == 12 && command.m_startInstance == 5;
+		}
+	}
+	CHECK(sawViews);
+	CHECK(sawSamplers);
+	CHECK(sawConstants);
+	CHECK(sawInstanced);
+}
+
+TEST_CASE(ReplayRecordsEveryCommand)
+{
+	RenderCommandList commands;
+	EmitDraw(commands, 0, 1.0f);
+	EmitDraw(commands, 1, 1.0f);
+
+	RecordingRenderBackend backend;
+	backend.Execute(commands);
+	CHECK(backend.GetRecorded().GetCommandCount() == 22);
+	CHECK(backend.GetRecorded().GetSizeInBytes() == commands.GetSizeInBytes());
+	CHECK(backend.GetCount(RenderCommand::Type::BIND_PIPELINE) == 2);
+	CHECK(backend.GetCount(RenderCommand::Type::UPDATE_CONSTANT_BUFFER) == 2);
+	CHECK(backend.GetDrawCount() == 4);
+
+	//a replay is a byte copy of what was emitted
+	CHECK(RecordingRenderBackend::FindFirstDifference(commands, backend.GetRecorded()) == SIZE_MAX);
+
+	//several lists append, the way chunks are replayed one after another
+	backend.Execute(commands);
+	CHECK(backend.GetRecorded().GetCommandCount() == 44);
+	CHECK(backend.GetDrawCount() == 8);
+
+	std::string text = backend.ToString();
+	size_t lines = 0;
+	for (char c : text) lines += c == '\n' ? 1 : 0;
+	CHECK(lines == 44);
+	CHECK(text.find("DrawIndexedInstanced indices=36 instances=12 start=0 base=0 firstInstance=5") != std::string::npos);
+	CHECK(text.find("PS t0..t2") != std::string::npos);
+
+	backend.Clear();
+	CHECK(backend.GetRecorded().GetCommandCount() == 0);
+	CHECK(backend.GetDrawCount() == 0);
+}
+
+TEST_CASE(FindFirstDifferenceReportsTheCommand)
+{
+	RenderCommandList first, second;
+	EmitDraw(first, 0, 1.0f);
+	EmitDraw(first, 1, 1.0f);
+	EmitDraw(second, 0, 1.0f);
+	EmitDraw(second, 2, 1.0f);
+	CHECK(RecordingRenderBackend::FindFirstDifference(first, first) == SIZE_MAX);
+	CHECK(RecordingRenderBackend::FindFirstDifference(first, second) == 19);
+
+	//a change inside trailing data counts
+	RenderCommandList tinted;
+	EmitDraw(tinted, 0, 1.0f);
+	EmitDraw(tinted, 1, 0.5f);
+	CHECK(RecordingRenderBackend::FindFirstDifference(first, tinted) == 17);
+
+	//one list being a prefix of the other differs where the shorter one ends
+	RenderCommandList prefix;
+	EmitDraw(prefix, 0, 1.0f);
+	CHECK(RecordingRenderBackend::FindFirstDifference(first, prefix) == 11);
+	CHECK(RecordingRenderBackend::FindFirstDifference(prefix, first) == 11);
+	CHECK(RecordingRenderBackend::FindFirstDifference(RenderCommandList(), RenderCommandList()) == SIZE_MAX);
+}
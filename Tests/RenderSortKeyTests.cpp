@@ -0,0 +1,255 @@
+#include "TestHarness.h"
+#include "RenderSortKey.h"
+#include <algorithm>
+#include <random>
+
+namespace
+{
+	std::vector<RenderSortKey::Item> RandomItems(size_t a_count, unsigned int a_seed)
+	{
+		std::mt19937 random(a_seed);
+		std::uniform_int_distribution<uint32_t> material(0, 63);
+		std::uniform_int_distribution<uint32_t> mesh(0, 127);
+		std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+		std::vector<RenderSortKey::Item> items(a_count);
+		for (uint32_t i = 0; i < a_count; i++) {
+			uint32_t materialId = material(random);
+			RenderPass pass = i % 5 == 0 ? RenderPass::TRANSPARENT_GEOMETRY : RenderPass::OPAQUE_GEOMETRY;
+			items[i] = { RenderSortKey::Make(pass, materialId % 16, materialId, mesh(random), depth(random)), i };
+		}
+		return items;
+	}
+
+	std::vector<RenderSortKey::Item> StableSorted(std::vector<RenderSortKey::Item> a_items)
+	{
+		std::stable_sort(a_items.begin(), a_items.end(),
+			[](const RenderSortKey::Item& a_left, const RenderSortKey::Item& a_right) { return a_left.m_key < a_right.m_key; });
+		return a_items;
+	}
+
+	bool SameOrder(const std::vector<RenderSortKey::Item>& a_first, const std::vector<RenderSortKey::Item>& a_second)
+	{
+		if (a_first.size() != a_second.size()) return false;
+		for (size_t i = 0; i < a_first.size(); i++) {
+			if (a_first[i].m_key != a_second[i].m_key || a_first[i].m_index != a_second[i].m_index) return false;
+		}
+		return true;
+	}
+}
+
+TEST_CASE(FieldsRoundTrip)
+{
+	uint64_t key = RenderSortKey::Make(RenderPass::TRANSPARENT_GEOMETRY, 0xABC, 0x1234, 0x5678, 0.5f);
+	CHECK(key >> RenderSortKey::PASS_SHIFT == static_cast<uint64_t>(RenderPass::TRANSPARENT_GEOMETRY));
+	CHECK(RenderSortKey::GetShader(key) == 0xABC);
+	CHECK(RenderSortKey::GetMaterial(key) == 0x1234);
+	CHECK(RenderSortKey::GetMesh(key) == 0x5678);
+	CHECK((key & RenderSortKey::DEPTH_MASK) == static_cast<uint64_t>(0.5f * RenderSortKey::DEPTH_MASK));
+
+	//ids wider than their field are cut, they never spill into the field above
+	uint64_t wide = RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 0x1FFF, 0x1FFFF, 0x1FFFF, 0.0f);
+	CHECK(wide >> RenderSortKey::PASS_SHIFT == 0);
+	CHECK(RenderSortKey::GetShader(wide) == 0xFFF);
+	CHECK(RenderSortKey::GetMaterial(wide) == 0xFFFF);
+	CHECK(RenderSortKey::GetMesh(wide) == 0xFFFF);
+}
+
+TEST_CASE(FieldsOrderBySignificance)
+{
+	using RenderSortKey::Make;
+	RenderPass opaque = RenderPass::OPAQUE_GEOMETRY;
+
+	//a higher field wins whatever the lower ones hold
+	CHECK(Make(opaque, 4095, 65535, 65535, 1.0f) < Make(RenderPass::TRANSPARENT_GEOMETRY, 0, 0, 0, 0.0f));
+	CHECK(Make(opaque, 1, 65535, 65535, 1.0f) < Make(opaque, 2, 0, 0, 0.0f));
+	CHECK(Make(opaque, 1, 3, 65535, 1.0f) < Make(opaque, 1, 4, 0, 0.0f));
+	CHECK(Make(opaque, 1, 3, 7, 1.0f) < Make(opaque, 1, 3, 8, 0.0f));
+	CHECK(Make(opaque, 1, 3, 7, 0.25f) < Make(opaque, 1, 3, 7, 0.75f));
+}
+
+TEST_CASE(DepthIsClamped)
+{
+	using RenderSortKey::Make;
+	RenderPass opaque = RenderPass::OPAQUE_GEOMETRY;
+
+	CHECK(Make(opaque, 1, 2, 3, -5.0f) == Make(opaque, 1, 2, 3, 0.0f));
+	CHECK(Make(opaque, 1, 2, 3, 7.0f) == Make(opaque, 1, 2, 3, 1.0f));
+	CHECK(RenderSortKey::GetMesh(Make(opaque, 1, 2, 3, 7.0f)) == 3);
+}
+
+TEST_CASE(FrontToBackKeysGoBySliceThenMesh)
+{
+	using RenderSortKey::MakeFrontToBack;
+	RenderPass opaque = RenderPass::OPAQUE_GEOMETRY;
+	auto depth = [](uint32_t a_slice, uint32_t a_offset) { return (a_slice * 256 + a_offset + 0.5f) / RenderSortKey::DEPTH_MASK; };
+
+	//a nearer slice wins whatever the mesh, inside one slice the mesh decides before depth
+	CHECK(MakeFrontToBack(opaque, 65535, depth(25, 200)) < MakeFrontToBack(opaque, 0, depth(26, 10)));
+	CHECK(MakeFrontToBack(opaque, 3, depth(100, 200)) < MakeFrontToBack(opaque, 4, depth(100, 10)));
+	CHECK(MakeFrontToBack(opaque, 3, depth(100, 10)) < MakeFrontToBack(opaque, 3, depth(100, 11)));
+	CHECK(MakeFrontToBack(opaque, 0, 1.0f) < MakeFrontToBack(RenderPass::TRANSPARENT_GEOMETRY, 0, 0.0f));
+
+	CHECK(MakeFrontToBack(opaque, 3, -2.0f) == MakeFrontToBack(opaque, 3, 0.0f));
+	CHECK(MakeFrontToBack(opaque, 3, 9.0f) == MakeFrontToBack(opaque, 3, 1.0f));
+
+	//the mesh sits where GetMesh doesn't look, read it from its own field
+	uint64_t key = MakeFrontToBack(opaque, 0x1ABCD, 0.75f);
+	CHECK(((key >> RenderSortKey::FRONT_TO_BACK_MESH_SHIFT) & RenderSortKey::MESH_MASK) == 0xABCD);
+	CHECK(((key >> RenderSortKey::SLICE_SHIFT) & RenderSortKey::SLICE_MASK) == ((key & RenderSortKey::DEPTH_MASK) >> 8));
+}
+
+TEST_CASE(FrontToBackSortIsNearlyDepthOrdered)
+{
+	//sorted keys never step back more than one slice in depth
+	std::mt19937 random(48);
+	std::uniform_int_distribution<uint32_t> mesh(0, 15);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+	std::vector<RenderSortKey::Item> items(20000);
+	for (uint32_t i = 0; i < items.size(); i++) {
+		items[i] = { RenderSortKey::MakeFrontToBack(RenderPass::OPAQUE_GEOMETRY, mesh(random), depth(random)), i };
+	}
+	std::vector<RenderSortKey::Item> scratch;
+	RenderSortKey::RadixSort(items, scratch);
+
+	bool ordered = true;
+	uint64_t farthest = 0;
+	for (const RenderSortKey::Item& item : items) {
+		uint64_t itemDepth = item.m_key & RenderSortKey::DEPTH_MASK;
+		ordered = ordered && itemDepth + 256 > farthest;
+		farthest = (std::max)(farthest, itemDepth);
+	}
+	CHECK(ordered);
+}
+
+TEST_CASE(RadixSortMatchesStableSort)
+{
+	for (size_t count : { 0, 1, 2, 17, 1000, 100000 }) {
+		std::vector<RenderSortKey::Item> items = RandomItems(count, static_cast<unsigned int>(count) + 1);
+		std::vector<RenderSortKey::Item> expected = StableSorted(items);
+		std::vector<RenderSortKey::Item> scratch;
+		RenderSortKey::RadixSort(items, scratch);
+		CHECK(SameOrder(items, expected));
+	}
+}
+
+TEST_CASE(RadixSortIsStable)
+{
+	//a handful of distinct keys over many items, equal keys have to keep their input order
+	std::mt19937 random(7);
+	std::uniform_int_distribution<uint32_t> material(0, 3);
+	std::vector<RenderSortKey::Item> items(5000);
+	for (uint32_t i = 0; i < items.size(); i++) {
+		items[i] = { RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 0, material(random), 0, 0.0f), i };
+	}
+	std::vector<RenderSortKey::Item> expected = StableSorted(items);
+	std::vector<RenderSortKey::Item> scratch;
+	RenderSortKey::RadixSort(items, scratch);
+	CHECK(SameOrder(items, expected));
+}
+
+TEST_CASE(RadixSortSkipsUniformBytes)
+{
+	//only the material's low byte differs, a single pass decides the order and the result
+	//lands in scratch, the sort still has to hand it back in a_items
+	std::vector<RenderSortKey::Item> items;
+	for (uint32_t i = 0; i < 300; i++) {
+		items.push_back({ RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 9, (i * 37) % 256, 11, 0.5f), i });
+	}
+	std::vector<RenderSortKey::Item> expected = StableSorted(items);
+	std::vector<RenderSortKey::Item> scratch;
+	RenderSortKey::RadixSort(items, scratch);
+	CHECK(SameOrder(items, expected));
+
+	//every key equal, nothing moves
+	std::vector<RenderSortKey::Item> equal(64, { RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 1, 1, 1, 0.5f), 0 });
+	for (uint32_t i = 0; i < equal.size(); i++) equal[i].m_index = i;
+	RenderSortKey::RadixSort(equal, scratch);
+	bool unchanged = true;
+	for (uint32_t i = 0; i < equal.size(); i++) unchanged = unchanged && equal[i].m_index == i;
+	CHECK(unchanged);
+}
+
+TEST_CASE(BatchesSplitOnPassAndState)
+{
+	//stateIds is indexed by the item's m_index, not its sorted position
+	std::vector<uint64_t> stateIds = { 5, 5, 7, 5, 5 };
+	std::vector<RenderSortKey::Item> items = {
+		{ RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 0, 0, 0, 0.0f), 4 },
+		{ RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 0, 0, 0, 0.1f), 0 },
+		{ RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 0, 0, 0, 0.2f), 2 },
+		{ RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, 0, 0, 0, 0.3f), 1 },
+		{ RenderSortKey::Make(RenderPass::TRANSPARENT_GEOMETRY, 0, 0, 0, 0.0f), 3 },
+	};
+
+	std::vector<RenderSortKey::Batch> batches;
+	RenderSortKey::BuildBatches(items, stateIds, UINT32_MAX, batches);
+	CHECK(batches.size() == 4);
+	if (batches.size() == 4) {
+		CHECK(batches[0].m_first == 0 && batches[0].m_count == 2);
+		CHECK(batches[1].m_first == 2 && batches[1].m_count == 1);
+		CHECK(batches[2].m_first == 3 && batches[2].m_count == 1);
+		//same state as the run before it, but another pass
+		CHECK(batches[3].m_first == 4 && batches[3].m_count == 1);
+	}
+
+	RenderSortKey::BuildBatches({}, stateIds, UINT32_MAX, batches);
+	CHECK(batches.empty());
+}
+
+TEST_CASE(BatchesAreCapped)
+{
+	std::vector<uint64_t> stateIds(10, 1);
+	std::vector<RenderSortKey::Item> items(10);
+	for (uint32_t i = 0; i < items.size(); i++) items[i] = { 0, i };
+
+	std::vector<RenderSortKey::Batch> batches;
+	RenderSortKey::BuildBatches(items, stateIds, 4, batches);
+	CHECK(batches.size() == 3);
+	if (batches.size() == 3) CHECK(batches[0].m_count == 4 && batches[1].m_count == 4 && batches[2].m_count == 2);
+
+	//a cap of one is instancing off, and zero is treated the same
+	RenderSortKey::BuildBatches(items, stateIds, 1, batches);
+	CHECK(batches.size() == 10);
+	RenderSortKey::BuildBatches(items, stateIds, 0, batches);
+	CHECK(batches.size() == 10);
+}
+
+TEST_CASE(BatchingReducesDrawCalls)
+{
+	//a prop field the way RenderQueue::Add keys it, 12 meshes under 6 materials over 2 shaders
+	const uint32_t propCount = 10000;
+	std::mt19937 random(34);
+	std::uniform_int_distribution<uint32_t> material(0, 5);
+	std::uniform_int_distribution<uint32_t> mesh(0, 11);
+	std::uniform_real_distribution<float> depth(0.0f, 1.0f);
+
+	std::vector<RenderSortKey::Item> items(propCount);
+	std::vector<uint64_t> stateIds(propCount);
+	for (uint32_t i = 0; i < propCount; i++) {
+		uint32_t materialId = material(random);
+		uint32_t meshId = mesh(random);
+		items[i] = { RenderSortKey::Make(RenderPass::OPAQUE_GEOMETRY, materialId % 2, materialId, meshId, depth(random)), i };
+		stateIds[i] = (static_cast<uint64_t>(materialId) << 32) | meshId;
+	}
+	std::vector<RenderSortKey::Item> scratch;
+	RenderSortKey::RadixSort(items, scratch);
+
+	std::vector<RenderSortKey::Batch> batches;
+	RenderSortKey::BuildBatches(items, stateIds, UINT32_MAX, batches);
+	printf("  %u draws -> %zu instanced draws, %.1fx fewer\n", propCount, batches.size(), static_cast<double>(propCount) / batches.size());
+
+	//one draw per mesh and material pair, covering every prop exactly once in order
+	CHECK(batches.size() == 72);
+	uint32_t next = 0;
+	bool uniform = true;
+	for (const RenderSortKey::Batch& batch : batches) {
+		uniform = uniform && batch.m_first == next;
+		for (uint32_t i = batch.m_first; i < batch.m_first + batch.m_count; i++) {
+			uniform = uniform && stateIds[items[i].m_index] == stateIds[items[batch.m_first].m_index];
+		}
+		next = batch.m_first + batch.m_count;
+	}
+	CHECK(uniform);
+	CHECK(next == propCount);
+}
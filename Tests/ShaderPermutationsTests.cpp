@@ -0,0 +1,127 @@
+#include "TestHarness.h"
+#include "ShaderPermutations.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+	std::vector<uint32_t> ValidKeys()
+	{
+		std::vector<uint32_t> keys;
+		for (uint32_t key = 0; key < ShaderPermutations::VARIANT_COUNT; key++) {
+			if (ShaderPermutations::IsValidKey(key)) keys.push_back(key);
+		}
+		return keys;
+	}
+}
+
+TEST_CASE(MaterialFeaturesNeedBothSurfaceMaps)
+{
+	using SP = ShaderPermutations;
+	CHECK(SP::GetMaterialFeatures(false, false, false) == 0);
+	CHECK(SP::GetMaterialFeatures(true, false, false) == SP::NORMAL_MAP);
+	CHECK(SP::GetMaterialFeatures(false, true, false) == 0);
+	CHECK(SP::GetMaterialFeatures(false, false, true) == 0);
+	CHECK(SP::GetMaterialFeatures(false, true, true) == SP::SURFACE_MAPS);
+	CHECK(SP::GetMaterialFeatures(true, true, true) == (SP::NORMAL_MAP | SP::SURFACE_MAPS));
+}
+
+TEST_CASE(DeferredFramesDropLightsAndShadows)
+{
+	using SP = ShaderPermutations;
+	CHECK(SP::GetFrameFeatures(false, false, false, false) == 0);
+	CHECK(SP::GetFrameFeatures(true, true, true, true) == (SP::CLUSTERED_LIGHTS | SP::SHADOWS | SP::IBL | SP::PROBES));
+	CHECK(SP::GetFrameFeatures(true, true, true, true, true) == (SP::DEFERRED | SP::IBL | SP::PROBES));
+	CHECK(SP::GetFrameFeatures(true, true, false, false, true) == SP::DEFERRED);
+
+	//whatever the settings, the frame half never carries material bits and always makes a valid key
+	bool valid = true;
+	for (uint32_t settings = 0; settings < 32; settings++) {
+		uint32_t frame = SP::GetFrameFeatures(settings & 1, settings & 2, settings & 4, settings & 8, settings & 16);
+		valid = valid && (frame & SP::MATERIAL_FEATURES) == 0;
+		for (uint32_t material = 0; material <= SP::MATERIAL_FEATURES; material++) {
+			valid = valid && SP::IsValidKey(SP::Combine(material, frame));
+		}
+	}
+	CHECK(valid);
+}
+
+TEST_CASE(CombineKeepsEachHalfInItsBits)
+{
+	using SP = ShaderPermutations;
+	CHECK(SP::Combine(SP::NORMAL_MAP, SP::SHADOWS) == (SP::NORMAL_MAP | SP::SHADOWS));
+	CHECK(SP::Combine(0xFFFFFFFFu, 0) == SP::MATERIAL_FEATURES);
+	CHECK(SP::Combine(0, 0xFFFFFFFFu) == SP::FRAME_FEATURES);
+	CHECK(SP::Combine(0xFFFFFFFFu, 0xFFFFFFFFu) == SP::VARIANT_COUNT - 1);
+	CHECK((SP::MATERIAL_FEATURES & SP::FRAME_FEATURES) == 0);
+	CHECK((SP::MATERIAL_FEATURES | SP::FRAME_FEATURES) == SP::VARIANT_COUNT - 1);
+	CHECK(SP::IsValidKey(SP::DEFAULT_KEY));
+}
+
+TEST_CASE(InvalidKeys)
+{
+	using SP = ShaderPermutations;
+	CHECK(!SP::IsValidKey(SP::VARIANT_COUNT));
+	CHECK(!SP::IsValidKey(SP::DEFERRED | SP::CLUSTERED_LIGHTS));
+	CHECK(!SP::IsValidKey(SP::DEFERRED | SP::SHADOWS));
+	CHECK(SP::IsValidKey(SP::DEFERRED | SP::IBL | SP::PROBES | SP::NORMAL_MAP));
+
+	//a quarter of the deferred half survives, the forward half is whole
+	CHECK(ValidKeys().size() == SP::VARIANT_COUNT / 2 + SP::VARIANT_COUNT / 8);
+}
+
+TEST_CASE(NamesAndFiles)
+{
+	using SP = ShaderPermutations;
+	CHECK(SP::Describe(0) == "none");
+	CHECK(SP::Describe(SP::NORMAL_MAP | SP::SHADOWS) == "normal map | shadows");
+	CHECK(SP::Describe(SP::DEFERRED) == "deferred");
+	CHECK(std::string(SP::GetFeatureName(SP::NORMAL_MAP | SP::SHADOWS)) == "unknown");
+	CHECK(SP::GetFileName(13) == L"PixelShader_13.cso");
+	CHECK(SP::GetFileName(0) == L"PixelShader_0.cso");
+}
+
+TEST_CASE(ManifestRoundTrips)
+{
+	//every valid key once and in order
+	std::string manifest = ShaderPermutations::BuildManifest();
+	CHECK(ShaderPermutations::ParseManifest(manifest) == ValidKeys());
+	CHECK(static_cast<size_t>(std::count(manifest.begin(), manifest.end(), '\n')) == ValidKeys().size());
+}
+
+TEST_CASE(ManifestParsingSkipsJunk)
+{
+	using SP = ShaderPermutations;
+	std::string manifest =
+		"13\r\n"
+		"\n"
+		"# comment\n"
+		"-4\n"
+		" 5\n"
+		"12345678901\n"
+		"128\n"
+		+ std::to_string(SP::DEFERRED | SP::SHADOWS) + "\n"
+		"64";
+	std::vector<uint32_t> keys = SP::ParseManifest(manifest);
+	CHECK(keys.size() == 2);
+	if (keys.size() == 2) CHECK(keys[0] == 13 && keys[1] == 64);
+	CHECK(SP::ParseManifest("").empty());
+}
+
+TEST_CASE(ManifestIsWritten)
+{
+	std::filesystem::path path = std::filesystem::temp_directory_path() / "ShaderPermutationsTests.txt";
+	CHECK(ShaderPermutations::WriteManifest(path.wstring()));
+
+	std::ifstream file(path, std::ios::binary);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	file.close();
+	std::filesystem::remove(path);
+	CHECK(contents.str() == ShaderPermutations::BuildManifest());
+
+	CHECK(!ShaderPermutations::WriteManifest((std::filesystem::temp_directory_path() / "missing" / "folder" / "manifest.txt").wstring()));
+}
@@ -0,0 +1,174 @@
+#include "TestHarness.h"
+#include "LocalShadows.h"
+#include <algorithm>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	//a grid of point lights with every third a spot, a few metres apart so ranges barely overlap
+	std::vector<SceneLight> GridLights(const Double3& a_offset)
+	{
+		std::vector<SceneLight> lights(40);
+		for (size_t i = 0; i < lights.size(); i++) {
+			lights[i].m_position = Double3(
+				a_offset.x + static_cast<double>(i % 7) * 6.0 - 20.0,
+				a_offset.y + 1.0,
+				a_offset.z + static_cast<double>(i / 7) * 6.0);
+			Light& light = lights[i].m_light;
+			light.m_Type = i % 3 == 0 ? LIGHT_TYPE_SPOT : LIGHT_TYPE_POINT;
+			light.m_Direction = XMFLOAT3(0.0f, -1.0f, 0.2f);
+			light.m_Range = 5.0f;
+			light.m_Intensity = 1.0f;
+			light.m_SpotOuterAngle = 0.6f;
+		}
+		return lights;
+	}
+
+	struct Scene
+	{
+		std::vector<SceneLight> m_lights;
+		LocalShadows m_shadows;
+		Double3 m_origin;
+		XMFLOAT3 m_camera;
+
+		explicit Scene(const Double3& a_origin) :
+			m_lights(GridLights(a_origin)),
+			m_origin(a_origin),
+			m_camera(XMFLOAT3(0.0f, 2.0f, -10.0f))
+		{
+		}
+
+		void Update()
+		{
+			m_shadows.Update(m_lights.data(), m_lights.size(), m_origin, m_camera, 1.0f, 1080.0f, false);
+		}
+	};
+
+	std::vector<ShadowAtlasTile> FaceTiles(const LocalShadows& a_shadows)
+	{
+		std::vector<ShadowAtlasTile> tiles;
+		for (const LocalShadows::Face& face : a_shadows.GetFaces()) tiles.push_back(face.m_tile);
+		return tiles;
+	}
+}
+
+TEST_CASE(RandomPackingNeverOverlaps)
+{
+	std::mt19937 random(1234);
+	ShadowAtlas atlas(4096, 128);
+	std::vector<ShadowAtlasTile> used;
+	for (int step = 0; step < 20000; step++) {
+		if (used.empty() || random() % 3 != 0) {
+			ShadowAtlasTile tile = atlas.Allocate(128u << (random() % 5));
+			if (tile.IsValid()) used.push_back(tile);
+		}
+		else {
+			size_t victim = random() % used.size();
+			atlas.Free(used[victim]);
+			used[victim] = used.back();
+			used.pop_back();
+		}
+	}
+	CHECK(!used.empty());
+	CHECK(atlas.Validate(used));
+
+	//everything back merges into the single root node again
+	for (const ShadowAtlasTile& tile : used) atlas.Free(tile);
+	CHECK(atlas.GetFreeNodeCount() == 1);
+	CHECK(atlas.GetUsedArea() == 0);
+}
+
+TEST_CASE(UnchangedLightsStayCached)
+{
+	Scene scene(Double3(1000.0, 0.0, 1000.0));
+	scene.Update();
+	CHECK(!scene.m_shadows.GetFaces().empty());
+	CHECK(scene.m_shadows.GetDirtyFaceCount() == scene.m_shadows.GetFaces().size());
+	CHECK(scene.m_shadows.GetAtlas().Validate(FaceTiles(scene.m_shadows)));
+
+	scene.m_shadows.MarkStaticRendered();
+	scene.Update();
+	CHECK(scene.m_shadows.GetDirtyFaceCount() == 0);
+	CHECK(scene.m_shadows.GetReallocationCount() == 0);
+}
+
+TEST_CASE(MovedLightRedrawsOnlyItsFaces)
+{
+	Scene scene(Double3(1000.0, 0.0, 1000.0));
+	scene.Update();
+	scene.m_shadows.MarkStaticRendered();
+
+	uint32_t moved = scene.m_shadows.GetFaces()[0].m_light;
+	scene.m_lights[moved].m_position.x += 0.5;
+	scene.Update();
+	CHECK(scene.m_shadows.GetDirtyFaceCount() == (scene.m_lights[moved].m_light.m_Type == LIGHT_TYPE_POINT ? 6u : 1u));
+	for (const LocalShadows::Face& face : scene.m_shadows.GetFaces()) {
+		CHECK(!face.m_staticDirty || face.m_light == moved);
+	}
+}
+
+TEST_CASE(InvalidationOnlyReachesLightsInRange)
+{
+	Scene scene(Double3(1000.0, 0.0, 1000.0));
+	scene.Update();
+	scene.m_shadows.MarkStaticRendered();
+
+	//a box far from every light
+	scene.m_shadows.InvalidateBounds(Bounds::FromMinMax(XMFLOAT3(500.0f, 0.0f, 500.0f), XMFLOAT3(501.0f, 1.0f, 501.0f)), scene.m_origin);
+	scene.Update();
+	CHECK(scene.m_shadows.GetDirtyFaceCount() == 0);
+
+	//a box just inside one shadowed light's range
+	uint32_t target = scene.m_shadows.GetFaces()[0].m_light;
+	XMFLOAT3 p = scene.m_lights[target].m_position.RelativeTo(scene.m_origin);
+	Bounds box = Bounds::FromMinMax(XMFLOAT3(p.x + 3.0f, p.y, p.z), XMFLOAT3(p.x + 4.0f, p.y + 1.0f, p.z + 1.0f));
+	scene.m_shadows.InvalidateBounds(box, scene.m_origin);
+	scene.Update();
+
+	bool targetDirty = false;
+	bool allReach = true;
+	for (const LocalShadows::Face& face : scene.m_shadows.GetFaces()) {
+		if (!face.m_staticDirty) continue;
+		targetDirty = targetDirty || face.m_light == target;
+
+		XMFLOAT3 q = scene.m_lights[face.m_light].m_position.RelativeTo(scene.m_origin);
+		float dx = (std::max)(0.0f, std::fabs(q.x - box.m_center.x) - box.m_extents.x);
+		float dy = (std::max)(0.0f, std::fabs(q.y - box.m_center.y) - box.m_extents.y);
+		float dz = (std::max)(0.0f, std::fabs(q.z - box.m_center.z) - box.m_extents.z);
+		float range = scene.m_lights[face.m_light].m_light.m_Range;
+		allReach = allReach && dx * dx + dy * dy + dz * dz <= range * range;
+	}
+	CHECK(targetDirty);
+	CHECK(allReach);
+	CHECK(scene.m_shadows.GetAtlas().Validate(FaceTiles(scene.m_shadows)));
+}
+
+TEST_CASE(InvalidationIsExactFarFromTheWorldOrigin)
+{
+	//floats are a whole metre apart out here, the box edge has to be placed in doubles
+	Double3 origin(1.0e7, 0.0, 1.0e7);
+	Scene scene(origin);
+	scene.Update();
+	scene.m_shadows.MarkStaticRendered();
+
+	uint32_t target = scene.m_shadows.GetFaces()[0].m_light;
+	XMFLOAT3 p = scene.m_lights[target].m_position.RelativeTo(origin);
+	float range = scene.m_lights[target].m_light.m_Range;
+
+	//0.2m past the range, nothing redraws
+	Bounds outside = Bounds::FromMinMax(XMFLOAT3(p.x + range + 0.2f, p.y, p.z), XMFLOAT3(p.x + range + 1.2f, p.y + 1.0f, p.z + 1.0f));
+	scene.m_shadows.InvalidateBounds(outside, origin);
+	scene.Update();
+	bool targetDirty = false;
+	for (const LocalShadows::Face& face : scene.m_shadows.GetFaces()) targetDirty = targetDirty || (face.m_staticDirty && face.m_light == target);
+	CHECK(!targetDirty);
+
+	//0.2m inside it does
+	Bounds inside = Bounds::FromMinMax(XMFLOAT3(p.x + range - 0.2f, p.y, p.z), XMFLOAT3(p.x + range + 0.8f, p.y + 1.0f, p.z + 1.0f));
+	scene.m_shadows.InvalidateBounds(inside, origin);
+	scene.Update();
+	for (const LocalShadows::Face& face : scene.m_shadows.GetFaces()) targetDirty = targetDirty || (face.m_staticDirty && face.m_light == target);
+	CHECK(targetDirty);
+}
@@ -0,0 +1,176 @@
+#include "TestHarness.h"
+#include "ShadowCascades.h"
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	const float NEAR_PLANE = 0.1f;
+	const float FAR_PLANE = 300.0f;
+	const XMFLOAT3 LIGHT_DIRECTION(0.3f, -1.0f, 0.4f);
+
+	XMFLOAT4X4 Projection(bool a_orthographic)
+	{
+		XMFLOAT4X4 projection;
+		XMStoreFloat4x4(&projection, a_orthographic
+			? XMMatrixOrthographicLH(40.0f, 22.5f, NEAR_PLANE, FAR_PLANE)
+			: XMMatrixPerspectiveFovLH(XM_PI / 3.0f, 16.0f / 9.0f, NEAR_PLANE, FAR_PLANE));
+		return projection;
+	}
+
+	struct RandomCamera
+	{
+		XMVECTOR m_eye;
+		XMVECTOR m_forward;
+		XMFLOAT4X4 m_view;
+		Double3 m_origin;
+
+		explicit RandomCamera(std::mt19937& a_random)
+		{
+			std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+			//far away origins are where float snapping would fall apart
+			m_origin = Double3(unit(a_random) * 1.0e6, 0.0, unit(a_random) * 1.0e6);
+			m_eye = XMVectorSet(unit(a_random) * 50.0f, 10.0f + unit(a_random) * 5.0f, unit(a_random) * 50.0f, 1.0f);
+			m_forward = XMVector3Normalize(XMVectorSet(unit(a_random), unit(a_random) * 0.5f, unit(a_random), 0.0f));
+			m_view = LookTo(m_eye);
+		}
+
+		XMFLOAT4X4 LookTo(XMVECTOR a_eye) const
+		{
+			XMFLOAT4X4 view;
+			XMStoreFloat4x4(&view, XMMatrixLookToLH(a_eye, m_forward, XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)));
+			return view;
+		}
+	};
+}
+
+TEST_CASE(SplitsIncreaseFromNearToFar)
+{
+	float splits[ShadowCascades::MAX_CASCADES + 1];
+	for (int lambda = 0; lambda <= 10; lambda++) {
+		ShadowCascades::ComputeSplits(NEAR_PLANE, FAR_PLANE, ShadowCascades::MAX_CASCADES, lambda / 10.0f, splits);
+		CHECK_NEAR(splits[0], NEAR_PLANE, 1e-6);
+		CHECK_NEAR(splits[ShadowCascades::MAX_CASCADES], FAR_PLANE, 1e-3);
+		bool increasing = true;
+		for (uint32_t i = 0; i < ShadowCascades::MAX_CASCADES; i++) increasing = increasing && splits[i] < splits[i + 1];
+		CHECK(increasing);
+	}
+
+	//0 is uniform, 1 logarithmic
+	ShadowCascades::ComputeSplits(1.0f, 9.0f, 2, 0.0f, splits);
+	CHECK_NEAR(splits[1], 5.0, 1e-5);
+	ShadowCascades::ComputeSplits(1.0f, 9.0f, 2, 1.0f, splits);
+	CHECK_NEAR(splits[1], 3.0, 1e-5);
+}
+
+TEST_CASE(CascadesCoverTheirSliceCorners)
+{
+	std::mt19937 random(43);
+	for (bool orthographic : { false, true }) {
+		XMFLOAT4X4 projection = Projection(orthographic);
+		size_t outside = 0;
+		for (int test = 0; test < 50; test++) {
+			RandomCamera camera(random);
+			ShadowCascades cascades;
+			cascades.Fit(camera.m_view, projection, NEAR_PLANE, FAR_PLANE, orthographic, LIGHT_DIRECTION, camera.m_origin);
+			CHECK(cascades.GetCascadeCount() == ShadowCascades::MAX_CASCADES);
+
+			XMMATRIX inverseView = XMMatrixInverse(nullptr, XMLoadFloat4x4(&camera.m_view));
+			for (uint32_t i = 0; i < cascades.GetCascadeCount(); i++) {
+				const ShadowCascade& cascade = cascades.GetCascade(i);
+				XMMATRIX viewProjection = XMLoadFloat4x4(&cascade.m_viewProjection);
+				for (float depth : { cascade.m_nearDepth, cascade.m_farDepth }) {
+					float halfWidth = (orthographic ? 1.0f : depth) / projection._11;
+					float halfHeight = (orthographic ? 1.0f : depth) / projection._22;
+					for (int corner = 0; corner < 4; corner++) {
+						XMVECTOR viewCorner = XMVectorSet(corner & 1 ? halfWidth : -halfWidth, corner & 2 ? halfHeight : -halfHeight, depth, 1.0f);
+						XMFLOAT3 clip;
+						XMStoreFloat3(&clip, XMVector3TransformCoord(XMVector3TransformCoord(viewCorner, inverseView), viewProjection));
+						if (std::fabs(clip.x) > 1.001f || std::fabs(clip.y) > 1.001f || clip.z < 0.0f || clip.z > 1.0f) outside++;
+					}
+				}
+			}
+
+			//cascades pick up where the last one stopped and end at the shadow distance
+			CHECK_NEAR(cascades.GetCascade(0).m_nearDepth, NEAR_PLANE, 1e-5);
+			for (uint32_t i = 1; i < cascades.GetCascadeCount(); i++) {
+				CHECK_NEAR(cascades.GetCascade(i).m_nearDepth, cascades.GetCascade(i - 1).m_farDepth, 1e-4);
+			}
+			CHECK_NEAR(cascades.GetCascade(cascades.GetCascadeCount() - 1).m_farDepth, cascades.m_maxDistance, 1e-3);
+		}
+		CHECK(outside == 0);
+	}
+}
+
+TEST_CASE(SmallCameraMovesShiftWholeTexels)
+{
+	std::mt19937 random(44);
+	XMFLOAT4X4 projection = Projection(false);
+	size_t unsnapped = 0;
+	for (int test = 0; test < 50; test++) {
+		RandomCamera camera(random);
+		ShadowCascades cascades;
+		cascades.Fit(camera.m_view, projection, NEAR_PLANE, FAR_PLANE, false, LIGHT_DIRECTION, camera.m_origin);
+
+		//a fixed point has to move by whole texels when the camera nudges less than one
+		ShadowCascades nudged = cascades;
+		XMFLOAT4X4 nudgedView = camera.LookTo(XMVectorAdd(camera.m_eye, XMVectorSet(0.001f, 0.0007f, -0.0003f, 0.0f)));
+		nudged.Fit(nudgedView, projection, NEAR_PLANE, FAR_PLANE, false, LIGHT_DIRECTION, camera.m_origin);
+
+		XMVECTOR point = XMVectorSet(3.0f, 1.0f, 2.0f, 1.0f);
+		for (uint32_t i = 0; i < cascades.GetCascadeCount(); i++) {
+			XMFLOAT3 before, after;
+			XMStoreFloat3(&before, XMVector3TransformCoord(point, XMLoadFloat4x4(&cascades.GetCascade(i).m_viewProjection)));
+			XMStoreFloat3(&after, XMVector3TransformCoord(point, XMLoadFloat4x4(&nudged.GetCascade(i).m_viewProjection)));
+			for (float moved : { after.x - before.x, after.y - before.y }) {
+				float texels = moved * 0.5f * cascades.m_resolution;
+				if (std::fabs(texels - std::round(texels)) > 0.05f) unsnapped++;
+			}
+		}
+	}
+	CHECK(unsnapped == 0);
+}
+
+TEST_CASE(CasterCullMatchesSingleBoxes)
+{
+	std::mt19937 random(45);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	BoundsSoA bounds;
+	std::vector<Bounds> boxes(2000);
+	for (Bounds& box : boxes) {
+		XMFLOAT3 center(unit(random) * 200.0f, unit(random) * 30.0f, unit(random) * 200.0f);
+		float halfSize = 1.5f + unit(random);
+		box = Bounds::FromMinMax(
+			XMFLOAT3(center.x - halfSize, center.y - halfSize, center.z - halfSize),
+			XMFLOAT3(center.x + halfSize, center.y + halfSize, center.z + halfSize));
+		bounds.Add(box);
+	}
+
+	XMFLOAT4X4 projection = Projection(false);
+	std::vector<uint32_t> casters;
+	size_t mismatches = 0;
+	size_t found = 0;
+	for (int test = 0; test < 20; test++) {
+		RandomCamera camera(random);
+		ShadowCascades cascades;
+		cascades.Fit(camera.m_view, projection, NEAR_PLANE, FAR_PLANE, false, LIGHT_DIRECTION, camera.m_origin);
+
+		for (uint32_t i = 0; i < cascades.GetCascadeCount(); i++) {
+			cascades.CullCasters(i, bounds, casters);
+			found += casters.size();
+
+			Frustum frustum;
+			frustum.ExtractPlanes(cascades.GetCascade(i).m_viewProjection);
+			std::vector<uint32_t> expected;
+			for (uint32_t box = 0; box < boxes.size(); box++) {
+				if (frustum.IntersectsBox(boxes[box].m_center, boxes[box].m_extents)) expected.push_back(box);
+			}
+			if (casters != expected) mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(found > 0);
+}
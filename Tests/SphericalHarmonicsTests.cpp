@@ -0,0 +1,95 @@
+#include "TestHarness.h"
+#include "SphericalHarmonics.h"
+#include <numbers>
+
+using namespace DirectX;
+
+namespace
+{
+	//evenly spread directions on the sphere, each covering the same solid angle
+	std::vector<XMFLOAT3> FibonacciSphere(uint32_t a_count)
+	{
+		std::vector<XMFLOAT3> directions(a_count);
+		const float golden = std::numbers::pi_v<float> * (3.0f - std::sqrt(5.0f));
+		for (uint32_t i = 0; i < a_count; i++) {
+			float z = 1.0f - (2.0f * i + 1.0f) / a_count;
+			float radius = std::sqrt((std::max)(0.0f, 1.0f - z * z));
+			float phi = golden * i;
+			directions[i] = XMFLOAT3(radius * std::cos(phi), radius * std::sin(phi), z);
+		}
+		return directions;
+	}
+
+	template <typename Radiance>
+	SphericalHarmonicsL2 Project(Radiance a_radiance, uint32_t a_count = 20000)
+	{
+		SphericalHarmonicsL2 sh;
+		float weight = 4.0f * std::numbers::pi_v<float> / a_count;
+		for (const XMFLOAT3& direction : FibonacciSphere(a_count)) sh.AddSample(direction, a_radiance(direction), weight);
+		return sh;
+	}
+}
+
+TEST_CASE(BasisIsOrthonormal)
+{
+	const uint32_t count = 20000;
+	float weight = 4.0f * std::numbers::pi_v<float> / count;
+	float products[SphericalHarmonicsL2::COEFFICIENT_COUNT][SphericalHarmonicsL2::COEFFICIENT_COUNT] = {};
+	for (const XMFLOAT3& direction : FibonacciSphere(count)) {
+		float basis[SphericalHarmonicsL2::COEFFICIENT_COUNT];
+		SphericalHarmonicsL2::EvaluateBasis(direction, basis);
+		for (int i = 0; i < SphericalHarmonicsL2::COEFFICIENT_COUNT; i++) {
+			for (int j = 0; j < SphericalHarmonicsL2::COEFFICIENT_COUNT; j++) products[i][j] += basis[i] * basis[j] * weight;
+		}
+	}
+	for (int i = 0; i < SphericalHarmonicsL2::COEFFICIENT_COUNT; i++) {
+		for (int j = 0; j < SphericalHarmonicsL2::COEFFICIENT_COUNT; j++) CHECK_NEAR(products[i][j], i == j ? 1.0 : 0.0, 2e-3);
+	}
+}
+
+TEST_CASE(UniformRadianceGivesTheSameIrradianceEverywhere)
+{
+	//a sky of radiance L lights every surface with pi L, over pi that is L again
+	SphericalHarmonicsL2 irradiance = Project([](const XMFLOAT3&) { return XMFLOAT3(0.5f, 1.0f, 2.0f); }).ConvolvedWithCosine();
+	for (const XMFLOAT3& normal : FibonacciSphere(50)) {
+		XMFLOAT3 value = irradiance.Evaluate(normal);
+		CHECK_NEAR(value.x, 0.5, 1e-3);
+		CHECK_NEAR(value.y, 1.0, 1e-3);
+		CHECK_NEAR(value.z, 2.0, 1e-3);
+	}
+}
+
+TEST_CASE(LinearRadianceConvolvesExactly)
+{
+	//radiance 1 + z integrates against the clamped cosine to pi (1 + 2/3 n.z)
+	SphericalHarmonicsL2 irradiance = Project([](const XMFLOAT3& a_direction) {
+		float value = 1.0f + a_direction.z;
+		return XMFLOAT3(value, value, value);
+	}).ConvolvedWithCosine();
+	for (const XMFLOAT3& normal : FibonacciSphere(50)) {
+		CHECK_NEAR(irradiance.Evaluate(normal).x, 1.0 + 2.0 / 3.0 * normal.z, 1e-3);
+	}
+}
+
+TEST_CASE(AddAndScaleAreLinear)
+{
+	SphericalHarmonicsL2 first = Project([](const XMFLOAT3& a_direction) { return XMFLOAT3(a_direction.x * a_direction.x, 0.0f, 1.0f); }, 500);
+	SphericalHarmonicsL2 second = Project([](const XMFLOAT3& a_direction) { return XMFLOAT3(1.0f, a_direction.y, 0.0f); }, 500);
+
+	SphericalHarmonicsL2 sum = first;
+	sum.Add(second, 0.5f);
+	SphericalHarmonicsL2 scaled = first;
+	scaled.Scale(3.0f);
+
+	XMFLOAT3 normal(0.6f, 0.0f, 0.8f);
+	XMFLOAT3 a = first.Evaluate(normal), b = second.Evaluate(normal);
+	CHECK_NEAR(sum.Evaluate(normal).x, a.x + 0.5f * b.x, 1e-5);
+	CHECK_NEAR(sum.Evaluate(normal).y, a.y + 0.5f * b.y, 1e-5);
+	CHECK_NEAR(scaled.Evaluate(normal).z, 3.0f * a.z, 1e-5);
+	CHECK_NEAR(SphericalHarmonicsL2().Evaluate(normal).x, 0.0, 0.0);
+}
+
+TEST_CASE(LayoutMatchesTheShader)
+{
+	CHECK(sizeof(SphericalHarmonicsL2) == 108);
+}
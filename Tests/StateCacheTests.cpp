@@ -0,0 +1,140 @@
+#include "TestHarness.h"
+#include "MockContext.h"
+#include "StateCache.h"
+
+namespace
+{
+	using Cache = StateCache<MockContext>;
+
+	struct Fixture
+	{
+		MockContext m_context;
+		Cache m_cache;
+
+		Fixture() { m_cache.SetContext(&m_context); }
+	};
+}
+
+TEST_CASE(RedundantBindsAreDropped)
+{
+	Fixture fixture;
+	ID3D11VertexShader* shader = MockContext::Handle<ID3D11VertexShader>(1);
+	ID3D11Buffer* buffer = MockContext::Handle<ID3D11Buffer>(2);
+	ID3D11RasterizerState* rasterizer = MockContext::Handle<ID3D11RasterizerState>(3);
+
+	fixture.m_cache.VSSetShader(shader);
+	fixture.m_cache.VSSetShader(shader);
+	fixture.m_cache.IASetVertexBuffer(buffer, 48, 0);
+	fixture.m_cache.IASetVertexBuffer(buffer, 48, 0);
+	fixture.m_cache.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	fixture.m_cache.IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	fixture.m_cache.RSSetState(rasterizer);
+	fixture.m_cache.RSSetState(rasterizer);
+	CHECK(fixture.m_context.m_calls.size() == 4);
+
+	const Cache::Counters& counters = fixture.m_cache.GetCounters();
+	CHECK(counters.TotalIssued() == 4);
+	CHECK(counters.TotalSkipped() == 4);
+	CHECK(counters.m_skipped[Cache::SHADERS] == 1);
+	CHECK(counters.m_skipped[Cache::INPUT_ASSEMBLER] == 2);
+	CHECK(counters.m_skipped[Cache::PIPELINE_STATES] == 1);
+
+	//any part of a compound binding changing goes through
+	fixture.m_cache.IASetVertexBuffer(buffer, 48, 96);
+	fixture.m_cache.OMSetDepthStencilState(nullptr, 0);
+	fixture.m_cache.OMSetDepthStencilState(nullptr, 1);
+	CHECK(fixture.m_context.m_calls.size() == 7);
+}
+
+TEST_CASE(NullIsABinding)
+{
+	Fixture fixture;
+
+	//nothing is known after SetContext, so the first null is issued
+	fixture.m_cache.PSSetShader(nullptr);
+	fixture.m_cache.PSSetShader(nullptr);
+	fixture.m_cache.PSSetShaderResource(3, nullptr);
+	fixture.m_cache.PSSetShaderResource(3, nullptr);
+	CHECK(fixture.m_context.m_calls.size() == 2);
+
+	//unbinding a bound slot is a change
+	ID3D11ShaderResourceView* view = MockContext::Handle<ID3D11ShaderResourceView>(1);
+	fixture.m_cache.PSSetShaderResource(3, view);
+	fixture.m_cache.PSSetShaderResource(3, nullptr);
+	CHECK(fixture.m_context.m_calls.size() == 4);
+	if (fixture.m_context.m_calls.size() == 4) CHECK(fixture.m_context.m_calls[3].m_value == nullptr);
+
+	//and after Invalidate null is unknown again
+	fixture.m_cache.Invalidate();
+	fixture.m_cache.PSSetShader(nullptr);
+	CHECK(fixture.m_context.m_calls.size() == 5);
+}
+
+TEST_CASE(RangeBindsUpdateEverySlot)
+{
+	Fixture fixture;
+	ID3D11ShaderResourceView* views[3] = {
+		MockContext::Handle<ID3D11ShaderResourceView>(1),
+		MockContext::Handle<ID3D11ShaderResourceView>(2),
+		MockContext::Handle<ID3D11ShaderResourceView>(3) };
+
+	fixture.m_cache.PSSetShaderResources(4, 3, views);
+	CHECK(fixture.m_context.m_calls.size() == 1);
+	if (fixture.m_context.m_calls.size() == 1) {
+		CHECK(fixture.m_context.m_calls[0].m_slot == 4);
+		CHECK(fixture.m_context.m_calls[0].m_count == 3);
+	}
+
+	//the range left every slot it covered known, single binds of the same views drop
+	fixture.m_cache.PSSetShaderResource(5, views[1]);
+	fixture.m_cache.PSSetShaderResources(4, 3, views);
+	CHECK(fixture.m_context.m_calls.size() == 1);
+
+	//one slot of the range changing reissues the whole range
+	fixture.m_cache.PSSetShaderResource(6, nullptr);
+	fixture.m_cache.PSSetShaderResources(4, 3, views);
+	CHECK(fixture.m_context.m_calls.size() == 3);
+	if (fixture.m_context.m_calls.size() == 3) CHECK(fixture.m_context.m_calls[2].m_count == 3);
+
+	//an unbind range clears what the singles remember
+	ID3D11ShaderResourceView* nulls[3] = {};
+	fixture.m_cache.PSSetShaderResources(4, 3, nulls);
+	fixture.m_cache.PSSetShaderResource(5, views[1]);
+	CHECK(fixture.m_context.m_calls.size() == 5);
+
+	const Cache::Counters& counters = fixture.m_cache.GetCounters();
+	CHECK(counters.m_issued[Cache::SHADER_RESOURCES] == 5);
+	CHECK(counters.m_skipped[Cache::SHADER_RESOURCES] == 2);
+}
+
+TEST_CASE(ConstantBufferRangesCompareOffsets)
+{
+	Fixture fixture;
+	ID3D11Buffer* ring = MockContext::Handle<ID3D11Buffer>(1);
+
+	//suballocations of one ring buffer differ only in their first constant
+	fixture.m_cache.VSSetConstantBuffer(0, ring, 0, 16);
+	fixture.m_cache.VSSetConstantBuffer(0, ring, 16, 16);
+	fixture.m_cache.VSSetConstantBuffer(0, ring, 16, 16);
+	fixture.m_cache.PSSetConstantBuffer(0, ring, 16, 16);
+	CHECK(fixture.m_context.m_calls.size() == 3);
+}
+
+TEST_CASE(SlotsPastTheShadowPassThrough)
+{
+	Fixture fixture;
+	unsigned int slot = Cache::SHADER_RESOURCE_SLOTS + 2;
+	fixture.m_cache.PSSetShaderResource(slot, nullptr);
+	fixture.m_cache.PSSetShaderResource(slot, nullptr);
+	CHECK(fixture.m_context.m_calls.size() == 2);
+
+	//a range reaching past the end can't be proven redundant, it always goes through
+	ID3D11ShaderResourceView* views[2] = {};
+	fixture.m_cache.PSSetShaderResources(Cache::SHADER_RESOURCE_SLOTS - 1, 2, views);
+	fixture.m_cache.PSSetShaderResources(Cache::SHADER_RESOURCE_SLOTS - 1, 2, views);
+	CHECK(fixture.m_context.m_calls.size() == 4);
+
+	//but it still recorded the slot it could see
+	fixture.m_cache.PSSetShaderResource(Cache::SHADER_RESOURCE_SLOTS - 1, nullptr);
+	CHECK(fixture.m_context.m_calls.size() == 4);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+/// <summary>
+/// Just enough of a test framework for the headless tests. TEST_CASE registers
+/// a function, CHECK and CHECK_NEAR report failures without stopping the test,
+/// and TestMain.cpp runs everything registered in the executable.
+/// </summary>
+namespace TestHarness
+{
+	struct TestCase
+	{
+		const char* m_name;
+		void (*m_function)();
+	};
+
+	inline std::vector<TestCase>& GetTests()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	inline int& GetFailureCount()
+	{
+		static int failures = 0;
+		return failures;
+	}
+
+	struct Registrar
+	{
+		Registrar(const char* a_name, void (*a_function)()) { GetTests().push_back({ a_name, a_function }); }
+	};
+
+	inline void Fail(const char* a_file, int a_line, const char* a_expression)
+	{
+		printf("  %s(%d): CHECK(%s) failed\n", a_file, a_line, a_expression);
+		GetFailureCount()++;
+	}
+
+	inline void FailNear(const char* a_file, int a_line, const char* a_expression, double a_value, double a_expected, double a_tolerance)
+	{
+		printf("  %s(%d): CHECK_NEAR(%s) failed, %.9g is not within %g of %.9g\n", a_file, a_line, a_expression, a_value, a_tolerance, a_expected);
+		GetFailureCount()++;
+	}
+}
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static TestHarness::Registrar name##Registrar(#name, name); \
+	static void name()
+
+#define CHECK(condition) \
+	do { if (!(condition)) TestHarness::Fail(__FILE__, __LINE__, #condition); } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+	do { \
+		double checkValue = (value), checkExpected = (expected); \
+		if (!(std::fabs(checkValue - checkExpected) <= (tolerance))) \
+			TestHarness::FailNear(__FILE__, __LINE__, #value ", " #expected, checkValue, checkExpected, (tolerance)); \
+	} while (0)
@@ -0,0 +1,15 @@
+#include "TestHarness.h"
+
+int main()
+{
+	int failedTests = 0;
+	for (const TestHarness::TestCase& test : TestHarness::GetTests()) {
+		int failuresBefore = TestHarness::GetFailureCount();
+		test.m_function();
+		bool passed = TestHarness::GetFailureCount() == failuresBefore;
+		printf("%s %s\n", passed ? "[pass]" : "[FAIL]", test.m_name);
+		if (!passed) failedTests++;
+	}
+	printf("%d of %zu tests failed\n", failedTests, TestHarness::GetTests().size());
+	return failedTests == 0 ? 0 : 1;
+}
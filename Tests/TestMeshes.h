@@ -0,0 +1,39 @@
+#pragma once
+#include <DirectXMath.h>
+#include <array>
+#include <cstdint>
+
+/// <summary>
+/// Small meshes the headless tests build scenes from
+/// </summary>
+namespace TestMeshes
+{
+	//unit cube centered on the origin, clockwise seen from outside like the game's meshes
+	inline const std::array<DirectX::XMFLOAT3, 8> CUBE_POSITIONS = {
+		DirectX::XMFLOAT3(-0.5f, -0.5f, -0.5f), DirectX::XMFLOAT3(0.5f, -0.5f, -0.5f),
+		DirectX::XMFLOAT3(0.5f, 0.5f, -0.5f), DirectX::XMFLOAT3(-0.5f, 0.5f, -0.5f),
+		DirectX::XMFLOAT3(-0.5f, -0.5f, 0.5f), DirectX::XMFLOAT3(0.5f, -0.5f, 0.5f),
+		DirectX::XMFLOAT3(0.5f, 0.5f, 0.5f), DirectX::XMFLOAT3(-0.5f, 0.5f, 0.5f)
+	};
+
+	inline const std::array<uint32_t, 36> CUBE_INDICES = {
+		0, 3, 2, 0, 2, 1, // -z
+		5, 6, 7, 5, 7, 4, // +z
+		4, 7, 3, 4, 3, 0, // -x
+		1, 2, 6, 1, 6, 5, // +x
+		3, 7, 6, 3, 6, 2, // +y
+		4, 0, 1, 4, 1, 5  // -y
+	};
+
+	/// <summary>
+	/// World matrix taking the unit cube to the box between a_min and a_max
+	/// </summary>
+	inline DirectX::XMFLOAT4X4 BoxWorld(const DirectX::XMFLOAT3& a_min, const DirectX::XMFLOAT3& a_max)
+	{
+		DirectX::XMFLOAT4X4 world;
+		DirectX::XMStoreFloat4x4(&world, DirectX::XMMatrixMultiply(
+			DirectX::XMMatrixScaling(a_max.x - a_min.x, a_max.y - a_min.y, a_max.z - a_min.z),
+			DirectX::XMMatrixTranslation((a_min.x + a_max.x) * 0.5f, (a_min.y + a_max.y) * 0.5f, (a_min.z + a_max.z) * 0.5f)));
+		return world;
+	}
+}
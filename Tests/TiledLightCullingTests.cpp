@@ -0,0 +1,201 @@
+#include "TestHarness.h"
+#include "TiledLightCulling.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace DirectX;
+
+namespace
+{
+	struct View
+	{
+		uint32_t m_width;
+		uint32_t m_height;
+		XMFLOAT4X4 m_projection;
+		bool m_orthographic;
+	};
+
+	View MakeView(uint32_t a_width, uint32_t a_height, bool a_orthographic)
+	{
+		View view = { a_width, a_height, {}, a_orthographic };
+		float aspect = static_cast<float>(a_width) / a_height;
+		XMStoreFloat4x4(&view.m_projection, a_orthographic
+			? XMMatrixOrthographicLH(40.0f * aspect, 40.0f, 0.1f, 100.0f)
+			: XMMatrixPerspectiveFovLH(XM_PIDIV4, aspect, 0.1f, 100.0f));
+		return view;
+	}
+
+	//view space position of a pixel's center at view depth a_z
+	XMFLOAT3 PixelPosition(const View& a_view, uint32_t a_x, uint32_t a_y, float a_z)
+	{
+		float ndcX = 2.0f * (a_x + 0.5f) / a_view.m_width - 1.0f;
+		float ndcY = 1.0f - 2.0f * (a_y + 0.5f) / a_view.m_height;
+		float scale = a_view.m_orthographic ? 1.0f : a_z;
+		return XMFLOAT3(ndcX * scale / a_view.m_projection._11, ndcY * scale / a_view.m_projection._22, a_z);
+	}
+
+	//blocks of random depth with the left tile column and a corner left empty
+	std::vector<float> RandomDepths(const View& a_view, unsigned int a_seed)
+	{
+		std::mt19937 random(a_seed);
+		std::uniform_real_distribution<float> depth(1.0f, 60.0f);
+		std::vector<float> depths(static_cast<size_t>(a_view.m_width) * a_view.m_height);
+		for (uint32_t blockY = 0; blockY < a_view.m_height; blockY += 5) {
+			for (uint32_t blockX = 0; blockX < a_view.m_width; blockX += 7) {
+				float value = depth(random);
+				for (uint32_t y = blockY; y < (std::min)(blockY + 5, a_view.m_height); y++) {
+					for (uint32_t x = blockX; x < (std::min)(blockX + 7, a_view.m_width); x++) {
+						bool empty = x < TiledLightCulling::TILE_SIZE || (x > a_view.m_width - 10 && y > a_view.m_height - 10);
+						depths[static_cast<size_t>(y) * a_view.m_width + x] = empty ? 0.0f : value + 0.05f * (x - blockX);
+					}
+				}
+			}
+		}
+		return depths;
+	}
+
+	std::vector<XMFLOAT4> RandomSpheres(const View& a_view, size_t a_count, unsigned int a_seed)
+	{
+		std::mt19937 random(a_seed);
+		std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+		std::uniform_real_distribution<float> depth(-2.0f, 65.0f);
+		std::uniform_real_distribution<float> range(0.3f, 5.0f);
+		std::vector<XMFLOAT4> spheres(a_count);
+		for (XMFLOAT4& sphere : spheres) {
+			float z = depth(random);
+			float scale = a_view.m_orthographic ? 1.2f : 1.2f * (std::max)(z, 1.0f);
+			sphere = XMFLOAT4(unit(random) * scale / a_view.m_projection._11, unit(random) * scale / a_view.m_projection._22, z, range(random));
+		}
+		return spheres;
+	}
+
+	const uint32_t* Tile(const TiledLightCulling& a_culling, uint32_t a_x, uint32_t a_y)
+	{
+		return a_culling.GetTileLights().data() + static_cast<size_t>(a_y * a_culling.GetCountX() + a_x) * TiledLightCulling::TILE_STRIDE;
+	}
+
+	bool Contains(const uint32_t* a_tile, uint32_t a_light)
+	{
+		return std::find(a_tile + 1, a_tile + 1 + a_tile[0], a_light) != a_tile + 1 + a_tile[0];
+	}
+}
+
+TEST_CASE(TileCountsRoundUp)
+{
+	CHECK(TiledLightCulling::GetTileCount(1) == 1);
+	CHECK(TiledLightCulling::GetTileCount(16) == 1);
+	CHECK(TiledLightCulling::GetTileCount(17) == 2);
+	CHECK(TiledLightCulling::GetTileCount(1920) == 120);
+	CHECK(TiledLightCulling::GetTileCount(1080) == 68);
+}
+
+TEST_CASE(DepthLinearizesBack)
+{
+	for (bool orthographic : { false, true }) {
+		View view = MakeView(64, 64, orthographic);
+		for (float z : { 0.1f, 1.0f, 7.5f, 42.0f, 100.0f }) {
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector4Transform(XMVectorSet(0.0f, 0.0f, z, 1.0f), XMLoadFloat4x4(&view.m_projection)));
+			float depth = clip.z / clip.w;
+			CHECK_NEAR(TiledLightCulling::LinearizeDepth(depth, view.m_projection._33, view.m_projection._43, orthographic), z, z * 1e-3);
+		}
+	}
+}
+
+TEST_CASE(NoLightThatReachesAPixelIsMissed)
+{
+	//a screen whose size isn't a tile multiple, so the last row and column are partial
+	for (bool orthographic : { false, true }) {
+		View view = MakeView(100, 70, orthographic);
+		std::vector<float> depths = RandomDepths(view, orthographic ? 5 : 4);
+		std::vector<XMFLOAT4> spheres = RandomSpheres(view, 400, orthographic ? 7 : 6);
+
+		TiledLightCulling culling;
+		culling.Cull(depths, view.m_width, view.m_height, view.m_projection._11, view.m_projection._22, orthographic, spheres);
+		CHECK(culling.GetCountX() == 7 && culling.GetCountY() == 5);
+		CHECK(culling.GetTileLights().size() == 35 * TiledLightCulling::TILE_STRIDE);
+
+		size_t reached = 0;
+		bool missed = false;
+		for (uint32_t y = 0; y < view.m_height; y++) {
+			for (uint32_t x = 0; x < view.m_width; x++) {
+				float z = depths[static_cast<size_t>(y) * view.m_width + x];
+				if (z <= 0.0f) continue;
+				XMFLOAT3 p = PixelPosition(view, x, y, z);
+				const uint32_t* tile = Tile(culling, x / TiledLightCulling::TILE_SIZE, y / TiledLightCulling::TILE_SIZE);
+				for (uint32_t light = 0; light < spheres.size(); light++) {
+					const XMFLOAT4& s = spheres[light];
+					float dx = p.x - s.x, dy = p.y - s.y, dz = p.z - s.z;
+					if (dx * dx + dy * dy + dz * dz > s.w * s.w) continue;
+					reached++;
+					missed = missed || !Contains(tile, light);
+				}
+			}
+		}
+		CHECK(reached > 0);
+		CHECK(!missed);
+
+		//the empty column has no depth range, nothing is kept
+		bool emptyColumn = true;
+		for (uint32_t tileY = 0; tileY < culling.GetCountY(); tileY++) emptyColumn = emptyColumn && Tile(culling, 0, tileY)[0] == 0;
+		CHECK(emptyColumn);
+	}
+}
+
+TEST_CASE(SmallLightStaysInItsTile)
+{
+	View view = MakeView(64, 48, false);
+	std::vector<float> depths(static_cast<size_t>(view.m_width) * view.m_height, 10.0f);
+
+	//the center of tile (2, 1) at the depth of every pixel
+	XMFLOAT3 center = PixelPosition(view, 2 * TiledLightCulling::TILE_SIZE + 8, TiledLightCulling::TILE_SIZE + 8, 10.0f);
+	std::vector<XMFLOAT4> spheres = {
+		XMFLOAT4(center.x, center.y, center.z, 0.05f),
+		XMFLOAT4(center.x, center.y, 30.0f, 0.05f), // behind everything drawn
+		XMFLOAT4(center.x, center.y, 2.0f, 0.05f), // in front of everything drawn
+	};
+
+	TiledLightCulling culling;
+	culling.Cull(depths, view.m_width, view.m_height, view.m_projection._11, view.m_projection._22, false, spheres);
+	for (uint32_t tileY = 0; tileY < culling.GetCountY(); tileY++) {
+		for (uint32_t tileX = 0; tileX < culling.GetCountX(); tileX++) {
+			const uint32_t* tile = Tile(culling, tileX, tileY);
+			if (tileX == 2 && tileY == 1) CHECK(tile[0] == 1 && tile[1] == 0);
+			else CHECK(tile[0] == 0);
+		}
+	}
+}
+
+TEST_CASE(TilesStopAtTheListLength)
+{
+	View view = MakeView(32, 16, false);
+	std::vector<float> depths(static_cast<size_t>(view.m_width) * view.m_height, 5.0f);
+	std::vector<XMFLOAT4> spheres(TiledLightCulling::MAX_LIGHTS_PER_TILE + 45, XMFLOAT4(0.0f, 0.0f, 5.0f, 50.0f));
+
+	TiledLightCulling culling;
+	culling.Cull(depths, view.m_width, view.m_height, view.m_projection._11, view.m_projection._22, false, spheres);
+	const uint32_t* tile = Tile(culling, 1, 0);
+	CHECK(tile[0] == TiledLightCulling::MAX_LIGHTS_PER_TILE);
+	CHECK(tile[TiledLightCulling::MAX_LIGHTS_PER_TILE] == TiledLightCulling::MAX_LIGHTS_PER_TILE - 1);
+}
+
+TEST_CASE(DifferentTilesIgnoreOrder)
+{
+	const uint32_t stride = TiledLightCulling::TILE_STRIDE;
+	std::vector<uint32_t> first(3 * stride, 0), second(3 * stride, 0);
+
+	//same set in another order
+	first[0] = 3; first[1] = 4; first[2] = 9; first[3] = 1;
+	second[0] = 3; second[1] = 1; second[2] = 4; second[3] = 9;
+	//same count, different light
+	first[stride] = 1; first[stride + 1] = 2;
+	second[stride] = 1; second[stride + 1] = 3;
+	//different count, slots past the count are ignored
+	first[2 * stride] = 1; first[2 * stride + 1] = 5; first[2 * stride + 2] = 8;
+	second[2 * stride] = 2; second[2 * stride + 1] = 5; second[2 * stride + 2] = 8;
+
+	CHECK(TiledLightCulling::CountDifferentTiles(first.data(), second.data(), 3) == 2);
+	CHECK(TiledLightCulling::CountDifferentTiles(first.data(), second.data(), 1) == 0);
+	CHECK(TiledLightCulling::CountDifferentTiles(first.data(), first.data(), 3) == 0);
+}
@@ -0,0 +1,115 @@
+#include "TiledLightCulling.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+
+float TiledLightCulling::LinearizeDepth(float a_depth, float a_depthScale, float a_depthBias, bool a_orthographic)
+{
+	//depth = z * _33 + _43, divided by z for perspective
+	return a_orthographic
+		? (a_depth - a_depthBias) / a_depthScale
+		: a_depthBias / (a_depth - a_depthScale);
+}
+
+void TiledLightCulling::GetTilePlanes(
+	uint32_t a_tileX, uint32_t a_tileY, uint32_t a_width, uint32_t a_height,
+	float a_projectionX, float a_projectionY, bool a_orthographic,
+	XMFLOAT4 a_planes[4])
+{
+	//tile edges in NDC, the last row and column stop at the screen edge
+	float left = 2.0f * (a_tileX * TILE_SIZE) / a_width - 1.0f;
+	float right = 2.0f * (std::min)((a_tileX + 1) * TILE_SIZE, a_width) / a_width - 1.0f;
+	float top = 1.0f - 2.0f * (a_tileY * TILE_SIZE) / a_height;
+	float bottom = 1.0f - 2.0f * (std::min)((a_tileY + 1) * TILE_SIZE, a_height) / a_height;
+
+	//perspective planes pass through the eye, x * _11 = left * z, orthographic ones are offset, x * _11 = left
+	if (a_orthographic) {
+		a_planes[0] = XMFLOAT4(a_projectionX, 0.0f, 0.0f, -left);
+		a_planes[1] = XMFLOAT4(-a_projectionX, 0.0f, 0.0f, right);
+		a_planes[2] = XMFLOAT4(0.0f, -a_projectionY, 0.0f, top);
+		a_planes[3] = XMFLOAT4(0.0f, a_projectionY, 0.0f, -bottom);
+	}
+	else {
+		a_planes[0] = XMFLOAT4(a_projectionX, 0.0f, -left, 0.0f);
+		a_planes[1] = XMFLOAT4(-a_projectionX, 0.0f, right, 0.0f);
+		a_planes[2] = XMFLOAT4(0.0f, -a_projectionY, top, 0.0f);
+		a_planes[3] = XMFLOAT4(0.0f, a_projectionY, -bottom, 0.0f);
+	}
+
+	for (int i = 0; i < 4; i++) {
+		XMFLOAT4& plane = a_planes[i];
+		float length = std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+		plane = XMFLOAT4(plane.x / length, plane.y / length, plane.z / length, plane.w / length);
+	}
+}
+
+bool TiledLightCulling::SphereIntersectsTile(const XMFLOAT4 a_planes[4], float a_minZ, float a_maxZ, const XMFLOAT4& a_sphere)
+{
+	if (a_sphere.z + a_sphere.w < a_minZ || a_sphere.z - a_sphere.w > a_maxZ) return false;
+	for (int i = 0; i < 4; i++) {
+		const XMFLOAT4& plane = a_planes[i];
+		if (plane.x * a_sphere.x + plane.y * a_sphere.y + plane.z * a_sphere.z + plane.w < -a_sphere.w) return false;
+	}
+	return true;
+}
+
+void TiledLightCulling::Cull(
+	const std::vector<float>& a_viewDepths, uint32_t a_width, uint32_t a_height,
+	float a_projectionX, float a_projectionY, bool a_orthographic,
+	const std::vector<XMFLOAT4>& a_spheres)
+{
+	m_countX = GetTileCount(a_width);
+	m_countY = GetTileCount(a_height);
+	m_tileLights.assign(static_cast<size_t>(GetTileCount()) * TILE_STRIDE, 0);
+
+	for (uint32_t tileY = 0; tileY < m_countY; tileY++) {
+		for (uint32_t tileX = 0; tileX < m_countX; tileX++) {
+			//empty tiles keep min above max so nothing passes
+			float minZ = FLT_MAX;
+			float maxZ = 0.0f;
+			for (uint32_t y = tileY * TILE_SIZE; y < (std::min)((tileY + 1) * TILE_SIZE, a_height); y++) {
+				for (uint32_t x = tileX * TILE_SIZE; x < (std::min)((tileX + 1) * TILE_SIZE, a_width); x++) {
+					float viewZ = a_viewDepths[static_cast<size_t>(y) * a_width + x];
+					if (viewZ <= 0.0f) continue;
+					minZ = (std::min)(minZ, viewZ);
+					maxZ = (std::max)(maxZ, viewZ);
+				}
+			}
+
+			XMFLOAT4 planes[4];
+			GetTilePlanes(tileX, tileY, a_width, a_height, a_projectionX, a_projectionY, a_orthographic, planes);
+
+			uint32_t* tile = m_tileLights.data() + static_cast<size_t>(tileY * m_countX + tileX) * TILE_STRIDE;
+			for (uint32_t i = 0; i < a_spheres.size() && tile[0] < MAX_LIGHTS_PER_TILE; i++) {
+				if (!SphereIntersectsTile(planes, minZ, maxZ, a_spheres[i])) continue;
+				tile[1 + tile[0]] = i;
+				tile[0]++;
+			}
+		}
+	}
+}
+
+size_t TiledLightCulling::CountDifferentTiles(const uint32_t* a_first, const uint32_t* a_second, size_t a_tileCount)
+{
+	size_t different = 0;
+	std::vector<uint32_t> first, second;
+	for (size_t tile = 0; tile < a_tileCount; tile++) {
+		const uint32_t* firstTile = a_first + tile * TILE_STRIDE;
+		const uint32_t* secondTile = a_second + tile * TILE_STRIDE;
+		uint32_t firstCount = (std::min)(firstTile[0], MAX_LIGHTS_PER_TILE);
+		uint32_t secondCount = (std::min)(secondTile[0], MAX_LIGHTS_PER_TILE);
+		if (firstCount != secondCount) {
+			different++;
+			continue;
+		}
+
+		first.assign(firstTile + 1, firstTile + 1 + firstCount);
+		second.assign(secondTile + 1, secondTile + 1 + secondCount);
+		std::sort(first.begin(), first.end());
+		std::sort(second.begin(), second.end());
+		if (first != second) different++;
+	}
+	return different;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+/// <summary>
+/// CPU reference of the tile culling in DeferredLightingCS.hlsl. The screen is
+/// split into TILE_SIZE pixel squares and every tile keeps the point and spot
+/// lights whose range sphere touches the part of the view frustum between its
+/// nearest and farthest pixel. Tile lists use the shader's buffer layout, a
+/// count followed by MAX_LIGHTS_PER_TILE slots, so a GPU readback compares directly.
+/// Knows nothing about D3D, depths and spheres are plain view space values.
+/// </summary>
+class TiledLightCulling
+{
+public:
+	//same as the thread group size and list length of the compute shader
+	static constexpr uint32_t TILE_SIZE = 16;
+	static constexpr uint32_t MAX_LIGHTS_PER_TILE = 255;
+	static constexpr uint32_t TILE_STRIDE = MAX_LIGHTS_PER_TILE + 1;
+
+	static uint32_t GetTileCount(uint32_t a_pixels) { return (a_pixels + TILE_SIZE - 1) / TILE_SIZE; }
+
+	/// <summary>
+	/// View depth of a depth buffer value, a_depthScale and a_depthBias are the
+	/// projection's _33 and _43
+	/// </summary>
+	static float LinearizeDepth(float a_depth, float a_depthScale, float a_depthBias, bool a_orthographic);
+
+	/// <summary>
+	/// The four side planes of a tile in view space, xyz pointing into the tile.
+	/// a_projectionX and a_projectionY are the projection's _11 and _22.
+	/// </summary>
+	static void GetTilePlanes(
+		uint32_t a_tileX, uint32_t a_tileY, uint32_t a_width, uint32_t a_height,
+		float a_projectionX, float a_projectionY, bool a_orthographic,
+		DirectX::XMFLOAT4 a_planes[4]);
+
+	/// <summary>
+	/// Whether a view space sphere (xyz center, w radius) touches the tile between a_minZ and a_maxZ
+	/// </summary>
+	static bool SphereIntersectsTile(const DirectX::XMFLOAT4 a_planes[4], float a_minZ, float a_maxZ, const DirectX::XMFLOAT4& a_sphere);
+
+	/// <summary>
+	/// Culls every tile of a a_width x a_height view. a_viewDepths has one view
+	/// depth per pixel, row by row, with 0 where nothing was drawn. The indices
+	/// written are positions in a_spheres.
+	/// </summary>
+	void Cull(
+		const std::vector<float>& a_viewDepths, uint32_t a_width, uint32_t a_height,
+		float a_projectionX, float a_projectionY, bool a_orthographic,
+		const std::vector<DirectX::XMFLOAT4>& a_spheres);
+
+	uint32_t GetCountX() const { return m_countX; }
+	uint32_t GetCountY() const { return m_countY; }
+	uint32_t GetTileCount() const { return m_countX * m_countY; }
+	const std::vector<uint32_t>& GetTileLights() const { return m_tileLights; }
+
+	/// <summary>
+	/// Tiles whose light sets differ between two buffers in the tile list layout,
+	/// the order inside a tile doesn't matter since the GPU appends in any order
+	/// </summary>
+	static size_t CountDifferentTiles(const uint32_t* a_first, const uint32_t* a_second, size_t a_tileCount);
+
+private:
+	uint32_t m_countX = 0;
+	uint32_t m_countY = 0;
+	std::vector<uint32_t> m_tileLights;
+};
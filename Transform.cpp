@@ -6,9 +6,10 @@ Transform::Transform() : Transform(DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f), DirectX:
 
 Transform::Transform(DirectX::XMFLOAT3 a_startingPosition, DirectX::XMFLOAT4 a_startingOrientation)
 {
-	m_position = a_startingPosition;
+	m_position = Double3(a_startingPosition);
 	m_rotation = a_startingOrientation;
 	m_scale = DirectX::XMFLOAT3(1.0f, 1.0f, 1.0f);
+	SavePreviousState();
 
 	UpdateTransformDirection(m_rotation);
 
@@ -23,15 +24,18 @@ Transform::~Transform()
 
 void Transform::SetPosition(DirectX::XMFLOAT3 a_position)
 {	
-	if (a_position.x == m_position.x &&
-		a_position.y == m_position.y &&
-		a_position.z == m_position.z) {
+	Transform::SetPosition(Double3(a_position));
+}
+
+void Transform::SetPosition(Double3 a_position)
+{
+	if (a_position == m_position) {
 		return;
 	}
 
 	//only update if different, update dirty
 	m_position = a_position;
-	m_matrixDirtied = true;
+	MarkDirty();
 }
 
 void Transform::SetPosition(float a_x, float a_y, float a_z)
@@ -57,7 +61,7 @@ void Transform::SetRotation(DirectX::XMFLOAT4 a_rotation)
 	
 	UpdateTransformDirection(a_rotation);
 
-	m_matrixDirtied = true;
+	MarkDirty();
 }
 
 void Transform::SetRotation(float a_x, float a_y, float a_z, float a_w)
@@ -75,7 +79,7 @@ void Transform::SetScale(DirectX::XMFLOAT3 a_scale)
 
 	//only update if different, update dirty
 	m_scale = a_scale;
-	m_matrixDirtied = true;
+	MarkDirty();
 }
 
 void Transform::SetScale(float a_x, float a_y, float a_z)
@@ -83,7 +87,12 @@ void Transform::SetScale(float a_x, float a_y, float a_z)
 	Transform::SetScale(DirectX::XMFLOAT3(a_x, a_y, a_z));
 }
 
-const DirectX::XMFLOAT3& Transform::GetPosition()
+DirectX::XMFLOAT3 Transform::GetPosition()
+{
+	return m_position.ToFloat3();
+}
+
+const Double3& Transform::GetWorldPosition()
 {
 	return m_position;
 }
@@ -115,12 +124,9 @@ void Transform::MoveAbsolute(DirectX::XMFLOAT3 a_offset)
 	}
 
 	//Only update when offset not zero
-
-	DirectX::XMVECTOR originalPosition = DirectX::XMLoadFloat3(&m_position);
-	DirectX::XMVECTOR newPosition = DirectX::XMVectorAdd(originalPosition, DirectX::XMLoadFloat3(&a_offset));
-
-	DirectX::XMStoreFloat3(&m_position, newPosition);
-	m_matrixDirtied = true;
+	//accumulate in double so small steps aren't lost far from the origin
+	m_position = m_position + Double3(a_offset);
+	MarkDirty();
 }
 
 void Transform::MoveAbsolute(float a_x, float a_y, float a_z)
@@ -143,7 +149,7 @@ void Transform::Rotate(float a_pitch, float a_yaw, float a_roll)
 	DirectX::XMVECTOR forwardVector = DirectX::XMLoadFloat3(&m_forward);
 	forwardVector = DirectX::XMVector3Rotate(forwardVector, rotationOffsetVector);
 	UpdateTransformDirection(m_rotation);
-	m_matrixDirtied = true;
+	MarkDirty();
 }
 
 void Transform::Rotate(DirectX::XMFLOAT4 a_rotationDelta)
@@ -162,7 +168,7 @@ void Transform::Rotate(DirectX::XMFLOAT4 a_rotationDelta)
 
 	DirectX::XMStoreFloat4(&m_rotation, rotationOffsetVector);
 	UpdateTransformDirection(a_rotationDelta);
-	m_matrixDirtied = true;
+	MarkDirty();
 }
 
 void Transform::Scale(DirectX::XMFLOAT3 a_scale)
@@ -176,8 +182,8 @@ void Transform::Scale(DirectX::XMFLOAT3 a_scale)
 	DirectX::XMVECTOR newScale = DirectX::XMLoadFloat3(&a_scale);
 	newScale = DirectX::XMVectorMultiply(originalScale, newScale);
 	
-	DirectX::XMStoreFloat3(&m_position, newScale);
-	m_matrixDirtied = true;
+	DirectX::XMStoreFloat3(&m_scale, newScale);
+	MarkDirty();
 }
 
 void Transform::Scale(float a_x, float a_y, float a_z)
@@ -189,7 +195,8 @@ void Transform::CalculateWorldMatrix()
 {
 	if (!m_matrixDirtied) return;
 
-	DirectX::XMMATRIX translateMatrix = DirectX::XMMatrixTranslation(m_position.x, m_position.y, m_position.z);
+	DirectX::XMFLOAT3 position = m_position.ToFloat3();
+	DirectX::XMMATRIX translateMatrix = DirectX::XMMatrixTranslation(position.x, position.y, position.z);
 	DirectX::XMMATRIX rotationMatrix = DirectX::XMMatrixRotationQuaternion(DirectX::XMLoadFloat4(&m_rotation));
 	DirectX::XMMATRIX scaleMatrix = DirectX::XMMatrixScaling(m_scale.x, m_scale.y, m_scale.z);
 
@@ -202,6 +209,80 @@ void Transform::CalculateWorldMatrix()
 	m_matrixDirtied = false;
 }
 
+DirectX::XMFLOAT4X4 Transform::GetRelativeWorldMatrix(const Double3& a_origin)
+{
+	CalculateWorldMatrix();
+
+	//rotation and scale are origin independent, only the translation row changes
+	DirectX::XMFLOAT4X4 relativeWorld = m_worldMatrix;
+	DirectX::XMFLOAT3 relativePosition = m_position.RelativeTo(a_origin);
+	relativeWorld._41 = relativePosition.x;
+	relativeWorld._42 = relativePosition.y;
+	relativeWorld._43 = relativePosition.z;
+	return relativeWorld;
+}
+
+void Transform::MarkDirty()
+{
+	m_matrixDirtied = true;
+	m_version++;
+}
+
+uint32_t Transform::GetVersion() const
+{
+	return m_version;
+}
+
+void Transform::SavePreviousState()
+{
+	m_previousPosition = m_position;
+	m_previousRotation = m_rotation;
+	m_previousScale = m_scale;
+}
+
+Double3 Transform::GetInterpolatedPosition(float a_alpha)
+{
+	return Double3::Lerp(m_previousPosition, m_position, a_alpha);
+}
+
+void Transform::GetInterpolatedRelativeWorldMatrices(
+	const Double3& a_origin,
+	float a_alpha,
+	DirectX::XMFLOAT4X4& a_worldMatrix,
+	DirectX::XMFLOAT4X4& a_worldInverseTransposeMatrix)
+{
+	bool moved =
+		m_previousPosition != m_position ||
+		m_previousRotation.x != m_rotation.x || m_previousRotation.y != m_rotation.y ||
+		m_previousRotation.z != m_rotation.z || m_previousRotation.w != m_rotation.w ||
+		m_previousScale.x != m_scale.x || m_previousScale.y != m_scale.y || m_previousScale.z != m_scale.z;
+
+	//static objects are the common case, reuse the cached matrices
+	if (!moved) {
+		a_worldMatrix = GetRelativeWorldMatrix(a_origin);
+		a_worldInverseTransposeMatrix = m_worldInverseTransposeMatrix;
+		return;
+	}
+
+	DirectX::XMFLOAT3 position = GetInterpolatedPosition(a_alpha).RelativeTo(a_origin);
+	DirectX::XMVECTOR rotation = DirectX::XMQuaternionSlerp(
+		DirectX::XMLoadFloat4(&m_previousRotation),
+		DirectX::XMLoadFloat4(&m_rotation),
+		a_alpha);
+	DirectX::XMVECTOR scale = DirectX::XMVectorLerp(
+		DirectX::XMLoadFloat3(&m_previousScale),
+		DirectX::XMLoadFloat3(&m_scale),
+		a_alpha);
+
+	DirectX::XMMATRIX world = DirectX::XMMatrixMultiply(
+		DirectX::XMMatrixMultiply(DirectX::XMMatrixScalingFromVector(scale), DirectX::XMMatrixRotationQuaternion(rotation)),
+		DirectX::XMMatrixTranslation(position.x, position.y, position.z));
+
+	DirectX::XMStoreFloat4x4(&a_worldMatrix, world);
+	DirectX::XMStoreFloat4x4(&a_worldInverseTransposeMatrix,
+		DirectX::XMMatrixInverse(0, DirectX::XMMatrixTranspose(world)));
+}
+
 void Transform::MoveRelative(DirectX::XMFLOAT3 a_offset)
 {
 	MoveRelative(a_offset.x, a_offset.y, a_offset.z);
@@ -1,5 +1,7 @@
 #pragma once
 #include <DirectXMath.h>
+#include "Double3.h"
+#include <cstdint>
 class Transform
 {
 public:
@@ -14,17 +16,25 @@ public:
 
 	void SetPosition(float a_x, float a_y, float a_z);
 	void SetPosition(DirectX::XMFLOAT3 a_position);
+	void SetPosition(Double3 a_position);
 	void SetRotation(float a_x, float a_y, float a_z, float a_w);
 	void SetRotation(DirectX::XMFLOAT4 a_rotation);
 	void SetScale(float a_x, float a_y, float a_z);
 	void SetScale(DirectX::XMFLOAT3 a_scale);
 
-	const DirectX::XMFLOAT3& GetPosition();
+	DirectX::XMFLOAT3 GetPosition();
+	const Double3& GetWorldPosition();
 	const DirectX::XMFLOAT4& GetRotation();
 	const DirectX::XMFLOAT3& GetScale();
 	const DirectX::XMFLOAT4X4& GetWorldMatrix();
 	const DirectX::XMFLOAT4X4& GetWorldInverseTransposeMatrix();
 
+	/// <summary>
+	/// World matrix with the translation expressed relative to a_origin,
+	/// keeps the values sent to the GPU small far away from the world origin
+	/// </summary>
+	DirectX::XMFLOAT4X4 GetRelativeWorldMatrix(const Double3& a_origin);
+
 	void MoveAbsolute(float a_x, float a_y, float a_z);
 	void MoveAbsolute(DirectX::XMFLOAT3 a_offset);
 	void Rotate(float a_pitch, float a_yaw, float a_roll);
@@ -34,6 +44,33 @@ public:
 
 	void CalculateWorldMatrix();
 
+	/// <summary>
+	/// Bumped on every change, lets caches notice a transform moved
+	/// even after the matrix has been recalculated
+	/// </summary>
+	uint32_t GetVersion() const;
+
+	/// <summary>
+	/// Remembers the current state as the previous simulation tick,
+	/// call at the start of every fixed step before anything moves
+	/// </summary>
+	void SavePreviousState();
+
+	/// <summary>
+	/// Position blended between the previous tick and the current one
+	/// </summary>
+	Double3 GetInterpolatedPosition(float a_alpha);
+
+	/// <summary>
+	/// Relative world and inverse transpose matrices blended between the previous
+	/// tick and the current one, falls back to the cached matrices when nothing moved
+	/// </summary>
+	void GetInterpolatedRelativeWorldMatrices(
+		const Double3& a_origin,
+		float a_alpha,
+		DirectX::XMFLOAT4X4& a_worldMatrix,
+		DirectX::XMFLOAT4X4& a_worldInverseTransposeMatrix);
+
 	//Cameras
 	void MoveRelative(float a_x, float a_y, float a_z);
 	void MoveRelative(DirectX::XMFLOAT3 a_offset);
@@ -50,14 +87,22 @@ private:
 	DirectX::XMFLOAT4X4 m_worldMatrix;
 	DirectX::XMFLOAT4X4 m_worldInverseTransposeMatrix;
 
-	DirectX::XMFLOAT3 m_position;
+	Double3 m_position;
 	DirectX::XMFLOAT4 m_rotation;
 	DirectX::XMFLOAT3 m_scale;
+	uint32_t m_version = 0;
+
+	//state at the previous simulation tick, used for interpolation
+	Double3 m_previousPosition;
+	DirectX::XMFLOAT4 m_previousRotation;
+	DirectX::XMFLOAT3 m_previousScale;
 
 	/// <summary>
 	/// Updates transform forward/right/up
 	/// </summary>
 	/// <param name="a_rotationDelta">Rotation offset (from original rotation</param>
 	void UpdateTransformDirection(DirectX::XMFLOAT4 a_rotationDelta);
+
+	void MarkDirty();
 };
 
@@ -1,12 +1,23 @@
 #include "ShaderIncludes.hlsli"
 
-// Constant buffer for shader
+// Per object constant buffer, world * view * projection is combined on the CPU
 cbuffer BufferStruct : register (b0)
 {
+    matrix worldViewProjection;
     matrix world;
-    matrix projection;
-    matrix view;
     matrix worldInverseTranspose;
+    uint irradianceIndex;
+    float3 objectPadding;
+};
+
+// Per frame constant buffer, bound once before any entity is drawn
+cbuffer PerFrame : register(b1)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float3 frameCameraPosition;
+    uint frameLightCount;
 };
 
 // Struct representing a single vertex worth of data
@@ -48,13 +59,15 @@ VertexToPixel main( VertexShaderInput input )
 	// - Each of these components is then automatically divided by the W component, 
 	//   which we're leaving at 1.0 for now (this is more useful when dealing with 
 	//   a perspective projection matrix, which we'll get to in the future).
-    matrix wvp = mul(projection, mul(view, world));
-    output.screenPosition = mul(wvp, float4(input.localPosition, 1.0f));
+    // precise, DepthOnlyVS.hlsl has to come out bit for bit the same for the depth pre-pass
+    precise float4 screenPosition = mul(worldViewProjection, float4(input.localPosition, 1.0f));
+    output.screenPosition = screenPosition;
 
     output.uv = input.uv;
     output.normal = mul((float3x3) worldInverseTranspose, input.normal);
     output.worldPosition = mul(world, float4(input.localPosition, 1)).xyz;
     output.tangent = mul((float3x3) world, input.tangent);
+    output.irradianceIndex = irradianceIndex;
     //output.tangent = input.tangent;
 	// Pass the color through 
 	// - The values will be interpolated per-pixel by the rasterizer
@@ -0,0 +1,63 @@
+#include "ShaderIncludes.hlsli"
+
+// Per draw constant buffer, where this batch starts in the instance buffer
+// - SV_InstanceID always starts at 0, StartInstanceLocation doesn't offset it
+cbuffer InstanceBatch : register(b0)
+{
+    uint firstInstance;
+    float3 batchPadding;
+};
+
+// Per frame constant buffer, same layout as VertexShader.hlsl
+cbuffer PerFrame : register(b1)
+{
+    matrix view;
+    matrix projection;
+    matrix viewProjection;
+    float3 frameCameraPosition;
+    uint frameLightCount;
+};
+
+// Per instance matrices for every instanced entity drawn this frame
+struct InstanceData
+{
+    matrix world;
+    matrix worldInverseTranspose;
+    uint irradianceIndex;
+    float3 padding;
+};
+
+StructuredBuffer<InstanceData> instances : register(t0);
+
+// Same vertex layout as VertexShader.hlsl so both share one input layout
+struct VertexShaderInput
+{
+    float3 localPosition	: POSITION;
+    float2 uv				: TEXCOORD;
+    float3 normal			: NORMAL;
+    float3 tangent			: TANGENT;
+};
+
+// --------------------------------------------------------
+// Instanced variant of VertexShader.hlsl
+// - world matrices come from the structured buffer instead of b0
+// - world * viewProjection is done here rather than on the CPU
+// --------------------------------------------------------
+VertexToPixel main(VertexShaderInput input, uint instanceId : SV_InstanceID)
+{
+    InstanceData instance = instances[firstInstance + instanceId];
+
+    VertexToPixel output;
+
+    // precise, DepthOnlyVSInstanced.hlsl has to come out bit for bit the same for the depth pre-pass
+    precise float4 worldPosition = mul(instance.world, float4(input.localPosition, 1.0f));
+    precise float4 screenPosition = mul(viewProjection, worldPosition);
+    output.screenPosition = screenPosition;
+
+    output.uv = input.uv;
+    output.normal = mul((float3x3) instance.worldInverseTranspose, input.normal);
+    output.worldPosition = worldPosition.xyz;
+    output.tangent = mul((float3x3) instance.world, input.tangent);
+    output.irradianceIndex = instance.irradianceIndex;
+    return output;
+}